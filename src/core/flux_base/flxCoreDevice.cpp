@@ -12,6 +12,7 @@
  */
 
 #include "flxCoreDevice.h"
+#include "flxClock.h"
 #include "flxFlux.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -32,6 +33,33 @@ bool flxDevice::initialize()
     return true;
 }
 
+//----------------------------------------------------------------
+// Sample acquisition - read the device sample for an observation. The sample is current until
+// executeComplete() is called. The sample time is taken as the read starts.
+
+bool flxDevice::acquire(void)
+{
+    _sampleTime = flxClock.timestamp();
+    _sampleCurrent = onAcquire();
+    _sampleAcquired = true;
+
+    return _sampleCurrent;
+}
+
+//----------------------------------------------------------------
+// Called by output parameter getters. In an observation, the sample read by acquire() is used - if
+// that read failed, it isn't retried for each getter. Outside of an observation, read a sample.
+
+bool flxDevice::sampleReady(void)
+{
+    if (_sampleAcquired)
+        return _sampleCurrent;
+
+    _sampleTime = flxClock.timestamp();
+    return onAcquire();
+}
+
+//----------------------------------------------------------------
 // Input param/function methods to enable/disable all parameters
 void flxDevice::disable_all_parameters(void)
 {
@@ -28,6 +28,7 @@
 
 #include "flxBusI2C.h"
 #include "flxBusSPI.h"
+#include "flxTimebase.h"
 #include "flxCore.h"
 #include "flxUtils.h"
 
@@ -155,7 +156,8 @@ class flxDevice : public flxOperation
     void enable_all_parameters(void);
 
   public:
-    flxDevice() : _autoload{false}, _address{kSparkDeviceAddressNull}, _isInitalized{false}
+    flxDevice() : _autoload{false}, _address{kSparkDeviceAddressNull}, _isInitalized{false}, _sampleCurrent{false},
+                    _sampleAcquired{false}, _sampleTime{0}
     {
         flxRegister(disableAllParameters, "Disable All Parameters", "Disables all output parameters");
         flxRegister(enableAllParameters, "Enable All Parameters", "Enable all output parameters");
@@ -165,10 +167,33 @@ class flxDevice : public flxOperation
     {
     }
 
-    // override our operation class
+    // override our operation class - the logger calls execute() once per observation, before the
+    // output parameters are read, and executeComplete() after.
     virtual bool execute(void)
     {
-        return true;
+        return acquire();
+    }
+    virtual void executeComplete(void)
+    {
+        _sampleCurrent = false;
+        _sampleAcquired = false;
+    }
+
+    // Sample acquisition.
+    //
+    // A device that returns several values from one bus read (multi-axis sensors, GNSS) overrides
+    // onAcquire() and reads all its values into a device owned sample, in one transaction. The output
+    // parameter getters call sampleReady() and return values from the sample - so the values of an
+    // observation are read together and are time coherent.
+    //
+    // acquire() reads the sample used for an observation - once, even if the read fails. Outside of an
+    // observation, sampleReady() reads a new sample for each call.
+    bool acquire(void);
+
+    // Time the last sample was read - microseconds since the epoch, from the flxClock timebase
+    flxTimestamp_t sampleTime(void)
+    {
+        return _sampleTime;
     }
 
     // Methods called on initialize
@@ -224,10 +249,23 @@ class flxDevice : public flxOperation
     flxParameterInVoid<flxDevice, &flxDevice::disable_all_parameters> disableAllParameters;
     flxParameterInVoid<flxDevice, &flxDevice::enable_all_parameters> enableAllParameters;
 
+  protected:
+    // Read the device sample - overridden by devices that read their values as a sample
+    virtual bool onAcquire(void)
+    {
+        return true;
+    }
+
+    // For output parameter getters - true if the sample holds current values. False if the read failed.
+    bool sampleReady(void);
+
   private:
     bool _autoload;
     uint8_t _address;
     bool _isInitalized;
+    bool _sampleCurrent;
+    bool _sampleAcquired;
+    flxTimestamp_t _sampleTime;
 };
 
 using flxDeviceContainer = flxContainer<flxDevice *>;
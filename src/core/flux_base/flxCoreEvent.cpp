@@ -9,8 +9,11 @@
 
 #include "flxCoreEvent.h"
 
+#include "flxCoreJobs.h"
 #include "flxFlux.h"
 
+#include <algorithm>
+
 // Declare the storage for the singleton
 _flxEventHub &flxEventHub = _flxEventHub::get();
 
@@ -20,4 +23,67 @@ _flxEventHub &flxEventHub = _flxEventHub::get();
 void flxSendEvent(flxEvent::flxEventID_t id)
 {
     flxEventHub.sendEvent(id);
-}
\ No newline at end of file
+}
+
+//---------------------------------------------------------------
+// Implementation of the flxPostEvent() function
+//
+bool flxPostEvent(flxEvent::flxEventID_t id)
+{
+    return flxEventHub.postEvent(id);
+}
+
+//---------------------------------------------------------------
+// Event signal lookup - binary search of the sorted signal array
+//
+flxSignalBase *_flxEventHub::findSignal(uint32_t id)
+{
+    auto it = std::lower_bound(_eventSignals.begin(), _eventSignals.end(), id,
+                               [](const flxEventSignal_t &entry, uint32_t value) { return entry.id < value; });
+
+    return it != _eventSignals.end() && it->id == id ? it->signal : nullptr;
+}
+
+//---------------------------------------------------------------
+void _flxEventHub::addSignal(uint32_t id, flxSignalBase *theSignal)
+{
+    auto it = std::lower_bound(_eventSignals.begin(), _eventSignals.end(), id,
+                               [](const flxEventSignal_t &entry, uint32_t value) { return entry.id < value; });
+
+    _eventSignals.insert(it, {id, theSignal});
+}
+
+//---------------------------------------------------------------
+// Add a record to the posted event queue. Any idle sleep of the main loop is ended, so the event is
+// dispatched promptly.
+//
+bool _flxEventHub::post(const flxEventRecord_t &theRecord)
+{
+    if (!_eventQueue.push(theRecord))
+        return false;
+
+    flxJobQueue.wake();
+
+    return true;
+}
+
+//---------------------------------------------------------------
+// Dispatch posted events. Events posted by the callbacks run here are limited to one pass of the
+// queue, so this always returns.
+//
+bool _flxEventHub::dispatchEvents(void)
+{
+    flxEventRecord_t theRecord;
+    uint32_t nEvents = 0;
+
+    while (nEvents < _eventQueue.size() && _eventQueue.pop(theRecord))
+    {
+        nEvents++;
+
+        flxSignalBase *theSignal = findSignal(theRecord.id);
+        if (theSignal)
+            theRecord.dispatch(theSignal, theRecord.payload);
+    }
+
+    return nEvents > 0;
+}
@@ -9,97 +9,13 @@
 #pragma once
 
 #include "flxCoreEventID.h"
+#include "flxCoreEventQueue.h"
 #include "flxCoreLog.h"
+#include "flxCoreSignal.h"
 #include "flxCoreTypes.h"
 
-#include <functional>
+#include <type_traits>
 #include <vector>
-// spEvent.h
-//
-// Define the concept of signals/slots to enable events within the framework
-//-----------------------------------------------------------------------
-// 5/20 - Impl based on https://schneegans.github.io/tutorials/2015/09/20/signal-slot
-// flxSignals - sort of  - support for our simple observer pattern for events
-//
-//
-class flxSignalBase
-{
-    // empty base class
-};
-
-template <typename TB, typename... ArgT> class flxSignal : public flxSignalBase
-{
-
-  public:
-    // connects a member function to this flxSignal
-    template <typename T> void call(T *inst, void (T::*func)(ArgT...))
-    {
-        connect([=](ArgT... args) { // uses a lambda for the callback
-            (inst->*func)(args...);
-        });
-    }
-
-    // connects a const member function to this flxSignal
-    template <typename T> void call(T *inst, void (T::*func)(ArgT...) const)
-    {
-        connect([=](ArgT... args) { // users a lambda for the callback
-            (inst->*func)(args...);
-        });
-    }
-
-    // Just call a user supplied function - no object
-    void call(void (*func)(ArgT...))
-    {
-        connect([=](ArgT... args) { // users a lambda for the callback
-            (*func)(args...);
-        });
-    }
-    // Just call a user supplied function - no object - but with a User Defined value
-    template <typename T> void call(void (*func)(T uval, ArgT...), T uValue)
-    {
-        connect([=](ArgT... args) { // users a lambda for the callback
-            (*func)(uValue, args...);
-        });
-    }
-
-    template <typename T, typename U> void call(T *inst, void (T::*func)(U uVal, ArgT...), U uValue)
-    {
-        connect([=](ArgT... args) { // users a lambda for the callback
-            (inst->*func)(uValue, args...);
-        });
-    }
-    // connects a std::function to the flxSignal.
-    void connect(std::function<void(ArgT &...Values)> const &slot) const
-    {
-        slots_.push_back(slot);
-    }
-
-    // calls all connected functions
-    void emit(ArgT... args)
-    {
-        for (auto const &it : slots_)
-        {
-            it(args...);
-        }
-    }
-
-    typedef TB value_type;
-
-  private:
-    mutable std::vector<std::function<void(ArgT &...Values)>> slots_;
-};
-
-typedef flxSignal<bool, bool> flxSignalBool;
-typedef flxSignal<int8_t, int8_t> flxSignalInt8;
-typedef flxSignal<int16_t, int16_t> flxSignalInt16;
-typedef flxSignal<int32_t, int32_t> flxSignalInt32;
-typedef flxSignal<uint8_t, uint8_t> flxSignalUInt8;
-typedef flxSignal<uint16_t, uint16_t> flxSignalUInt16;
-typedef flxSignal<uint32_t, uint32_t> flxSignalUInt32;
-typedef flxSignal<float, float> flxSignalFloat;
-typedef flxSignal<double, double> flxSignalDouble;
-typedef flxSignal<const char *, const char *> flxSignalString;
-typedef flxSignal<void> flxSignalVoid;
 
 ///////////////////////////////////////////////////////////////////////////////////////
 //
@@ -112,20 +28,46 @@ typedef flxSignal<void> flxSignalVoid;
 //
 //    The event hub decouples the source from the sink of the event model. Events are posted, and if someone is
 //    interested in it, they event is sent to a registered callback. In practice, the hub automatically creates the
-//    above signal objects and maps them to an ID. This ID is used to register callbacks and post messages. The event
+//    signal objects (flxSignal - see flxCoreSignal.h) and maps them to an ID. This ID is used to register callbacks and post messages. The event
 //    source and sink don't know about each other, but they use the same event ID to pass information via the Event Hub.
 //
 // Implementation:
-//    The event hub is singleton that is built around a std::map. The event ID is mapped to an event signal object
-//    (one of the above). When an event is registered, the provided callback is passed to the signal object. If
-//    a signal object doesn't exist for the provided event ID, one is created.
+//    The event hub is singleton that is built around a flat array of (event ID, signal) pairs, sorted by ID. The event
+//    ID is mapped to an event signal object (one of the above). When an event is registered, the provided callback is
+//    passed to the signal object. If a signal object doesn't exist for the provided event ID, one is created.
 //
-//    When an event is *sent*, the event signal object is retrieved from the map, and the emit() method  called.
+//    When an event is *sent*, the event signal object is found (binary search), and the emit() method called - the
+//    callbacks run on the caller's stack, before sendEvent() returns.
+//
+//    Deferred events:
+//    When an event is *posted*, an (event ID, value) record is added to a fixed size, lock-free queue, and the
+//    callbacks are run later, from the main loop - flxFlux::loop() calls dispatchEvents(). Posting is safe from an
+//    interrupt handler or another core/task, doesn't run callbacks in the middle of the posting code (logging for
+//    example) and doesn't allocate. If the queue is full, the event is dropped and counted.
+//
+//    Posted values are copied - so they must be small (<= kEventPayloadSize bytes) trivially copyable values. A
+//    posted pointer (a string) must still be valid when the event is dispatched.
 //
 // Potential Issues:
 //    Type matching of the event callback parameters might cause an issue. But since everything is tightly controlled
 //    at this point in the implementation, this is not a major concern.
 //
+
+// Size of the deferred event queue - a power of 2
+#ifndef kEventQueueSize
+#define kEventQueueSize 32
+#endif
+
+#define kEventPayloadSize 8
+
+// A deferred event - dispatch is the function that emits the payload, with its type, on the event signal
+typedef struct
+{
+    uint32_t id;
+    void (*dispatch)(flxSignalBase *, const void *);
+    uint8_t payload[kEventPayloadSize];
+} flxEventRecord_t;
+
 class _flxEventHub
 {
   public:
@@ -149,11 +91,9 @@ class _flxEventHub
     {
         // do we have this event already registered
 
-        flxSignal<TP, TP> *theSignal = nullptr;
+        flxSignal<TP, TP> *theSignal = reinterpret_cast<flxSignal<TP, TP> *>(findSignal(id()));
 
-        auto mpSig = _eventSignals.find(id());
-
-        if (mpSig == _eventSignals.end())
+        if (!theSignal)
         {
             // not setup, create it
             theSignal = new flxSignal<TP, TP>;
@@ -162,10 +102,8 @@ class _flxEventHub
                 flxLogM_E(kMsgErrAllocErrorN, "Event Hub", "callback");
                 return;
             }
-            _eventSignals[id()] = theSignal;
+            addSignal(id(), theSignal);
         }
-        else
-            theSignal = reinterpret_cast<flxSignal<TP, TP> *>(mpSig->second); // exists
 
         theSignal->call(inst, func);
     }
@@ -177,11 +115,9 @@ class _flxEventHub
     {
         // do we have this event already registered
 
-        flxSignal<void> *theSignal = nullptr;
-
-        auto mpSig = _eventSignals.find(id());
+        flxSignal<void> *theSignal = reinterpret_cast<flxSignal<void> *>(findSignal(id()));
 
-        if (mpSig == _eventSignals.end())
+        if (!theSignal)
         {
             // not setup, create it
             theSignal = new flxSignal<void>;
@@ -190,29 +126,41 @@ class _flxEventHub
                 flxLogM_E(kMsgErrAllocErrorN, "Event Hub", "callback");
                 return;
             }
-            _eventSignals[id()] = theSignal;
+            addSignal(id(), theSignal);
         }
-        else
-            theSignal = reinterpret_cast<flxSignal<void> *>(mpSig->second); // exists
 
         theSignal->call(inst, func);
     }
 
+    //----------------------------------------------------------------------------------------------------
+    // Disconnects a member function from an Event ID. Returns true if the callback was registered.
+    //
+    template <typename T, typename TP>
+    bool unregisterEventCallback(flxEvent::flxEventID_t id, T *inst, void (T::*func)(TP var))
+    {
+        flxSignalBase *theSignal = findSignal(id());
+
+        return theSignal ? reinterpret_cast<flxSignal<TP, TP> *>(theSignal)->disconnect(inst, func) : false;
+    }
+
+    template <typename T> bool unregisterEventCallback(flxEvent::flxEventID_t id, T *inst, void (T::*func)(void))
+    {
+        flxSignalBase *theSignal = findSignal(id());
+
+        return theSignal ? reinterpret_cast<flxSignal<void> *>(theSignal)->disconnect(inst, func) : false;
+    }
+
     //----------------------------------------------------------------------------------------------------
     // Send and event with the given value.
     //
     template <typename T> void sendEvent(flxEvent::flxEventID_t id, T value)
     {
         // does this event exist/registered?
-        auto mpSig = _eventSignals.find(id());
+        flxSignalBase *theSignal = findSignal(id());
 
-        if (mpSig == _eventSignals.end())
-        {
-            // no event, no need to continue - just eat this
-            return;
-        }
-
-        reinterpret_cast<flxSignal<T, T> *>(mpSig->second)->emit(value);
+        // no event, no need to continue - just eat this
+        if (theSignal)
+            reinterpret_cast<flxSignal<T, T> *>(theSignal)->emit(value);
     }
     //----------------------------------------------------------------------------------------------------
     // Send a void event
@@ -220,22 +168,93 @@ class _flxEventHub
     void sendEvent(flxEvent::flxEventID_t id)
     {
         // does this event exist/registered?
-        auto mpSig = _eventSignals.find(id());
+        flxSignalBase *theSignal = findSignal(id());
 
-        if (mpSig == _eventSignals.end())
-        {
-            // no event, no need to continue - just eat this
-            return;
-        }
+        // no event, no need to continue - just eat this
+        if (theSignal)
+            reinterpret_cast<flxSignal<void> *>(theSignal)->emit();
+    }
+
+    //----------------------------------------------------------------------------------------------------
+    // Post an event with the given value - dispatched from the main loop. Safe to call from an interrupt
+    // handler or another core. Returns false if the event queue is full.
+    //
+    template <typename T> bool postEvent(flxEvent::flxEventID_t id, T value)
+    {
+        static_assert(sizeof(T) <= kEventPayloadSize && std::is_trivially_copyable<T>::value,
+                      "Posted event values must be small, trivially copyable types");
+
+        flxEventRecord_t theRecord;
+        theRecord.id = id();
+        theRecord.dispatch = dispatchValue<T>;
+        memcpy(theRecord.payload, &value, sizeof(T));
 
-        reinterpret_cast<flxSignal<void> *>(mpSig->second)->emit();
+        return post(theRecord);
+    }
+
+    //----------------------------------------------------------------------------------------------------
+    // Post a void event
+    //
+    bool postEvent(flxEvent::flxEventID_t id)
+    {
+        flxEventRecord_t theRecord;
+        theRecord.id = id();
+        theRecord.dispatch = dispatchVoid;
+
+        return post(theRecord);
+    }
+
+    // Run the callbacks of posted events - called from the main loop. Returns true if an event was dispatched
+    bool dispatchEvents(void);
+
+    // Posted events dropped because the queue was full
+    uint32_t queueOverflows(void)
+    {
+        return _eventQueue.overflows();
+    }
+
+    // Most posted events waiting in the queue
+    uint32_t queueHighWater(void)
+    {
+        return _eventQueue.highWater();
+    }
+
+    void resetQueueStats(void)
+    {
+        _eventQueue.resetStats();
     }
 
   private:
     _flxEventHub() {};
 
-    // map event ID to event signal
-    std::map<uint32_t, flxSignalBase *> _eventSignals;
+    bool post(const flxEventRecord_t &theRecord);
+
+    flxSignalBase *findSignal(uint32_t id);
+    void addSignal(uint32_t id, flxSignalBase *theSignal);
+
+    template <typename T> static void dispatchValue(flxSignalBase *theSignal, const void *payload)
+    {
+        T value;
+        memcpy(&value, payload, sizeof(T));
+        reinterpret_cast<flxSignal<T, T> *>(theSignal)->emit(value);
+    }
+
+    static void dispatchVoid(flxSignalBase *theSignal, const void *)
+    {
+        reinterpret_cast<flxSignal<void> *>(theSignal)->emit();
+    }
+
+    // event ID to event signal - sorted by ID
+    typedef struct
+    {
+        uint32_t id;
+        flxSignalBase *signal;
+    } flxEventSignal_t;
+
+    std::vector<flxEventSignal_t> _eventSignals;
+
+    // posted (deferred) events
+    flxEventRing<flxEventRecord_t, kEventQueueSize> _eventQueue;
 };
 //
 extern _flxEventHub &flxEventHub;
@@ -254,6 +273,20 @@ template <typename T> void flxRegisterEventCB(flxEvent::flxEventID_t id, T *inst
 {
     flxEventHub.registerEventCallback(id, inst, func);
 }
+//----------------------------------------------------------------------------------------------------
+// User exposed convenience functions to unregister a callback
+//
+template <typename T, typename TP>
+bool flxUnregisterEventCB(flxEvent::flxEventID_t id, T *inst, void (T::*func)(TP var))
+{
+    return flxEventHub.unregisterEventCallback(id, inst, func);
+}
+
+template <typename T> bool flxUnregisterEventCB(flxEvent::flxEventID_t id, T *inst, void (T::*func)(void))
+{
+    return flxEventHub.unregisterEventCallback(id, inst, func);
+}
+
 //----------------------------------------------------------------------------------------------------
 // User exposed convenience function to send a void /empty event
 //
@@ -266,3 +299,17 @@ template <typename T> void flxSendEvent(flxEvent::flxEventID_t id, T value)
 {
     flxEventHub.sendEvent(id, value);
 }
+
+//----------------------------------------------------------------------------------------------------
+// User exposed convenience function to post a void /empty event - the event is dispatched from the main
+// loop. Safe to call from an interrupt handler or another core.
+//
+bool flxPostEvent(flxEvent::flxEventID_t id);
+
+//----------------------------------------------------------------------------------------------------
+// User exposed convenience function to post an event that takes a value
+//
+template <typename T> bool flxPostEvent(flxEvent::flxEventID_t id, T value)
+{
+    return flxEventHub.postEvent(id, value);
+}
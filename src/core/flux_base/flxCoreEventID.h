@@ -78,3 +78,7 @@ flxDefineEventID(kOnSystemActivityLow);
 
 // System needs a restart/reboot
 flxDefineEventID(kSystemNeedsRestart);
+
+// The system is about to restart/reset - sent by flxSystem before the device restarts
+flxDefineEventID(kOnSystemRestart);
+flxDefineEventID(kOnSystemReset);
@@ -0,0 +1,150 @@
+/*
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// flxCoreEventQueue.h
+//
+// A fixed size, lock-free, multi-producer / single-consumer ring of records. Used by the event hub to
+// defer events - posted from anywhere (interrupt handlers, another core/task), and drained from the
+// main loop.
+//
+// Implementation:
+//    Bounded queue with a sequence number per slot (D. Vyukov). A producer claims a slot by advancing
+//    the head with a compare-exchange, copies the record in, then publishes it by setting the slot
+//    sequence. The consumer reads published slots in order.
+//
+//    - Posting never blocks or waits on another producer. If the ring is full, the record is dropped and
+//      the overflow counter incremented.
+//    - A producer interrupted between claiming and publishing a slot (by an ISR that also posts) only
+//      delays the consumer - the drain stops at the unpublished slot and picks it up on the next pass.
+//    - Only one consumer - pop() is called from the main loop.
+//
+// This header has no framework dependencies, so it can be built and tested on a host.
+//
+// The ring size must be a power of 2.
+
+template <typename T, uint32_t N> class flxEventRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "flxEventRing size must be a power of 2");
+
+  public:
+    flxEventRing() : _head{0}, _tail{0}, _overflows{0}, _highWater{0}
+    {
+        for (uint32_t i = 0; i < N; i++)
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    //----------------------------------------------------------------------------------------------------
+    // Add a record - safe from any context. Returns false if the ring is full (the record is dropped).
+    //
+    bool push(const T &record)
+    {
+        uint32_t pos = _head.load(std::memory_order_relaxed);
+        Slot *slot;
+
+        for (;;)
+        {
+            slot = &_slots[pos & (N - 1)];
+            int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+
+            if (diff == 0)
+            {
+                // slot is free - claim it
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // full
+                _overflows.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+                pos = _head.load(std::memory_order_relaxed);
+        }
+
+        slot->record = record;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        // track the high water mark - the depth seen by this producer
+        uint32_t depth = pos + 1 - _tail.load(std::memory_order_relaxed);
+        uint32_t high = _highWater.load(std::memory_order_relaxed);
+        while (depth > high && !_highWater.compare_exchange_weak(high, depth, std::memory_order_relaxed))
+            ;
+
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------------
+    // Remove the next record - single consumer only. Returns false if nothing is ready.
+    //
+    bool pop(T &record)
+    {
+        uint32_t pos = _tail.load(std::memory_order_relaxed);
+        Slot *slot = &_slots[pos & (N - 1)];
+
+        if ((int32_t)(slot->sequence.load(std::memory_order_acquire) - (pos + 1)) < 0)
+            return false;
+
+        record = slot->record;
+
+        // hand the slot back to the producers - one lap on
+        slot->sequence.store(pos + N, std::memory_order_release);
+        _tail.store(pos + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    bool empty(void)
+    {
+        uint32_t pos = _tail.load(std::memory_order_relaxed);
+        return (int32_t)(_slots[pos & (N - 1)].sequence.load(std::memory_order_acquire) - (pos + 1)) < 0;
+    }
+
+    // Number of records dropped because the ring was full
+    uint32_t overflows(void)
+    {
+        return _overflows.load(std::memory_order_relaxed);
+    }
+
+    // Most records waiting in the ring
+    uint32_t highWater(void)
+    {
+        return _highWater.load(std::memory_order_relaxed);
+    }
+
+    void resetStats(void)
+    {
+        _overflows.store(0, std::memory_order_relaxed);
+        _highWater.store(0, std::memory_order_relaxed);
+    }
+
+    static constexpr uint32_t size(void)
+    {
+        return N;
+    }
+
+  private:
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;
+        T record;
+    };
+
+    Slot _slots[N];
+
+    std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _tail;
+
+    std::atomic<uint32_t> _overflows;
+    std::atomic<uint32_t> _highWater;
+};
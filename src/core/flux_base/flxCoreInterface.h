@@ -76,6 +76,23 @@ class flxWriter
     {
         write(value.c_str(), true);
     };
+
+    // Can this writer take a single line of output across several write() calls - newline
+    // is false for all but the last piece? Message based writers (IoT) treat each write()
+    // as a complete message, so they return false.
+    virtual bool acceptsPartialLines(void)
+    {
+        return false;
+    }
+
+    // Binary output. Writers that can store raw bytes (files) override these - each call
+    // is a complete block of data.
+    virtual bool acceptsBinary(void)
+    {
+        return false;
+    }
+    virtual void writeBytes(const uint8_t *data, size_t length, flxLineType_t type) {};
+
     // Color testing
     virtual bool colorEnabled(void)
     {
@@ -59,6 +59,7 @@
 
 #include "flxCoreJobs.h"
 #include <Arduino.h>
+#include <algorithm>
 #include <vector>
 
 //------------------------------------------------------------------
@@ -66,11 +67,128 @@
 
 _flxJobQueue &flxJobQueue = _flxJobQueue::get();
 
+//------------------------------------------------------------------
+// Initial capacity of each priority queue - this is grown as needed when jobs are added, but
+// by reserving space up front, normal operation doesn't allocate memory.
+#define kJobQueueInitialSize 16
+
+// When idle, the queue sleeps in slices of this length (ms) so a wake() request is serviced
+#define kJobQueueIdleSlice 10
+
+// Default time budget (ms) for background jobs per loop pass
+#define kJobQueueBackgroundBudget 20
+
 //------------------------------------------------------------------
 // overall job queue object
 //
-_flxJobQueue::_flxJobQueue() : _running{false}
+_flxJobQueue::_flxJobQueue()
+    : _running{false}, _wakeRequested{false}, _idleStats{0, 0, 0, 0}, _backgroundBudget{kJobQueueBackgroundBudget},
+      _backgroundDeferrals{0}
+{
+    for (int i = 0; i < flxJobPriorityCount; i++)
+        _jobQueue[i].reserve(kJobQueueInitialSize);
+}
+
+//------------------------------------------------------------------
+// Heap operations
+//
+// Each priority level of the queue is a binary min-heap stored in a vector, ordered by
+// job deadline. Each job records its index in the heap, so it can be located without a search.
+//
+//   - Add, remove and update are O(log n)
+//   - Access to the next job to dispatch is O(1)
+//   - Once the vector capacity is established, no memory is allocated
+//
+//------------------------------------------------------------------
+// place a job in a heap slot, updating the jobs index
+//
+void _flxJobQueue::heapPlace(std::vector<flxJob *> &queue, flxJob *theJob, int32_t index)
+{
+    queue[index] = theJob;
+    theJob->_queueIndex = index;
+}
+//------------------------------------------------------------------
+// move a job up the heap until it's parent has an earlier deadline
+//
+void _flxJobQueue::heapSiftUp(std::vector<flxJob *> &queue, int32_t index)
+{
+    flxJob *theJob = queue[index];
+    int32_t parent;
+
+    while (index > 0)
+    {
+        parent = (index - 1) / 2;
+
+        if (!isBefore(theJob->_tDeadline, queue[parent]->_tDeadline))
+            break;
+
+        heapPlace(queue, queue[parent], index);
+        index = parent;
+    }
+    heapPlace(queue, theJob, index);
+}
+//------------------------------------------------------------------
+// move a job down the heap until it's children have later deadlines
+//
+void _flxJobQueue::heapSiftDown(std::vector<flxJob *> &queue, int32_t index)
+{
+    flxJob *theJob = queue[index];
+    int32_t count = queue.size();
+    int32_t child;
+
+    while (true)
+    {
+        child = 2 * index + 1;
+        if (child >= count)
+            break;
+
+        // pick the child with the earliest deadline
+        if (child + 1 < count && isBefore(queue[child + 1]->_tDeadline, queue[child]->_tDeadline))
+            child++;
+
+        if (!isBefore(queue[child]->_tDeadline, theJob->_tDeadline))
+            break;
+
+        heapPlace(queue, queue[child], index);
+        index = child;
+    }
+    heapPlace(queue, theJob, index);
+}
+//------------------------------------------------------------------
+// add a job to the heap of its priority - the job deadline is set
+//
+void _flxJobQueue::heapInsert(flxJob *theJob)
 {
+    theJob->_queuePriority = theJob->priority();
+
+    std::vector<flxJob *> &queue = _jobQueue[theJob->_queuePriority];
+
+    queue.push_back(theJob);
+    heapSiftUp(queue, queue.size() - 1);
+}
+//------------------------------------------------------------------
+// remove a job from the heap
+//
+void _flxJobQueue::heapRemove(flxJob *theJob)
+{
+    std::vector<flxJob *> &queue = _jobQueue[theJob->_queuePriority];
+    int32_t index = theJob->_queueIndex;
+
+    if (index < 0 || index >= (int32_t)queue.size() || queue[index] != theJob)
+        return;
+
+    theJob->_queueIndex = flxJob::kNotQueued;
+
+    // move the last item in the heap into the open slot and restore heap ordering
+    flxJob *theLast = queue.back();
+    queue.pop_back();
+
+    if (theLast == theJob)
+        return;
+
+    heapPlace(queue, theLast, index);
+    heapSiftUp(queue, index);
+    heapSiftDown(queue, theLast->_queueIndex);
 }
 
 //------------------------------------------------------------------
@@ -87,17 +205,17 @@ bool _flxJobQueue::start(void)
     // based on operational timing.
     //
     // Now order the jobs based on delta time needs based on *start* time
-    std::vector<flxJob *> theJobs;
-
-    // stash our jobs
-    for (auto aJob : _jobQueue)
-        theJobs.push_back(aJob.second);
+    uint32_t ticks = millis();
 
-    // now clear out the map, and add everything back with proper timing
-    _jobQueue.clear();
+    for (auto &queue : _jobQueue)
+    {
+        for (auto aJob : queue)
+            aJob->_tDeadline = ticks + aJob->period();
 
-    for (auto aJob : theJobs)
-        addJob(*aJob);
+        // rebuild the heap
+        for (int32_t i = queue.size() / 2 - 1; i >= 0; i--)
+            heapSiftDown(queue, i);
+    }
 
     _running = true;
 
@@ -111,7 +229,21 @@ void _flxJobQueue::stop()
     // stop the job queue
     _running = false;
 }
+//------------------------------------------------------------------
+// Return the next job to dispatch - the highest priority job that is due. If
+// bBackground is false, background jobs are not considered.
+//
+flxJob *_flxJobQueue::nextDueJob(uint32_t ticks, bool bBackground)
+{
+    int nQueues = bBackground ? flxJobPriorityCount : flxJobPriorityBackground;
 
+    for (int i = 0; i < nQueues; i++)
+    {
+        if (_jobQueue[i].size() > 0 && !isBefore(ticks, _jobQueue[i].front()->_tDeadline))
+            return _jobQueue[i].front();
+    }
+    return nullptr;
+}
 //------------------------------------------------------------------
 // Any jobs to dispatch?
 //
@@ -122,26 +254,78 @@ void _flxJobQueue::dispatchJobs(void)
 
     // The Plan
     //
-    // The job queue is sorted based on time to call/dispatch a job handler.
-    // Loop over the queue and dispatch handlers to all events that time values (keys)
-    // are less than ticks.
+    // The job queue is a set of heaps - one per priority - ordered by the time to call/dispatch
+    // a job handler. Dispatch handlers for all jobs with a time value (deadline) less than ticks,
+    // always taking the due job with the highest priority next.
+    //
+    // Background jobs share a time budget in each pass. Once it's used, any remaining due
+    // background jobs are deferred to the next pass - so they don't delay higher priority jobs
+    // that come due in the meantime.
+    //
+    // Note: All time compares are relative (signed difference) so the queue operates across
+    // the rollover of the millis() counter.
 
     flxJob *theJob;
+    flxJobStats_t *stats;
+    uint32_t tDeadline;
     uint32_t tNext;
+    uint32_t skipped;
+    uint32_t usStart;
+    uint32_t usElapsed;
+    uint32_t msLate;
+    uint32_t usBackground = 0;
+    bool bBackground = true;
 
     // our time cutoff
     uint32_t ticks = millis();
 
-    for (auto it = _jobQueue.begin(); it != _jobQueue.end(); /*nothing*/)
+    while (true)
     {
-        // past what is available?
-        if (it->first > ticks)
+        theJob = nextDueJob(ticks, bBackground);
+
+        if (!theJob)
             break;
 
-        theJob = it->second;
+        tDeadline = theJob->_tDeadline;
+
+        // lateness is measured at dispatch - earlier handlers in this pass add to it
+        msLate = millis() - tDeadline;
 
         // call the job's handler. Doing this here, allows the target to modify job period if needed
+        usStart = micros();
         theJob->callHandler();
+        usElapsed = micros() - usStart;
+
+        // Background budget used up?
+        if (theJob->_queuePriority == flxJobPriorityBackground && _backgroundBudget > 0)
+        {
+            usBackground += usElapsed;
+            if (usBackground >= _backgroundBudget * 1000)
+                bBackground = false;
+        }
+
+        // update the execution stats for the job
+        stats = &theJob->_stats;
+        if (stats->calls == 0 || usElapsed < stats->usMin)
+            stats->usMin = usElapsed;
+        if (usElapsed > stats->usMax)
+            stats->usMax = usElapsed;
+        stats->usTotal += usElapsed;
+
+        if (msLate > stats->msLateMax)
+            stats->msLateMax = msLate;
+        stats->msLateTotal += msLate;
+        stats->calls++;
+
+        // If the handler removed or updated the job in the queue, it's been rescheduled
+        if (!theJob->queued() || theJob->_tDeadline != tDeadline)
+            continue;
+
+        if (theJob->oneShot())
+        {
+            heapRemove(theJob);
+            continue;
+        }
 
         // normally the base of the next period timeout is the current event timeout - this
         // keeps timed sequences on a predicable schedule - absorbing small delays
@@ -152,59 +336,44 @@ void _flxJobQueue::dispatchJobs(void)
         // end is less than current ticks. If this is the case, fast forward the base by N * period()
         //
         // For a majority of jobs, the next event tick number is this event tick number + job period.
-        tNext = it->first + theJob->period();
+        tNext = tDeadline + theJob->period();
 
         // high-speed or timed out system (next is <= current ticks) - re-base the period to next valid time
-        if (tNext <= ticks)
-            tNext = it->first + (((ticks - it->first) / theJob->period()) + 1) * theJob->period();
+        if (!isBefore(ticks, tNext))
+        {
+            skipped = (ticks - tDeadline) / theJob->period();
+            tNext = tDeadline + (skipped + 1) * theJob->period();
+            stats->skipped += skipped;
+        }
 
-        // remove this item from the job queue head,
-        // Note - erase returns the iterator to next item in container
-        it = _jobQueue.erase(it);
-
-        // add back if not a one shot job
-        if (!theJob->oneShot())
-            _jobQueue.insert(std::pair<uint32_t, flxJob *>(tNext, theJob));
+        // The deadline only moves later, so just sift the job down the heap - no removal/re-insert needed
+        theJob->_tDeadline = tNext;
+        heapSiftDown(_jobQueue[theJob->_queuePriority], theJob->_queueIndex);
     }
-}
-//------------------------------------------------------------------
-// Find a job in the job queue
-//
-auto _flxJobQueue::findJob(flxJob &theJob) -> decltype(_jobQueue.end())
-{
-    auto itJob = _jobQueue.begin();
-
-    while (itJob != _jobQueue.end())
-    {
-        if (itJob->second == &theJob)
-            break;
 
-        itJob++;
-    }
-    return itJob;
+    // were any background jobs deferred to the next pass?
+    if (!bBackground && nextDueJob(ticks, true) != nullptr)
+        _backgroundDeferrals++;
 }
 //------------------------------------------------------------------
 //
 void _flxJobQueue::addJob(flxJob &theJob)
 {
-    // Is this job in our queue already
-    if (_jobQueue.size() == 0 || findJob(theJob) == _jobQueue.end())
-    {
-        // Add this job to the job queue (map) - make sure it has some sane period
-        if (theJob.period() > 0)
-            _jobQueue.insert(std::pair<uint32_t, flxJob *>(millis() + theJob.period(), &theJob));
-    }
+    // Is this job in our queue already - make sure it has some sane period
+    if (theJob.queued() || theJob.period() == 0)
+        return;
+
+    theJob._tDeadline = millis() + theJob.period();
+    heapInsert(&theJob);
 }
 //------------------------------------------------------------------
 // remove a job
 //
 void _flxJobQueue::removeJob(flxJob &theJob)
 {
-    auto itJob = findJob(theJob);
-
     // do we know of this job?
-    if (itJob != _jobQueue.end())
-        _jobQueue.erase(itJob);
+    if (theJob.queued())
+        heapRemove(&theJob);
 }
 
 //------------------------------------------------------------------
@@ -214,18 +383,130 @@ void _flxJobQueue::updateJob(flxJob &theJob)
 {
     // the job needs to be reset it in the current job (priority) queue.
     //
-    // To do this - just remove it and the add it back.
+    // If not queued, or the priority changed, (re)add it. Otherwise set the new deadline
+    // and restore the heap order.
+    if (theJob.queued() && theJob._queuePriority != theJob.priority())
+        heapRemove(&theJob);
 
-    removeJob(theJob);
-    addJob(theJob);
+    if (!theJob.queued())
+    {
+        addJob(theJob);
+        return;
+    }
+
+    std::vector<flxJob *> &queue = _jobQueue[theJob._queuePriority];
+
+    theJob._tDeadline = millis() + theJob.period();
+    heapSiftUp(queue, theJob._queueIndex);
+    heapSiftDown(queue, theJob._queueIndex);
 }
 //------------------------------------------------------------------
 // dump out the contents of the queue
 //
 void _flxJobQueue::dump(void)
 {
-    for (auto aJob : _jobQueue)
-        flxLog_I("\t %u\t%s", aJob.first, aJob.second->name());
+    static const char *priorityNames[] = {"RT", "Norm", "Bkgd"};
+
+    // output in dispatch order - the queue is a set of heaps, so sort a copy
+    std::vector<flxJob *> theJobs;
+
+    for (auto &queue : _jobQueue)
+        theJobs.insert(theJobs.end(), queue.begin(), queue.end());
+
+    std::sort(theJobs.begin(), theJobs.end(),
+              [](flxJob *a, flxJob *b) { return isBefore(a->_tDeadline, b->_tDeadline); });
+
+    flxLog_I("\t%10s  %-24s %4s %8s %8s %8s %8s %8s %8s %8s", "Deadline", "Job", "Pri", "Calls", "Min us", "Avg us",
+             "Max us", "Late ms", "Max ms", "Skipped");
+
+    for (auto aJob : theJobs)
+    {
+        const flxJobStats_t &stats = aJob->stats();
+
+        flxLog_I("\t%10u  %-24s %4s %8u %8u %8u %8u %8u %8u %8u", aJob->_tDeadline, aJob->name() ? aJob->name() : "",
+                 priorityNames[aJob->_queuePriority], stats.calls, stats.usMin, aJob->usAverage(), stats.usMax,
+                 aJob->msLateAverage(), stats.msLateMax, stats.skipped);
+    }
+}
+//------------------------------------------------------------------
+// reset the stats of all jobs in the queue
+//
+void _flxJobQueue::resetStats(void)
+{
+    for (auto &queue : _jobQueue)
+        for (auto aJob : queue)
+            aJob->resetStats();
+}
+//------------------------------------------------------------------
+// nextDeadline()
+//
+// Returns the time in ms until the next job is due.
+//
+uint32_t _flxJobQueue::nextDeadline(void)
+{
+    if (!_running)
+        return kJobQueueNoDeadline;
+
+    uint32_t ticks = millis();
+    uint32_t next = kJobQueueNoDeadline;
+    int32_t delta;
+
+    for (auto &queue : _jobQueue)
+    {
+        if (queue.size() == 0)
+            continue;
+
+        delta = (int32_t)(queue.front()->_tDeadline - ticks);
+        if (delta <= 0)
+            return 0;
+
+        if ((uint32_t)delta < next)
+            next = delta;
+    }
+    return next;
+}
+//------------------------------------------------------------------
+// idle()
+//
+// Sleep until the next job is due (or maxSleep ms). This allows the main loop to
+// yield the processor (delay() lets the RTOS idle the CPU) instead of spinning on
+// the job queue when nothing is scheduled.
+//
+// The sleep is made in short slices, and ends early if wake() is called - from an
+// interrupt handler for example. Returns true if the sleep was cut short.
+//
+bool _flxJobQueue::idle(uint32_t maxSleep)
+{
+    uint32_t toSleep = nextDeadline();
+
+    if (toSleep > maxSleep)
+        toSleep = maxSleep;
+
+    // Nothing scheduled and no limit - don't sleep forever
+    if (toSleep == 0 || toSleep == kJobQueueNoDeadline)
+        return false;
+
+    _wakeRequested = false;
+
+    uint32_t tStart = millis();
+    uint32_t elapsed = 0;
+
+    while (elapsed < toSleep && !_wakeRequested)
+    {
+        delay(toSleep - elapsed < kJobQueueIdleSlice ? toSleep - elapsed : kJobQueueIdleSlice);
+        elapsed = millis() - tStart;
+    }
+
+    bool bEarly = _wakeRequested;
+    _wakeRequested = false;
+
+    _idleStats.sleeps++;
+    _idleStats.msRequested += toSleep;
+    _idleStats.msSlept += elapsed;
+    if (bEarly)
+        _idleStats.earlyWakes++;
+
+    return bEarly;
 }
 //------------------------------------------------------------------
 //  loop()
@@ -13,12 +13,37 @@
 #pragma once
 
 #include "flxCoreLog.h"
+#include "flxCoreSignal.h"
 
-#include <functional>
-#include <map>
 #include <stdint.h>
 #include <vector>
 
+//-----------------------------------------------------------------
+// Job priorities
+//
+// When several jobs are due, the jobs with the higher priority are dispatched first.
+// Background jobs are also limited to a time budget per pass of the job queue loop.
+typedef enum
+{
+    flxJobPriorityRealTime = 0, // time critical - i.e. data sampling/logging
+    flxJobPriorityNormal,       // the default
+    flxJobPriorityBackground,   // housekeeping - can be deferred
+    flxJobPriorityCount
+} flxJobPriority_t;
+
+//-----------------------------------------------------------------
+// Execution statistics for a job - maintained by the job queue
+typedef struct
+{
+    uint32_t calls;       // number of times the handler was called
+    uint32_t usMin;       // min handler execution time (us)
+    uint32_t usMax;       // max handler execution time (us)
+    uint64_t usTotal;     // total handler execution time (us)
+    uint32_t msLateMax;   // max lateness of a dispatch vs. the scheduled tick (ms)
+    uint64_t msLateTotal; // total lateness (ms)
+    uint32_t skipped;     // number of periods skipped - the job was fast-forwarded
+} flxJobStats_t;
+
 //-----------------------------------------------------------------
 // Define our Job
 //
@@ -30,21 +55,29 @@ class flxJob
 {
 
   public:
-    flxJob() : _name{nullptr}, _one_shot{false}
+    flxJob()
+        : _name{nullptr}, _period{0}, _one_shot{false}, _priority{flxJobPriorityNormal}, _tDeadline{0},
+          _queueIndex{kNotQueued}, _queuePriority{flxJobPriorityNormal}
     {
+        resetStats();
     }
 
-    flxJob(const char *name, uint32_t in_period) : _name{name}, _period{in_period}
+    flxJob(const char *name, uint32_t in_period)
+        : _name{name}, _period{in_period}, _one_shot{false}, _priority{flxJobPriorityNormal}, _tDeadline{0},
+          _queueIndex{kNotQueued}, _queuePriority{flxJobPriorityNormal}
     {
+        resetStats();
     }
 
     template <typename T>
-    void setup(const char *name, uint32_t in_period, T *inst, void (T::*func)(), bool bOneShot = false)
+    void setup(const char *name, uint32_t in_period, T *inst, void (T::*func)(), bool bOneShot = false,
+               flxJobPriority_t priority = flxJobPriorityNormal)
     {
         setName(name);
         setPeriod(in_period);
         setHandler(inst, func);
         setOneShot(bOneShot);
+        setPriority(priority);
     }
 
     void callHandler(void)
@@ -58,9 +91,7 @@ class flxJob
         if (!inst || !func)
             return;
 
-        _handler = [=]() { // uses a lambda for the callback
-            (inst->*func)();
-        };
+        _handler = flxDelegate<>::member(inst, func);
     }
 
     void setPeriod(uint32_t in_period)
@@ -92,17 +123,86 @@ class flxJob
         return _one_shot;
     }
 
+    // Note - if the job is queued, a priority change takes effect when the job is updated
+    // in the queue - see flxUpdateJobInQueue()
+    void setPriority(flxJobPriority_t priority)
+    {
+        if (priority < flxJobPriorityCount)
+            _priority = priority;
+    }
+
+    inline flxJobPriority_t priority(void)
+    {
+        return _priority;
+    }
+
+    // Is this job currently in the job queue?
+    inline bool queued(void)
+    {
+        return _queueIndex != kNotQueued;
+    }
+
+    // Execution statistics
+    const flxJobStats_t &stats(void)
+    {
+        return _stats;
+    }
+
+    uint32_t usAverage(void)
+    {
+        return _stats.calls > 0 ? (uint32_t)(_stats.usTotal / _stats.calls) : 0;
+    }
+
+    uint32_t msLateAverage(void)
+    {
+        return _stats.calls > 0 ? (uint32_t)(_stats.msLateTotal / _stats.calls) : 0;
+    }
+
+    void resetStats(void)
+    {
+        _stats = {0, 0, 0, 0, 0, 0, 0};
+    }
+
   private:
+    // The job queue manages the scheduling state of a job
+    friend class _flxJobQueue;
+
+    static constexpr int32_t kNotQueued = -1;
+
     // handler
-    std::function<void()> _handler;
+    flxDelegate<> _handler;
 
     const char *_name;
     // Time delta in MS
     uint32_t _period;
 
     bool _one_shot;
+
+    flxJobPriority_t _priority;
+
+    // Scheduling state - owned by the job queue.
+    //    _tDeadline     - tick (ms) when the job is next dispatched
+    //    _queueIndex    - slot of this job in the queue heap, kNotQueued if not queued
+    //    _queuePriority - the priority (heap) the job is queued at
+    uint32_t _tDeadline;
+    int32_t _queueIndex;
+    flxJobPriority_t _queuePriority;
+
+    flxJobStats_t _stats;
 };
 
+// Returned by nextDeadline() when no job is scheduled
+#define kJobQueueNoDeadline 0xFFFFFFFF
+
+// Idle/sleep statistics of the job queue
+typedef struct
+{
+    uint32_t sleeps;      // number of idle sleeps
+    uint32_t earlyWakes;  // sleeps cut short by a wake() request
+    uint32_t msRequested; // total time requested to sleep (ms)
+    uint32_t msSlept;     // total time actually slept (ms)
+} flxJobQueueIdleStats_t;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Job Queue/Timer based
 ////////////////////////////////////////////////////////////////////////////////
@@ -135,17 +235,104 @@ class _flxJobQueue
 
     void dump(void);
 
+    // Reset the execution statistics of all queued jobs
+    void resetStats(void);
+
+    // Number of jobs in the queue, and access to them. Note - the order of jobs
+    // changes as jobs are dispatched.
+    uint32_t size(void)
+    {
+        uint32_t count = 0;
+        for (int i = 0; i < flxJobPriorityCount; i++)
+            count += _jobQueue[i].size();
+        return count;
+    }
+    flxJob *at(uint32_t index)
+    {
+        for (int i = 0; i < flxJobPriorityCount; i++)
+        {
+            if (index < _jobQueue[i].size())
+                return _jobQueue[i][index];
+            index -= _jobQueue[i].size();
+        }
+        return nullptr;
+    }
+
+    // Time budget (ms) for background jobs in each pass of loop(). Once exceeded, any
+    // other due background jobs are deferred to the next pass. 0 = no limit.
+    void setBackgroundBudget(uint32_t budget)
+    {
+        _backgroundBudget = budget;
+    }
+    uint32_t backgroundBudget(void)
+    {
+        return _backgroundBudget;
+    }
+
+    // Number of loop passes where due background jobs were deferred
+    uint32_t backgroundDeferrals(void)
+    {
+        return _backgroundDeferrals;
+    }
+
+    // Time in ms until the next job is due. 0 if a job is due now, kJobQueueNoDeadline if
+    // no jobs are scheduled.
+    uint32_t nextDeadline(void);
+
+    // Sleep until the next job is due, or maxSleep ms - whichever is sooner. Returns true if
+    // the sleep was cut short by a call to wake().
+    bool idle(uint32_t maxSleep = kJobQueueNoDeadline);
+
+    // End an idle sleep early - safe to call from an interrupt handler
+    void wake(void)
+    {
+        _wakeRequested = true;
+    }
+
+    const flxJobQueueIdleStats_t &idleStats(void)
+    {
+        return _idleStats;
+    }
+
+    void resetIdleStats(void)
+    {
+        _idleStats = {0, 0, 0, 0};
+    }
+
   private:
     _flxJobQueue();
 
     void dispatchJobs(void);
 
+    // Wraparound safe deadline compare. Ticks are uint32_t milliseconds, which roll over
+    // every ~49.7 days, so deadlines are compared by their signed difference.
+    static inline bool isBefore(uint32_t tA, uint32_t tB)
+    {
+        return (int32_t)(tA - tB) < 0;
+    }
+
+    // heap operations
+    void heapInsert(flxJob *theJob);
+    void heapRemove(flxJob *theJob);
+    void heapSiftUp(std::vector<flxJob *> &queue, int32_t index);
+    void heapSiftDown(std::vector<flxJob *> &queue, int32_t index);
+    void heapPlace(std::vector<flxJob *> &queue, flxJob *theJob, int32_t index);
+
+    // the next due job - by priority, then deadline
+    flxJob *nextDueJob(uint32_t ticks, bool bBackground);
+
     bool _running; // used to flag if the queue is running
 
-    // use a multi-map for the queue - since entries can have the same key (time value)
-    std::multimap<uint32_t, flxJob *> _jobQueue;
+    volatile bool _wakeRequested;
+
+    flxJobQueueIdleStats_t _idleStats;
+
+    uint32_t _backgroundBudget;
+    uint32_t _backgroundDeferrals;
 
-    auto findJob(flxJob &theJob) -> decltype(_jobQueue.end());
+    // The queue is a binary min-heap of jobs per priority, ordered by job deadline. Each job stores
+    // its slot in the heap, so find, add, update and remove don't require a search of the queue.
+    std::vector<flxJob *> _jobQueue[flxJobPriorityCount];
 };
 extern _flxJobQueue &flxJobQueue;
 
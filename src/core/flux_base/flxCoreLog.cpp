@@ -189,9 +189,9 @@ int flxLogging::logPrintfInternal(const flxLogLevel_t level, bool newline, const
         retval = tmpval | retval; // is this right?
     }
 
-    // trigger an event on error or warning
+    // trigger an event on error or warning - posted, so the handlers don't run in the middle of logging
     if (level == flxLogError || level == flxLogWarning)
-        flxSendEvent(flxEvent::kLogErrWarn, (uint8_t)level);
+        flxPostEvent(flxEvent::kLogErrWarn, (uint8_t)level);
 
     return retval;
 }
@@ -24,6 +24,7 @@ const flxMessageBlock<flxMessageCoreID_t> msgBlockFluxCore = {
     {kMsgErrAllocError, "Allocation error for %s"},
     {kMsgErrAllocErrorN, "%s: Allocation error for %s"},
     {kMsgErrFileOpen, "%s: Unable to open file %s"},
+    {kMsgErrFileWrite, "%s: Error writing to file %s"},
     {kMsgErrSizeExceeded, "%s size exceeded limit"},
     {kMsgErrInitialization, "%s: Initialization Error [%s]"},
     {kMsgErrValueNotProvided, "%s: Value not provided [%s]"},
@@ -75,7 +75,8 @@ typedef enum
     kMsgErrValueError,
     kMsgErrResourceNotAvail,
     kMsgErrCreateFailure,
-    kMsgErrInvalidState
+    kMsgErrInvalidState,
+    kMsgErrFileWrite
 } flxMessageCoreID_t;
 
 // Extern ref to the core message block for Flux
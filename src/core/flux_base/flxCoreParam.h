@@ -610,6 +610,11 @@ class flxParameterOutArray : public flxParameterOut
     }
 
     virtual flxDataArray *get(void) = 0;
+
+    // Get the value into an array object owned by the parameter. The array object (and
+    // its buffer) is reused on each call, so no memory is allocated during steady state
+    // operation. The returned object is valid until the next call - do not delete it.
+    virtual flxDataArray *getArray(void) = 0;
 };
 
 //---------------------------------------------------------------------------------------
@@ -717,6 +722,22 @@ class flxParameterOutArrayType : public flxParameterOutArray
         return data;
     }
 
+    //---------------------------------------------------------------------------------
+    // get the value of the parameter into our array object - no allocation/delete.
+    flxDataArrayType<T> *getArray(void)
+    {
+        if (!my_object)
+        {
+            flxLogM_E(kMsgParentObjNotSet, "output parameter");
+            return nullptr;
+        }
+        return (my_object->*_getter)(&_array) ? &_array : nullptr;
+    }
+
+  private:
+    // Our persistent array object - returned by getArray()
+    flxDataArrayType<T> _array;
+
     // //---------------------------------------------------------------------------------
     // // get -> parameter()
     // bool operator()(flxDataArrayType<T> & data)
@@ -888,6 +909,21 @@ class flxParameterOutArrayString : public flxParameterOutArray
 
         return data;
     }
+    //---------------------------------------------------------------------------------
+    // get the value of the parameter into our array object - no allocation/delete.
+    flxDataArrayString *getArray(void)
+    {
+        if (!my_object)
+        {
+            flxLogM_E(kMsgParentObjNotSet, "output parameter");
+            return nullptr;
+        }
+        return (my_object->*_getter)(&_array) ? &_array : nullptr;
+    }
+
+  private:
+    // Our persistent array object - returned by getArray()
+    flxDataArrayString _array;
 };
 
 //-----------------------------------------------------------------------------------
@@ -1332,6 +1368,11 @@ class flxOperation : public flxObject, public _flxParameterContainer
         return true;
     }
 
+    /// @brief Virtual method called after the data for an execute() call is retrieved
+    virtual void executeComplete(void)
+    {
+    }
+
     virtual bool onSave(flxStorageBlock *stBlk)
     {
         if (!stBlk)
@@ -1342,7 +1383,7 @@ class flxOperation : public flxObject, public _flxParameterContainer
 
         for (auto param : outParams)
         {
-            if (!stBlk->write(param->name(), param->enabled()))
+            if (!stBlk->write(flxStorageTag(*param), param->enabled()))
                 flxLog_E(F("Error saving enabled flag for %s - parameter %s"), name(), param->name());
         }
 
@@ -1360,7 +1401,7 @@ class flxOperation : public flxObject, public _flxParameterContainer
         bool isEnabled;
         for (auto param : outParams)
         {
-            if (stBlk->read(param->name(), isEnabled))
+            if (stBlk->read(flxStorageTag(*param), isEnabled))
                 param->setEnabled(isEnabled);
         }
 
@@ -305,7 +305,7 @@ class _flxPropertyBase : public flxProperty, public _flxDataIn<T>, public _flxDa
         if (stBlk->kind() == flxStorage::flxStorageKindInternal || (!hidden() && !secure()))
         {
             T c = get();
-            bool status = stBlk->write(name(), c);
+            bool status = stBlk->write(flxStorageTag(*this), c);
 
             if (!status)
                 flxLogM_E(kMsgErrSavingProperty, name());
@@ -318,7 +318,7 @@ class _flxPropertyBase : public flxProperty, public _flxDataIn<T>, public _flxDa
     {
         T c;
 
-        bool status = stBlk->read(name(), c);
+        bool status = stBlk->read(flxStorageTag(*this), c);
 
         if (status)
             set(c);
@@ -473,10 +473,13 @@ class _flxPropertyBaseString : public flxProperty, _flxDataInString, _flxDataOut
     {
         bool status = true;
 
+        // the storage tag - carries the cached hash of our name
+        flxStorageTag tag(*this);
+
         // If this is a secure string and storage is internal, the strings are stored
         // encrypted
         if (stBlk->kind() == flxStorage::flxStorageKindInternal && secure())
-            return stBlk->saveSecureString(name(), get().c_str());
+            return stBlk->saveSecureString(tag, get().c_str());
 
         // If we are saving to an external source, we don't save hidden values or secure values.
         // But, for secure props, we to write the key and a blank string (makes it easier to enter values)
@@ -487,7 +490,7 @@ class _flxPropertyBaseString : public flxProperty, _flxDataInString, _flxDataOut
             // if a secure property and external storage, set value to an empty string
             std::string c = (stBlk->kind() == flxStorage::flxStorageKindExternal && secure()) ? "" : get();
 
-            status = stBlk->writeString(name(), c.c_str());
+            status = stBlk->writeString(tag, c.c_str());
             if (!status)
                 flxLogM_E(kMsgErrSavingProperty, name());
         }
@@ -498,29 +501,30 @@ class _flxPropertyBaseString : public flxProperty, _flxDataInString, _flxDataOut
     bool restore(flxStorageBlock *stBlk)
     {
         size_t len;
+        flxStorageTag tag(*this);
 
         // Secure string?
         if (stBlk->kind() == flxStorage::flxStorageKindInternal && secure())
         {
             // get buffer length. Note, add one to make sure we have room for line termination
-            len = stBlk->getBytesLength(name()) + 1;
+            len = stBlk->getBytesLength(tag) + 1;
             if (!len)
                 return false;
 
             char szBuffer[len];
-            if (!stBlk->restoreSecureString(name(), szBuffer, len))
+            if (!stBlk->restoreSecureString(tag, szBuffer, len))
                 return false;
 
             set(szBuffer);
         }
         else
         {
-            len = stBlk->getStringLength(name());
+            len = stBlk->getStringLength(tag);
             if (!len)
                 return false;
 
             char szBuffer[len + 1] = {'\0'};
-            len = stBlk->readString(name(), szBuffer, sizeof(szBuffer));
+            len = stBlk->readString(tag, szBuffer, sizeof(szBuffer));
 
             set(szBuffer);
         }
@@ -1883,8 +1887,11 @@ class flxObject : public flxPersist, public _flxPropertyContainer, public flxDes
     //---------------------------------------------------------------------------------
     virtual bool save(flxStorage *pStorage)
     {
+        // Nothing changed since the last save? If the storage only wants changes, we're done.
+        if (pStorage->saveChangesOnly() && !isDirty())
+            return true;
 
-        flxStorageBlock *stBlk = pStorage->beginBlock(name());
+        flxStorageBlock *stBlk = pStorage->beginBlock(flxStorageTag(*this));
         if (!stBlk)
             return false;
 
@@ -1907,7 +1914,7 @@ class flxObject : public flxPersist, public _flxPropertyContainer, public flxDes
     virtual bool restore(flxStorage *pStorage)
     {
         // Do we have this block in storage?
-        flxStorageBlock *stBlk = pStorage->getBlock(name());
+        flxStorageBlock *stBlk = pStorage->getBlock(flxStorageTag(*this));
 
         if (!stBlk)
         {
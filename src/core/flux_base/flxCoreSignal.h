@@ -0,0 +1,393 @@
+/*
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+// flxCoreSignal.h
+//
+// Delegates and signals - the callback plumbing used by events (flxSignal, the event hub) and jobs.
+//
+//-----------------------------------------------------------------------
+// flxDelegate
+//
+// A callback - an object pointer, a function to call (stored inline) and a thunk that makes the call
+// with the right types. Unlike std::function, a delegate never allocates, copies are a memcpy and
+// delegates can be compared - so a connected callback can be disconnected.
+//
+// A delegate can call:
+//    - a member function of an object
+//    - a member function of an object, with a user value as the first argument
+//    - a function
+//    - a function, with a user value as the first argument
+//    - a small, trivially copyable functor/lambda (i.e. a lambda that captures a pointer or two)
+//
+// The stored function and user value must fit in kDelegateStorageSize bytes - checked at compile time.
+
+// Room for a member function pointer (two words) and a user value
+#define kDelegateStorageSize (2 * sizeof(void *) + 8)
+
+template <typename... ArgT> class flxDelegate
+{
+  public:
+    flxDelegate() : _object{nullptr}, _thunk{nullptr}
+    {
+        memset(_storage, 0, sizeof(_storage));
+    }
+
+    //----------------------------------------------------------------------------------------------------
+    // Factory methods
+    //
+    // Member function of an object
+    template <typename T> static flxDelegate member(T *inst, void (T::*func)(ArgT...))
+    {
+        flxDelegate theDelegate;
+        theDelegate._object = inst;
+        theDelegate._thunk = memberThunk<T, void (T::*)(ArgT...)>;
+        theDelegate.store(0, func);
+
+        return theDelegate;
+    }
+
+    // const member function of an object
+    template <typename T> static flxDelegate member(T *inst, void (T::*func)(ArgT...) const)
+    {
+        flxDelegate theDelegate;
+        theDelegate._object = inst;
+        theDelegate._thunk = memberThunk<T, void (T::*)(ArgT...) const>;
+        theDelegate.store(0, func);
+
+        return theDelegate;
+    }
+
+    // Member function of an object, called with a user value as the first argument
+    template <typename T, typename U> static flxDelegate member(T *inst, void (T::*func)(U uVal, ArgT...), U uValue)
+    {
+        flxDelegate theDelegate;
+        theDelegate._object = inst;
+        theDelegate._thunk = memberValueThunk<T, U>;
+        theDelegate.store(0, func);
+        theDelegate.store(sizeof(func), uValue);
+
+        return theDelegate;
+    }
+
+    // A function
+    static flxDelegate function(void (*func)(ArgT...))
+    {
+        flxDelegate theDelegate;
+        theDelegate._thunk = functionThunk;
+        theDelegate.store(0, func);
+
+        return theDelegate;
+    }
+
+    // A function, called with a user value as the first argument
+    template <typename U> static flxDelegate function(void (*func)(U uVal, ArgT...), U uValue)
+    {
+        flxDelegate theDelegate;
+        theDelegate._thunk = functionValueThunk<U>;
+        theDelegate.store(0, func);
+        theDelegate.store(sizeof(func), uValue);
+
+        return theDelegate;
+    }
+
+    // A small functor or lambda
+    template <typename F> static flxDelegate functor(const F &theFunctor)
+    {
+        flxDelegate theDelegate;
+        theDelegate._thunk = functorThunk<F>;
+        theDelegate.store(0, theFunctor);
+
+        return theDelegate;
+    }
+
+    //----------------------------------------------------------------------------------------------------
+    void operator()(ArgT... args) const
+    {
+        if (_thunk)
+            _thunk(*this, args...);
+    }
+
+    explicit operator bool() const
+    {
+        return _thunk != nullptr;
+    }
+
+    bool operator==(const flxDelegate &rhs) const
+    {
+        return _thunk == rhs._thunk && _object == rhs._object && !memcmp(_storage, rhs._storage, sizeof(_storage));
+    }
+
+    bool operator!=(const flxDelegate &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    // The object called - nullptr for functions
+    void *object(void) const
+    {
+        return _object;
+    }
+
+    void clear(void)
+    {
+        *this = flxDelegate();
+    }
+
+  private:
+    typedef void (*thunk_t)(const flxDelegate &, ArgT...);
+
+    template <typename V> void store(size_t offset, const V &value)
+    {
+        static_assert(std::is_trivially_copyable<V>::value, "Delegate values must be trivially copyable");
+        static_assert(sizeof(V) <= kDelegateStorageSize, "Delegate function and value are too large");
+
+        memcpy(_storage + offset, &value, sizeof(V));
+    }
+
+    template <typename V> V load(size_t offset) const
+    {
+        V value;
+        memcpy(&value, _storage + offset, sizeof(V));
+        return value;
+    }
+
+    //----------------------------------------------------------------------------------------------------
+    // Thunks - make the call, with the stored function cast back to its type
+    template <typename T, typename F> static void memberThunk(const flxDelegate &theDelegate, ArgT... args)
+    {
+        F func = theDelegate.load<F>(0);
+        (static_cast<T *>(theDelegate._object)->*func)(args...);
+    }
+
+    template <typename T, typename U> static void memberValueThunk(const flxDelegate &theDelegate, ArgT... args)
+    {
+        typedef void (T::*F)(U, ArgT...);
+        static_assert(sizeof(F) + sizeof(U) <= kDelegateStorageSize, "Delegate function and value are too large");
+
+        F func = theDelegate.load<F>(0);
+        (static_cast<T *>(theDelegate._object)->*func)(theDelegate.load<U>(sizeof(F)), args...);
+    }
+
+    static void functionThunk(const flxDelegate &theDelegate, ArgT... args)
+    {
+        (*theDelegate.load<void (*)(ArgT...)>(0))(args...);
+    }
+
+    template <typename U> static void functionValueThunk(const flxDelegate &theDelegate, ArgT... args)
+    {
+        typedef void (*F)(U, ArgT...);
+        static_assert(sizeof(F) + sizeof(U) <= kDelegateStorageSize, "Delegate function and value are too large");
+
+        (*theDelegate.load<F>(0))(theDelegate.load<U>(sizeof(F)), args...);
+    }
+
+    template <typename F> static void functorThunk(const flxDelegate &theDelegate, ArgT... args)
+    {
+        (*reinterpret_cast<const F *>(theDelegate._storage))(args...);
+    }
+
+    void *_object;
+    thunk_t _thunk;
+    alignas(void *) alignas(uint64_t) uint8_t _storage[kDelegateStorageSize];
+};
+
+//-----------------------------------------------------------------------
+// 5/20 - Impl based on https://schneegans.github.io/tutorials/2015/09/20/signal-slot
+// flxSignals - sort of  - support for our simple observer pattern for events
+//
+// The connected slots are delegates, held in a small inline array - most signals have one or two
+// listeners. Past that, slots overflow to a vector.
+//
+// Note: Don't connect or disconnect slots of a signal from a callback of the same signal.
+//
+#define kSignalInlineSlots 2
+
+class flxSignalBase
+{
+    // empty base class
+};
+
+template <typename TB, typename... ArgT> class flxSignal : public flxSignalBase
+{
+
+  public:
+    typedef flxDelegate<ArgT...> slot_type;
+
+    flxSignal() : _nInline{0}
+    {
+    }
+
+    // connects a member function to this flxSignal
+    template <typename T> void call(T *inst, void (T::*func)(ArgT...))
+    {
+        connect(slot_type::member(inst, func));
+    }
+
+    // connects a const member function to this flxSignal
+    template <typename T> void call(T *inst, void (T::*func)(ArgT...) const)
+    {
+        connect(slot_type::member(inst, func));
+    }
+
+    // Just call a user supplied function - no object
+    void call(void (*func)(ArgT...))
+    {
+        connect(slot_type::function(func));
+    }
+    // Just call a user supplied function - no object - but with a User Defined value
+    template <typename T> void call(void (*func)(T uval, ArgT...), T uValue)
+    {
+        connect(slot_type::function(func, uValue));
+    }
+
+    template <typename T, typename U> void call(T *inst, void (T::*func)(U uVal, ArgT...), U uValue)
+    {
+        connect(slot_type::member(inst, func, uValue));
+    }
+
+    // connects a delegate to the flxSignal.
+    void connect(slot_type const &slot) const
+    {
+        if (!slot)
+            return;
+
+        if (_nInline < kSignalInlineSlots)
+            _slots[_nInline++] = slot;
+        else
+            _overflow.push_back(slot);
+    }
+
+    // connects a small functor/lambda to the flxSignal.
+    template <typename F> void connect(F const &theFunctor) const
+    {
+        connect(slot_type::functor(theFunctor));
+    }
+
+    //----------------------------------------------------------------------------------------------------
+    // Disconnect - remove the first slot that matches. Returns true if a slot was removed
+    //
+    bool disconnect(slot_type const &slot) const
+    {
+        for (uint8_t i = 0; i < _nInline; i++)
+        {
+            if (_slots[i] == slot)
+            {
+                removeInline(i);
+                return true;
+            }
+        }
+        for (auto it = _overflow.begin(); it != _overflow.end(); it++)
+        {
+            if (*it == slot)
+            {
+                _overflow.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename T> bool disconnect(T *inst, void (T::*func)(ArgT...))
+    {
+        return disconnect(slot_type::member(inst, func));
+    }
+
+    template <typename T, typename U> bool disconnect(T *inst, void (T::*func)(U uVal, ArgT...), U uValue)
+    {
+        return disconnect(slot_type::member(inst, func, uValue));
+    }
+
+    bool disconnect(void (*func)(ArgT...))
+    {
+        return disconnect(slot_type::function(func));
+    }
+
+    // Remove all the slots that call the given object - i.e. when the object is deleted. Returns the
+    // number of slots removed.
+    uint32_t disconnectAll(void *inst) const
+    {
+        uint32_t nRemoved = 0;
+
+        for (auto it = _overflow.begin(); it != _overflow.end();)
+        {
+            if (it->object() == inst)
+            {
+                it = _overflow.erase(it);
+                nRemoved++;
+            }
+            else
+                it++;
+        }
+        for (uint8_t i = _nInline; i > 0; i--)
+        {
+            if (_slots[i - 1].object() == inst)
+            {
+                removeInline(i - 1);
+                nRemoved++;
+            }
+        }
+        return nRemoved;
+    }
+
+    // number of connected slots
+    size_t size(void) const
+    {
+        return _nInline + _overflow.size();
+    }
+
+    // calls all connected functions
+    void emit(ArgT... args)
+    {
+        for (uint8_t i = 0; i < _nInline; i++)
+            _slots[i](args...);
+
+        for (auto const &it : _overflow)
+            it(args...);
+    }
+
+    typedef TB value_type;
+
+  private:
+    // Remove an inline slot, keeping the connection order - the first overflow slot moves inline
+    void removeInline(uint8_t iSlot) const
+    {
+        for (uint8_t i = iSlot; i + 1 < _nInline; i++)
+            _slots[i] = _slots[i + 1];
+
+        if (_overflow.size() > 0)
+        {
+            _slots[_nInline - 1] = _overflow.front();
+            _overflow.erase(_overflow.begin());
+        }
+        else
+            _slots[--_nInline].clear();
+    }
+
+    mutable slot_type _slots[kSignalInlineSlots];
+    mutable uint8_t _nInline;
+    mutable std::vector<slot_type> _overflow;
+};
+
+typedef flxSignal<bool, bool> flxSignalBool;
+typedef flxSignal<int8_t, int8_t> flxSignalInt8;
+typedef flxSignal<int16_t, int16_t> flxSignalInt16;
+typedef flxSignal<int32_t, int32_t> flxSignalInt32;
+typedef flxSignal<uint8_t, uint8_t> flxSignalUInt8;
+typedef flxSignal<uint16_t, uint16_t> flxSignalUInt16;
+typedef flxSignal<uint32_t, uint32_t> flxSignalUInt32;
+typedef flxSignal<float, float> flxSignalFloat;
+typedef flxSignal<double, double> flxSignalDouble;
+typedef flxSignal<const char *, const char *> flxSignalString;
+typedef flxSignal<void> flxSignalVoid;
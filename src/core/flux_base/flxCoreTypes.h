@@ -15,6 +15,7 @@
 
 #include <functional>
 #include <map>
+#include <new>
 #include <string.h>
 #include <string>
 #include <type_traits>
@@ -41,7 +42,8 @@ class flxDescriptor
 {
   public:
     flxDescriptor()
-        : _name{nullptr}, _nameAlloc{false}, _desc{nullptr}, _descAlloc{false}, _title(nullptr), _titleAlloc{false}
+        : _name{nullptr}, _nameAlloc{false}, _nameHashed{false}, _nameHash{0}, _desc{nullptr}, _descAlloc{false},
+          _title(nullptr), _titleAlloc{false}
     {
     }
 
@@ -63,6 +65,7 @@ class flxDescriptor
             _nameAlloc = false;
         }
         _name = new_name;
+        _nameHashed = false;
     }
 
     /**
@@ -125,6 +128,22 @@ class flxDescriptor
         return std::string(_name);
     }
 
+    /**
+     * @brief Return the hash of the name - flx_utils::id_hash_string(). Used to key values in storage.
+     * The hash is computed on first use and kept until the name changes.
+     *
+     * @return uint32_t
+     */
+    uint32_t nameHash(void)
+    {
+        if (!_nameHashed)
+        {
+            _nameHash = flx_utils::id_hash_string(name());
+            _nameHashed = true;
+        }
+        return _nameHash;
+    }
+
     /**
      * @brief Set the Description object - the input value is constant and not copied. If the previous
      * description was allocated, it is freed.
@@ -249,6 +268,8 @@ class flxDescriptor
   protected:
     const char *_name;
     bool _nameAlloc;
+    bool _nameHashed;
+    uint32_t _nameHash;
 
     const char *_desc;
     bool _descAlloc;
@@ -655,10 +676,13 @@ class flxDataArray
      */
     size_t size(void)
     {
-        uint sum = 0;
+        if (_n_dims == 0)
+            return 0;
+
+        size_t count = 1;
         for (int i = 0; i < _n_dims; i++)
-            sum += _dimensions[i];
-        return sum;
+            count *= _dimensions[i];
+        return count;
     }
 
   protected:
@@ -701,7 +725,7 @@ template <typename T> class flxDataArrayType : public flxDataArray
 {
 
   public:
-    flxDataArrayType() : _bAlloc{false}, _data{nullptr}
+    flxDataArrayType() : _bAlloc{false}, _allocSize{0}, _data{nullptr}
     {
     }
 
@@ -771,6 +795,48 @@ template <typename T> class flxDataArrayType : public flxDataArray
         }
     };
 
+    /**
+     * @brief Set the array dimensions and return an array owned buffer to fill in place.
+     *
+     * @note The buffer is reused across calls - memory is only allocated if the array grows. A newly
+     * allocated buffer is zeroed. Not available for string arrays - use set().
+     *
+     * @param d0 The first dimension of the array
+     * @return T* The buffer to fill, nullptr on error
+     */
+    T *buffer(uint16_t d0)
+    {
+        setDimensions(d0);
+        return ownedBuffer(size());
+    }
+
+    /**
+     * @brief Set the array dimensions and return an array owned buffer to fill in place.
+     *
+     * @param d0 The first dimension of the array
+     * @param d1 The second dimension of the array
+     * @return T* The buffer to fill, nullptr on error
+     */
+    T *buffer(uint16_t d0, uint16_t d1)
+    {
+        setDimensions(d0, d1);
+        return ownedBuffer(size());
+    }
+
+    /**
+     * @brief Set the array dimensions and return an array owned buffer to fill in place.
+     *
+     * @param d0 The first dimension of the array
+     * @param d1 The second dimension of the array
+     * @param d2 The third dimension of the array
+     * @return T* The buffer to fill, nullptr on error
+     */
+    T *buffer(uint16_t d0, uint16_t d1, uint16_t d2)
+    {
+        setDimensions(d0, d1, d2);
+        return ownedBuffer(size());
+    }
+
     /**
      * @brief Return a pointer to the array data.
      *
@@ -798,13 +864,48 @@ template <typename T> class flxDataArrayType : public flxDataArray
         // free any existing alloc'd memory
         if (_data != nullptr && _bAlloc)
         {
-            delete _data;
+            delete[] _data;
             _data = nullptr;
             _bAlloc = false;
+            _allocSize = 0;
+        }
+    }
+
+    //--------------------------------------------------------------------
+    // Can an existing allocation be reused for new data - i.e. the elements don't own memory
+    virtual bool reuseAlloc(void)
+    {
+        return true;
+    }
+
+    //--------------------------------------------------------------------
+    // Return an array owned buffer of at least length elements - reusing the current
+    // allocation if possible. A new allocation is value initialized (zero, or nullptr
+    // for strings), so elements the caller doesn't set are still valid.
+    T *ownedBuffer(size_t length)
+    {
+        if (length == 0)
+        {
+            reset();
+            return nullptr;
         }
+        if (!_bAlloc || length > _allocSize || !reuseAlloc())
+        {
+            freeAlloc();
+            _data = new (std::nothrow) T[length]();
+            if (!_data)
+            {
+                reset();
+                return nullptr;
+            }
+            _bAlloc = true;
+            _allocSize = length;
+        }
+        return _data;
     }
 
     bool _bAlloc;
+    size_t _allocSize;
 
     //--------------------------------------------------------------------
     virtual bool setDataPtr(T *data, size_t length, bool no_copy)
@@ -813,18 +914,22 @@ template <typename T> class flxDataArrayType : public flxDataArray
         if (!data || length == 0)
             return false;
 
-        // free any alloc'd memory
-        freeAlloc();
-
         // copy data or not?
         if (no_copy)
+        {
+            // free any alloc'd memory
+            freeAlloc();
             _data = data;
+        }
         else
         {
-            // create a copy of the passed in data.
-            _data = new T[length];
-            memcpy(_data, data, length * sizeof(T));
-            _bAlloc = true;
+            // create a copy of the passed in data - reusing our buffer if it's large enough.
+            T *pBuffer = ownedBuffer(length);
+            if (!pBuffer)
+                return false;
+
+            if (pBuffer != data)
+                memcpy(pBuffer, data, length * sizeof(T));
         }
 
         return true;
@@ -877,6 +982,26 @@ using flxDataArrayDouble = flxDataArrayType<double>;
  */
 class flxDataArrayString : public flxDataArrayType<char *>
 {
+    //--------------------------------------------------------------------
+    // The strings in our buffer are allocated - so don't reuse it
+    bool reuseAlloc(void)
+    {
+        return false;
+    }
+
+  public:
+    ~flxDataArrayString()
+    {
+        // the base class destructor can't call our version of freeAlloc()
+        freeAlloc();
+    }
+
+    // The array owns the strings in its buffer - it can't be filled in place. Use set().
+    char **buffer(uint16_t d0) = delete;
+    char **buffer(uint16_t d0, uint16_t d1) = delete;
+    char **buffer(uint16_t d0, uint16_t d1, uint16_t d2) = delete;
+
+  private:
     //--------------------------------------------------------------------
     void freeAlloc(void)
     {
@@ -885,12 +1010,10 @@ class flxDataArrayString : public flxDataArrayType<char *>
         // free any existing alloc'd memory
         if (pData != nullptr && _bAlloc)
         {
-            // need to delete the strings
-
-            uint16_t nStr = size();
+            // need to delete the strings - one per element of our allocation
 
-            for (int i = 0; i < nStr; i++)
-                delete *pData++;
+            for (int i = 0; i < _allocSize; i++)
+                delete[] *pData++;
         }
 
         // call super
@@ -917,7 +1040,10 @@ class flxDataArrayString : public flxDataArrayType<char *>
         for (int i = 0; i < nStr; i++, pData++, data++)
         {
             if (!*data) // no string?
+            {
+                *pData = nullptr;
                 continue;
+            }
 
             // alloc and copy over string data...
             slen = strlen(*data) + 1;
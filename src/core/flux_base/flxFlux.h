@@ -304,6 +304,17 @@ class flxFlux : public flxObjectContainer
         _loadSettings = bLoad;
     }
 
+    // Idle sleep - if set (> 0), when a pass of loop() does no work, the system sleeps until
+    // the next job is due, for at most the given number of ms. 0 disables idle sleep.
+    void setIdleSleep(uint32_t maxSleep)
+    {
+        _idleSleep = maxSleep;
+    }
+    uint32_t idleSleep(void)
+    {
+        return _idleSleep;
+    }
+
     // more of a debug setting ...
     void dumpDeviceAutoLoadTable(void)
     {
@@ -334,11 +345,13 @@ class flxFlux : public flxObjectContainer
     bool _deviceAutoload;
     bool _loadSettings;
 
+    uint32_t _idleSleep;
+
     // Note private constructor...
     flxFlux()
         : _v_major{0}, _v_minor{0}, _v_point{0}, _v_build{0}, _v_desc{""}, _v_idprefix{"0000"},
           _appClassID{kDefaultAppClassName}, _theApplication{nullptr}, _token{0}, _hasToken{false},
-          _verboseDevNames{false}, _deviceAutoload{true}, _loadSettings{true}
+          _verboseDevNames{false}, _deviceAutoload{true}, _loadSettings{true}, _idleSleep{0}
     {
 
         // setup some default hierarchy things ...
@@ -28,4 +28,7 @@ class flxPlatform
 
     // free heap
     static uint32_t heap_free(void);
+
+    // Monotonic time since boot, in microseconds - doesn't wrap
+    static uint64_t micros64(void);
 };
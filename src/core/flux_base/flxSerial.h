@@ -50,6 +50,11 @@ class flxSerial_ : public flxWriter
     }
     void write(const char *value, bool newline, flxLineType_t type);
 
+    bool acceptsPartialLines(void)
+    {
+        return true;
+    }
+
     // Overload listen, so we can type the events, and use the template-based
     // write() method above.
 
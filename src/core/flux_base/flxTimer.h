@@ -57,8 +57,9 @@ class flxTimer : public flxActionType<flxTimer>
         // Register the interval property - do here not in ctor due to uncertainty of global object creation order
 
         flxRegister(interval, "Interval", "Timer interval in milliseconds");
-        // setup the job used to trigger the timer (note - we enable "job compression" for this )
-        _timerJob.setup(name(), _initialInterval, this, &flxTimer::onTimer, false);
+        // setup the job used to trigger the timer (note - we enable "job compression" for this ).
+        // Timers drive sampling/logging, so run at real-time priority
+        _timerJob.setup(name(), _initialInterval, this, &flxTimer::onTimer, false, flxJobPriorityRealTime);
         // Add the job to the job queue
         flxAddJobToQueue(_timerJob);
 
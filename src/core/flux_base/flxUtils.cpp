@@ -37,11 +37,126 @@
 //
 // Logic from the quad project
 //
+//-------------------------------------------------------------------
+// utostr()
+//
+// Fast unsigned integer to string - no printf. Returns the length of the string, 0 on error
+// (buffer too small).
+//
+size_t flx_utils::utostr(uint32_t value, char *szBuffer, size_t nBuffer)
+{
+    char digits[10];
+    size_t n = 0;
+
+    do
+    {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    if (!szBuffer || n + 1 > nBuffer)
+        return 0;
+
+    for (size_t i = 0; i < n; i++)
+        szBuffer[i] = digits[n - 1 - i];
+
+    szBuffer[n] = '\0';
+
+    return n;
+}
+//-------------------------------------------------------------------
+// itostr()
+//
+// Fast signed integer to string - no printf
+//
+size_t flx_utils::itostr(int32_t value, char *szBuffer, size_t nBuffer)
+{
+    if (value >= 0)
+        return utostr((uint32_t)value, szBuffer, nBuffer);
+
+    if (!szBuffer || nBuffer < 2)
+        return 0;
+
+    szBuffer[0] = '-';
+
+    // note: negate as unsigned to handle INT32_MIN
+    size_t n = utostr(0u - (uint32_t)value, szBuffer + 1, nBuffer - 1);
+
+    return n == 0 ? 0 : n + 1;
+}
+//-------------------------------------------------------------------
+// Fixed point fast path for dtostr() - for values where the integer part fits in 32 bits.
+// Returns 0 if the value can't be formatted by this method.
+//
+static size_t dtostr_fixed(double value, char *szBuffer, size_t nBuffer, uint8_t precision)
+{
+    static const uint32_t powers10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+    if (precision >= sizeof(powers10) / sizeof(powers10[0]))
+        return 0;
+
+    bool negative = value < 0.0;
+    if (negative)
+        value = -value;
+
+    // integer part needs to fit in 32 bits
+    if (value >= 4.0e9)
+        return 0;
+
+    // Only the fraction is scaled - removing the integer part is exact, so the rounding isn't thrown
+    // off by the precision the integer part takes in a scaled value. Rounding can carry into the
+    // integer part.
+    uint32_t intPart = (uint32_t)value;
+    uint32_t fracPart = (uint32_t)((value - intPart) * powers10[precision] + 0.5);
+    if (fracPart >= powers10[precision])
+    {
+        intPart++;
+        fracPart -= powers10[precision];
+    }
+
+    char szInt[12];
+    size_t nInt = flx_utils::utostr(intPart, szInt, sizeof(szInt));
+
+    size_t length = (negative ? 1 : 0) + nInt + (precision > 0 ? precision + 1 : 0);
+    if (length + 1 > nBuffer)
+        return 0;
+
+    char *pCurr = szBuffer;
+    if (negative)
+        *pCurr++ = '-';
+
+    memcpy(pCurr, szInt, nInt);
+    pCurr += nInt;
+
+    if (precision > 0)
+    {
+        *pCurr++ = '.';
+        // fraction digits - with leading zeros
+        for (int i = precision - 1; i >= 0; i--)
+        {
+            pCurr[i] = (char)('0' + fracPart % 10);
+            fracPart /= 10;
+        }
+        pCurr += precision;
+    }
+    *pCurr = '\0';
+
+    return length;
+}
+
 size_t flx_utils::dtostr(double value, char *szBuffer, size_t nBuffer, uint8_t precision)
 {
     if (!szBuffer || nBuffer == 0)
         return 0;
 
+    // Most values are formatted using fixed point integer math, which is fast
+    if (!isnan(value) && !isinf(value))
+    {
+        size_t length = dtostr_fixed(value, szBuffer, nBuffer, precision);
+        if (length > 0)
+            return length;
+    }
+
     memset(szBuffer, '\0', nBuffer);
 
     // check floating point math edge values
@@ -154,11 +269,38 @@ bool flx_utils::id_hash_string_to_string(const char *instr, char *outstr, size_t
         return false;
     }
 
-    // hash the input string - returns 32 bits of hash-ness
-    uint32_t hash = id_hash_string(instr);
+    // hash the input string - returns 32 bits of hash-ness, and print it into a string -- forms a unique tag
+    return id_hash_to_string(id_hash_string(instr), outstr, len);
+}
+//-------------------------------------------------------------------
+// returns a string version of a hash - upper case hex, no leading zeros (same as "%X"). This is called for
+// every value saved/restored, so the string is built directly, not with snprintf()
+bool flx_utils::id_hash_to_string(uint32_t hash, char *outstr, size_t len)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    if (!outstr || !len)
+        return false;
+
+    char szDigits[8];
+    size_t nDigits = 0;
+
+    do
+    {
+        szDigits[nDigits++] = hexDigits[hash & 0xF];
+        hash >>= 4;
+    } while (hash != 0);
+
+    if (nDigits + 1 > len)
+    {
+        *outstr = '\0';
+        return false;
+    }
+
+    while (nDigits > 0)
+        *outstr++ = szDigits[--nDigits];
 
-    // Now print this has into a string -- forms a unique tag
-    snprintf(outstr, len, "%X", hash);
+    *outstr = '\0';
 
     return true;
 }
@@ -183,7 +325,7 @@ std::string flx_utils::to_string(char *const data)
 std::string flx_utils::to_string(int32_t const data)
 {
     char szBuffer[20];
-    snprintf(szBuffer, sizeof(szBuffer), "%d", data);
+    itostr(data, szBuffer, sizeof(szBuffer));
     std::string stmp = szBuffer;
     return stmp;
 }
@@ -191,7 +333,7 @@ std::string flx_utils::to_string(int32_t const data)
 std::string flx_utils::to_string(int8_t const data)
 {
     char szBuffer[20];
-    snprintf(szBuffer, sizeof(szBuffer), "%d", data);
+    itostr(data, szBuffer, sizeof(szBuffer));
     std::string stmp = szBuffer;
     return stmp;
 }
@@ -199,7 +341,7 @@ std::string flx_utils::to_string(int8_t const data)
 std::string flx_utils::to_string(int16_t const data)
 {
     char szBuffer[20];
-    snprintf(szBuffer, sizeof(szBuffer), "%d", data);
+    itostr(data, szBuffer, sizeof(szBuffer));
     std::string stmp = szBuffer;
     return stmp;
 }
@@ -207,7 +349,7 @@ std::string flx_utils::to_string(int16_t const data)
 std::string flx_utils::to_string(uint32_t const data)
 {
     char szBuffer[20];
-    snprintf(szBuffer, sizeof(szBuffer), "%u", data);
+    utostr(data, szBuffer, sizeof(szBuffer));
     std::string stmp = szBuffer;
     return stmp;
 }
@@ -215,7 +357,7 @@ std::string flx_utils::to_string(uint32_t const data)
 std::string flx_utils::to_string(uint8_t const data)
 {
     char szBuffer[20];
-    snprintf(szBuffer, sizeof(szBuffer), "%u", data);
+    utostr(data, szBuffer, sizeof(szBuffer));
     std::string stmp = szBuffer;
     return stmp;
 }
@@ -223,7 +365,7 @@ std::string flx_utils::to_string(uint8_t const data)
 std::string flx_utils::to_string(uint16_t const data)
 {
     char szBuffer[20];
-    snprintf(szBuffer, sizeof(szBuffer), "%u", data);
+    utostr(data, szBuffer, sizeof(szBuffer));
     std::string stmp = szBuffer;
     return stmp;
 }
@@ -23,10 +23,33 @@ namespace flx_utils
 
 size_t dtostr(double value, char *szBuffer, size_t nBuffer, uint8_t precision = 3);
 
+size_t itostr(int32_t value, char *szBuffer, size_t nBuffer);
+
+size_t utostr(uint32_t value, char *szBuffer, size_t nBuffer);
+
 uint32_t id_hash_string(const char *str);
 
+// Compile time version of id_hash_string() - returns the same hash value. Used to hash string literals.
+//
+// Like id_hash_string(), the terminating null is hashed (the final * 33) - except for an empty string,
+// which hashes to the seed.
+constexpr uint32_t id_hash_string_constexpr_next(const char *str, uint32_t hash)
+{
+    return *str == 0 ? hash * 33 : id_hash_string_constexpr_next(str + 1, hash * 33 + *str);
+}
+
+constexpr uint32_t id_hash_string_constexpr(const char *str, uint32_t hash = 5381)
+{
+    return !str ? 0 : (*str == 0 ? hash : id_hash_string_constexpr_next(str, hash));
+}
+
+static_assert(id_hash_string_constexpr("") == 5381, "The hash of an empty string is the seed");
+static_assert(id_hash_string_constexpr("a") == (5381u * 33 + 'a') * 33, "The hash includes the terminating null");
+
 bool id_hash_string_to_string(const char *instr, char *outstr, size_t len);
 
+bool id_hash_to_string(uint32_t hash, char *outstr, size_t len);
+
 //-------------------------------------------------------------------
 std::string &to_string(std::string &data);
 const std::string &to_string(std::string const &data);
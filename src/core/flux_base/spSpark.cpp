@@ -156,13 +156,18 @@ bool flxFlux::start()
 bool flxFlux::loop(void)
 {
 
-    // Just Call loop on the job queue system
+    // Dispatch any posted events, then call loop on the job queue system
     //
-    bool rc = flxJobQueue.loop();
+    bool rc = flxEventHub.dispatchEvents();
+    rc = flxJobQueue.loop() || rc;
 
     // and the application loop handler if we have an app
     if (_theApplication)
-        rc = rc || _theApplication->loop();
+        rc = _theApplication->loop() || rc;
+
+    // Nothing done? If enabled, sleep until the next job is due
+    if (!rc && _idleSleep > 0)
+        flxJobQueue.idle(_idleSleep);
 
     return rc;
 }
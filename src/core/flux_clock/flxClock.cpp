@@ -11,6 +11,7 @@
 #include "flxClock.h"
 
 #include "flxFlux.h"
+#include "flxPlatform.h"
 
 // A little hacky - maybe ...
 #ifdef ESP32
@@ -24,12 +25,16 @@ flxClockESP32 systemClock;
 
 const uint32_t kClockMinutesToMS = 60000;
 
+// How often the timebase is checked against the system clock - in microseconds
+const uint64_t kClockSystemCheckUS = 1000000;
+
 // Global object - for quick access to Settings system
 _flxClock &flxClock = _flxClock::get();
 
 _flxClock::_flxClock()
     : _systemClock{nullptr}, _refClock{nullptr}, _refCheck{0}, _connCheck{0}, _bInitialized{false}, _bSysTimeSet{false},
-      _nameRefClock{kNoClockName}
+      _nameRefClock{kNoClockName}, _timebaseClock{nullptr},
+      _lastSystemCheck{0}
 {
     // Set name and description
     setName("Time Setup", "Manage time configuration and reference sources");
@@ -62,16 +67,21 @@ bool _flxClock::initialize(void)
 #endif
 
     // Setup our clock check jobs
-    _jobRefCheck.setup("clock refchk", _refCheck * kClockMinutesToMS, this, &_flxClock::checkRefClock);
+    _jobRefCheck.setup("clock refchk", _refCheck * kClockMinutesToMS, this, &_flxClock::checkRefClock, false,
+                      flxJobPriorityBackground);
     if (_refCheck > 0)
         flxAddJobToQueue(_jobRefCheck);
-    _jobConnCheck.setup("clock conchk", _connCheck * kClockMinutesToMS, this, &_flxClock::checkConnClock);
+    _jobConnCheck.setup("clock conchk", _connCheck * kClockMinutesToMS, this, &_flxClock::checkConnClock, false,
+                       flxJobPriorityBackground);
     if (_connCheck > 0)
         flxAddJobToQueue(_jobConnCheck);
 
     // setup time zone for the system....
     if (!_tzStorage.empty() && _systemClock)
+    {
         _systemClock->set_timezone(_tzStorage.c_str());
+        flxSendEvent(flxEvent::kOnTimeZoneChange);
+    }
 
     _bInitialized = true;
     updateClock();
@@ -176,7 +186,10 @@ void _flxClock::set_timezone(std::string tz)
 
     _tzStorage = tz;
     if (_bInitialized && _systemClock)
+    {
         _systemClock->set_timezone(tz.c_str());
+        flxSendEvent(flxEvent::kOnTimeZoneChange);
+    }
 }
 //----------------------------------------------------------------
 std::string _flxClock::get_timezone(void)
@@ -250,6 +263,62 @@ uint32_t _flxClock::now()
     return epoch();
 }
 //----------------------------------------------------------------
+uint64_t _flxClock::monotonic(void)
+{
+    return flxPlatform::micros64();
+}
+//----------------------------------------------------------------
+flxTimestamp_t _flxClock::timestamp(void)
+{
+    uint64_t usMonotonic = monotonic();
+
+    // Not disciplined by a reference clock yet? Start from the system clock
+    if (!_timebase.valid())
+    {
+        _timebase.set(usMonotonic, _systemClock ? _systemClock->get_epoch_us()
+                                                : (flxTimestamp_t)epoch() * kTimestampUSPerSecond);
+        _lastSystemCheck = usMonotonic;
+    }
+    else if (usMonotonic - _lastSystemCheck >= kClockSystemCheckUS)
+        checkSystemClock(usMonotonic);
+
+    return _timebase.timestamp(usMonotonic);
+}
+//----------------------------------------------------------------
+// The system clock can be set outside of updateClock() - SNTP, the menu system. The timebase is
+// compared to it (at most once every kClockSystemCheckUS), and stepped to it if they disagree by
+// more than the timebase step threshold. Smaller offsets are left to the reference clock - the
+// system clock is only set to the whole second.
+
+void _flxClock::checkSystemClock(uint64_t usMonotonic)
+{
+    _lastSystemCheck = usMonotonic;
+
+    if (!_systemClock || !_systemClock->valid_epoch())
+        return;
+
+    flxTimestamp_t sysTime = _systemClock->get_epoch_us();
+    int64_t offset = (int64_t)sysTime - (int64_t)_timebase.timestamp(usMonotonic);
+
+    if (offset > kTimebaseStepThreshold || offset < -kTimebaseStepThreshold)
+        disciplineTimebase(_systemClock, usMonotonic, sysTime);
+}
+//----------------------------------------------------------------
+// Discipline the timebase with a reading of the given clock. If the clock changed, the drift
+// estimate is restarted - each clock has its own rate.
+
+void _flxClock::disciplineTimebase(flxIClock *theClock, uint64_t usMonotonic, flxTimestamp_t reference)
+{
+    if (theClock != _timebaseClock)
+    {
+        _timebase.resetDrift();
+        _timebaseClock = theClock;
+    }
+
+    if (_timebase.discipline(usMonotonic, reference, theClock->epoch_resolution_us()))
+        flxLog_D(F("Clock timebase stepped - offset %lld ms"), (long long)(_timebase.stats().lastOffset / 1000));
+}
+//----------------------------------------------------------------
 void _flxClock::setSystemClock(flxISystemClock *clock)
 {
     if (clock)
@@ -321,10 +390,23 @@ void _flxClock::updateClock()
     // do we have a clock with a valid epoch value?
     if (theClock && theClock->valid_epoch())
     {
+        // Read the reference for the timebase - before the system clock is set, which can change it
+        uint64_t usMonotonic = monotonic();
+        flxTimestamp_t reference = theClock->get_epoch_us();
+
         uint32_t epoch = theClock->get_epoch();
         if (epoch)
         {
-            _systemClock->set_epoch(epoch);
+            disciplineTimebase(theClock, usMonotonic, reference);
+
+            // Set the system clock - if it's off by more than the reference resolution. Setting the
+            // clock to a whole second drops the sub-second part of the system time.
+            int64_t sysOffset = (int64_t)_systemClock->get_epoch_us() - (int64_t)reference;
+            if (sysOffset < 0)
+                sysOffset = -sysOffset;
+
+            if (!_bSysTimeSet || sysOffset >= theClock->epoch_resolution_us())
+                _systemClock->set_epoch(epoch);
 
             // if first time setting the system time value:
             //   - flag that is has been set
@@ -341,6 +423,11 @@ void _flxClock::updateClock()
                 updateConnectedClocks();
         }
     }
+    else if (_systemClock->valid_epoch())
+    {
+        // No reference - keep the timebase with the system clock, which could be set by other means
+        disciplineTimebase(_systemClock, monotonic(), _systemClock->get_epoch_us());
+    }
 }
 
 //----------------------------------------------------------------
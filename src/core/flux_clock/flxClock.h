@@ -13,6 +13,7 @@
 
 #include "flxCore.h"
 #include "flxCoreJobs.h"
+#include "flxTimebase.h"
 
 #include <map>
 #include <vector>
@@ -20,6 +21,9 @@
 // default tz
 #define kClockTimeZoneSparkFun "MST7MDT,M3.2.0,M11.1.0"
 
+// The system clock time zone changed - sent once the new time zone is in effect
+flxDefineEventID(kOnTimeZoneChange);
+
 // Define a clock interface -- really just want secs from unix epoch
 class flxIClock
 {
@@ -27,6 +31,19 @@ class flxIClock
     virtual uint32_t get_epoch(void) = 0;
     virtual void set_epoch(const uint32_t &) = 0;
     virtual bool valid_epoch(void) = 0;
+
+    // Epoch in microseconds - for clocks with better than second resolution. The default is the
+    // middle of the current second.
+    virtual flxTimestamp_t get_epoch_us(void)
+    {
+        return (flxTimestamp_t)get_epoch() * kTimestampUSPerSecond + kTimestampUSPerSecond / 2;
+    }
+
+    // Resolution of the value returned by get_epoch_us() - in microseconds
+    virtual uint32_t epoch_resolution_us(void)
+    {
+        return kTimestampUSPerSecond;
+    }
 };
 
 // Define a System Clock interface -- a clock interface and some TimeZone magic
@@ -40,6 +57,7 @@ class flxISystemClock : public flxIClock
 
 #ifdef ESP32
 
+#include <sys/time.h>
 #include <time.h>
 class flxClockESP32 : public flxISystemClock
 {
@@ -51,6 +69,18 @@ class flxClockESP32 : public flxISystemClock
         return now;
     }
 
+    flxTimestamp_t get_epoch_us(void)
+    {
+        struct timeval tv;
+        gettimeofday(&tv, nullptr);
+        return (flxTimestamp_t)tv.tv_sec * kTimestampUSPerSecond + tv.tv_usec;
+    }
+
+    uint32_t epoch_resolution_us(void)
+    {
+        return 1;
+    }
+
     void set_epoch(const uint32_t &refEpoch)
     {
         timeval epoch = {(time_t)refEpoch, 0};
@@ -131,6 +161,19 @@ class _flxClock : public flxActionType<_flxClock>
 
     uint32_t now();
 
+    // Microseconds since the epoch - from the monotonic timebase, disciplined by the reference clock.
+    // Steps of the system clock (SNTP, set from the menu) are followed.
+    flxTimestamp_t timestamp(void);
+
+    // Monotonic microseconds since boot
+    uint64_t monotonic(void);
+
+    // Timebase drift and offset information
+    const flxTimebaseStats_t &timebaseStats(void) const
+    {
+        return _timebase.stats();
+    }
+
     void setSystemClock(flxISystemClock *clock);
 
     bool setReferenceClock(flxIClock *clock, const char *name = nullptr);
@@ -168,6 +211,8 @@ class _flxClock : public flxActionType<_flxClock>
     void checkConnClock(void);
     void checkRefClock(void);
     void resetReferenceUpdate(void);
+    void disciplineTimebase(flxIClock *theClock, uint64_t usMonotonic, flxTimestamp_t reference);
+    void checkSystemClock(uint64_t usMonotonic);
 
     // our system / runtime clock
     flxISystemClock *_systemClock;
@@ -196,6 +241,13 @@ class _flxClock : public flxActionType<_flxClock>
 
     std::string _tzStorage;
 
+    // microsecond timebase - and the clock it was last disciplined by
+    flxTimebase _timebase;
+    flxIClock *_timebaseClock;
+
+    // monotonic time the timebase was last checked against the system clock
+    uint64_t _lastSystemCheck;
+
     // Update jobs
     flxJob _jobRefCheck;
     flxJob _jobConnCheck;
@@ -0,0 +1,143 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+#include "flxTimebase.h"
+
+//----------------------------------------------------------------
+// Scale a time span by a parts per billion value. The span is split at the second, so the
+// multiply doesn't overflow for long spans.
+static int64_t scalePPB(uint64_t usSpan, int32_t ppb)
+{
+    return (int64_t)(usSpan / 1000000) * ppb / 1000 + (int64_t)(usSpan % 1000000) * ppb / 1000000000LL;
+}
+
+//----------------------------------------------------------------
+flxTimebase::flxTimebase()
+    : _bValid{false}, _baseMonotonic{0}, _baseTimestamp{0}, _driftPPB{0}, _slew{0}, _refMonotonic{0},
+      _refTimestamp{0}, _bRefValid{false}, _stats{0, 0, 0, 0}
+{
+}
+
+//----------------------------------------------------------------
+void flxTimebase::anchor(uint64_t usMonotonic, int64_t timestamp)
+{
+    _baseMonotonic = usMonotonic;
+    _baseTimestamp = timestamp;
+    _slew = 0;
+}
+
+//----------------------------------------------------------------
+void flxTimebase::set(uint64_t usMonotonic, flxTimestamp_t timestamp)
+{
+    anchor(usMonotonic, (int64_t)timestamp);
+    _bValid = true;
+}
+
+//----------------------------------------------------------------
+// The timestamp is the anchor timestamp, plus the monotonic time since the anchor corrected for
+// drift, plus the part of the slew offset applied so far.
+
+flxTimestamp_t flxTimebase::timestamp(uint64_t usMonotonic) const
+{
+    uint64_t span = usMonotonic > _baseMonotonic ? usMonotonic - _baseMonotonic : 0;
+
+    int64_t ts = _baseTimestamp + (int64_t)span + scalePPB(span, _driftPPB);
+
+    if (_slew != 0)
+    {
+        int64_t slewed = scalePPB(span, kTimebaseSlewPPB);
+        if (_slew > 0)
+            ts += slewed < _slew ? slewed : _slew;
+        else
+            ts -= slewed < -_slew ? slewed : -_slew;
+    }
+
+    return ts > 0 ? (flxTimestamp_t)ts : 0;
+}
+
+//----------------------------------------------------------------
+void flxTimebase::resetDrift(void)
+{
+    _bRefValid = false;
+}
+
+//----------------------------------------------------------------
+bool flxTimebase::discipline(uint64_t usMonotonic, flxTimestamp_t reference, uint32_t usResolution)
+{
+    _stats.updates++;
+
+    int64_t current = (int64_t)timestamp(usMonotonic);
+    int64_t offset = (int64_t)reference - current;
+
+    _stats.lastOffset = offset;
+
+    // First reading, or a large offset - step
+    if (!_bValid || offset > kTimebaseStepThreshold || offset < -kTimebaseStepThreshold)
+    {
+        set(usMonotonic, reference);
+
+        _stats.steps++;
+
+        // The reference time jumped - drift measured up to now is not valid
+        _refMonotonic = usMonotonic;
+        _refTimestamp = (int64_t)reference;
+        _bRefValid = true;
+
+        return true;
+    }
+
+    // Drift estimate - the rate of the monotonic clock vs the reference, over the span of readings
+    if (!_bRefValid)
+    {
+        _refMonotonic = usMonotonic;
+        _refTimestamp = (int64_t)reference;
+        _bRefValid = true;
+    }
+    else
+    {
+        uint64_t span = usMonotonic - _refMonotonic;
+
+        uint64_t minSpan = usResolution * kTimebaseDriftResolutionSpan;
+        if (minSpan < kTimebaseDriftMinSpan)
+            minSpan = kTimebaseDriftMinSpan;
+
+        if (span >= minSpan)
+        {
+            int64_t error = ((int64_t)reference - _refTimestamp) - (int64_t)span;
+            int64_t ppb = error * 1000 / (int64_t)(span / 1000000);
+
+            if (ppb > kTimebaseMaxDriftPPB)
+                ppb = kTimebaseMaxDriftPPB;
+            else if (ppb < -kTimebaseMaxDriftPPB)
+                ppb = -kTimebaseMaxDriftPPB;
+
+            _driftPPB = (int32_t)ppb;
+            _stats.driftPPB = _driftPPB;
+
+            // Keep the estimate current - restart the span once it's long enough
+            if (span >= kTimebaseDriftMaxSpan && span >= 4 * minSpan)
+            {
+                _refMonotonic = usMonotonic;
+                _refTimestamp = (int64_t)reference;
+            }
+        }
+    }
+
+    // Re-anchor at the current timestamp (no jump), and slew out the offset - if it's beyond the
+    // reading noise of the reference.
+    anchor(usMonotonic, current);
+
+    int64_t deadband = usResolution / 2 < kTimebaseSlewDeadband ? usResolution / 2 : kTimebaseSlewDeadband;
+
+    if (offset > deadband || offset < -deadband)
+        _slew = offset;
+
+    return false;
+}
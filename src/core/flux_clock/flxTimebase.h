@@ -0,0 +1,117 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//----------------------------------------------------------------------------------------
+// flxTimebase
+//
+// A microsecond timebase, anchored to the epoch and disciplined by reference clock readings.
+//
+// The timebase runs from the monotonic microsecond counter of the platform. When a reference clock
+// is read, the timebase is corrected:
+//
+//   - Small offsets are slewed - the timebase runs slightly fast or slow (at most kTimebaseSlewPPB)
+//     until the offset is removed. The timestamps never go backwards.
+//   - Offsets over kTimebaseStepThreshold are stepped - i.e. the first reading of a reference clock.
+//   - The drift of the local oscillator vs. the reference is estimated over the readings, and the
+//     timebase rate corrected for it.
+//
+// Reference readings are given with their resolution - a clock that only provides seconds reads as the
+// middle of the second. The resolution sets how long the drift is measured over, and small offsets
+// (under half the resolution, at most kTimebaseSlewDeadband) are left as reading noise.
+//
+// This class has no platform dependencies - the monotonic time is passed in.
+//----------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+// Microseconds since the Unix epoch
+typedef uint64_t flxTimestamp_t;
+
+#define kTimestampUSPerSecond 1000000ULL
+
+// Offsets larger than this are stepped, not slewed (us)
+#define kTimebaseStepThreshold (2 * 1000000LL)
+
+// Slew rate - in parts per billion (500 ppm)
+#define kTimebaseSlewPPB 500000
+
+// Offsets under this (us) are not slewed - reading noise
+#define kTimebaseSlewDeadband 1000
+
+// Limit of the drift correction - parts per billion (500 ppm)
+#define kTimebaseMaxDriftPPB 500000
+
+// The drift is estimated over at least this span of reference readings (us) - 10 minutes. For a low
+// resolution reference, the span is at least kTimebaseDriftResolutionSpan times the resolution - so the
+// resolution adds at most 20 ppm of error to the estimate (about 14 hours for a clock in seconds).
+#define kTimebaseDriftMinSpan (600 * 1000000ULL)
+#define kTimebaseDriftResolutionSpan 50000ULL
+
+// ... and at most this span (or 4x the min span) - so the estimate follows changes (temperature) - 1 day
+#define kTimebaseDriftMaxSpan (86400 * 1000000ULL)
+
+// Timebase statistics
+typedef struct
+{
+    uint32_t updates;  // reference readings
+    uint32_t steps;    // offsets that were stepped
+    int64_t lastOffset; // offset of the last reading - reference - timebase (us)
+    int32_t driftPPB;   // drift correction in use - parts per billion
+} flxTimebaseStats_t;
+
+class flxTimebase
+{
+  public:
+    flxTimebase();
+
+    // Set the time - a step. Used to anchor the timebase before there's a reference reading
+    void set(uint64_t usMonotonic, flxTimestamp_t timestamp);
+
+    // The timestamp of a monotonic time - the current time if usMonotonic is now
+    flxTimestamp_t timestamp(uint64_t usMonotonic) const;
+
+    // A reference clock reading, taken at the monotonic time. Returns true if the timebase was stepped
+    bool discipline(uint64_t usMonotonic, flxTimestamp_t reference, uint32_t usResolution);
+
+    // The reference changed - start a new drift estimate
+    void resetDrift(void);
+
+    bool valid(void) const
+    {
+        return _bValid;
+    }
+
+    const flxTimebaseStats_t &stats(void) const
+    {
+        return _stats;
+    }
+
+  private:
+    void anchor(uint64_t usMonotonic, int64_t timestamp);
+
+    bool _bValid;
+
+    // anchor point - the timebase advances from here
+    uint64_t _baseMonotonic;
+    int64_t _baseTimestamp;
+
+    // rate correction, and an offset being slewed out since the anchor point
+    int32_t _driftPPB;
+    int64_t _slew;
+
+    // start of the drift estimate
+    uint64_t _refMonotonic;
+    int64_t _refTimestamp;
+    bool _bRefValid;
+
+    flxTimebaseStats_t _stats;
+};
@@ -12,26 +12,74 @@
 #include "flxClock.h"
 #include "flxUtils.h"
 
-// number of writes between flushes
+#include <algorithm>
+#include <new>
+
+// number of writes between flushes - when output isn't buffered
 const int kFlushIncrement = 2;
 
+//------------------------------------------------------------------------------------------------
+// Build the filename for a file number
+void flxFileRotate::fileNameForNumber(uint32_t number, char *szBuffer, size_t length)
+{
+    snprintf(szBuffer, length, kFileNameTemplate, filePrefix.get().c_str(), number, kLogFileSuffix);
+}
+
+//------------------------------------------------------------------------------------------------
+bool flxFileRotate::fileNumberExists(uint32_t number)
+{
+    char szBuffer[64];
+    fileNameForNumber(number, szBuffer, sizeof(szBuffer));
+
+    return _theFS->exists(szBuffer);
+}
+
+//------------------------------------------------------------------------------------------------
+// Find the next free file number, starting at the current file number.
+//
+// The current file number is persisted, so normally the first or second probe finds a free
+// file. If that state is lost (settings reset, a card from another device), files are numbered
+// sequentially - so step forward exponentially to find a free number, then binary search back
+// to the first free number after the last used one. This keeps the number of directory lookups
+// at O(log n) for a card with n log files.
+
 bool flxFileRotate::getNextFilename(std::string &strFile)
 {
     // FS Set?
     if (!_theFS)
         return false;
 
-    char szBuffer[64];
-    while (true)
-    {
-        snprintf(szBuffer, sizeof(szBuffer), kFileNameTemplate, filePrefix.get().c_str(), _currentFileNumber(),
-                 kLogFileSuffix);
+    uint32_t number = _currentFileNumber();
 
-        // - does this file already exist?
-        if (!_theFS->exists(szBuffer))
-            break; // free
-        _currentFileNumber = _currentFileNumber() + 1;
+    if (fileNumberExists(number))
+    {
+        // number is used. Step forward until a free number is found
+        uint32_t used = number;
+        uint32_t step = 1;
+        uint32_t free = used + step;
+
+        while (fileNumberExists(free))
+        {
+            used = free;
+            step = step < 0x40000000 ? step * 2 : step;
+            free = used + step;
+        }
+
+        // Now binary search between the last used number and the free number
+        while (free - used > 1)
+        {
+            uint32_t mid = used + (free - used) / 2;
+            if (fileNumberExists(mid))
+                used = mid;
+            else
+                free = mid;
+        }
+        number = free;
     }
+    _currentFileNumber = number;
+
+    char szBuffer[64];
+    fileNameForNumber(number, szBuffer, sizeof(szBuffer));
     strFile = szBuffer;
 
     return true;
@@ -51,6 +99,18 @@ bool flxFileRotate::openLogFile(bool bAppend)
     }
     _flushCount = 0; // new file, new start
 
+    // buffered output is written in sector aligned blocks - so track the file position
+    _filePosition = bAppend ? _currentFile.size() : 0;
+    _writeError = false;
+
+    // start the flush job - limits how long output waits in the buffer
+    if (!_jobFlush.queued())
+    {
+        _jobFlush.setup("file flush", _secsFlushInterval * 1000, this, &flxFileRotate::flush, false,
+                        flxJobPriorityBackground);
+        flxAddJobToQueue(_jobFlush);
+    }
+
     return true;
 }
 //------------------------------------------------------------------------------------------------
@@ -64,9 +124,7 @@ bool flxFileRotate::openCurrentFile(void)
         return false;
 
     char szBuffer[64];
-
-    snprintf(szBuffer, sizeof(szBuffer), kFileNameTemplate, filePrefix.get().c_str(), _currentFileNumber(),
-             kLogFileSuffix);
+    fileNameForNumber(_currentFileNumber(), szBuffer, sizeof(szBuffer));
 
     _currentFilename = szBuffer;
 
@@ -85,6 +143,7 @@ bool flxFileRotate::openNextLogFile()
 
     if (_currentFile)
     {
+        flush();
         _currentFile.close();
         _currentFile = flxFSFile(); // "null file"
         _currentFilename = "";
@@ -123,66 +182,224 @@ void flxFileRotate::write(float value)
 }
 
 //------------------------------------------------------------------------------------------------
-void flxFileRotate::write(const char *value, bool newline, flxLineType_t type)
-{
+// Make sure a log file is open, ready for output
 
+bool flxFileRotate::checkCurrentFile(void)
+{
     if (!_theFS)
-        return;
+        return false;
 
-    // no file - system just starting up?
-    if (!_currentFile)
-    {
-        bool status;
+    // file open? all good
+    if (_currentFile)
+        return true;
 
-        // Do we use a current file, or go for the next file?
-        //
-        // Reasons for Next file:
-        //      - No state saved - starting new (_secsFileOpen == 0)
-        //      - or if the current elapsed period has expired
+    // no file - system just starting up?
+    //
+    // Do we use a current file, or go for the next file?
+    //
+    // Reasons for Next file:
+    //      - No state saved - starting new (_secsFileOpen == 0)
+    //      - or if the current elapsed period has expired
+
+    if (_secsFileOpen() == 0 || flxClock.epoch() - _secsFileOpen() > _secsRotPeriod)
+        return openNextLogFile();
+
+    // have state, use current file
+    return openCurrentFile();
+}
 
-        if (_secsFileOpen() == 0 || flxClock.epoch() - _secsFileOpen() > _secsRotPeriod)
-            status = openNextLogFile();
-        else // have state, use current file
-            status = openCurrentFile();
+//------------------------------------------------------------------------------------------------
+// Called at the end of a line/record of output - rotates the file if needed and manages flushing
 
-        // error loading
-        if (!status)
+void flxFileRotate::endOfOutput(void)
+{
+    // Will we need to rotate? Either the time period has passed, or the file is at the size limit.
+    if (flxClock.epoch() - _secsFileOpen() > _secsRotPeriod ||
+        (_rotateSizeMB > 0 && (uint64_t)_filePosition + _bufferUsed >= (uint64_t)_rotateSizeMB * kBytesPerMB))
+    {
+        // open the next file, send the new file event. This will cause
+        // the next line out to be a "start of the file line" (i.e. header)
+        // if that's how the format rolls
+        if (!openNextLogFile())
             return;
     }
 
+    // Not buffered? flush the file buffer every few lines. Buffered output is flushed
+    // by the flush job or when the buffer fills.
+    if (_bufferSize == 0)
+    {
+        _flushCount = (_flushCount + 1) % kFlushIncrement;
+        if (!_flushCount)
+            _currentFile.flush();
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+void flxFileRotate::write(const char *value, bool newline, flxLineType_t type)
+{
+    if (!checkCurrentFile())
+        return;
+
     // Data line? write it
     if (type == flxLineTypeData)
     {
-        // Write the current line out
-        _currentFile.write((uint8_t *)value, strlen(value) + 1);
+        // Write the current line out - a line can arrive in pieces, so no terminator
+        bufferOutput((uint8_t *)value, strlen(value));
         // add a cr if newline set
         if (newline)
-            _currentFile.write((uint8_t *)"\n", 1);
+            bufferOutput((uint8_t *)"\n", 1);
     }
     // if this is a header line, and we've not written a header, write it
     else if (type == flxLineTypeHeader && !_headerWritten)
     {
         // Write the current line out
-        _currentFile.write((uint8_t *)value, strlen(value) + 1);
+        bufferOutput((uint8_t *)value, strlen(value));
         // add a cr if newline set
         if (newline)
-            _currentFile.write((uint8_t *)"\n", 1);
+            bufferOutput((uint8_t *)"\n", 1);
 
         _headerWritten = true;
     }
 
-    // Will we need to rotate?
-    if (flxClock.epoch() - _secsFileOpen() > _secsRotPeriod)
+    // Mid line? Don't rotate or flush until the line is complete
+    if (newline)
+        endOfOutput();
+}
+
+//------------------------------------------------------------------------------------------------
+// Binary output - each call is a complete block of data, written as is.
+
+void flxFileRotate::writeBytes(const uint8_t *data, size_t length, flxLineType_t type)
+{
+    if (!data || length == 0 || !checkCurrentFile())
+        return;
+
+    bufferOutput(data, length);
+
+    endOfOutput();
+}
+
+//------------------------------------------------------------------------------------------------
+// Write-behind buffer
+//
+// Output is collected in a buffer and written to the file when the buffer fills. Only whole
+// sectors (based on the file position) are written then - the remainder stays in the buffer.
+// So the card sees large, aligned writes. The flush job writes out anything that has waited
+// flushInterval seconds, and syncs the file system.
+
+void flxFileRotate::bufferOutput(const uint8_t *data, size_t length)
+{
+    // Buffering disabled?
+    if (_bufferSize == 0)
     {
-        // open the next file, send the new file event. This will cause
-        // the next line out to be a "start of the file line" (i.e. header)
-        // if that's how the format rolls
-        if (!openNextLogFile())
+        if (_currentFile.write(data, length) != length)
+            _writeError = true;
+        _filePosition += length;
+        return;
+    }
+
+    if (!_writeBuffer)
+    {
+        _writeBuffer = new (std::nothrow) uint8_t[_bufferSize];
+        if (!_writeBuffer)
+        {
+            flxLogM_E(kMsgErrAllocErrorN, name(), "write buffer");
+            _bufferSize = 0;
+            bufferOutput(data, length);
             return;
+        }
+        _bufferUsed = 0;
+    }
+
+    while (length > 0)
+    {
+        size_t n = std::min(length, (size_t)(_bufferSize - _bufferUsed));
+        memcpy(_writeBuffer + _bufferUsed, data, n);
+        _bufferUsed += n;
+        data += n;
+        length -= n;
+
+        if (_bufferUsed == _bufferSize)
+            writeBuffer(false);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// Write the buffer to the file. If bAll is false, only data up to the last sector boundary is written
+
+void flxFileRotate::writeBuffer(bool bAll)
+{
+    if (!_writeBuffer || _bufferUsed == 0 || !_currentFile)
+        return;
+
+    uint32_t nWrite = _bufferUsed;
+    if (!bAll)
+    {
+        uint32_t nPartial = (_filePosition + _bufferUsed) % kFileRotateSectorSize;
+
+        // buffer is at least a sector, so this leaves something to write
+        if (nPartial < _bufferUsed)
+            nWrite -= nPartial;
     }
 
-    // flush the file buffer?
-    _flushCount = (_flushCount + 1) % kFlushIncrement;
-    if (!_flushCount)
-        _currentFile.flush();
+    size_t nWritten = _currentFile.write(_writeBuffer, nWrite);
+    if (nWritten != nWrite)
+    {
+        // Don't fill the log with errors - note it once per file
+        if (!_writeError)
+            flxLogM_E(kMsgErrFileWrite, name(), _currentFilename.c_str());
+        _writeError = true;
+    }
+    // The data is dropped on an error - there's no room to keep it
+    _filePosition += nWrite;
+
+    _bufferUsed -= nWrite;
+    if (_bufferUsed > 0)
+        memmove(_writeBuffer, _writeBuffer + nWrite, _bufferUsed);
+}
+
+//------------------------------------------------------------------------------------------------
+void flxFileRotate::flush(void)
+{
+    if (!_currentFile)
+        return;
+
+    writeBuffer(true);
+    _currentFile.flush();
+}
+
+//------------------------------------------------------------------------------------------------
+void flxFileRotate::set_BufferSize(uint32_t size)
+{
+    // round to whole sectors
+    size = (size / kFileRotateSectorSize) * kFileRotateSectorSize;
+
+    if (size == _bufferSize)
+        return;
+
+    // write out anything buffered and drop the old buffer - the new one is allocated when needed
+    flush();
+
+    if (_writeBuffer)
+    {
+        delete[] _writeBuffer;
+        _writeBuffer = nullptr;
+    }
+    _bufferUsed = 0;
+    _bufferSize = size;
+}
+
+//------------------------------------------------------------------------------------------------
+void flxFileRotate::set_FlushInterval(uint32_t secs)
+{
+    if (secs == 0)
+        secs = 1;
+
+    _secsFlushInterval = secs;
+
+    if (_jobFlush.queued())
+    {
+        _jobFlush.setPeriod(_secsFlushInterval * 1000);
+        flxUpdateJobInQueue(_jobFlush);
+    }
 }
@@ -12,16 +12,28 @@
 
 #include "flxCore.h"
 #include "flxCoreInterface.h"
+#include "flxCoreJobs.h"
 #include "flxFS.h"
 #include "flxFlux.h"
 
 // TODO - refactor this out
 // #include "flxFSSDMMCard.h"
+#include <algorithm>
 #include <string>
 
 // Define the "new file" event
 flxDefineEventID(kOnNewFile);
 
+// Output is buffered and written to the file in blocks aligned to the card sector size
+#define kFileRotateSectorSize 512
+#define kFileRotateDefaultBufferSize 4096
+
+// Default max time (secs) buffered output waits before it's written to the file
+#define kFileRotateDefaultFlushSecs 5
+
+// Largest rotate size (MB) - file sizes are 32 bit (FAT32 files are limited to 4 GB - 1)
+#define kFileRotateMaxSizeMB 4095
+
 // This object implements the flxWriter interface, and manages the rotation
 // of files created on the passed in filesystem.
 
@@ -39,15 +51,45 @@ class flxFileRotate : public flxActionType<flxFileRotate>, public flxWriter
         _secsRotPeriod = hours * kSecsPerHour;
     }
 
+    // write buffer size setter/getter
+    uint32_t get_BufferSize(void)
+    {
+        return _bufferSize;
+    }
+    void set_BufferSize(uint32_t size);
+
+    // flush interval setter/getter
+    uint32_t get_FlushInterval(void)
+    {
+        return _secsFlushInterval;
+    }
+    void set_FlushInterval(uint32_t secs);
+
+    // rotation size setter/getter
+    uint32_t get_RotateSize(void)
+    {
+        return _rotateSizeMB;
+    }
+    void set_RotateSize(uint32_t sizeMB)
+    {
+        _rotateSizeMB = std::min(sizeMB, (uint32_t)kFileRotateMaxSizeMB);
+    }
+
   public:
-    flxFileRotate() : _currentFilename{""}, _theFS{nullptr}, _flushCount{0}, _secsRotPeriod{0}, _headerWritten{false}
+    flxFileRotate()
+        : _currentFilename{""}, _theFS{nullptr}, _flushCount{0}, _secsRotPeriod{0}, _headerWritten{false},
+          _writeBuffer{nullptr}, _bufferSize{kFileRotateDefaultBufferSize}, _bufferUsed{0}, _filePosition{0},
+          _secsFlushInterval{kFileRotateDefaultFlushSecs}, _writeError{false}, _rotateSizeMB{0}
     {
 
-        setName("File Rotate", "Writes output to a file. Rotates files after a given time period.");
+        setName("File Rotate", "Writes output to a file. Rotates files after a given time period or size.");
 
         flxRegister(rotatePeriod, "Rotate Period", "Time between file rotation");
+        flxRegister(rotateSize, "Rotate Size", "File size (MB) that triggers a rotation. 0 disables");
         flxRegister(startNumber, "File Start Number", "The start number for filename rotation");
         flxRegister(filePrefix, "Filename Prefix", "The prefix string for filenames");
+        flxRegister(bufferSize, "Write Buffer Size", "Size of the write buffer in bytes. 0 disables buffering");
+        flxRegister(flushInterval, "Flush Interval", "Max seconds buffered output waits before being written");
 
         // hidden prop
         flxRegister(_secsFileOpen);
@@ -56,13 +98,40 @@ class flxFileRotate : public flxActionType<flxFileRotate>, public flxWriter
         // at startup, current file count == startNumber-1
         _currentFileNumber = startNumber.get() - 1;
 
+        // flush out buffered output before a restart
+        flxRegisterEventCB(flxEvent::kOnSystemRestart, this, &flxFileRotate::flush);
+        flxRegisterEventCB(flxEvent::kOnSystemReset, this, &flxFileRotate::flush);
+
         flux_add(this);
     };
 
+    ~flxFileRotate()
+    {
+        flush();
+
+        if (_writeBuffer)
+            delete[] _writeBuffer;
+    }
+
     void write(int32_t);
     void write(float);
     void write(const char *, bool newline, flxLineType_t type);
 
+    bool acceptsPartialLines(void)
+    {
+        return true;
+    }
+
+    void writeBytes(const uint8_t *data, size_t length, flxLineType_t type);
+
+    // Write any buffered output to the file and sync the file system. Call before power is removed.
+    void flush(void);
+
+    bool acceptsBinary(void)
+    {
+        return true;
+    }
+
     void setFileSystem(flxIFileSystem *fs)
     {
         if (fs)
@@ -82,10 +151,23 @@ class flxFileRotate : public flxActionType<flxFileRotate>, public flxWriter
     flxPropertyRWUInt32<flxFileRotate, &flxFileRotate::get_RotatePeriod, &flxFileRotate::set_RotatePeriod>
         rotatePeriod = {24, {{"6 Hours", 6}, {"12 Hours", 12}, {"1 Day", 24}, {"2 Days", 48}, {"1 Week", 168}}};
 
+    // Rotation size in MB - 0 is disabled
+    flxPropertyRWUInt32<flxFileRotate, &flxFileRotate::get_RotateSize, &flxFileRotate::set_RotateSize> rotateSize = {
+        0, {{"Disabled", 0}, {"1 MB", 1}, {"10 MB", 10}, {"50 MB", 50}, {"100 MB", 100}, {"500 MB", 500}}};
+
     flxPropertyUInt32<flxFileRotate> startNumber = {1};
 
     flxPropertyString<flxFileRotate> filePrefix = {"sfe"};
 
+    // Write buffer - in bytes
+    flxPropertyRWUInt32<flxFileRotate, &flxFileRotate::get_BufferSize, &flxFileRotate::set_BufferSize> bufferSize = {
+        kFileRotateDefaultBufferSize,
+        {{"Disabled", 0}, {"512", 512}, {"1024", 1024}, {"2048", 2048}, {"4096", 4096}, {"8192", 8192}}};
+
+    // Max seconds output stays in the write buffer
+    flxPropertyRWUInt32<flxFileRotate, &flxFileRotate::get_FlushInterval, &flxFileRotate::set_FlushInterval>
+        flushInterval = {kFileRotateDefaultFlushSecs, 1, 600};
+
     static constexpr const char *kLogFileSuffix = "txt";
 
   private:
@@ -94,12 +176,19 @@ class flxFileRotate : public flxActionType<flxFileRotate>, public flxWriter
     flxPropertyHiddenUInt32<flxFileRotate> _currentFileNumber = {0};
 
     static constexpr uint kSecsPerHour = 3600;
+    static constexpr uint32_t kBytesPerMB = 1024 * 1024;
     static constexpr const char *kFileNameTemplate = "%s%04d.%s";
 
     bool getNextFilename(std::string &strFile);
+    void fileNameForNumber(uint32_t number, char *szBuffer, size_t length);
+    bool fileNumberExists(uint32_t number);
     bool openNextLogFile();
     bool openCurrentFile(void);
     bool openLogFile(bool bAppend = false);
+    bool checkCurrentFile(void);
+    void endOfOutput(void);
+    void bufferOutput(const uint8_t *data, size_t length);
+    void writeBuffer(bool bAll);
 
     std::string _currentFilename;
     flxIFileSystem *_theFS;
@@ -109,4 +198,17 @@ class flxFileRotate : public flxActionType<flxFileRotate>, public flxWriter
     flxFSFile _currentFile;
 
     bool _headerWritten;
+
+    // write-behind buffer
+    uint8_t *_writeBuffer;
+    uint32_t _bufferSize;
+    uint32_t _bufferUsed;
+    uint32_t _filePosition;
+
+    uint32_t _secsFlushInterval;
+    bool _writeError;
+
+    flxJob _jobFlush;
+
+    uint32_t _rotateSizeMB;
 };
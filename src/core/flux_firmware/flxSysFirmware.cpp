@@ -52,6 +52,7 @@ void flxSysFirmware::restartDevice()
     // Now
     flxLog_N(F("Restarting the device..."));
 
+    flxSendEvent(flxEvent::kOnSystemRestart);
     delay(500);
 
     esp_restart();
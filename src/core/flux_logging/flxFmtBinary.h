@@ -0,0 +1,461 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// A binary output formatter - for high rate logging to files
+//
+
+#pragma once
+
+#include "flxCore.h"
+#include "flxOutput.h"
+#include "flxUtils.h"
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// File layout
+//
+// The output is a sequence of blocks. All values are little-endian.
+//
+//      Block:      magic (2 bytes, 0xF1 0x58), type (uint8), reserved (uint8), payload length (uint32)
+//                  payload
+//                  CRC32 of the block header and payload (uint32)
+//
+// Block types:
+//
+//  Schema  ('S')   Written at start, when the layout of an observation changes, and on request
+//                  (new file). Describes the values in the records that follow:
+//
+//                      version (uint8), reserved (uint8), number of fields (uint16), title (string)
+//                      for each field:
+//                          type (uint8 - flxDataType_t), number of dimensions (uint8 - 0 for a scalar),
+//                          dimensions (uint16 each), name (string - "{section}.{tag}")
+//
+//  Record  ('R')   One per observation:
+//
+//                      sequence number (uint32), the field values in schema order
+//
+//                  Values are written at their native size - bool as uint8, float/double as IEEE 754.
+//                  Arrays are written flat, in row-major order.
+//
+//  Sync    ('Y')   Written after each schema and every kBinarySyncInterval records. The payload is a
+//                  fixed pattern followed by the next record sequence number (uint32). Allows a reader to
+//                  find a block boundary after damaged data (power loss).
+//
+// Strings are written as a length (uint16) followed by the characters - no terminator.
+//
+// The tool in tools/flxBinaryToCSV converts a binary log file to CSV. tools/flxBinaryRoundTrip checks
+// the output of this formatter decodes to the values logged - run it after changing the layout.
+
+#define kBinaryMagic0 0xF1
+#define kBinaryMagic1 0x58
+#define kBinaryVersion 1
+
+#define kBinaryBlockSchema 'S'
+#define kBinaryBlockRecord 'R'
+#define kBinaryBlockSync 'Y'
+
+// magic(2), type, reserved, length(4)
+#define kBinaryBlockHeaderSize 8
+
+// A sync block is written after this many records
+#define kBinarySyncInterval 32
+
+#define kBinaryMaxString 0xFFFF
+
+static const uint8_t kBinarySyncPattern[] = {0xA5, 0x5A, 'F', 'L', 'X', 'S', 'Y', 'N'};
+
+class flxFormatBinary : public flxOutputFormat
+{
+
+  public:
+    //-----------------------------------------------------------------
+    flxFormatBinary() : _sequence{0}, _sinceSync{0}, _section_name{nullptr}, _writeSchema{true}
+    {
+    }
+
+    //-----------------------------------------------------------------
+    // value methods
+    void logValue(const std::string &tag, bool value)
+    {
+        add_field(tag, flxTypeBool);
+        append_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, int8_t value)
+    {
+        add_field(tag, flxTypeInt8);
+        append_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, int16_t value)
+    {
+        add_field(tag, flxTypeInt16);
+        append_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, int32_t value)
+    {
+        add_field(tag, flxTypeInt32);
+        append_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, uint8_t value)
+    {
+        add_field(tag, flxTypeUInt8);
+        append_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, uint16_t value)
+    {
+        add_field(tag, flxTypeUInt16);
+        append_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, uint32_t value)
+    {
+        add_field(tag, flxTypeUInt32);
+        append_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, float value, uint16_t precision = 3)
+    {
+        add_field(tag, flxTypeFloat);
+        append_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, double value, uint16_t precision = 3)
+    {
+        add_field(tag, flxTypeDouble);
+        append_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, const char *value)
+    {
+        add_field(tag, flxTypeString);
+        append_string(_record, value);
+    }
+
+    //-----------------------------------------------------------------
+    // Arrays
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, flxDataArrayBool *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayInt8 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayInt16 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayInt32 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayUInt8 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayUInt16 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayUInt32 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayFloat *value, uint16_t precision = 3)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayDouble *value, uint16_t precision = 3)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayString *value)
+    {
+        writeOutArray(tag, value);
+    }
+
+    //-----------------------------------------------------------------
+    // structure cycle
+
+    void beginObservation(const char *szTitle = nullptr)
+    {
+        clear_buffers();
+
+        // schema - version, reserved, field count (set when written), title
+        _schema.push_back(kBinaryVersion);
+        _schema.push_back(0);
+        append_le(_schema, 0, 2);
+        append_string(_schema, szTitle);
+        _nFields = 0;
+
+        // record - sequence number
+        append_le(_record, _sequence, 4);
+    }
+
+    //-----------------------------------------------------------------
+    void beginSection(const char *szName)
+    {
+        _section_name = szName;
+    }
+
+    //-----------------------------------------------------------------
+    void endSection(void)
+    {
+        _section_name = nullptr;
+    }
+
+    //-----------------------------------------------------------------
+    void endObservation(void)
+    {
+        // no op
+    }
+
+    //-----------------------------------------------------------------
+    void writeObservation(void)
+    {
+        if (_nFields == 0)
+            return;
+
+        // patch in the field count
+        _schema[2] = _nFields & 0xFF;
+        _schema[3] = (_nFields >> 8) & 0xFF;
+
+        // Has the layout changed since the last observation? Or has a schema been requested?
+        //
+        // Clear the request before writing - a write can rotate the file, and the new file
+        // event requests the schema again (output_header()). Then the schema is written again,
+        // so the new file has it ahead of this record.
+        while (_writeSchema || _schema != _schema_cache)
+        {
+            _writeSchema = false;
+            _schema_cache = _schema;
+            write_block(kBinaryBlockSchema, _schema_cache);
+            write_sync();
+        }
+
+        write_block(kBinaryBlockRecord, _record);
+        _sequence++;
+
+        if (++_sinceSync >= kBinarySyncInterval)
+            write_sync();
+    }
+
+    //-----------------------------------------------------------------
+    void clearObservation(void)
+    {
+        clear_buffers();
+    }
+
+    //-----------------------------------------------------------------
+    void reset(void)
+    {
+        clear_buffers();
+        _schema_cache.clear();
+        _writeSchema = true;
+        _section_name = nullptr;
+    }
+
+    //-----------------------------------------------------------------
+    // Call this method to force the schema to be written with the next observation - for
+    // example when a new file is started (flxFileRotate on_newFile event).
+    void output_header(void)
+    {
+        _writeSchema = true;
+    }
+
+  private:
+    //-----------------------------------------------------------------
+    void clear_buffers(void)
+    {
+        // clear() retains the allocated memory - so the buffers settle at the observation size
+        _schema.clear();
+        _record.clear();
+        _block.clear();
+        _nFields = 0;
+    }
+
+    //-----------------------------------------------------------------
+    // Little endian output of an integer value of the given size (bytes)
+    static void append_le(std::vector<uint8_t> &buffer, uint64_t value, uint8_t size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            buffer.push_back(value & 0xFF);
+            value >>= 8;
+        }
+    }
+
+    //-----------------------------------------------------------------
+    static void append_string(std::vector<uint8_t> &buffer, const char *value)
+    {
+        size_t len = value ? strlen(value) : 0;
+        if (len > kBinaryMaxString)
+            len = kBinaryMaxString;
+
+        append_le(buffer, len, 2);
+        if (len > 0)
+            buffer.insert(buffer.end(), (const uint8_t *)value, (const uint8_t *)value + len);
+    }
+
+    //-----------------------------------------------------------------
+    // record value output
+    void append_value(bool value)
+    {
+        append_le(_record, value ? 1 : 0, 1);
+    }
+    void append_value(int8_t value)
+    {
+        append_le(_record, (uint8_t)value, 1);
+    }
+    void append_value(int16_t value)
+    {
+        append_le(_record, (uint16_t)value, 2);
+    }
+    void append_value(int32_t value)
+    {
+        append_le(_record, (uint32_t)value, 4);
+    }
+    void append_value(uint8_t value)
+    {
+        append_le(_record, value, 1);
+    }
+    void append_value(uint16_t value)
+    {
+        append_le(_record, value, 2);
+    }
+    void append_value(uint32_t value)
+    {
+        append_le(_record, value, 4);
+    }
+    void append_value(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        append_le(_record, bits, 4);
+    }
+    void append_value(double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        append_le(_record, bits, 8);
+    }
+    void append_value(char *value)
+    {
+        append_string(_record, value);
+    }
+
+    //-----------------------------------------------------------------
+    // Add a field to the schema - name is {section name}.{tag}
+    void add_field(const std::string &tag, flxDataType_t type, uint8_t nDims = 0, const uint16_t *dims = nullptr)
+    {
+        _schema.push_back(type);
+        _schema.push_back(nDims);
+        for (int i = 0; i < nDims; i++)
+            append_le(_schema, dims[i], 2);
+
+        size_t lenSection = _section_name ? strlen(_section_name) + 1 : 0;
+        size_t len = lenSection + tag.length();
+        if (len > kBinaryMaxString)
+            len = kBinaryMaxString;
+
+        append_le(_schema, len, 2);
+        if (lenSection > 0)
+        {
+            _schema.insert(_schema.end(), (const uint8_t *)_section_name,
+                           (const uint8_t *)_section_name + lenSection - 1);
+            _schema.push_back('.');
+        }
+        _schema.insert(_schema.end(), (const uint8_t *)tag.c_str(), (const uint8_t *)tag.c_str() + (len - lenSection));
+
+        _nFields++;
+    }
+
+    //-----------------------------------------------------------------
+    // Array support
+    //-----------------------------------------------------------------
+    template <typename T> void writeOutArray(const std::string &tag, flxDataArrayType<T> *theArray)
+    {
+        T *pData = theArray->get();
+
+        // no data - output an empty, one dimension array so the record still matches the schema
+        if (!pData)
+        {
+            static const uint16_t kEmptyDims[] = {0};
+            add_field(tag, theArray->type(), 1, kEmptyDims);
+            return;
+        }
+
+        add_field(tag, theArray->type(), theArray->n_dimensions(), theArray->dimensions());
+
+        size_t count = theArray->size();
+        for (size_t i = 0; i < count; i++)
+            append_value(pData[i]);
+    }
+
+    //-----------------------------------------------------------------
+    // Frame the payload into a block and send it to the writers
+    void write_block(uint8_t type, const std::vector<uint8_t> &payload)
+    {
+        _block.clear();
+        _block.push_back(kBinaryMagic0);
+        _block.push_back(kBinaryMagic1);
+        _block.push_back(type);
+        _block.push_back(0);
+        append_le(_block, payload.size(), 4);
+        _block.insert(_block.end(), payload.begin(), payload.end());
+
+        append_le(_block, flx_utils::calc_crc32(0, _block.data(), _block.size()), 4);
+
+        outputBinary(_block.data(), _block.size());
+    }
+
+    //-----------------------------------------------------------------
+    void write_sync(void)
+    {
+        _sync.clear();
+        _sync.insert(_sync.end(), kBinarySyncPattern, kBinarySyncPattern + sizeof(kBinarySyncPattern));
+        append_le(_sync, _sequence, 4);
+
+        write_block(kBinaryBlockSync, _sync);
+        _sinceSync = 0;
+    }
+
+    std::vector<uint8_t> _schema;
+    std::vector<uint8_t> _schema_cache;
+    std::vector<uint8_t> _record;
+    std::vector<uint8_t> _block;
+    std::vector<uint8_t> _sync;
+
+    uint16_t _nFields;
+    uint32_t _sequence;
+    uint32_t _sinceSync;
+
+    const char *_section_name;
+
+    bool _writeSchema;
+};
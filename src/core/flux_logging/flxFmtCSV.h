@@ -32,11 +32,11 @@ class flxFormatCSV : public flxOutputFormat
 {
 
   private:
+    // The header is built for every observation - it's how a change in the observation
+    // layout (schema) is detected. The buffer keeps its memory, so this doesn't allocate.
     void writeHeaderEntry(const std::string &tag)
     {
-        if ((_writeHeader & kHeaderWrite) == kHeaderWrite)
-            if (!append_to_header(tag))
-                flxLogM_W(kMsgErrSizeExceeded, "CVS header");
+        append_to_header(tag);
     }
 
   public:
@@ -53,9 +53,8 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        std::string stmp = flx_utils::to_string(value);
-        if (!append_csv_value(stmp, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_separator();
+        format_value(_data_buffer, value);
     }
 
     //-----------------------------------------------------------------
@@ -64,9 +63,8 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        std::string stmp = flx_utils::to_string(value);
-        if (!append_csv_value(stmp, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_separator();
+        format_value(_data_buffer, value);
     }
 
     //-----------------------------------------------------------------
@@ -75,9 +73,8 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        std::string stmp = flx_utils::to_string(value);
-        if (!append_csv_value(stmp, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_separator();
+        format_value(_data_buffer, value);
     }
 
     //-----------------------------------------------------------------
@@ -86,9 +83,8 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        std::string stmp = flx_utils::to_string(value);
-        if (!append_csv_value(stmp, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_separator();
+        format_value(_data_buffer, value);
     }
 
     //-----------------------------------------------------------------
@@ -97,9 +93,8 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        std::string stmp = flx_utils::to_string(value);
-        if (!append_csv_value(stmp, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_separator();
+        format_value(_data_buffer, value);
     }
 
     //-----------------------------------------------------------------
@@ -108,9 +103,8 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        std::string stmp = flx_utils::to_string(value);
-        if (!append_csv_value(stmp, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_separator();
+        format_value(_data_buffer, value);
     }
 
     //-----------------------------------------------------------------
@@ -119,9 +113,8 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        std::string stmp = flx_utils::to_string(value);
-        if (!append_csv_value(stmp, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_separator();
+        format_value(_data_buffer, value);
     }
 
     //-----------------------------------------------------------------
@@ -135,11 +128,8 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        char szBuffer[32] = {'\0'};
-        (void)flx_utils::dtostr(value, szBuffer, sizeof(szBuffer), precision);
-
-        if (!append_csv_value(szBuffer, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_separator();
+        format_value(_data_buffer, value, precision);
     }
     //-----------------------------------------------------------------
     void logValue(const std::string &tag, const std::string &value)
@@ -147,8 +137,7 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        if (!append_csv_value(value, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_value(value.c_str());
     }
     //-----------------------------------------------------------------
     void logValue(const std::string &tag, const char *value)
@@ -156,8 +145,7 @@ class flxFormatCSV : public flxOutputFormat
         // header?
         writeHeaderEntry(tag);
 
-        if (!append_csv_value(std::string(value), _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+        append_data_value(value);
     }
 
     void logValue(const std::string &tag, flxDataArrayBool *value)
@@ -221,6 +209,20 @@ class flxFormatCSV : public flxOutputFormat
         writeHeaderEntry(tag);
         writeOutArray(value);
     }
+    //-----------------------------------------------------------------
+    // Multi-rate logging - a value not sampled in this observation is an empty field, so the columns
+    // (and header) don't change
+    bool fixedLayout(void)
+    {
+        return true;
+    }
+
+    void logUnchanged(const std::string &tag)
+    {
+        writeHeaderEntry(tag);
+        append_data_separator();
+    }
+
     //-----------------------------------------------------------
     // structure cycle
 
@@ -250,7 +252,7 @@ class flxFormatCSV : public flxOutputFormat
     virtual void writeObservation()
     {
         // Is the buffer empty?
-        if (_data_buffer.length() == 0)
+        if (_nDataFields == 0)
             return;
 
         // First run? output mime type
@@ -259,9 +261,16 @@ class flxFormatCSV : public flxOutputFormat
             outputObservation("Content-Type: text/csv", flxLineTypeMime);
             _isFirstRun = false;
         }
+        // Has the schema (header) changed since the last observation? If so, cache it and write it out
+        if (_header_buffer != _header_cache)
+        {
+            _header_cache = _header_buffer;
+            _writeHeader = (flxFmtCSVHeader_t)(_writeHeader | kHeaderWrite);
+        }
+
         // Write out the header?
-        if ((_writeHeader & kHeaderWrite) == kHeaderWrite && _header_buffer.length() > 0)
-            outputObservation(_header_buffer.c_str(), flxLineTypeHeader);
+        if ((_writeHeader & kHeaderWrite) == kHeaderWrite && _header_cache.length() > 0)
+            outputObservation(_header_cache.c_str(), flxLineTypeHeader);
 
         outputObservation(_data_buffer.c_str());
     }
@@ -281,6 +290,7 @@ class flxFormatCSV : public flxOutputFormat
     void reset(void)
     {
         clear_buffers();
+        _header_cache.clear();
         _writeHeader = kHeaderWrite;
         _section_name = nullptr;
         _inObservation = false;
@@ -317,29 +327,97 @@ class flxFormatCSV : public flxOutputFormat
     {
 
         // Note: clear() empties the string, but retains memory.
-        //       shrink_to_fit() - frees memory
         //
-        // Since the header is normally printed very rarely,
-        // we shrink it.
-        //
-        // For data buffer, it's since is consistent between calls,
-        // so just clear it.
+        // The size of the header and data is consistent between calls, so once the
+        // buffers have grown to size, no memory is allocated formatting an observation.
 
         _header_buffer.clear();
-        _header_buffer.shrink_to_fit();
         _data_buffer.clear();
+        _nDataFields = 0;
     }
 
-    bool append_csv_value(const std::string &value, std::string &buffer)
+    //-----------------------------------------------------------------
+    inline void append_csv_separator(std::string &buffer)
     {
-
         if (buffer.length() > 0)
             buffer += ',';
+    }
 
-        buffer += value;
+    //-----------------------------------------------------------------
+    // Data fields are separated by count, not buffer length - the first field can be empty
+    inline void append_data_separator(void)
+    {
+        if (_nDataFields++ > 0)
+            _data_buffer += ',';
+    }
 
-        return true;
+    //-----------------------------------------------------------------
+    void append_data_value(const char *value)
+    {
+        append_data_separator();
+
+        if (value)
+            _data_buffer += value;
+    }
+
+    //-----------------------------------------------------------------
+    void append_csv_value(const char *value, std::string &buffer)
+    {
+        append_csv_separator(buffer);
+
+        if (value)
+            buffer += value;
     }
+
+    //-----------------------------------------------------------------
+    // Value formatting - values are formatted on the stack, then appended to the
+    // buffer. No temporary strings are created.
+
+    void format_value(std::string &buffer, bool value)
+    {
+        buffer += value ? "true" : "false";
+    }
+    void format_value(std::string &buffer, int32_t value)
+    {
+        char szBuffer[16];
+        buffer.append(szBuffer, flx_utils::itostr(value, szBuffer, sizeof(szBuffer)));
+    }
+    void format_value(std::string &buffer, int8_t value)
+    {
+        format_value(buffer, (int32_t)value);
+    }
+    void format_value(std::string &buffer, int16_t value)
+    {
+        format_value(buffer, (int32_t)value);
+    }
+    void format_value(std::string &buffer, uint32_t value)
+    {
+        char szBuffer[16];
+        buffer.append(szBuffer, flx_utils::utostr(value, szBuffer, sizeof(szBuffer)));
+    }
+    void format_value(std::string &buffer, uint8_t value)
+    {
+        format_value(buffer, (uint32_t)value);
+    }
+    void format_value(std::string &buffer, uint16_t value)
+    {
+        format_value(buffer, (uint32_t)value);
+    }
+    void format_value(std::string &buffer, double value, uint16_t precision)
+    {
+        char szBuffer[32];
+        buffer.append(szBuffer, flx_utils::dtostr(value, szBuffer, sizeof(szBuffer), precision));
+    }
+    void format_value(std::string &buffer, float value, uint16_t precision)
+    {
+        format_value(buffer, (double)value, precision);
+    }
+    void format_value(std::string &buffer, char *value)
+    {
+        if (value)
+            buffer += value;
+    }
+
     //-----------------------------------------------------------------
     bool append_to_header(const std::string &tag)
     {
@@ -356,26 +434,15 @@ class flxFormatCSV : public flxOutputFormat
         }
         strlcat(szBuffer, tag.c_str(), sizeof(szBuffer));
 
-        return append_csv_value(szBuffer, _header_buffer);
+        append_csv_value(szBuffer, _header_buffer);
+
+        return true;
     }
 
     //-----------------------------------------------------------------
     // Array support
     //-----------------------------------------------------------------
 
-    template <typename T> void formatArrayValue(std::string &sData, T value, uint16_t precision = 3)
-    {
-        sData += flx_utils::to_string(value);
-    }
-    void formatArrayValue(std::string &sData, float value, uint16_t precision)
-    {
-        sData += flx_utils::to_string(value, precision);
-    }
-    void formatArrayValue(std::string &sData, double value, uint16_t precision)
-    {
-        sData += flx_utils::to_string(value, precision);
-    }
-
     template <typename T>
     void writeOutArrayDimension(std::string &sData, T *&pData, flxDataArrayType<T> *theArray, uint16_t currentDim,
                                 uint16_t precision = 3)
@@ -385,17 +452,12 @@ class flxFormatCSV : public flxOutputFormat
         // Write out the data?
         if (currentDim == theArray->n_dimensions() - 1)
         {
-            bool isFloat = (theArray->type() == flxTypeFloat || theArray->type() == flxTypeDouble);
-
             for (int i = 0; i < theArray->dimensions()[currentDim]; i++)
             {
                 if (i > 0)
                     sData += ",";
 
-                if (isFloat)
-                    formatArrayValue(sData, *pData++, precision);
-                else
-                    formatArrayValue(sData, *pData++);
+                formatArrayValue(sData, *pData++, precision);
             }
         }
         else
@@ -411,26 +473,43 @@ class flxFormatCSV : public flxOutputFormat
         }
         sData += "]";
     }
+
+    // array values - precision is only used by float types
+    template <typename T> void formatArrayValue(std::string &sData, T value, uint16_t precision)
+    {
+        format_value(sData, value);
+    }
+    void formatArrayValue(std::string &sData, float value, uint16_t precision)
+    {
+        format_value(sData, value, precision);
+    }
+    void formatArrayValue(std::string &sData, double value, uint16_t precision)
+    {
+        format_value(sData, value, precision);
+    }
+
     //-----------------------------------------------------------------
+    // Arrays are written directly into the data buffer
     template <typename T> void writeOutArray(flxDataArrayType<T> *theArray, uint16_t precision = 3)
     {
-        std::string sData = "";
+        append_data_separator();
 
         T *pData = theArray->get();
 
-        if (!pData)
-            sData = "[]";
+        if (!pData || theArray->n_dimensions() == 0)
+            _data_buffer += "[]";
         else
-            writeOutArrayDimension(sData, pData, theArray, 0, precision);
-
-        if (!append_csv_value(sData, _data_buffer))
-            flxLogM_E(kMsgErrSizeExceeded, "CVS buffer");
+            writeOutArrayDimension(_data_buffer, pData, theArray, 0, precision);
     }
 
     //-----------------------------------------------------------------
 
     std::string _header_buffer;
     std::string _data_buffer;
+    uint16_t _nDataFields;
+
+    // The last header written - used to detect changes in the observation schema
+    std::string _header_cache;
 
     char *_section_name;
 
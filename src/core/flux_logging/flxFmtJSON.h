@@ -14,14 +14,30 @@
 
 #pragma once
 
+#include "flxJSONWriterSink.h"
 #include "flxOutput.h"
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
 
+#include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
 
+// Output modes for the JSON formatter
+typedef enum
+{
+    // A complete JSON document is output for each observation
+    flxJSONModeFull = 0,
+
+    // The layout of the observation - title, section and value names - is output as a
+    // schema record when it changes, followed by values only records of the form:
+    //      [[section 1 values],[section 2 values],...]
+    flxJSONModeSchemaOnce
+} flxJSONMode_t;
+
+//-----------------------------------------------------------------
 // define a simple interface to output the actual JSON document, not
 // the serialized string.
 //
@@ -38,7 +54,8 @@ template <std::size_t BUFFER_SIZE> class flxFormatJSON : public flxOutputFormat
   public:
     //-----------------------------------------------------------------
     flxFormatJSON()
-        : _spDoc{nullptr}, _buffer_size{BUFFER_SIZE}, _isFirstRun{true}, _pSectionName{nullptr}, _maxSize{0} {};
+        : _spDoc{nullptr}, _buffer_size{BUFFER_SIZE}, _isFirstRun{true}, _pSectionName{nullptr}, _maxSize{0},
+          _streaming{false}, _mode{flxJSONModeFull}, _sendSchema{true} {};
 
     //-----------------------------------------------------------------
     // value methods
@@ -157,6 +174,20 @@ template <std::size_t BUFFER_SIZE> class flxFormatJSON : public flxOutputFormat
     {
         writeOutArray(tag, value);
     }
+    //-----------------------------------------------------------------
+    // Multi-rate logging. A full document leaves out values that aren't sampled - the names are in
+    // the document. In schema once mode, they're output as null, so the schema doesn't change.
+    bool fixedLayout(void)
+    {
+        return _mode == flxJSONModeSchemaOnce;
+    }
+
+    void logUnchanged(const std::string &tag)
+    {
+        if (_mode == flxJSONModeSchemaOnce && _spDoc)
+            _jSection[tag] = nullptr;
+    }
+
     //-----------------------------------------------------------------
     // structure cycle
 
@@ -215,27 +246,54 @@ template <std::size_t BUFFER_SIZE> class flxFormatJSON : public flxOutputFormat
         if (_spDoc->isNull())
             return;
 
-        char szBuffer[_buffer_size + 1];
-        size_t n = serializeJson(*_spDoc, szBuffer, _buffer_size);
-
-        if (n > _maxSize)
-            _maxSize = n;
-
-        // TODO: Add Error output
-        if (n > _buffer_size + 1)
-        {
-            flxLogM_W(kMsgErrSizeExceeded, "JSON output buffer");
-            szBuffer[_buffer_size] = '\0';
-        }
-
         // dump out mime type
         if (_isFirstRun)
         {
             outputObservation("Content-Type: application/json", flxLineTypeMime);
             _isFirstRun = false;
         }
-        // Send the JSON string to output writers/destinations
-        outputObservation(szBuffer);
+
+        // Sort out which writers get the output streamed, and which need the complete line
+        _streamWriters.clear();
+        _bufferWriters.clear();
+        for (auto aWriter : writers())
+        {
+            if (_streaming && aWriter->acceptsPartialLines())
+                _streamWriters.push_back(aWriter);
+            else
+                _bufferWriters.push_back(aWriter);
+        }
+
+        if (_bufferWriters.size() > 0)
+            _sink.reserve(_buffer_size);
+
+        size_t n;
+
+        if (_mode == flxJSONModeSchemaOnce)
+        {
+            // Has the layout changed since last output? Or has a resend been requested?
+            buildSchema();
+            if (_sendSchema || _schemaBuffer != _schemaCache)
+            {
+                _schemaCache = _schemaBuffer;
+                outputObservation(_schemaCache.c_str());
+                _sendSchema = false;
+            }
+
+            _sink.begin(_streamWriters, _bufferWriters);
+            writeValues(_sink);
+            n = _sink.end();
+        }
+        else
+        {
+            // Send the JSON string to output writers/destinations
+            _sink.begin(_streamWriters, _bufferWriters);
+            serializeJson(*_spDoc, _sink);
+            n = _sink.end();
+        }
+
+        if (n > _maxSize)
+            _maxSize = n;
 
         // if we have any output writers that want the actual json document,
         // send the document.
@@ -280,7 +338,46 @@ template <std::size_t BUFFER_SIZE> class flxFormatJSON : public flxOutputFormat
     }
 
     //-----------------------------------------------------------------
-    // TODO: Rethink the buffer settings -- appears to not be needed with latest ArduinoJson version.
+    // When streaming is enabled, output is sent to writers that accept partial lines (serial, file)
+    // in kJSONStreamChunkSize pieces as it's serialized, rather than building the complete line in
+    // memory first. Message based writers (IoT) always get the complete line.
+    void setStreaming(bool enable)
+    {
+        _streaming = enable;
+    }
+
+    //-----------------------------------------------------------------
+    bool streaming(void)
+    {
+        return _streaming;
+    }
+
+    //-----------------------------------------------------------------
+    void setMode(flxJSONMode_t mode)
+    {
+        if (mode != _mode)
+            _sendSchema = true;
+
+        _mode = mode;
+    }
+
+    //-----------------------------------------------------------------
+    flxJSONMode_t mode(void)
+    {
+        return _mode;
+    }
+
+    //-----------------------------------------------------------------
+    // Call this method to force the schema record to output with the next observation
+    // when in flxJSONModeSchemaOnce mode - for example, when a new log file is started.
+    void output_schema(void)
+    {
+        _sendSchema = true;
+    }
+
+    //-----------------------------------------------------------------
+    // The buffer size is the initial size of the line buffer used for writers that need a
+    // complete line of output. The buffer grows as needed, output is not truncated.
     void setBufferSize(size_t new_size)
     {
         // Same?
@@ -310,6 +407,129 @@ template <std::size_t BUFFER_SIZE> class flxFormatJSON : public flxOutputFormat
     }
 
   protected:
+    //-----------------------------------------------------------------
+    // Append a quoted, escaped JSON string to the provided buffer. Control characters are escaped -
+    // JSON doesn't allow them in a string.
+    void appendJSONString(std::string &buffer, const char *value)
+    {
+        static const char hexDigits[] = "0123456789abcdef";
+
+        buffer += '"';
+        for (const char *p = value; p && *p; p++)
+        {
+            uint8_t c = (uint8_t)*p;
+            switch (c)
+            {
+            case '"':
+            case '\\':
+                buffer += '\\';
+                buffer += *p;
+                break;
+            case '\n':
+                buffer += "\\n";
+                break;
+            case '\r':
+                buffer += "\\r";
+                break;
+            case '\t':
+                buffer += "\\t";
+                break;
+            default:
+                if (c < 0x20)
+                {
+                    buffer += "\\u00";
+                    buffer += hexDigits[c >> 4];
+                    buffer += hexDigits[c & 0x0F];
+                }
+                else
+                    buffer += *p;
+                break;
+            }
+        }
+        buffer += '"';
+    }
+
+    //-----------------------------------------------------------------
+    // Build the schema record for the current document - the title and the value names for
+    // each section, in the order the values are output:
+    //
+    //      {"schema":{"title":"...","sections":{"section 1":["name 1","name 2"],...}}}
+    void buildSchema(void)
+    {
+        _schemaBuffer.clear();
+        _schemaBuffer += "{\"schema\":{";
+
+        JsonObjectConst jRoot = _spDoc->as<JsonObjectConst>();
+
+        const char *szTitle = jRoot["title"];
+        if (szTitle)
+        {
+            _schemaBuffer += "\"title\":";
+            appendJSONString(_schemaBuffer, szTitle);
+            _schemaBuffer += ',';
+        }
+        _schemaBuffer += "\"sections\":{";
+
+        bool bFirstSection = true;
+        for (JsonPairConst jSection : jRoot)
+        {
+            if (!jSection.value().is<JsonObjectConst>())
+                continue;
+
+            if (!bFirstSection)
+                _schemaBuffer += ',';
+            bFirstSection = false;
+
+            appendJSONString(_schemaBuffer, jSection.key().c_str());
+            _schemaBuffer += ":[";
+
+            bool bFirstValue = true;
+            for (JsonPairConst jValue : jSection.value().as<JsonObjectConst>())
+            {
+                if (!bFirstValue)
+                    _schemaBuffer += ',';
+                bFirstValue = false;
+
+                appendJSONString(_schemaBuffer, jValue.key().c_str());
+            }
+            _schemaBuffer += ']';
+        }
+        _schemaBuffer += "}}}";
+    }
+
+    //-----------------------------------------------------------------
+    // Output the values of the current document, with no names, in schema order
+    void writeValues(Print &output)
+    {
+        JsonObjectConst jRoot = _spDoc->as<JsonObjectConst>();
+
+        output.write('[');
+
+        bool bFirstSection = true;
+        for (JsonPairConst jSection : jRoot)
+        {
+            if (!jSection.value().is<JsonObjectConst>())
+                continue;
+
+            if (!bFirstSection)
+                output.write(',');
+            bFirstSection = false;
+
+            output.write('[');
+            bool bFirstValue = true;
+            for (JsonPairConst jValue : jSection.value().as<JsonObjectConst>())
+            {
+                if (!bFirstValue)
+                    output.write(',');
+                bFirstValue = false;
+
+                serializeJson(jValue.value(), output);
+            }
+            output.write(']');
+        }
+        output.write(']');
+    }
+
     //-----------------------------------------------------------------
     template <typename T>
     void writeOutArrayDimension(JsonArray &jsonArray, T *&pData, flxDataArrayType<T> *theArray, uint16_t currentDim)
@@ -363,4 +583,16 @@ template <std::size_t BUFFER_SIZE> class flxFormatJSON : public flxOutputFormat
     const char *_pSectionName;
 
     uint32_t _maxSize;
+
+    bool _streaming;
+    flxJSONMode_t _mode;
+    bool _sendSchema;
+
+    // Output routing - reused between observations
+    flxJSONWriterSink _sink;
+    std::vector<flxWriter *> _streamWriters;
+    std::vector<flxWriter *> _bufferWriters;
+
+    std::string _schemaBuffer;
+    std::string _schemaCache;
 };
@@ -0,0 +1,524 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// A MessagePack output formatter - compact observation payloads for IoT connections
+//
+
+#pragma once
+
+#include "flxCore.h"
+#include "flxOutput.h"
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Payload layout
+//
+// Each output is a MessagePack (https://msgpack.org) array. The value names are replaced by
+// small integer ids, using a dictionary that is sent to the destination:
+//
+//  Dictionary      [0, {id: "{section}.{tag}", ...}]
+//
+//                  A value logged outside a section is named by its tag alone.
+//
+//                  Output as a header line (flxLineTypeHeader) when new value names are seen. Ids
+//                  don't change while running, so the latest dictionary covers all earlier
+//                  observations. Connections set the latest dictionary as their outbox context
+//                  (flxOutbox::setContext()) - it's sent ahead of their next message, and again at the
+//                  start of each session. Messages saved to the outbox spill file are stored after the
+//                  dictionary in effect when they were saved, so after a restart they're sent with the
+//                  dictionary of the run that logged them.
+//
+//  Observation     [1, sequence number, {id: value, ...}]
+//
+//                  Output as a data line (flxLineTypeData). Values use the smallest MessagePack
+//                  encoding - floats as float32. Arrays are nested MessagePack arrays, one level per
+//                  dimension.
+//
+// The formatter outputs to writers that accept binary data (flxWriter::acceptsBinary()).
+
+#define kMsgPackTypeDictionary 0
+#define kMsgPackTypeObservation 1
+
+#define kMsgPackContentType "application/msgpack"
+
+// Payload formats - used by IoT connections to select the format they send
+#define kPayloadFormatJSON 0
+#define kPayloadFormatMsgPack 1
+
+class flxFormatMsgPack : public flxOutputFormat
+{
+
+  public:
+    //-----------------------------------------------------------------
+    flxFormatMsgPack()
+        : _buffer{&_values}, _nValues{0}, _sequence{0}, _section_name{nullptr}, _writeDictionary{true}
+    {
+    }
+
+    //-----------------------------------------------------------------
+    // value methods
+    void logValue(const std::string &tag, bool value)
+    {
+        add_key(tag);
+        pack_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, int8_t value)
+    {
+        add_key(tag);
+        pack_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, int16_t value)
+    {
+        add_key(tag);
+        pack_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, int32_t value)
+    {
+        add_key(tag);
+        pack_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, uint8_t value)
+    {
+        add_key(tag);
+        pack_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, uint16_t value)
+    {
+        add_key(tag);
+        pack_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, uint32_t value)
+    {
+        add_key(tag);
+        pack_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, float value, uint16_t precision = 3)
+    {
+        add_key(tag);
+        pack_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, double value, uint16_t precision = 3)
+    {
+        add_key(tag);
+        pack_value(value);
+    }
+
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, const char *value)
+    {
+        add_key(tag);
+        pack_string(value);
+    }
+
+    //-----------------------------------------------------------------
+    // Arrays
+    //-----------------------------------------------------------------
+    void logValue(const std::string &tag, flxDataArrayBool *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayInt8 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayInt16 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayInt32 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayUInt8 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayUInt16 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayUInt32 *value)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayFloat *value, uint16_t precision = 3)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayDouble *value, uint16_t precision = 3)
+    {
+        writeOutArray(tag, value);
+    }
+    void logValue(const std::string &tag, flxDataArrayString *value)
+    {
+        writeOutArray(tag, value);
+    }
+
+    //-----------------------------------------------------------------
+    // structure cycle
+
+    void beginObservation(const char *szTitle = nullptr)
+    {
+        clear_buffers();
+    }
+
+    //-----------------------------------------------------------------
+    void beginSection(const char *szName)
+    {
+        _section_name = szName;
+    }
+
+    //-----------------------------------------------------------------
+    void endSection(void)
+    {
+        _section_name = nullptr;
+    }
+
+    //-----------------------------------------------------------------
+    void endObservation(void)
+    {
+        // no op
+    }
+
+    //-----------------------------------------------------------------
+    void writeObservation(void)
+    {
+        if (_nValues == 0)
+            return;
+
+        // New value names? Send the dictionary first
+        if (_writeDictionary)
+        {
+            write_dictionary();
+            _writeDictionary = false;
+        }
+
+        // The value count isn't known until the end - so the header is built, then the values added
+        _buffer = &_message;
+        _message.clear();
+        pack_array_header(3);
+        pack_value((uint8_t)kMsgPackTypeObservation);
+        pack_value(_sequence);
+        pack_map_header(_nValues);
+        _message.insert(_message.end(), _values.begin(), _values.end());
+
+        outputBinary(_message.data(), _message.size(), flxLineTypeData);
+
+        _sequence++;
+    }
+
+    //-----------------------------------------------------------------
+    void clearObservation(void)
+    {
+        clear_buffers();
+    }
+
+    //-----------------------------------------------------------------
+    void reset(void)
+    {
+        clear_buffers();
+        _writeDictionary = true;
+        _section_name = nullptr;
+    }
+
+    //-----------------------------------------------------------------
+    // Call this method to force the dictionary to be output with the next observation
+    void output_header(void)
+    {
+        _writeDictionary = true;
+    }
+
+  private:
+    //-----------------------------------------------------------------
+    void clear_buffers(void)
+    {
+        // clear() retains the allocated memory - so the buffers settle at the observation size
+        _values.clear();
+        _buffer = &_values;
+        _nValues = 0;
+    }
+
+    //-----------------------------------------------------------------
+    // Big endian output of an integer value of the given size (bytes)
+    void append_be(uint64_t value, uint8_t size)
+    {
+        for (int i = size - 1; i >= 0; i--)
+            _buffer->push_back((value >> (i * 8)) & 0xFF);
+    }
+
+    //-----------------------------------------------------------------
+    // MessagePack encoding
+    //-----------------------------------------------------------------
+    void pack_uint(uint64_t value)
+    {
+        if (value < 0x80)
+            _buffer->push_back(value); // positive fixint
+        else if (value <= 0xFF)
+        {
+            _buffer->push_back(0xCC);
+            append_be(value, 1);
+        }
+        else if (value <= 0xFFFF)
+        {
+            _buffer->push_back(0xCD);
+            append_be(value, 2);
+        }
+        else if (value <= 0xFFFFFFFF)
+        {
+            _buffer->push_back(0xCE);
+            append_be(value, 4);
+        }
+        else
+        {
+            _buffer->push_back(0xCF);
+            append_be(value, 8);
+        }
+    }
+
+    //-----------------------------------------------------------------
+    void pack_int(int64_t value)
+    {
+        if (value >= 0)
+            pack_uint(value);
+        else if (value >= -32)
+            _buffer->push_back((uint8_t)value); // negative fixint
+        else if (value >= INT8_MIN)
+        {
+            _buffer->push_back(0xD0);
+            append_be((uint8_t)value, 1);
+        }
+        else if (value >= INT16_MIN)
+        {
+            _buffer->push_back(0xD1);
+            append_be((uint16_t)value, 2);
+        }
+        else
+        {
+            _buffer->push_back(0xD2);
+            append_be((uint32_t)value, 4);
+        }
+    }
+
+    //-----------------------------------------------------------------
+    void pack_header(uint32_t count, uint8_t fixType, uint8_t type16)
+    {
+        if (count <= 15)
+            _buffer->push_back(fixType | count);
+        else if (count <= 0xFFFF)
+        {
+            _buffer->push_back(type16);
+            append_be(count, 2);
+        }
+        else
+        {
+            _buffer->push_back(type16 + 1);
+            append_be(count, 4);
+        }
+    }
+    void pack_array_header(uint32_t count)
+    {
+        pack_header(count, 0x90, 0xDC);
+    }
+    void pack_map_header(uint32_t count)
+    {
+        pack_header(count, 0x80, 0xDE);
+    }
+
+    //-----------------------------------------------------------------
+    void pack_string(const char *value)
+    {
+        size_t len = value ? strlen(value) : 0;
+
+        if (len <= 31)
+            _buffer->push_back(0xA0 | len); // fixstr
+        else if (len <= 0xFF)
+        {
+            _buffer->push_back(0xD9);
+            append_be(len, 1);
+        }
+        else if (len <= 0xFFFF)
+        {
+            _buffer->push_back(0xDA);
+            append_be(len, 2);
+        }
+        else
+        {
+            _buffer->push_back(0xDB);
+            append_be(len, 4);
+        }
+        if (len > 0)
+            _buffer->insert(_buffer->end(), (const uint8_t *)value, (const uint8_t *)value + len);
+    }
+
+    //-----------------------------------------------------------------
+    void pack_value(bool value)
+    {
+        _buffer->push_back(value ? 0xC3 : 0xC2);
+    }
+    void pack_value(int8_t value)
+    {
+        pack_int(value);
+    }
+    void pack_value(int16_t value)
+    {
+        pack_int(value);
+    }
+    void pack_value(int32_t value)
+    {
+        pack_int(value);
+    }
+    void pack_value(uint8_t value)
+    {
+        pack_uint(value);
+    }
+    void pack_value(uint16_t value)
+    {
+        pack_uint(value);
+    }
+    void pack_value(uint32_t value)
+    {
+        pack_uint(value);
+    }
+    void pack_value(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        _buffer->push_back(0xCA);
+        append_be(bits, 4);
+    }
+    void pack_value(double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        _buffer->push_back(0xCB);
+        append_be(bits, 8);
+    }
+    void pack_value(char *value)
+    {
+        pack_string(value);
+    }
+
+    //-----------------------------------------------------------------
+    // Add the key (id) for a value - name is {section name}.{tag}, or just the tag outside a section. New
+    // names are added to the dictionary.
+    void add_key(const std::string &tag)
+    {
+        // note: assign() reuses the name string memory
+        if (_section_name && *_section_name)
+        {
+            _name.assign(_section_name);
+            _name += '.';
+            _name += tag;
+        }
+        else
+            _name.assign(tag);
+
+        auto it = _ids.find(_name);
+        uint32_t id;
+        if (it != _ids.end())
+            id = it->second;
+        else
+        {
+            id = _ids.size();
+            _ids.emplace(_name, id);
+            _writeDictionary = true;
+        }
+
+        pack_uint(id);
+        _nValues++;
+    }
+
+    //-----------------------------------------------------------------
+    void write_dictionary(void)
+    {
+        _buffer = &_message;
+        _message.clear();
+        pack_array_header(2);
+        pack_value((uint8_t)kMsgPackTypeDictionary);
+        pack_map_header(_ids.size());
+        for (const auto &it : _ids)
+        {
+            pack_uint(it.second);
+            pack_string(it.first.c_str());
+        }
+
+        outputBinary(_message.data(), _message.size(), flxLineTypeHeader);
+
+        _buffer = &_values;
+    }
+
+    //-----------------------------------------------------------------
+    // Array support - nested arrays, one level for each dimension
+    //-----------------------------------------------------------------
+    template <typename T> void pack_array(T *pData, const uint16_t *dims, uint8_t nDims, size_t &index)
+    {
+        pack_array_header(dims[0]);
+        for (int i = 0; i < dims[0]; i++)
+        {
+            if (nDims == 1)
+                pack_value(pData[index++]);
+            else
+                pack_array(pData, dims + 1, nDims - 1, index);
+        }
+    }
+
+    //-----------------------------------------------------------------
+    template <typename T> void writeOutArray(const std::string &tag, flxDataArrayType<T> *theArray)
+    {
+        add_key(tag);
+
+        T *pData = theArray->get();
+        if (!pData || theArray->n_dimensions() == 0)
+        {
+            pack_array_header(0);
+            return;
+        }
+
+        size_t index = 0;
+        pack_array(pData, theArray->dimensions(), theArray->n_dimensions(), index);
+    }
+
+    // encoded values of the current observation, and the output message
+    std::vector<uint8_t> _values;
+    std::vector<uint8_t> _message;
+    std::vector<uint8_t> *_buffer;
+    uint32_t _nValues;
+
+    // value name -> id
+    std::map<std::string, uint32_t> _ids;
+    std::string _name;
+
+    uint32_t _sequence;
+
+    const char *_section_name;
+
+    bool _writeDictionary;
+};
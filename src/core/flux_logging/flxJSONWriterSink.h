@@ -0,0 +1,132 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Print sink for the JSON output formatter - streams serialized output to writers
+//
+
+#pragma once
+
+#include "flxCoreInterface.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Size of the chunks used when streaming serialized JSON to writers
+#define kJSONStreamChunkSize 128
+
+//-----------------------------------------------------------------
+// Print sink used to route serialized JSON output to writers.
+//
+// Streamed writers are sent the output in kJSONStreamChunkSize pieces as it is generated,
+// buffered writers are sent the complete line at the end. Buffers are retained between
+// observations.
+
+class flxJSONWriterSink : public Print
+{
+  public:
+    flxJSONWriterSink() : _nChunk{0}, _nTotal{0}, _streamWriters{nullptr}, _bufferWriters{nullptr}
+    {
+    }
+
+    //-----------------------------------------------------------------
+    void begin(const std::vector<flxWriter *> &streamWriters, const std::vector<flxWriter *> &bufferWriters)
+    {
+        _streamWriters = &streamWriters;
+        _bufferWriters = &bufferWriters;
+        _nChunk = 0;
+        _nTotal = 0;
+        _line.clear();
+    }
+
+    //-----------------------------------------------------------------
+    size_t write(uint8_t c)
+    {
+        return write(&c, 1);
+    }
+
+    //-----------------------------------------------------------------
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+        if (!_streamWriters || !_bufferWriters)
+            return 0;
+
+        _nTotal += size;
+
+        if (_bufferWriters->size() > 0)
+            _line.append((const char *)buffer, size);
+
+        if (_streamWriters->size() == 0)
+            return size;
+
+        size_t nLeft = size;
+        while (nLeft > 0)
+        {
+            size_t n = std::min(nLeft, (size_t)kJSONStreamChunkSize - _nChunk);
+            memcpy(_chunk + _nChunk, buffer, n);
+            _nChunk += n;
+            buffer += n;
+            nLeft -= n;
+
+            if (_nChunk == kJSONStreamChunkSize)
+                flushChunk(false);
+        }
+        return size;
+    }
+
+    //-----------------------------------------------------------------
+    // Completes the current line - returns the number of bytes output
+    size_t end(void)
+    {
+        if (!_streamWriters || !_bufferWriters)
+            return 0;
+
+        if (_streamWriters->size() > 0)
+            flushChunk(true);
+
+        for (auto aWriter : *_bufferWriters)
+            aWriter->write(_line.c_str(), true, flxLineTypeData);
+
+        _streamWriters = nullptr;
+        _bufferWriters = nullptr;
+
+        return _nTotal;
+    }
+
+    //-----------------------------------------------------------------
+    void reserve(size_t size)
+    {
+        _line.reserve(size);
+    }
+
+  private:
+    //-----------------------------------------------------------------
+    void flushChunk(bool newline)
+    {
+        _chunk[_nChunk] = '\0';
+
+        for (auto aWriter : *_streamWriters)
+            aWriter->write(_chunk, newline, flxLineTypeData);
+
+        _nChunk = 0;
+    }
+
+    char _chunk[kJSONStreamChunkSize + 1];
+    size_t _nChunk;
+    size_t _nTotal;
+
+    std::string _line;
+
+    const std::vector<flxWriter *> *_streamWriters;
+    const std::vector<flxWriter *> *_bufferWriters;
+};
@@ -15,6 +15,7 @@
  */
 
 #include "flxLogger.h"
+#include "flxClock.h"
 #include "flxFlux.h"
 #include "flxUtils.h"
 #include <string.h>
@@ -97,7 +98,7 @@ class _flxLoggerMetrics
 
 flxLogger::flxLogger()
     : _timestampType{TimeStampNone}, _outputDeviceID{false}, _outputLocalName{false}, _sampleNumberEnabled{false},
-      _currentSampleNumber{0}, _pMetrics{nullptr}
+      _currentSampleNumber{0}, _pMetrics{nullptr}, _tick{0}
 {
     setName("Logger", "Data logging action");
 
@@ -137,6 +138,9 @@ flxLogger::flxLogger()
 
     flxRegister(logRateMetric, "Rate Metric", "Enabled to record the logging rate data");
 
+    // timestamps are formatted in local time - a new time zone takes effect on the next entry
+    flxRegisterEventCB(flxEvent::kOnTimeZoneChange, this, &flxLogger::onTimeZoneChange);
+
     flux_add(this);
 }
 //----------------------------------------------------------------------------
@@ -247,8 +251,104 @@ void flxLogger::logArray(flxParameterOutArray *pParam)
     }
 }
 //----------------------------------------------------------------------------
-// Log the data in a section of the output - title and parameter values
-void flxLogger::logSection(const char *section_name, flxParameterOutList &paramList)
+// Multi-rate logging - the log dividers of operations and parameters. The list is sorted by item
+// pointer, and is empty unless dividers are used - so there's no lookup cost for a single rate logger.
+
+bool flxLogger::setLogDividerItem(const void *item, uint16_t divider)
+{
+    if (!item || divider == 0)
+        return false;
+
+    auto it = std::lower_bound(_logDividers.begin(), _logDividers.end(), item,
+                               [](const flxLogDivider_t &entry, const void *value) { return entry.item < value; });
+
+    if (it != _logDividers.end() && it->item == item)
+        it->divider = divider;
+    else
+        _logDividers.insert(it, {item, divider});
+
+    return true;
+}
+
+//----------------------------------------------------------------------------
+uint16_t flxLogger::getLogDivider(const void *item, uint16_t defaultDivider)
+{
+    if (_logDividers.size() == 0)
+        return defaultDivider;
+
+    auto it = std::lower_bound(_logDividers.begin(), _logDividers.end(), item,
+                               [](const flxLogDivider_t &entry, const void *value) { return entry.item < value; });
+
+    return it != _logDividers.end() && it->item == item ? it->divider : defaultDivider;
+}
+
+//----------------------------------------------------------------------------
+void flxLogger::eraseLogDivider(const void *item)
+{
+    auto it = std::lower_bound(_logDividers.begin(), _logDividers.end(), item,
+                               [](const flxLogDivider_t &entry, const void *value) { return entry.item < value; });
+
+    if (it != _logDividers.end() && it->item == item)
+        _logDividers.erase(it);
+}
+
+//----------------------------------------------------------------------------
+// Is a parameter sampled on this tick? divider is the divider of the section (operation) it's in.
+bool flxLogger::isDue(flxParameterOut *param, uint16_t divider)
+{
+    return _tick % getLogDivider(param, divider) == 0;
+}
+
+//----------------------------------------------------------------------------
+// Does a section have an enabled parameter that is sampled on this tick?
+bool flxLogger::sectionDue(flxParameterOutList &paramList, uint16_t divider)
+{
+    for (auto param : paramList)
+    {
+        if (param->enabled() && isDue(param, divider))
+            return true;
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------------
+// A section with no values sampled on this tick. Only formatters with a fixed layout output the
+// section - with placeholders for the values.
+void flxLogger::logSectionUnchanged(const char *section_name, flxParameterOutList &paramList)
+{
+    // no enabled parameters - the section isn't logged, like a sampled section
+    bool hasValid = false;
+    for (auto param : paramList)
+    {
+        if (param->enabled())
+        {
+            hasValid = true;
+            break;
+        }
+    }
+    if (!hasValid)
+        return;
+
+    for (auto theFormatter : _Formatters)
+    {
+        if (!theFormatter->fixedLayout())
+            continue;
+
+        theFormatter->beginSection(section_name);
+
+        for (auto param : paramList)
+        {
+            if (param->enabled())
+                theFormatter->logUnchanged(tag(param->name()));
+        }
+        theFormatter->endSection();
+    }
+}
+
+//----------------------------------------------------------------------------
+// Log the data in a section of the output - title and parameter values. Parameters that aren't
+// due this tick (multi-rate logging) are logged as unchanged.
+void flxLogger::logSection(const char *section_name, flxParameterOutList &paramList, uint16_t divider)
 {
 
     if (paramList.size() == 0)
@@ -278,6 +378,22 @@ void flxLogger::logSection(const char *section_name, flxParameterOutList &paramL
         if (!param->enabled())
             continue;
 
+        if (!isDue(param, divider))
+        {
+            const std::string &theTag = tag(param->name());
+
+            for (auto theFormatter : _Formatters)
+                theFormatter->logUnchanged(theTag);
+            continue;
+        }
+
+        // The timestamp is formatted in place - skip the string returned by the parameter
+        if (param == &timestamp)
+        {
+            logTimestamp();
+            continue;
+        }
+
         // is this an array or a scalar? Note: using covariant return values to get correct pointer
         if ((param->flags() & kParameterOutFlagArray) == kParameterOutFlagArray)
             logArray((flxParameterOutArray *)param->accessor());
@@ -291,6 +407,14 @@ void flxLogger::logSection(const char *section_name, flxParameterOutList &paramL
 //----------------------------------------------------------------------------
 void flxLogger::logObservation(void)
 {
+    // Multi-rate logging - is anything due this tick? The logger's own values (timestamp, sample
+    // number...) don't count.
+    if (_logDividers.size() > 0 && !observationDue())
+    {
+        _tick++;
+        return;
+    }
+
     // Begin the observation with all our formatters
     for (auto theFormatter : _Formatters)
         theFormatter->beginObservation();
@@ -304,9 +428,20 @@ void flxLogger::logObservation(void)
     // formatters
     for (auto pObj : _opsToLog)
     {
-        // call execute if the operation needs to run ...
+        uint16_t divider = getLogDivider(pObj, 1);
+
+        // Nothing due from this operation this tick? Don't execute it - no device read.
+        if (!sectionDue(pObj->getOutputParameters(), divider))
+        {
+            logSectionUnchanged(pObj->name(), pObj->getOutputParameters());
+            continue;
+        }
+
+        // call execute if the operation needs to run - devices read their sample here. Once the
+        // section is logged, let the operation know the data was retrieved.
         pObj->execute();
-        logSection(pObj->name(), pObj->getOutputParameters());
+        logSection(pObj->name(), pObj->getOutputParameters(), divider);
+        pObj->executeComplete();
     }
 
     // And end the observation for each formatter
@@ -323,8 +458,32 @@ void flxLogger::logObservation(void)
     if (_pMetrics)
         _pMetrics->captureMetric();
 
-    // send an activity event
-    flxSendEvent(flxEvent::kOnSystemActivityLow);
+    _tick++;
+
+    // post an activity event - dispatched from the main loop
+    flxPostEvent(flxEvent::kOnSystemActivityLow);
+}
+
+//----------------------------------------------------------------------------
+// Is there a value to sample this tick - from an operation, or a general parameter that isn't one of
+// the logger's own values?
+bool flxLogger::observationDue(void)
+{
+    for (auto pObj : _opsToLog)
+    {
+        if (sectionDue(pObj->getOutputParameters(), getLogDivider(pObj, 1)))
+            return true;
+    }
+
+    for (auto param : _paramsToLog)
+    {
+        if (param == &timestamp || param == &sampleNumber || param == &getDeviceID || param == &getLocalName)
+            continue;
+
+        if (param->enabled() && isDue(param, 1))
+            return true;
+    }
+    return false;
 }
 //----------------------------------------------------------------------------
 // log message
@@ -413,49 +572,47 @@ void flxLogger::set_ts_type(uint32_t newType)
 }
 
 //----------------------------------------------------------------------------
-// Return the current timestamp, as outlined in the timestamp mode.
-std::string flxLogger::get_timestamp(void)
+// Format the current time, per the timestamp mode. The time is from the flxClock timebase - the
+// same time used for device sample times.
+size_t flxLogger::formatTimestamp(char *buffer, size_t length)
 {
+    flxTimestamp_t theTime = flxClock.timestamp();
 
-    char szBuffer[64];
-
-    memset(szBuffer, '\0', sizeof(szBuffer));
-
-    time_t t_now;
-    time(&t_now);
-    struct tm *tmLocal = localtime(&t_now);
-    switch (_timestampType)
-    {
-    case TimeStampMillis:
-        snprintf(szBuffer, sizeof(szBuffer), "%lu", millis());
-        break;
+    struct timeval tv;
+    tv.tv_sec = (time_t)(theTime / kTimestampUSPerSecond);
+    tv.tv_usec = (suseconds_t)(theTime % kTimestampUSPerSecond);
 
-    case TimeStampEpoch:
-        snprintf(szBuffer, sizeof(szBuffer), "%ld", t_now);
-        break;
-
-    case TimeStampDateTimeUSA:
-        strftime(szBuffer, sizeof(szBuffer), "%m-%d-%G %T", tmLocal);
-        break;
+    return _timestampFormatter.format((flxTimestampMode_t)_timestampType, tv, millis(), buffer, length);
+}
 
-    case TimeStampDateTime:
-        strftime(szBuffer, sizeof(szBuffer), "%d-%m-%G %T", tmLocal);
-        break;
+//----------------------------------------------------------------------------
+void flxLogger::onTimeZoneChange(void)
+{
+    _timestampFormatter.reset();
+}
 
-    case TimeStampISO8601:
-    case TimeStampISO8601TZ:
-        flx_utils::timestampISO8601(t_now, szBuffer, sizeof(szBuffer), _timestampType == TimeStampISO8601TZ);
-        break;
+//----------------------------------------------------------------------------
+// Return the current timestamp, as outlined in the timestamp mode.
+std::string flxLogger::get_timestamp(void)
+{
+    char szBuffer[kTimestampBufferSize];
 
-    case TimeStampNone:
-    default:
-        break;
-    }
+    formatTimestamp(szBuffer, sizeof(szBuffer));
 
     std::string sBuffer = szBuffer;
     return sBuffer;
 }
 
+//----------------------------------------------------------------------------
+// Log the timestamp for an observation - formatted into our buffer, and passed to the formatters
+// as a C string.
+void flxLogger::logTimestamp(void)
+{
+    formatTimestamp(_szTimestamp, sizeof(_szTimestamp));
+
+    writeValue(timestamp.name(), (const char *)_szTimestamp);
+}
+
 //----------------------------------------------------------------------------
 // Device ID methods for output
 //----------------------------------------------------------------------------
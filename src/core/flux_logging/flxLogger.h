@@ -22,11 +22,13 @@
 #pragma once
 
 // #include <ArduinoJson.h>
+#include <algorithm>
 #include <initializer_list>
 #include <vector>
 
 #include "flxFlux.h"
 #include "flxOutput.h"
+#include "flxTimestamp.h"
 
 // KDB Testing begin
 
@@ -34,6 +36,13 @@ class _flxLoggerMetrics;
 
 // KDB Testing end
 
+// Multi-rate logging - the log divider of an operation or parameter
+typedef struct
+{
+    const void *item;
+    uint16_t divider;
+} flxLogDivider_t;
+
 // Define the Logging class
 class flxLogger : public flxActionType<flxLogger>
 {
@@ -240,6 +249,42 @@ class flxLogger : public flxActionType<flxLogger>
         va_remove(a1, args...);
     }
 
+    //------------------------------------------------------------
+    // Multi-rate logging
+    //
+    // Each call to logObservation() is a tick of the logger. By default, every logged operation and
+    // parameter is sampled each tick. Setting a divider logs an operation (or a parameter) every
+    // divider ticks - a fast IMU and a slow CO2 sensor can be logged by one logger, each at its own rate.
+    //
+    // A parameter of an operation uses the divider of the operation, unless it has its own. An operation
+    // is only executed (devices read) on ticks where one of its parameters is due. Values that aren't
+    // due are left out of the observation - or written as a placeholder by fixed layout formats (CSV).
+    // No observation is written on a tick with nothing due.
+    bool setLogDivider(flxOperation *op, uint16_t divider)
+    {
+        return setLogDividerItem(op, divider);
+    }
+    bool setLogDivider(flxOperation &op, uint16_t divider)
+    {
+        return setLogDividerItem(&op, divider);
+    }
+    bool setLogDivider(flxParameterOut *param, uint16_t divider)
+    {
+        return setLogDividerItem(param, divider);
+    }
+    bool setLogDivider(flxParameterOut &param, uint16_t divider)
+    {
+        return setLogDividerItem(&param, divider);
+    }
+    uint16_t logDivider(flxOperation *op)
+    {
+        return getLogDivider(op, 1);
+    }
+    uint16_t logDivider(flxParameterOut *param)
+    {
+        return getLogDivider(param, 1);
+    }
+
     //------------------------------------------------------------
     // for metrics
     void setEnableLogRate(bool enable);
@@ -253,13 +298,17 @@ class flxLogger : public flxActionType<flxLogger>
     // Enum for timestamp types.
     typedef enum
     {
-        TimeStampNone,
-        TimeStampMillis,
-        TimeStampEpoch,
-        TimeStampDateTimeUSA,
-        TimeStampDateTime,
-        TimeStampISO8601,
-        TimeStampISO8601TZ,
+        TimeStampNone = flxTimestampNone,
+        TimeStampMillis = flxTimestampMillis,
+        TimeStampEpoch = flxTimestampEpoch,
+        TimeStampDateTimeUSA = flxTimestampDateTimeUSA,
+        TimeStampDateTime = flxTimestampDateTime,
+        TimeStampISO8601 = flxTimestampISO8601,
+        TimeStampISO8601TZ = flxTimestampISO8601TZ,
+        TimeStampISO8601Millis = flxTimestampISO8601Millis,
+        TimeStampISO8601MillisTZ = flxTimestampISO8601MillisTZ,
+        TimeStampISO8601Micros = flxTimestampISO8601Micros,
+        TimeStampISO8601MicrosTZ = flxTimestampISO8601MicrosTZ,
     } Timestamp_t;
 
     // Timestamp property
@@ -272,7 +321,11 @@ class flxLogger : public flxActionType<flxLogger>
          {"Date Time - USA Date format", TimeStampDateTimeUSA},
          {"Date Time", TimeStampDateTime},
          {"ISO8601 Timestamp", TimeStampISO8601},
-         {"ISO8601 Timestamp with Time Zone", TimeStampISO8601TZ}}};
+         {"ISO8601 Timestamp with Time Zone", TimeStampISO8601TZ},
+         {"ISO8601 Timestamp - Milliseconds", TimeStampISO8601Millis},
+         {"ISO8601 Timestamp - Milliseconds with Time Zone", TimeStampISO8601MillisTZ},
+         {"ISO8601 Timestamp - Microseconds", TimeStampISO8601Micros},
+         {"ISO8601 Timestamp - Microseconds with Time Zone", TimeStampISO8601MicrosTZ}}};
 
     // output parameter for the timestamp
     flxParameterOutString<flxLogger, &flxLogger::get_timestamp> timestamp;
@@ -313,6 +366,15 @@ class flxLogger : public flxActionType<flxLogger>
     // Timestamp things
     Timestamp_t _timestampType;
 
+    // formats the timestamp of a log entry - into the buffer, no allocation
+    void logTimestamp(void);
+    size_t formatTimestamp(char *buffer, size_t length);
+    flxTimestampFormatter _timestampFormatter;
+
+    // the clock time zone changed - drop the cached date/time of the formatter
+    void onTimeZoneChange(void);
+    char _szTimestamp[kTimestampBufferSize];
+
     // output device id?
     bool _outputDeviceID;
 
@@ -325,53 +387,74 @@ class flxLogger : public flxActionType<flxLogger>
 
     // Templates used to manage array logging based on type.
     //
-    // Note - the array object is dynamically allocated.
+    // Note - the array object is owned by the parameter and reused for each observation,
+    //        so nothing is allocated or deleted here.
 
     template <typename T> void logArrayType(flxParameterOutArray *pParam)
     {
-        T *theArray = (T *)pParam->get();
+        T *theArray = (T *)pParam->getArray();
 
         if (theArray != nullptr)
-        {
             writeValue(pParam->name(), theArray);
-            delete theArray;
-        }
     }
 
     // same as above, just adding precision support for our float/double types
     template <typename T> void logArrayType(flxParameterOutArray *pParam, uint16_t precision)
     {
-        T *theArray = (T *)pParam->get();
+        T *theArray = (T *)pParam->getArray();
 
         if (theArray != nullptr)
-        {
             writeValue(pParam->name(), theArray, precision);
-            delete theArray;
-        }
     }
     //----------------------------------------------------------------------------
     // When we log a value, we need to write it to all formatters. Seems like a lot
     // of short loops, but we want to write the SAME value to all formatters
 
-    template <typename T> void writeValue(const std::string &tag, T value)
+    template <typename T> void writeValue(const char *name, T value)
     {
+        const std::string &theTag = tag(name);
+
         for (auto theFormatter : _Formatters)
-            theFormatter->logValue(tag, value);
+            theFormatter->logValue(theTag, value);
     }
 
-    template <typename T> void writeValue(const std::string &tag, T value, uint16_t precision)
+    template <typename T> void writeValue(const char *name, T value, uint16_t precision)
     {
+        const std::string &theTag = tag(name);
+
         for (auto theFormatter : _Formatters)
-            theFormatter->logValue(tag, value, precision);
+            theFormatter->logValue(theTag, value, precision);
+    }
+
+    // The formatters take the tag of a value as a std::string. The tag string is reused for each value,
+    // so once it has grown to the longest name, building a tag doesn't allocate.
+    const std::string &tag(const char *name)
+    {
+        _tag.assign(name);
+        return _tag;
     }
+    std::string _tag;
 
-    void logSection(const char *section_name, flxParameterOutList &params);
+    void logSection(const char *section_name, flxParameterOutList &params, uint16_t divider = 1);
 
-    void logSection(const std::string &name, flxParameterOutList &params)
+    void logSection(const std::string &name, flxParameterOutList &params, uint16_t divider = 1)
     {
-        logSection(name.c_str(), params);
+        logSection(name.c_str(), params, divider);
     }
 
+    // Multi-rate logging
+    bool setLogDividerItem(const void *item, uint16_t divider);
+    uint16_t getLogDivider(const void *item, uint16_t defaultDivider);
+    void eraseLogDivider(const void *item);
+    bool isDue(flxParameterOut *param, uint16_t divider);
+    bool sectionDue(flxParameterOutList &params, uint16_t divider);
+    bool observationDue(void);
+    void logSectionUnchanged(const char *section_name, flxParameterOutList &params);
+
+    // sorted by item - only holds items with a divider set
+    std::vector<flxLogDivider_t> _logDividers;
+    uint32_t _tick;
+
     // vargs management - how to add things recursively.
     //
     // General pattern for the below methods:
@@ -485,6 +568,16 @@ class flxLogger : public flxActionType<flxLogger>
     void _remove(flxOperation *op)
     {
         if (op != nullptr)
+        {
             _opsToLog.remove(op);
+            eraseLogDivider(op);
+
+            // and the dividers of its parameters - unless a parameter is also logged on its own
+            for (auto param : op->getOutputParameters())
+            {
+                if (std::find(_paramsToLog.begin(), _paramsToLog.end(), param) == _paramsToLog.end())
+                    eraseLogDivider(param);
+            }
+        }
     }
 };
@@ -57,6 +57,17 @@ class flxOutputFormat
     virtual void logValue(const std::string &tag, flxDataArrayDouble *value, uint16_t precision = 3) = 0;
     virtual void logValue(const std::string &tag, flxDataArrayString *value) = 0;
 
+    // Multi-rate logging - a value that isn't sampled in this observation (its rate group isn't due).
+    //
+    // Formats with a fixed layout - where each value has a position - write a placeholder, so the layout
+    // doesn't change from one observation to the next. Other formats leave the value (and a section with
+    // no sampled values) out of the observation - the default.
+    virtual bool fixedLayout(void)
+    {
+        return false;
+    }
+    virtual void logUnchanged(const std::string &tag) {};
+
     // structure cycle
 
     virtual void beginObservation(const char *szTitle = nullptr) = 0;
@@ -102,6 +113,21 @@ class flxOutputFormat
             writer->write(szBuffer, true, type);
     }
 
+    void outputBinary(const uint8_t *data, size_t length, flxLineType_t type = flxLineTypeData)
+    {
+        for (auto writer : _Writers)
+        {
+            if (writer->acceptsBinary())
+                writer->writeBytes(data, length, type);
+        }
+    }
+
+  protected:
+    const std::vector<flxWriter *> &writers(void) const
+    {
+        return _Writers;
+    }
+
   private:
     std::vector<flxWriter *> _Writers;
 };
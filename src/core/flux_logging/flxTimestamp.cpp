@@ -0,0 +1,203 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+#include "flxTimestamp.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------
+// Write an unsigned value, in decimal. Returns the number of characters written, 0 if it doesn't fit.
+static size_t formatUInt(uint64_t value, char *buffer, size_t length)
+{
+    char szTmp[24];
+    size_t n = 0;
+
+    do
+    {
+        szTmp[n++] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    if (n >= length)
+        return 0;
+
+    for (size_t i = 0; i < n; i++)
+        buffer[i] = szTmp[n - 1 - i];
+
+    buffer[n] = '\0';
+
+    return n;
+}
+
+//----------------------------------------------------------------------------
+// Write a value as a fixed number of digits
+static void formatDigits(uint32_t value, char *buffer, size_t nDigits)
+{
+    for (size_t i = nDigits; i > 0; i--)
+    {
+        buffer[i - 1] = '0' + (value % 10);
+        value /= 10;
+    }
+}
+
+//----------------------------------------------------------------------------
+flxTimestampFormatter::flxTimestampFormatter()
+    : _lenDateTime{0}, _lenTZ{0}, _cacheMode{flxTimestampNone}, _minuteStart{0}, _cacheValid{false}
+{
+    _szDateTime[0] = '\0';
+    _szTZ[0] = '\0';
+}
+
+//----------------------------------------------------------------------------
+void flxTimestampFormatter::reset(void)
+{
+    _cacheValid = false;
+}
+
+//----------------------------------------------------------------------------
+// Format the date/time of the minute the given time is in - the full (slow) path. The time zone
+// suffix is computed for the TZ modes.
+
+bool flxTimestampFormatter::updateCache(flxTimestampMode_t mode, time_t theTime)
+{
+    struct tm tmLocal;
+    if (!localtime_r(&theTime, &tmLocal))
+        return false;
+
+    const char *szFormat;
+    switch (mode)
+    {
+    case flxTimestampDateTimeUSA:
+        szFormat = "%m-%d-%G %T";
+        break;
+
+    case flxTimestampDateTime:
+        szFormat = "%d-%m-%G %T";
+        break;
+
+    default: // the ISO8601 modes
+        szFormat = "%G-%m-%dT%T";
+        break;
+    }
+
+    _lenDateTime = strftime(_szDateTime, sizeof(_szDateTime), szFormat, &tmLocal);
+    if (_lenDateTime < 2)
+        return false;
+
+    _lenTZ = 0;
+    _szTZ[0] = '\0';
+
+    if (mode == flxTimestampISO8601TZ || mode == flxTimestampISO8601MillisTZ || mode == flxTimestampISO8601MicrosTZ)
+    {
+        struct tm tmGMT;
+        gmtime_r(&theTime, &tmGMT);
+        int deltaT = theTime - mktime(&tmGMT);
+
+        char chSign = '+';
+        if (deltaT < 0)
+        {
+            chSign = '-';
+            deltaT *= -1;
+        }
+
+        _szTZ[0] = chSign;
+        formatDigits(deltaT / 3600, _szTZ + 1, 2);
+        _szTZ[3] = ':';
+        formatDigits((deltaT % 3600) / 60, _szTZ + 4, 2);
+        _szTZ[6] = '\0';
+        _lenTZ = 6;
+    }
+
+    _cacheMode = mode;
+    _minuteStart = theTime - tmLocal.tm_sec;
+    _cacheValid = true;
+
+    return true;
+}
+
+//----------------------------------------------------------------------------
+size_t flxTimestampFormatter::format(flxTimestampMode_t mode, char *buffer, size_t length)
+{
+    struct timeval tv = {0, 0};
+
+    // only the date/time modes need the wall clock
+    if (mode != flxTimestampMillis)
+        gettimeofday(&tv, nullptr);
+
+    return format(mode, tv, millis(), buffer, length);
+}
+
+//----------------------------------------------------------------------------
+size_t flxTimestampFormatter::format(flxTimestampMode_t mode, const struct timeval &tv, uint32_t msUptime,
+                                     char *buffer, size_t length)
+{
+    if (!buffer || length == 0)
+        return 0;
+
+    buffer[0] = '\0';
+
+    switch (mode)
+    {
+    case flxTimestampMillis:
+        return formatUInt(msUptime, buffer, length);
+
+    case flxTimestampEpoch:
+        if (tv.tv_sec < 0)
+            return 0;
+        return formatUInt(tv.tv_sec, buffer, length);
+
+    case flxTimestampNone:
+    case flxTimestampModeCount:
+        return 0;
+
+    default:
+        break;
+    }
+
+    // Date/time modes - is the time in the cached minute?
+    time_t theTime = tv.tv_sec;
+
+    if (!_cacheValid || mode != _cacheMode || theTime < _minuteStart || theTime >= _minuteStart + 60)
+    {
+        if (!updateCache(mode, theTime))
+            return 0;
+    }
+
+    // seconds are the last two digits of the date/time
+    formatDigits(theTime - _minuteStart, _szDateTime + _lenDateTime - 2, 2);
+
+    size_t nFraction = 0;
+    if (mode == flxTimestampISO8601Millis || mode == flxTimestampISO8601MillisTZ)
+        nFraction = 4;
+    else if (mode == flxTimestampISO8601Micros || mode == flxTimestampISO8601MicrosTZ)
+        nFraction = 7;
+
+    size_t total = _lenDateTime + nFraction + _lenTZ;
+    if (total >= length)
+        return 0;
+
+    memcpy(buffer, _szDateTime, _lenDateTime);
+    char *pNext = buffer + _lenDateTime;
+
+    if (nFraction > 0)
+    {
+        *pNext = '.';
+        if (nFraction == 4)
+            formatDigits(tv.tv_usec / 1000, pNext + 1, 3);
+        else
+            formatDigits(tv.tv_usec, pNext + 1, 6);
+        pNext += nFraction;
+    }
+
+    memcpy(pNext, _szTZ, _lenTZ + 1);
+
+    return total;
+}
@@ -0,0 +1,85 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+/*
+ *---------------------------------------------------------------------------------
+ * flxTimestamp.h
+ *
+ * Timestamp formatting for log entries.
+ *
+ * Formatting a date/time is expensive - localtime() and strftime() for every log entry. Since
+ * entries are logged many times a second, and only the seconds change from one entry to the next,
+ * the formatter caches the formatted date/time of the current minute. For a time in the cached
+ * minute, only the seconds digits (and any fractional part) are written.
+ *
+ * Output is written to a caller supplied buffer - no allocation.
+ *
+ * Note: A change to the time zone is picked up when the minute changes, or reset() is called. The
+ * logger calls reset() when flxClock sends flxEvent::kOnTimeZoneChange.
+ *---------------------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+
+// Timestamp modes - the values are stored (the logger timestamp mode property), so new modes
+// are added at the end.
+typedef enum
+{
+    flxTimestampNone,
+    flxTimestampMillis,
+    flxTimestampEpoch,
+    flxTimestampDateTimeUSA,
+    flxTimestampDateTime,
+    flxTimestampISO8601,
+    flxTimestampISO8601TZ,
+    flxTimestampISO8601Millis,
+    flxTimestampISO8601MillisTZ,
+    flxTimestampISO8601Micros,
+    flxTimestampISO8601MicrosTZ,
+    flxTimestampModeCount
+} flxTimestampMode_t;
+
+// Large enough for any timestamp mode
+#define kTimestampBufferSize 40
+
+class flxTimestampFormatter
+{
+  public:
+    flxTimestampFormatter();
+
+    // Format the current time. Returns the length of the timestamp, 0 on error
+    size_t format(flxTimestampMode_t mode, char *buffer, size_t length);
+
+    // Format the given time - tv is the wall clock time, msUptime is used by the millis mode
+    size_t format(flxTimestampMode_t mode, const struct timeval &tv, uint32_t msUptime, char *buffer, size_t length);
+
+    // Drop the cached date/time - i.e. the time zone changed
+    void reset(void);
+
+  private:
+    bool updateCache(flxTimestampMode_t mode, time_t theTime);
+
+    // The formatted date/time of the cached minute - the seconds digits are updated on use
+    char _szDateTime[32];
+    uint8_t _lenDateTime;
+
+    // Time zone suffix - "+hh:mm"
+    char _szTZ[8];
+    uint8_t _lenTZ;
+
+    flxTimestampMode_t _cacheMode;
+    time_t _minuteStart;
+    bool _cacheValid;
+};
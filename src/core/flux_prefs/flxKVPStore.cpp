@@ -22,6 +22,8 @@
 #include "flxKVPStore.h"
 #include "flxKVPStoreEntry.h"
 
+#include <algorithm>
+
 flxKVPError_t flxKVPStore::checkNameSpaces(void)
 {
     // Is this item in the page?
@@ -103,6 +105,9 @@ flxKVPError_t flxKVPStore::getNameSpaceIndex(const char *szNS, uint8_t &outNSInd
         // flxLog_I("CREATE: Adding Name Space Index: %s %u", szNS, outNSIndex);
         flxKVPError_t retval = _pages[_currPage]->setValue(kKVPNameSpaceEntryNS, szNS, outNSIndex);
 
+        for (size_t i = 0; retval == kKVPErrorPageFull && i <= _pages.size() && moveToFreePage(); i++)
+            retval = _pages[_currPage]->setValue(kKVPNameSpaceEntryNS, szNS, outNSIndex);
+
         if (retval != kKVPErrorOK)
             return retval;
 
@@ -162,8 +167,14 @@ flxKVPError_t flxKVPStore::initialize(void)
         _pages.push_back(pPage);
     }
 
-    // need to set the current page
-    _currPage = (_pages.size() > 0 ? 0 : kNullPage);
+    // finish any interrupted operations, then set the current page
+    if (recoverPages() != kKVPErrorOK)
+        return kKVPErrorIO;
+
+    selectCurrentPage();
+
+    if (_inTransaction)
+        setBatchMode(true);
 
     // Now check name spaces. First, mark off the zero space -- because
     _nsState.set(0, true);
@@ -196,30 +207,397 @@ uint8_t flxKVPStore::getNameSpace(const char *szNS)
     return iNS;
 }
 
+//----------------------------------------------------------
+// Page management
+//----------------------------------------------------------
+// Returns a sequence number higher than any page
+
+uint32_t flxKVPStore::nextSequence(void)
+{
+    uint32_t sequence = 0;
+
+    for (auto thePage : _pages)
+        sequence = std::max(sequence, thePage->sequence());
+
+    return sequence + 1;
+}
+
+//----------------------------------------------------------
+// Order the pages for searching - newest first
+
+void flxKVPStore::sortPages(void)
+{
+    _searchOrder = _pages;
+
+    std::stable_sort(_searchOrder.begin(), _searchOrder.end(),
+                     [](flxKVPStorePage *a, flxKVPStorePage *b) { return a->sequence() > b->sequence(); });
+}
+
+//----------------------------------------------------------
+// Called at startup - clean up after an operation that was interrupted by a power loss.
+//
+//   - A compaction that copied a page, but didn't erase the source page. The source is erased.
+//   - A value that was written to the active page, but whose old copy wasn't deleted. The old copy is deleted.
+//
+// Note: A compaction that didn't complete the copy is discarded when the page is loaded.
+//
+// Note: This relies on the device programming flash as the store writes it (ESP32, NOR). A device that
+// buffers a sector and rewrites it on flush (flxKVPStoreDeviceRP2) can lose the whole sector if power is
+// lost during the rewrite - recovery doesn't cover that.
+
+flxKVPError_t flxKVPStore::recoverPages(void)
+{
+    uint32_t iSource;
+
+    for (auto thePage : _pages)
+    {
+        iSource = thePage->source();
+
+        // If the source page is older than the copy and still has entries, the erase didn't happen
+        if (iSource < _pages.size() && _pages[iSource] != thePage && !_pages[iSource]->isEmpty() &&
+            _pages[iSource]->sequence() < thePage->sequence())
+        {
+            if (_pages[iSource]->initPage(true) != kKVPErrorOK)
+                return kKVPErrorIO;
+        }
+    }
+
+    sortPages();
+
+    for (size_t i = 0; i < _searchOrder.size(); i++)
+    {
+        for (size_t j = i + 1; j < _searchOrder.size(); j++)
+        {
+            if (_searchOrder[j]->sequence() < _searchOrder[i]->sequence() &&
+                _searchOrder[j]->removeDuplicates(*_searchOrder[i]) != kKVPErrorOK)
+                return kKVPErrorIO;
+        }
+    }
+
+    return kKVPErrorOK;
+}
+
+//----------------------------------------------------------
+// Set the current (write) page at startup - the newest page in use with space. If there isn't one, an
+// empty page is used, but the last empty page is kept for compaction. A blank page is activated - it gets
+// a sequence number higher than any page.
+
+void flxKVPStore::selectCurrentPage(void)
+{
+    _currPage = kNullPage;
+
+    if (_pages.size() == 0)
+        return;
+
+    flxKVPStorePage *pCurrent = nullptr;
+    flxKVPStorePage *pEmpty = nullptr;
+    uint32_t nEmpty = 0;
+
+    for (auto thePage : _searchOrder)
+    {
+        if (thePage->status() != flxKVPPageStatus::kPageAvailable)
+            continue;
+
+        if (!thePage->isEmpty())
+        {
+            if (!pCurrent)
+                pCurrent = thePage;
+        }
+        else
+        {
+            nEmpty++;
+            if (!pEmpty || thePage->eraseCount() < pEmpty->eraseCount())
+                pEmpty = thePage;
+        }
+    }
+
+    if (!pCurrent && (nEmpty > 1 || _pages.size() == 1))
+        pCurrent = pEmpty;
+
+    // No page with space - start with the newest. Writes will compact a page
+    if (!pCurrent)
+        pCurrent = _searchOrder[0];
+
+    _currPage = std::find(_pages.begin(), _pages.end(), pCurrent) - _pages.begin();
+
+    pCurrent->activate(nextSequence());
+    sortPages();
+}
+
 //----------------------------------------------------------
 bool flxKVPStore::moveToFreePage(void)
+{
+    if (!_inTransaction)
+        return selectFreePage();
+
+    // New entries of a transaction are only made on the current page, and are written out (made valid) before
+    // older copies are deleted. So write out the changes before the current page changes.
+    setBatchMode(false);
+    _inTransaction = false;
+
+    bool bStatus = selectFreePage();
+
+    _inTransaction = true;
+    setBatchMode(true);
+
+    return bStatus;
+}
+
+//----------------------------------------------------------
+bool flxKVPStore::selectFreePage(void)
 {
     if (_currPage == kNullPage && _pages.size() > 0)
     {
         _currPage = 0;
-        return true;
+        return _pages[0]->activate(nextSequence()) == kKVPErrorOK;
     }
-    // no page to switch to?
+    // no page to switch to? Compact the page in place
     if (_pages.size() < 2)
-        return false;
+        return compact(true);
+
+    // First choice is a page in use with space available. Next, an empty page - the least erased
+    // page, to spread wear. The last empty page is kept for compaction.
+    int16_t iUsed = kNullPage;
+    int16_t iEmpty = kNullPage;
+    uint32_t nEmpty = 0;
 
     for (size_t i = 0; i < _pages.size(); i++)
     {
-        if (_pages[i]->status() == flxKVPPageStatus::kPageAvailable && (int)i != _currPage)
+        if ((int)i == _currPage || _pages[i]->status() != flxKVPPageStatus::kPageAvailable)
+            continue;
+
+        if (!_pages[i]->isEmpty())
         {
-            commit();
-            _currPage = i;
-            return true;
+            if (iUsed == kNullPage)
+                iUsed = i;
+        }
+        else
+        {
+            nEmpty++;
+            if (iEmpty == kNullPage || _pages[i]->eraseCount() < _pages[iEmpty]->eraseCount())
+                iEmpty = i;
+        }
+    }
+
+    // Need to compact a page to get space? If the current page was compacted, the copy is the current page
+    if (iUsed == kNullPage && nEmpty < 2)
+    {
+        int16_t iPrevious = _currPage;
+
+        if (!compact(true))
+            return false;
+
+        return _currPage != iPrevious || selectFreePage();
+    }
+
+    int16_t iNewPage = iUsed != kNullPage ? iUsed : iEmpty;
+
+    commit();
+
+    // A blank page gets a sequence number higher than any page
+    if (_pages[iNewPage]->activate(nextSequence()) != kKVPErrorOK)
+        return false;
+
+    _currPage = iNewPage;
+    sortPages();
+
+    return true;
+}
+
+//----------------------------------------------------------
+// Compact a page - copy the entries of the most fragmented full page to the least erased empty page, and
+// erase the full page.
+//
+// The copy is marked as incomplete until all entries are copied, and records the page it was copied
+// from. If power is lost, startup discards an incomplete copy, or erases the source page of a complete copy.
+//
+// Without an empty page - a single page store, or version 1/2 pages that filled the store - the page is
+// compacted in place. That isn't power loss safe.
+
+bool flxKVPStore::compact(bool bForce /*=false*/)
+{
+    if (_pages.size() == 0)
+        return false;
+
+    // Find the full page with the most space to reclaim - and the least erased empty page to copy it into
+    int16_t iFrom = kNullPage;
+    int16_t iTo = kNullPage;
+    uint32_t nFree = 0;
+    uint32_t nPageFree;
+
+    // A single page is used until it's full - any deleted entries can be reclaimed
+    if (_pages.size() == 1)
+    {
+        iFrom = 0;
+        nFree = _pages[0]->erasedEntries();
+    }
+
+    for (size_t i = 0; i < _pages.size() && _pages.size() > 1; i++)
+    {
+        if (_pages[i]->status() == flxKVPPageStatus::kPageFull)
+        {
+            nPageFree = flxKVPStorePage::kNEntriesPerPage - _pages[i]->liveEntries();
+            if (nPageFree > nFree)
+            {
+                nFree = nPageFree;
+                iFrom = i;
+            }
+        }
+        else if (_pages[i]->status() == flxKVPPageStatus::kPageAvailable && _pages[i]->isEmpty())
+        {
+            if (iTo == kNullPage || _pages[i]->eraseCount() < _pages[iTo]->eraseCount())
+                iTo = i;
         }
     }
 
+    if (iFrom == kNullPage || nFree == 0 || (!bForce && nFree < kCompactMinFree))
+        return false;
+
+    // The copy must be complete in flash before the source page is erased - so no batching
+    if (_inTransaction)
+        setBatchMode(false);
+
+    bool bStatus = iTo != kNullPage ? compactPage(iFrom, iTo) : compactInPlace(iFrom);
+
+    if (_inTransaction)
+        setBatchMode(true);
+
+    return bStatus;
+}
+
+//----------------------------------------------------------
+bool flxKVPStore::compactPage(int16_t iFrom, int16_t iTo)
+{
+    flxKVPStorePage *pFrom = _pages[iFrom];
+    flxKVPStorePage *pTo = _pages[iTo];
+
+    // Note - if the copy fails, the page is left as incomplete and discarded at next startup
+    if (pTo->beginCopy(nextSequence(), iFrom) != kKVPErrorOK)
+        return false;
+
+    flxKVPStoreEntry theEntry;
+    flxKVPError_t retval;
+    uint32_t index = 0;
+
+    while ((retval = pFrom->nextEntry(index, theEntry)) == kKVPErrorOK)
+    {
+        if (pTo->copyEntry(*pFrom, index) != kKVPErrorOK)
+            return false;
+        index++;
+    }
+
+    if (retval != kKVPErrorNoMatch || pTo->endCopy() != kKVPErrorOK)
+        return false;
+
+    // the copy must be in flash before the source page is erased
+    commit();
+
+    if (pFrom->initPage(true) != kKVPErrorOK)
+        return false;
+
+    // The copy of the current page is the current page
+    if (iFrom == _currPage)
+        _currPage = iTo;
+
+    commit();
+    sortPages();
+
+    return true;
+}
+
+//----------------------------------------------------------
+bool flxKVPStore::compactInPlace(int16_t iPage)
+{
+    if (_pages[iPage]->compactInPlace(nextSequence()) != kKVPErrorOK)
+        return false;
+
+    commit();
+    sortPages();
+
+    return true;
+}
+
+//----------------------------------------------------------
+// Transactions
+//----------------------------------------------------------
+// Set batch mode on all pages. Ending batch mode writes any buffered entry state changes - the current page
+// first, so new values are valid before older copies on other pages are deleted.
+
+flxKVPError_t flxKVPStore::setBatchMode(bool bBatch)
+{
+    if (bBatch)
+    {
+        for (auto thePage : _pages)
+            thePage->beginBatch();
+
+        return kKVPErrorOK;
+    }
+
+    flxKVPError_t retval = kKVPErrorOK;
+
+    if (_currPage != kNullPage && _pages[_currPage]->endBatch() != kKVPErrorOK)
+        retval = kKVPErrorIO;
+
+    for (auto thePage : _pages)
+    {
+        if (thePage->endBatch() != kKVPErrorOK)
+            retval = kKVPErrorIO;
+    }
+    return retval;
+}
+
+//----------------------------------------------------------
+void flxKVPStore::beginTransaction(void)
+{
+    if (_inTransaction)
+        return;
+
+    _inTransaction = true;
+    setBatchMode(true);
+}
+
+//----------------------------------------------------------
+flxKVPError_t flxKVPStore::commitTransaction(void)
+{
+    flxKVPError_t retval = kKVPErrorOK;
+
+    if (_inTransaction)
+    {
+        _inTransaction = false;
+        retval = setBatchMode(false);
+    }
+
+    commit();
+
+    return retval;
+}
+
+//----------------------------------------------------------
+// After a value is written to the current page, delete any copy on another page
+
+void flxKVPStore::removeOlderCopies(uint8_t iNS, const char *szKey)
+{
+    for (size_t i = 0; i < _pages.size(); i++)
+    {
+        if ((int)i != _currPage)
+            (void)_pages[i]->deleteValue(iNS, szKey);
+    }
+}
+
+//----------------------------------------------------------
+// Is the value already stored, unchanged, on a page other than the current page? If so, there's nothing to write.
+
+bool flxKVPStore::storedOnOlderPage(uint8_t iNS, flxDataType_t dType, const char *szKey, const void *value,
+                                    size_t valueSize)
+{
+    for (size_t i = 0; i < _pages.size(); i++)
+    {
+        if ((int)i != _currPage && _pages[i]->hasValue(iNS, dType, szKey, value, valueSize))
+            return true;
+    }
     return false;
 }
+
 //-----------------------------------------------------------
 // setValue
 flxKVPError_t flxKVPStore::setValue(uint8_t iNS, flxDataType_t dType, const char *szKey, const void *value,
@@ -232,14 +610,17 @@ flxKVPError_t flxKVPStore::setValue(uint8_t iNS, flxDataType_t dType, const char
     if (_currPage == kNullPage || _pages.size() == 0)
         return kKVPErrorPageFull;
 
+    if (storedOnOlderPage(iNS, dType, szKey, value, valueSize))
+        return kKVPErrorOK;
+
     flxKVPError_t retval = _pages[_currPage]->setValue(iNS, dType, szKey, value, valueSize);
 
-    // first attempt - multi tries here?
-    if (retval == kKVPErrorPageFull && _pages.size() > 1)
-    {
-        if (moveToFreePage())
-            retval = _pages[_currPage]->setValue(iNS, dType, szKey, value, valueSize);
-    }
+    // Page full? Move to another page - a page that turns out to be full is marked full, so this ends
+    for (size_t i = 0; retval == kKVPErrorPageFull && i <= _pages.size() && moveToFreePage(); i++)
+        retval = _pages[_currPage]->setValue(iNS, dType, szKey, value, valueSize);
+
+    if (retval == kKVPErrorOK)
+        removeOlderCopies(iNS, szKey);
 
     return retval;
 }
@@ -250,19 +631,20 @@ flxKVPError_t flxKVPStore::setValueString(uint8_t iNS, const char *szKey, const
     if (iNS < 1 || szKey == nullptr || strlen(szKey) < 2 || value == nullptr || valueSize == 0)
         return kKVPErrorBadParam;
 
-    if (_currPage == kNullPage || _pages.size() == 0 || _pages[_currPage]->status() != flxKVPPageStatus::kPageAvailable)
+    if (_currPage == kNullPage || _pages.size() == 0)
         return kKVPErrorPageFull;
 
-    // TODO: Manage page availability
+    if (storedOnOlderPage(iNS, flxTypeString, szKey, value, valueSize))
+        return kKVPErrorOK;
 
     flxKVPError_t retval = _pages[_currPage]->setValueString(iNS, szKey, value, valueSize);
 
-    // first attempt - multi tries here?
-    if (retval == kKVPErrorPageFull && _pages.size() > 1)
-    {
-        if (moveToFreePage())
-            retval = _pages[_currPage]->setValueString(iNS, szKey, value, valueSize);
-    }
+    // Page full? Move to another page - a page that turns out to be full is marked full, so this ends
+    for (size_t i = 0; retval == kKVPErrorPageFull && i <= _pages.size() && moveToFreePage(); i++)
+        retval = _pages[_currPage]->setValueString(iNS, szKey, value, valueSize);
+
+    if (retval == kKVPErrorOK)
+        removeOlderCopies(iNS, szKey);
 
     return retval;
 }
@@ -273,12 +655,13 @@ flxKVPError_t flxKVPStore::getValue(uint8_t iNS, flxDataType_t dType, const char
     if (iNS < 1 || szKey == nullptr || strlen(szKey) < 2 || value == nullptr || valueSize == 0)
         return kKVPErrorBadParam;
 
-    // Serial.printf("getValue (1): NS: %u, %s\n\r", iNS , szKey);
-    for (auto thePage : _pages)
+    // Pages check their key directory - only the page with the key reads from flash
+    flxKVPError_t retval;
+    for (auto thePage : _searchOrder)
     {
-        // Serial.printf("keyExists: %d\n\r", (int)thePage->keyExists(iNS, szKey));
-        if (thePage->keyExists(iNS, szKey))
-            return thePage->readValue(iNS, dType, szKey, value, valueSize);
+        retval = thePage->readValue(iNS, dType, szKey, value, valueSize);
+        if (retval != kKVPErrorNoMatch)
+            return retval;
     }
     // Serial.printf("getValue (2): %s\n\r", szKey);
     return kKVPErrorNoMatch;
@@ -289,13 +672,15 @@ flxKVPError_t flxKVPStore::deleteValue(uint8_t iNS, const char *szKey)
     if (iNS < 1 || szKey == nullptr || strlen(szKey) < 2)
         return kKVPErrorBadParam;
 
+    // delete from every page - in case an old copy remains
+    flxKVPError_t retval = kKVPErrorNoMatch;
     for (auto thePage : _pages)
     {
-        if (thePage->keyExists(iNS, szKey))
-            return thePage->deleteValue(iNS, szKey);
+        if (thePage->deleteValue(iNS, szKey) == kKVPErrorOK)
+            retval = kKVPErrorOK;
     }
 
-    return kKVPErrorNoMatch;
+    return retval;
 }
 //----------------------------------------------------------
 bool flxKVPStore::keyExists(uint8_t iNS, const char *szKey)
@@ -319,4 +704,9 @@ void flxKVPStore::reset(void)
         // Reset the page - erase it and then re-init format
         thePage->initPage(true);
     }
+    if (_pages.size() > 0)
+    {
+        sortPages();
+        selectCurrentPage();
+    }
 }
\ No newline at end of file
@@ -34,7 +34,10 @@ class flxKVPStore
   public:
     static constexpr int16_t kNullPage = -1;
 
-    flxKVPStore() : _storageDevice{nullptr}, _currPage{kNullPage}
+    // A full page is compacted when at least this many entries can be reclaimed
+    static constexpr uint32_t kCompactMinFree = flxKVPStorePage::kNEntriesPerPage / 4;
+
+    flxKVPStore() : _storageDevice{nullptr}, _currPage{kNullPage}, _inTransaction{false}
     {
     }
     flxKVPError_t initialize(void);
@@ -95,8 +98,19 @@ class flxKVPStore
             _storageDevice->flush();
     }
 
+    // Transactions - bracket a set of changes. The entry state table of each page is written once, at
+    // commit, instead of on every change. Note - this coalesces writes, it isn't atomic; changes are
+    // also written out when the current page changes or a page is compacted.
+    void beginTransaction(void);
+    flxKVPError_t commitTransaction(void);
+
     void reset(void);
 
+    // Compact the most fragmented full page into an empty page, reclaiming deleted entries - a single page
+    // store compacts its page in place. Returns true if a page was compacted. Unless forced, only done if
+    // kCompactMinFree entries are reclaimed.
+    bool compact(bool bForce = false);
+
     void setStorageDevice(flxKVPStoreDevice *device)
     {
         _storageDevice = device;
@@ -111,6 +125,16 @@ class flxKVPStore
 
   private:
     bool moveToFreePage(void);
+    void selectCurrentPage(void);
+    uint32_t nextSequence(void);
+    void sortPages(void);
+    flxKVPError_t recoverPages(void);
+    void removeOlderCopies(uint8_t iNS, const char *szKey);
+    bool storedOnOlderPage(uint8_t iNS, flxDataType_t dType, const char *szKey, const void *value, size_t valueSize);
+    flxKVPError_t setBatchMode(bool bBatch);
+    bool selectFreePage(void);
+    bool compactPage(int16_t iFrom, int16_t iTo);
+    bool compactInPlace(int16_t iPage);
 
     flxKVPError_t checkNameSpaces(void);
 
@@ -131,7 +155,12 @@ class flxKVPStore
 
     int16_t _currPage;
 
+    bool _inTransaction;
+
     std::vector<flxKVPStorePage *> _pages;
+
+    // pages in search order - newest (highest sequence) first
+    std::vector<flxKVPStorePage *> _searchOrder;
     std::vector<KVPNameSpaceEntry *> _namespaces;
     std::bitset<256> _nsState;
 };
\ No newline at end of file
@@ -28,7 +28,10 @@
 #include <cstddef>
 #include <cstdint>
 
-const uint8_t kKVPStoreVersion = 1;
+// Version 2 - page header has a sequence number, erase count and compaction source
+// Version 3 - flash is only programmed from 1 to 0 between erases (NOR) - entry states and page status
+//             only clear bits, and values are written to a new entry instead of updated in place
+const uint8_t kKVPStoreVersion = 3;
 
 enum flxKVPError_t : std::int8_t
 {
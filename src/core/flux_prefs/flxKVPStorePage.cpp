@@ -23,6 +23,9 @@
 #include "flxKVPStoreDefs.h"
 #include "flxUtils.h"
 
+#include <algorithm>
+#include <new>
+
 //
 uint32_t flxKVPStorePage::flxKVPStorePageHeader::calculateCRC32() const
 {
@@ -39,7 +42,8 @@ uint32_t flxKVPStorePage::flxKVPStorePageHeader::calculateCRC32() const
 
 flxKVPStorePage::flxKVPStorePage()
     : _pageStatus{flxKVPPageStatus::kPageInvalid}, _pageSector{kNoSector}, _pageBaseAddress{0}, _pStorage{nullptr},
-      _entryState{0}, _lastEmptyEntry{0}
+      _entryState{0}, _lastEmptyEntry{0}, _sequence{0}, _eraseCount{0}, _source{kNoSector}, _isBlank{false},
+      _isLegacy{false}, _inBatch{false}, _stateDirty{false}
 {
 }
 
@@ -68,44 +72,80 @@ bool flxKVPStorePage::initialize(flxKVPStoreDevice *theDevice, uint32_t sectorNu
 }
 
 /** @brief Updates the status of the page.
+ *
+ * Only the status word of the header is written - a status change only clears bits. A blank page has no header
+ * yet, and the header of a version 1/2 page isn't updated, so for those the status is only kept in memory.
  *
  * @param newStatus The new status to set for the page.
  * @return kKVPErrorOK if the status was successfully updated, kKVPErrorConfig if the storage is not configured, or
  * kKVPErrorIO if there was an I/O error.
  */
-flxKVPError_t flxKVPStorePage::updatePageStatus(flxKVPPageStatus newStatus, bool bForce /*=false*/)
+flxKVPError_t flxKVPStorePage::updatePageStatus(flxKVPPageStatus newStatus)
 {
-    // Serial.printf("updatePageStatus() - newStatus: %d, sector %u, pageStatus: 0x%X\n\r", newStatus, _pageSector,
-    //   _pageStatus);
-    if (!bForce && newStatus == _pageStatus)
+    if (newStatus == _pageStatus)
         return flxKVPError_t::kKVPErrorOK;
 
+    // Only a change that clears bits can be written
+    bool bWrite = !_isBlank && !_isLegacy && (newStatus & ~_pageStatus) == 0;
+
     _pageStatus = newStatus;
 
     if (!_pStorage)
         return flxKVPError_t::kKVPErrorConfig;
 
+    if (!bWrite)
+        return flxKVPError_t::kKVPErrorOK;
+
+    if (!_pStorage->write(_pageSector, _pageBaseAddress + offsetof(flxKVPStorePageHeader, status), &newStatus,
+                          sizeof(newStatus)))
+    {
+        _pageStatus = flxKVPPageStatus::kPageInvalid;
+        return flxKVPError_t::kKVPErrorIO;
+    }
+
+    return flxKVPError_t::kKVPErrorOK;
+}
+
+//---------------------------------------------
+/**
+ * @brief Writes the page header - done once after the page is erased.
+ *
+ * @param status The status of the page
+ * @return flxKVPError_t kKVPErrorOK on success
+ */
+flxKVPError_t flxKVPStorePage::writeHeader(flxKVPPageStatus status)
+{
+    if (!_pStorage)
+        return kKVPErrorConfig;
+
+    if (!_isBlank)
+        return kKVPErrorGeneric;
+
     flxKVPStorePageHeader theHeader;
-    theHeader.status = _pageStatus;
+    theHeader.status = status;
     theHeader.number = _pageSector;
     theHeader.version = kKVPStoreVersion;
+    theHeader.sequence = _sequence;
+    theHeader.eraseCount = _eraseCount;
+    theHeader.source = _source;
     theHeader.crc32 = theHeader.calculateCRC32();
 
     if (!_pStorage->write(_pageSector, _pageBaseAddress, &theHeader, sizeof(flxKVPStorePageHeader)))
     {
-        // Serial.println("Error - updatePageStatus - write -  unable to update page status\n\r");
         _pageStatus = flxKVPPageStatus::kPageInvalid;
-        return flxKVPError_t::kKVPErrorIO;
+        return kKVPErrorIO;
     }
+    _isBlank = false;
+    _pageStatus = status;
 
-    return flxKVPError_t::kKVPErrorOK;
+    return kKVPErrorOK;
 }
 
 //---------------------------------------------
 /**
- * @brief Initialize the page AND write init values to flash
+ * @brief Initialize the page. The page is blank (erased) - the header is written when the page is activated.
  *
- * @param bErase if true, erase the page - defaults to false
+ * @param bErase if true, erase the page - defaults to false. Only a page that is already erased isn't erased.
  * @return flxKVPError_t kKVPErrorOK if success
  */
 flxKVPError_t flxKVPStorePage::initPage(bool bErase /*=false*/)
@@ -114,36 +154,70 @@ flxKVPError_t flxKVPStorePage::initPage(bool bErase /*=false*/)
     if (!_pStorage || _pageSector == kNoSector)
         return kKVPErrorConfig;
 
-    // if we are erasing, we need to do that first
+    // if we are erasing, we need to do that first. The erase count is written to the blank header, so it's kept
+    // over a restart.
     if (bErase)
     {
         if (!_pStorage->erase(_pageSector))
             return kKVPErrorIO;
-    }
+        _eraseCount++;
 
-    // force the page to be updated in the header/storage when update is called
-    flxKVPError_t retval = updatePageStatus(flxKVPPageStatus::kPageAvailable, true);
+        if (!_pStorage->write(_pageSector, _pageBaseAddress + offsetof(flxKVPStorePageHeader, eraseCount),
+                              &_eraseCount, sizeof(_eraseCount)))
+            return kKVPErrorIO;
+    }
 
-    if (retval != kKVPErrorOK)
-        return retval;
+    // A blank page is empty - it gets a sequence number and header when it becomes the active page
+    _sequence = 0;
+    _source = kNoSector;
+    _pageStatus = flxKVPPageStatus::kPageAvailable;
+    _isBlank = true;
+    _isLegacy = false;
+
+    memset(_entryState, 0xFF, sizeof(_entryState));
+    _directory.clear();
+    _freedInBatch.reset();
+    _stateDirty = false;
+    _lastEmptyEntry = 0;
 
-    // Write out the entry state table.
-    memset(_entryState, static_cast<uint8_t>(entryStateT::entryEmpty), sizeof(_entryState));
+    return kKVPErrorOK;
+}
 
-    bool bStatus = _pStorage->write(_pageSector, _pageBaseAddress + flxKVPStoreEntry::kEntrySize, _entryState,
-                                    sizeof(_entryState));
+//---------------------------------------------
+/**
+ * @brief Is the page blank - nothing written since the erase, except the erase count?
+ *
+ * @param theHeader The header of the page
+ * @return true if the page is blank
+ */
+bool flxKVPStorePage::isBlank(const flxKVPStorePageHeader &theHeader)
+{
+    const uint8_t *pHeader = reinterpret_cast<const uint8_t *>(&theHeader);
 
-    if (!bStatus)
+    for (uint32_t i = 0; i < sizeof(theHeader); i++)
     {
-        _pageStatus = flxKVPPageStatus::kPageInvalid;
-        return kKVPErrorIO;
+        if (pHeader[i] != 0xFF && (i < offsetof(flxKVPStorePageHeader, eraseCount) ||
+                                   i >= offsetof(flxKVPStorePageHeader, eraseCount) + sizeof(theHeader.eraseCount)))
+            return false;
     }
 
-    // commit our header changes
-    _pStorage->flush();
+    // and the rest of the page
+    uint8_t buffer[flxKVPStoreEntry::kEntrySize];
 
-    return kKVPErrorOK;
+    for (uint32_t offset = sizeof(theHeader); offset < kSectorSize; offset += sizeof(buffer))
+    {
+        if (!_pStorage->read(_pageSector, _pageBaseAddress + offset, buffer, sizeof(buffer)))
+            return false;
+
+        for (uint32_t i = 0; i < sizeof(buffer); i++)
+        {
+            if (buffer[i] != 0xFF)
+                return false;
+        }
+    }
+    return true;
 }
+
 //---------------------------------------------
 /**
  * @brief Loads the page from the storage device.
@@ -169,43 +243,278 @@ flxKVPError_t flxKVPStorePage::loadPage(void)
     {
         flxLog_E(F("KVP Storage - unable to load page"));
         // read failed, not good
-        updatePageStatus(flxKVPPageStatus::kPageInvalid);
+        _pageStatus = flxKVPPageStatus::kPageInvalid;
 
         return kKVPErrorIO;
     }
 
-    bool bNeedsInit = false;
-    // do we need to init the page?
-    if (theHeader.status != flxKVPPageStatus::kPageFull && theHeader.status != flxKVPPageStatus::kPageAvailable)
-        bNeedsInit = true;
-    else if (theHeader.crc32 != theHeader.calculateCRC32())
-    {
-        bNeedsInit = true;
-    }
-    // Serial.printf("loadPage() - page status: 0x%X, needs init: %d\n\r", theHeader.status, bNeedsInit);
+    _isBlank = false;
+    _isLegacy = false;
 
-    if (bNeedsInit)
+    bool bValidHeader = theHeader.crc32 == theHeader.calculateCRC32();
+
+    // Sequence and erase count were added in version 2 of the header
+    if (bValidHeader && theHeader.version >= 2)
     {
-        // if we are here, we need to init the page
-        if (initPage() != kKVPErrorOK)
-            return kKVPErrorIO;
+        _sequence = theHeader.sequence;
+        _eraseCount = theHeader.eraseCount;
+        _source = theHeader.source;
     }
     else
+    {
+        // The erase count of a blank page, or a page with a header write that didn't complete
+        _sequence = 0;
+        _eraseCount = theHeader.eraseCount != 0xFFFFFFFF ? theHeader.eraseCount : 0;
+        _source = kNoSector;
+    }
+
+    // A page in use?
+    if (bValidHeader && theHeader.version >= kKVPStoreVersion &&
+        (theHeader.status == flxKVPPageStatus::kPageAvailable || theHeader.status == flxKVPPageStatus::kPageFull))
         _pageStatus = theHeader.status;
 
+    else if (bValidHeader && theHeader.version < kKVPStoreVersion &&
+             (theHeader.status == flxKVPPageStatus::kPageAvailableV2 ||
+              theHeader.status == flxKVPPageStatus::kPageFullV2))
+        return loadLegacyPage(theHeader);
+
+    else
+    {
+        // Blank, or left by an interrupted erase, header write or compaction - there are no valid entries, since
+        // a page's header is written before any entries. Erase it, unless already blank.
+        return initPage(theHeader.status != flxKVPPageStatus::kPageUninitialized || !isBlank(theHeader));
+    }
+
     // need to load in the entry status table.
     bStatus =
         _pStorage->read(_pageSector, _pageBaseAddress + flxKVPStoreEntry::kEntrySize, _entryState, sizeof(_entryState));
     if (!bStatus)
+        return kKVPErrorIO;
+
+    // Build the key directory for the page
+    if (loadDirectory() != kKVPErrorOK)
+    {
+        flxLog_E(F("KVP Storage - unable to load page entries"));
+        return kKVPErrorIO;
+    }
+
+    return kKVPErrorOK;
+}
+
+//---------------------------------------------
+/**
+ * @brief Load a version 1 or 2 page.
+ *
+ * These pages updated entries in place, and have a different entry state encoding (written = 0x1, empty = 0). The
+ * entry states are converted when loaded - and back when written. Free entries might not be erased, so the page
+ * takes no new entries. Its entries can be read and deleted, and compaction copies them to a current page.
+ *
+ * @param theHeader The header of the page
+ * @return flxKVPError_t kKVPErrorOK on success
+ */
+flxKVPError_t flxKVPStorePage::loadLegacyPage(const flxKVPStorePageHeader &theHeader)
+{
+    if (!_pStorage->read(_pageSector, _pageBaseAddress + flxKVPStoreEntry::kEntrySize, _entryState,
+                         sizeof(_entryState)))
+        return kKVPErrorIO;
+
+    _isLegacy = true;
+    _pageStatus = flxKVPPageStatus::kPageFull;
+
+    // written (0x1) -> written, anything else -> erased
+    for (uint32_t i = 0; i < sizeof(_entryState) / sizeof(_entryState[0]); i++)
+    {
+        uint32_t written = _entryState[i] & ~(_entryState[i] >> 1) & 0x55555555;
+        _entryState[i] = written << 1;
+    }
+
+    if (loadDirectory() != kKVPErrorOK)
+    {
+        flxLog_E(F("KVP Storage - unable to load page entries"));
+        return kKVPErrorIO;
+    }
+
+    // Nothing on the page? Erase it, so it can be used
+    if (_directory.empty())
+        return initPage(true);
+
+    flxLog_I(F("KVP Storage - page %u is version %u"), _pageSector, theHeader.version);
+
+    return kKVPErrorOK;
+}
+
+//---------------------------------------------
+/**
+ * @brief Writes the entry state table.
+ *
+ * @param pState The table to write - defaults to the page's table
+ * @return true on success
+ */
+bool flxKVPStorePage::writeEntryState(const uint32_t *pState /*=nullptr*/)
+{
+    if (!_pStorage)
+        return false;
+
+    // writing the page's table?
+    bool bTable = pState == nullptr;
+    if (bTable)
+        pState = _entryState;
+
+    uint32_t theState[sizeof(_entryState) / sizeof(_entryState[0])];
+
+    // A version 1/2 page - written is 0x1, erased is 0
+    if (_isLegacy)
+    {
+        for (uint32_t i = 0; i < sizeof(_entryState) / sizeof(_entryState[0]); i++)
+            theState[i] = (pState[i] & ~(pState[i] << 1) & 0xAAAAAAAA) >> 1;
+        pState = theState;
+    }
+
+    bool bStatus =
+        _pStorage->write(_pageSector, _pageBaseAddress + flxKVPStoreEntry::kEntrySize, pState, sizeof(_entryState));
+
+    if (bStatus && bTable)
+        _stateDirty = false;
+
+    return bStatus;
+}
+
+//---------------------------------------------
+// Key directory methods
+//---------------------------------------------
+/**
+ * @brief Hash a key for the key directory.
+ *
+ * Only the portion of the key that is stored in an entry is hashed.
+ *
+ * @param szKey The key to hash
+ * @return uint16_t The 16 bit hash of the key
+ */
+uint16_t flxKVPStorePage::keyHash(const char *szKey)
+{
+    uint32_t hash = 5381;
+
+    for (uint32_t i = 0; i < flxKVPStoreEntry::kMaxKeyLength && szKey[i] != '\0'; i++)
+        hash = ((hash << 5) + hash) + (uint8_t)szKey[i]; // hash * 33 + c
+
+    return (uint16_t)(hash ^ (hash >> 16));
+}
+
+//---------------------------------------------
+/**
+ * @brief Builds the key directory for the page.
+ *
+ * Reads each written entry once, and cleans up after writes that were interrupted by a power loss:
+ *
+ *   - Entries that fail their CRC check are erased.
+ *   - Empty entries that were programmed, but not marked written, are erased - they can't be programmed again.
+ *   - A key written twice - a new value whose old entry wasn't erased. The later entry is the newer value.
+ *
+ * @return kKVPErrorOK on success, kKVPErrorIO if an entry couldn't be read.
+ */
+flxKVPError_t flxKVPStorePage::loadDirectory(void)
+{
+    _directory.clear();
+
+    flxKVPStoreEntry theEntry, otherEntry;
+    uint32_t inc = 0;
+    uint32_t i, iSpan;
+    entryStateT eState;
+
+    for (i = 0; i < kNEntriesPerPage; i += inc)
     {
-        initPage();
+        inc = 1;
+        eState = entryState(i);
+
+        if (eState == entryStateT::entryEmpty)
+        {
+            if (_pStorage->read(_pageSector,
+                                _pageBaseAddress + (i + kNBookKeepingEntries) * flxKVPStoreEntry::kEntrySize,
+                                theEntry.record, sizeof(theEntry.record)) &&
+                std::any_of(theEntry.record, theEntry.record + sizeof(theEntry.record),
+                            [](uint8_t value) { return value != 0xFF; }))
+                setEntryState(i, entryStateT::entryErased);
+            continue;
+        }
+
+        if (eState != entryStateT::entryWritten)
+            continue;
+
+        if (readEntry(i, theEntry) != kKVPErrorOK)
+            return kKVPErrorIO;
+
+        // data still look okay? Note - a corrupt entry's span can't be trusted, so only the entry is erased.
+        if (theEntry.crc32 != theEntry.calculateCRC32() || i + std::max<uint32_t>(theEntry.span, 1) > kNEntriesPerPage)
+        {
+            setEntryState(i, entryStateT::entryErased);
+            continue;
+        }
+
+        // skip the span of the entry - strings use multiple entries. Handle a span of 0
+        inc = theEntry.span == 0 ? 1 : theEntry.span;
+
+        // The data entries of a string are marked written with the entry - unless that was interrupted
+        for (iSpan = i + 1; iSpan < i + inc; iSpan++)
+        {
+            eState = entryState(iSpan);
+            if (eState != entryStateT::entryWritten && eState != entryStateT::entryEmpty)
+                break;
+        }
+        if (iSpan < i + inc)
+        {
+            setEntryState(i, entryStateT::entryErased, inc);
+            continue;
+        }
+        setEntryState(i, entryStateT::entryWritten, inc);
+
+        // The same key earlier on the page? That's the old value
+        for (auto &dirEntry : _directory)
+        {
+            if (dirEntry.iNameSpace != theEntry.iNameSpace || dirEntry.keyHash != keyHash(theEntry.entryKey) ||
+                readEntry(dirEntry.index, otherEntry) != kKVPErrorOK ||
+                strncmp(otherEntry.entryKey, theEntry.entryKey, flxKVPStoreEntry::kMaxKeyLength) != 0)
+                continue;
 
-        // TODO: -- Should we erase the page at this point - OR rebuild the entry table -- don't like rebuild
+            deleteEntry(dirEntry.index);
+            break;
+        }
+
+        addToDirectory(i, theEntry);
     }
 
     return kKVPErrorOK;
 }
 
+//---------------------------------------------
+// Returns the position of the first directory record with an index >= the given index
+std::vector<flxKVPStorePage::flxKVPDirEntry>::iterator flxKVPStorePage::directoryPosition(uint32_t index)
+{
+    return std::lower_bound(_directory.begin(), _directory.end(), index,
+                            [](const flxKVPDirEntry &dirEntry, uint32_t idx) { return dirEntry.index < idx; });
+}
+
+//---------------------------------------------
+void flxKVPStorePage::addToDirectory(uint32_t index, const flxKVPStoreEntry &theEntry)
+{
+    flxKVPDirEntry dirEntry = {keyHash(theEntry.entryKey), theEntry.iNameSpace, (uint8_t)index};
+
+    auto it = directoryPosition(index);
+
+    if (it != _directory.end() && it->index == index)
+        *it = dirEntry;
+    else
+        _directory.insert(it, dirEntry);
+}
+
+//---------------------------------------------
+void flxKVPStorePage::removeFromDirectory(uint32_t index)
+{
+    auto it = directoryPosition(index);
+
+    if (it != _directory.end() && it->index == index)
+        _directory.erase(it);
+}
+
 //---------------------------------------------
 /**
  * @brief Get the index of the next free entry in the flash page.
@@ -238,8 +547,9 @@ uint32_t flxKVPStorePage::getNextFreeEntry(uint8_t span)
             nEmpty = 0;
     }
 
-    // if we are here, we are full
-    updatePageStatus(flxKVPPageStatus::kPageFull);
+    // if we are here, we are full. Note: a page being filled by compaction keeps its status
+    if (_pageStatus == flxKVPPageStatus::kPageAvailable)
+        updatePageStatus(flxKVPPageStatus::kPageFull);
 
     return flxKVPStoreEntry::kEntryInvalid;
 }
@@ -256,9 +566,12 @@ uint32_t flxKVPStorePage::getNextFreeEntry(uint8_t span)
  */
 flxKVPError_t flxKVPStorePage::writeEntry(const flxKVPStoreEntry &theEntry)
 {
-    if (!_pStorage || _pageStatus == flxKVPPageStatus::kPageFull)
+    if (!_pStorage || _isBlank)
         return kKVPErrorConfig;
 
+    if (_pageStatus == flxKVPPageStatus::kPageFull)
+        return kKVPErrorPageFull;
+
     uint32_t index = getNextFreeEntry();
 
     if (index == flxKVPStoreEntry::kEntryInvalid)
@@ -294,25 +607,29 @@ flxKVPError_t flxKVPStorePage::readEntry(uint32_t index, flxKVPStoreEntry &theEn
 //--------------------------------------------------------
 // updateEntry()
 /**
- * @brief Updates an entry in the flash page.
+ * @brief Writes an entry to empty entries of the flash page.
  *
- * This function updates the entry at the specified index with the provided entry data.
+ * This function writes the entry at the specified index, and marks the entries it spans as written. Entries are
+ * not rewritten - a value update writes a new entry, and erases the old one.
  *
- * @param index The index of the entry to be updated.
+ * @param index The index of the entry to be written.
  * @param theEntry The entry data to be written.
  * @return The error code indicating the status of the update operation.
- *         - kKVPErrorConfig: If there is no storage device available.
- *         - kKVPErrorInvalidIndex: If the provided index is invalid.
+ *         - kKVPErrorConfig: If there is no storage device available, or the page isn't active.
+ *         - kKVPErrorInvalidIndex: If the provided index is invalid, or the entry isn't empty.
  *         - kKVPErrorIO: If there was an error during the write operation.
  *         - kKVPErrorOK: If the update operation was successful.
  */
 flxKVPError_t flxKVPStorePage::updateEntry(uint32_t index, const flxKVPStoreEntry &theEntry)
 {
     // no storage device, we haven't been initialized
-    if (!_pStorage)
+    if (!_pStorage || _isBlank)
         return kKVPErrorConfig;
 
-    if (index == flxKVPStoreEntry::kEntryInvalid || index >= flxKVPStorePage::kNEntriesPerPage)
+    uint8_t span = theEntry.span == 0 ? 1 : theEntry.span;
+
+    if (index == flxKVPStoreEntry::kEntryInvalid || index + span > flxKVPStorePage::kNEntriesPerPage ||
+        entryState(index) != entryStateT::entryEmpty)
         return kKVPErrorInvalidIndex;
 
     uint32_t address = _pageBaseAddress + (index + kNBookKeepingEntries) * flxKVPStoreEntry::kEntrySize;
@@ -322,9 +639,10 @@ flxKVPError_t flxKVPStorePage::updateEntry(uint32_t index, const flxKVPStoreEntr
     // if success, update the status in the entry table
     if (bStatus)
     {
-        for (uint8_t i = 0; i < theEntry.span; i++)
-            setEntryState(index + i, entryStateT::entryWritten);
-        _lastEmptyEntry = index + theEntry.span;
+        setEntryState(index, entryStateT::entryWritten, span);
+        _lastEmptyEntry = index + span;
+
+        addToDirectory(index, theEntry);
     }
     // return status code based on bool from write.
     return bStatus ? kKVPErrorOK : kKVPErrorIO;
@@ -360,39 +678,35 @@ flxKVPError_t flxKVPStorePage::findEntry(uint8_t iNS, const char *szKey, flxKVPS
     if (entryIndex >= kNEntriesPerPage)
         return kKVPErrorInvalidIndex;
 
-    // TODO: Optimize the start point for this search
-
-    uint32_t inc = 0;
+    uint16_t hash = szKey != nullptr ? keyHash(szKey) : 0;
 
-    // Serial.printf("Starting search at index: %u - key: %s\n\r", iNS, szKey);
+    // Walk the key directory - only entries that match namespace and key hash are read from flash
+    auto it = directoryPosition(entryIndex);
 
-    for (uint32_t i = entryIndex; i < flxKVPStorePage::kNEntriesPerPage; i += inc)
+    while (it != _directory.end())
     {
-        inc = 1;
-
-        // is this entry written/valid
-        if (entryState(i) != entryStateT::entryWritten)
+        if (it->iNameSpace != iNS || (szKey != nullptr && it->keyHash != hash))
+        {
+            it++;
             continue;
+        }
+
+        uint32_t i = it->index;
 
         // read the entry
         if (readEntry(i, theEntry) != kKVPErrorOK)
             return kKVPErrorIO;
 
-        // Is this type a string - if so, we need to skip the span of the string
-        // note - handle if span is set to 0
-        inc = theEntry.span == 0 ? 1 : theEntry.span;
-
         // data still look okay?
         if (theEntry.crc32 != theEntry.calculateCRC32())
         {
-            // Delete this entry - it's corrupt
-            deleteEntry(i);
+            // Erase this entry - it's corrupt, so its span can't be trusted. Continue from its position
+            setEntryState(i, entryStateT::entryErased);
+            removeFromDirectory(i);
+            it = directoryPosition(i);
             continue;
         }
 
-        if (iNS != theEntry.iNameSpace)
-            continue;
-
         // at this point the namespace matches. If no key - match, or  if key and key matches, we match
         if ((iNS == kKVPNameSpaceEntryNS && szKey == nullptr) ||
             strncmp(szKey, theEntry.entryKey, flxKVPStoreEntry::kMaxKeyLength) == 0)
@@ -400,6 +714,7 @@ flxKVPError_t flxKVPStorePage::findEntry(uint8_t iNS, const char *szKey, flxKVPS
             entryIndex = i;
             return kKVPErrorOK;
         }
+        it++;
     }
 
     // if we are here - no match
@@ -429,13 +744,11 @@ flxKVPError_t flxKVPStorePage::deleteEntry(uint32_t index)
         return kKVPErrorIO;
 
     // deal with the span of the entry
-    uint32_t nErase = theEntry.span;
+    uint32_t nErase = std::min<uint32_t>(theEntry.span == 0 ? 1 : theEntry.span, kNEntriesPerPage - index);
 
-    for (uint32_t i = 0; i < nErase; i++)
-        (void)setEntryState(index + i, entryStateT::entryEmpty);
+    (void)setEntryState(index, entryStateT::entryErased, nErase);
 
-    if (index < _lastEmptyEntry)
-        _lastEmptyEntry = index;
+    removeFromDirectory(index);
 
     return kKVPErrorOK;
 }
@@ -457,77 +770,88 @@ flxKVPError_t flxKVPStorePage::deleteEntry(uint32_t index)
  */
 flxKVPError_t flxKVPStorePage::setValueString(uint8_t iNS, const char *szKey, const char *value, size_t valueSize)
 {
-    if (!_pStorage)
+    if (!_pStorage || _isBlank)
         return kKVPErrorConfig;
 
+    if (valueSize == 0)
+        return kKVPErrorBadParam;
+
     // Is this item in the page?
     flxKVPStoreEntry theEntry;
     uint32_t idxEntry = 0;
 
     flxKVPError_t itExists = findEntry(iNS, szKey, theEntry, idxEntry);
 
-    // how many entries will this puppy require
-    size_t totalSize = (valueSize + flxKVPStoreEntry::kEntrySize - 1) & ~(flxKVPStoreEntry::kEntrySize - 1);
-    size_t nEntries = (totalSize / flxKVPStoreEntry::kEntrySize) + 1;
-    totalSize = totalSize + flxKVPStoreEntry::kEntrySize;
+    const uint8_t *uiValue = reinterpret_cast<const uint8_t *>(value);
+    uint32_t dataCRC32 = flxKVPStoreEntry::calculateCRC32(uiValue, valueSize);
 
-    size_t newSpan = (totalSize + flxKVPStoreEntry::kEntrySize - 1) / flxKVPStoreEntry::kEntrySize;
+    // no changes in value? Same size and data CRC - nothing to write
+    if (itExists == kKVPErrorOK && theEntry.dataType == flxTypeString && theEntry.dataLength.dataSize == valueSize &&
+        theEntry.dataLength.dataCRC32 == dataCRC32)
+        return kKVPErrorOK;
 
-    // room on this page for the string?
-    if (itExists == kKVPErrorOK)
-    {
-        // no changes in type/value?
-        if (theEntry.dataLength.dataSize == valueSize)
-        {
-            // If the value is the same, return kKVPErrorOK
-            uint32_t address = _pageBaseAddress + (idxEntry + kNBookKeepingEntries + 1) * flxKVPStoreEntry::kEntrySize;
-            if (memcmp(value, (char *)address, valueSize) == 0)
-                return kKVPErrorOK;
-        }
+    if (_pageStatus == flxKVPPageStatus::kPageFull)
+        return kKVPErrorPageFull;
 
-        // if the current span length being used is less than needed, delete the entry. A new one is needed.
-        if (theEntry.span < newSpan)
-        {
-            // We can't reuse and need to expand - delete and retreat
-            deleteEntry(idxEntry);
-            itExists = kKVPErrorGeneric; // force a new entry later in method
-        }
-        else if (theEntry.span > newSpan)
-        {
-            // We can use the current space, but don't requires the same number of
-            // entries/records. Mark the unused entries as empty
-            for (uint32_t i = newSpan; i < theEntry.span; i++)
-                setEntryState(idxEntry + i, entryStateT::entryEmpty);
+    // how many entries will this puppy require - the entry, and the data
+    size_t newSpan = 1 + (valueSize + flxKVPStoreEntry::kEntrySize - 1) / flxKVPStoreEntry::kEntrySize;
 
-            theEntry.span = newSpan;
-        }
-    }
+    if (newSpan > kNEntriesPerPage)
+        return kKVPErrorBadParam;
 
-    // do we need find a spot for this entry
-    if (itExists != kKVPErrorOK)
-    {
-        // if we are here, we need to find space for the string
-        idxEntry = getNextFreeEntry(newSpan);
-        if (idxEntry == flxKVPStoreEntry::kEntryInvalid)
-            return kKVPErrorPageFull;
+    // The value is written to new entries - find space for the string
+    uint32_t idxNew = getNextFreeEntry(newSpan);
+    if (idxNew == flxKVPStoreEntry::kEntryInvalid)
+        return kKVPErrorPageFull;
 
-        theEntry = flxKVPStoreEntry(iNS, flxTypeString, newSpan, szKey);
-    }
+    // write out the string data first - the entry makes it valid
+    uint32_t address = _pageBaseAddress + (idxNew + kNBookKeepingEntries + 1) * flxKVPStoreEntry::kEntrySize;
+    if (!_pStorage->write(_pageSector, address, uiValue, valueSize))
+        return kKVPErrorIO;
 
     // Setup the Entry
-    const uint8_t *uiValue = reinterpret_cast<const uint8_t *>(value);
+    flxKVPStoreEntry newEntry(iNS, flxTypeString, newSpan, szKey);
 
-    theEntry.dataLength.dataCRC32 = flxKVPStoreEntry::calculateCRC32(uiValue, valueSize);
-    theEntry.dataLength.dataSize = valueSize;
-    theEntry.dataLength.reserved = 0xFFFF;
+    newEntry.dataLength.dataCRC32 = dataCRC32;
+    newEntry.dataLength.dataSize = valueSize;
+    newEntry.dataLength.reserved = 0xFFFF;
 
-    theEntry.crc32 = theEntry.calculateCRC32();
-    if (updateEntry(idxEntry, theEntry) != kKVPErrorOK)
+    newEntry.crc32 = newEntry.calculateCRC32();
+    if (updateEntry(idxNew, newEntry) != kKVPErrorOK)
         return kKVPErrorIO;
 
-    // now write out the string data
-    uint32_t address = _pageBaseAddress + (idxEntry + kNBookKeepingEntries + 1) * flxKVPStoreEntry::kEntrySize;
-    return _pStorage->write(_pageSector, address, uiValue, valueSize) ? kKVPErrorOK : kKVPErrorIO;
+    // The new value is valid - erase the old one
+    if (itExists == kKVPErrorOK)
+        deleteEntry(idxEntry);
+
+    return kKVPErrorOK;
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Checks if the page holds the key with the given value - strings are compared by size and data CRC.
+ *
+ * @param iNS The namespace index.
+ * @param dType The data type of the value.
+ * @param szKey The key.
+ * @param value A pointer to the value.
+ * @param valueSize The size of the value.
+ * @return true if the key is on the page with the same value, false otherwise.
+ */
+bool flxKVPStorePage::hasValue(uint8_t iNS, flxDataType_t dType, const char *szKey, const void *value,
+                               size_t valueSize)
+{
+    flxKVPStoreEntry theEntry;
+
+    if (findEntry(iNS, szKey, theEntry) != kKVPErrorOK || theEntry.dataType != dType)
+        return false;
+
+    if (dType == flxTypeString)
+        return theEntry.dataLength.dataSize == valueSize &&
+               theEntry.dataLength.dataCRC32 ==
+                   flxKVPStoreEntry::calculateCRC32(reinterpret_cast<const uint8_t *>(value), valueSize);
+
+    return memcmp(value, theEntry.data, valueSize) == 0;
 }
 
 //--------------------------------------------------------------
@@ -556,20 +880,25 @@ flxKVPError_t flxKVPStorePage::setValue(uint8_t iNS, flxDataType_t dType, const
     uint32_t idxEntry = 0;
 
     flxKVPError_t itExists = findEntry(iNS, szKey, theEntry, idxEntry);
-    if (itExists == kKVPErrorOK)
-    {
-        // no changes in type/value?
-        if (dType == theEntry.dataType && memcmp(value, theEntry.data, valueSize) == 0)
-            return kKVPErrorOK;
-    }
-    else
-        theEntry = flxKVPStoreEntry(iNS, dType, 1, szKey);
+
+    // no changes in type/value?
+    if (itExists == kKVPErrorOK && dType == theEntry.dataType && memcmp(value, theEntry.data, valueSize) == 0)
+        return kKVPErrorOK;
+
+    // The value is written to a new entry
+    flxKVPStoreEntry newEntry(iNS, dType, 1, szKey);
 
     // setup the entry
-    memcpy(theEntry.data, value, valueSize);
-    theEntry.crc32 = theEntry.calculateCRC32();
+    memcpy(newEntry.data, value, std::min(valueSize, sizeof(newEntry.data)));
+    newEntry.crc32 = newEntry.calculateCRC32();
+
+    flxKVPError_t retval = writeEntry(newEntry);
 
-    return itExists == kKVPErrorOK ? updateEntry(idxEntry, theEntry) : writeEntry(theEntry);
+    // The new value is valid - erase the old one
+    if (retval == kKVPErrorOK && itExists == kKVPErrorOK)
+        deleteEntry(idxEntry);
+
+    return retval;
 }
 
 //--------------------------------------------------------------
@@ -669,6 +998,325 @@ bool flxKVPStorePage::keyExists(uint8_t iNS, const char *szKey)
     // Serial.printf("Checking for key: %s\n\r", szKey);
     return findEntry(iNS, szKey, theEntry) == kKVPErrorOK;
 }
+//--------------------------------------------------------------
+// Page management - used by the store for compaction and recovery
+//--------------------------------------------------------------
+/**
+ * @brief Returns the number of entries in use on the page.
+ *
+ * String values use multiple entries, and each is counted.
+ *
+ * @return uint32_t The number of entries in use
+ */
+uint32_t flxKVPStorePage::liveEntries(void)
+{
+    uint32_t nLive = 0;
+
+    for (uint32_t i = 0; i < kNEntriesPerPage; i++)
+    {
+        if (entryState(i) == entryStateT::entryWritten)
+            nLive++;
+    }
+    return nLive;
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Returns the number of erased (deleted) entries on the page.
+ *
+ * @return uint32_t The number of entries that compaction reclaims
+ */
+uint32_t flxKVPStorePage::erasedEntries(void)
+{
+    uint32_t nErased = 0;
+    entryStateT eState;
+
+    for (uint32_t i = 0; i < kNEntriesPerPage; i++)
+    {
+        eState = entryState(i);
+        if (eState != entryStateT::entryWritten && eState != entryStateT::entryEmpty)
+            nErased++;
+    }
+    return nErased;
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Make the page ready for writes.
+ *
+ * A blank page gets its header - with the sequence number. The header of a page is only written once after it's
+ * erased, so a page in use keeps its sequence number.
+ *
+ * @param sequence The sequence number for a blank page - higher than any other page
+ * @return flxKVPError_t kKVPErrorOK on success
+ */
+flxKVPError_t flxKVPStorePage::activate(uint32_t sequence)
+{
+    if (!_isBlank)
+        return kKVPErrorOK;
+
+    _sequence = sequence;
+    _source = kNoSector;
+
+    return writeHeader(flxKVPPageStatus::kPageAvailable);
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Returns the first entry on the page at or after the given index.
+ *
+ * @param[in,out] index Input: the index to start from, returns the index of the entry
+ * @param theEntry The entry read
+ * @return flxKVPError_t kKVPErrorOK on success, kKVPErrorNoMatch if there are no more entries
+ */
+flxKVPError_t flxKVPStorePage::nextEntry(uint32_t &index, flxKVPStoreEntry &theEntry)
+{
+    auto it = directoryPosition(index);
+
+    if (it == _directory.end())
+        return kKVPErrorNoMatch;
+
+    index = it->index;
+
+    return readEntry(index, theEntry);
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Start a compaction copy into this page.
+ *
+ * The page is erased, if it's not blank, and marked as compacting. It isn't a valid page until endCopy() is called.
+ *
+ * @param sequence The sequence number for the page
+ * @param source The page being compacted into this page
+ * @return flxKVPError_t kKVPErrorOK on success
+ */
+flxKVPError_t flxKVPStorePage::beginCopy(uint32_t sequence, uint32_t source)
+{
+    // A blank page doesn't need erasing
+    if (!_isBlank)
+    {
+        flxKVPError_t retval = initPage(true);
+
+        if (retval != kKVPErrorOK)
+            return retval;
+    }
+
+    _sequence = sequence;
+    _source = source;
+
+    return writeHeader(flxKVPPageStatus::kPageCompacting);
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Copy an entry - and any string data - from another page into this page.
+ *
+ * @param fromPage The page to copy from
+ * @param index The index of the entry on the from page
+ * @return flxKVPError_t kKVPErrorOK on success
+ */
+flxKVPError_t flxKVPStorePage::copyEntry(flxKVPStorePage &fromPage, uint32_t index)
+{
+    if (!_pStorage || &fromPage == this)
+        return kKVPErrorConfig;
+
+    flxKVPStoreEntry theEntry;
+    if (fromPage.readEntry(index, theEntry) != kKVPErrorOK)
+        return kKVPErrorIO;
+
+    uint8_t span = theEntry.span == 0 ? 1 : theEntry.span;
+
+    uint32_t idxEntry = getNextFreeEntry(span);
+    if (idxEntry == flxKVPStoreEntry::kEntryInvalid)
+        return kKVPErrorPageFull;
+
+    // copy the string data entries, then write the entry itself
+    uint8_t buffer[flxKVPStoreEntry::kEntrySize];
+    uint32_t fromAddress, toAddress;
+
+    for (uint32_t i = 1; i < span; i++)
+    {
+        fromAddress = fromPage._pageBaseAddress + (index + kNBookKeepingEntries + i) * flxKVPStoreEntry::kEntrySize;
+        toAddress = _pageBaseAddress + (idxEntry + kNBookKeepingEntries + i) * flxKVPStoreEntry::kEntrySize;
+
+        if (!_pStorage->read(fromPage._pageSector, fromAddress, buffer, sizeof(buffer)) ||
+            !_pStorage->write(_pageSector, toAddress, buffer, sizeof(buffer)))
+            return kKVPErrorIO;
+    }
+
+    return updateEntry(idxEntry, theEntry);
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Completes a compaction copy - the page is now valid.
+ *
+ * @return flxKVPError_t kKVPErrorOK on success
+ */
+flxKVPError_t flxKVPStorePage::endCopy(void)
+{
+    if (_pageStatus != flxKVPPageStatus::kPageCompacting)
+        return kKVPErrorConfig;
+
+    return updatePageStatus(flxKVPPageStatus::kPageAvailable);
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Compact the page in place.
+ *
+ * The live entries are read into RAM, the page is erased and the entries are written back, from the start of the
+ * page. For a store without an empty page to compact into - a single page store, or version 1/2 pages.
+ *
+ * Note: If power is lost after the erase, before the entries are written back, the entries are lost.
+ *
+ * @param sequence The sequence number of the page after it's compacted
+ * @return flxKVPError_t kKVPErrorOK on success
+ */
+flxKVPError_t flxKVPStorePage::compactInPlace(uint32_t sequence)
+{
+    if (!_pStorage || _inBatch)
+        return kKVPErrorConfig;
+
+    uint32_t nLive = liveEntries();
+    uint8_t *pData = nullptr;
+
+    if (nLive > 0)
+    {
+        pData = new (std::nothrow) uint8_t[nLive * flxKVPStoreEntry::kEntrySize];
+        if (!pData)
+            return kKVPErrorAlloc;
+    }
+
+    // Read each entry, with its string data
+    flxKVPStoreEntry theEntry;
+    uint32_t nCopy = 0;
+    uint32_t span;
+
+    for (auto &dirEntry : _directory)
+    {
+        if (readEntry(dirEntry.index, theEntry) != kKVPErrorOK)
+        {
+            delete[] pData;
+            return kKVPErrorIO;
+        }
+        span = theEntry.span == 0 ? 1 : theEntry.span;
+
+        if (nCopy + span > nLive ||
+            !_pStorage->read(_pageSector,
+                             _pageBaseAddress + (dirEntry.index + kNBookKeepingEntries) * flxKVPStoreEntry::kEntrySize,
+                             pData + nCopy * flxKVPStoreEntry::kEntrySize, span * flxKVPStoreEntry::kEntrySize))
+        {
+            delete[] pData;
+            return kKVPErrorIO;
+        }
+        nCopy += span;
+    }
+
+    flxKVPError_t retval = initPage(true);
+    if (retval == kKVPErrorOK)
+        retval = activate(sequence);
+
+    // write the entries back - in one write, then mark them written
+    if (retval == kKVPErrorOK && nCopy > 0)
+    {
+        if (!_pStorage->write(_pageSector, _pageBaseAddress + kNBookKeepingEntries * flxKVPStoreEntry::kEntrySize,
+                              pData, nCopy * flxKVPStoreEntry::kEntrySize) ||
+            setEntryState(0, entryStateT::entryWritten, nCopy) != entryStateT::entryWritten)
+            retval = kKVPErrorIO;
+        else
+            retval = loadDirectory();
+    }
+    delete[] pData;
+
+    return retval;
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Ends a batch - writes the entry state table if it changed during the batch.
+ *
+ * @return flxKVPError_t kKVPErrorOK on success, kKVPErrorIO if the table couldn't be written
+ */
+flxKVPError_t flxKVPStorePage::endBatch(void)
+{
+    _inBatch = false;
+
+    if (!_stateDirty)
+    {
+        _freedInBatch.reset();
+        return kKVPErrorOK;
+    }
+
+    // Entries erased in the batch are first written as still valid - so the new entries are valid before old
+    // values are erased. If power is lost between the writes, the page has both, and loading keeps the newer.
+    if (_freedInBatch.any())
+    {
+        uint32_t theState[sizeof(_entryState) / sizeof(_entryState[0])];
+        memcpy(theState, _entryState, sizeof(theState));
+
+        for (uint32_t i = 0; i < kNEntriesPerPage; i++)
+        {
+            if (_freedInBatch.test(i))
+                theState[i / 16] = (theState[i / 16] & ~(0x3 << ((i % 16) * 2))) |
+                                   (static_cast<uint32_t>(entryStateT::entryWritten) << ((i % 16) * 2));
+        }
+        _freedInBatch.reset();
+
+        if (!writeEntryState(theState))
+            return kKVPErrorIO;
+    }
+
+    if (!writeEntryState())
+        return kKVPErrorIO;
+
+    return kKVPErrorOK;
+}
+
+//--------------------------------------------------------------
+/**
+ * @brief Deletes entries that are also on a newer page.
+ *
+ * If power is lost after a value is written to the active page, but before the old copy is deleted,
+ * the key is on two pages. The copy on the newer page (higher sequence) is kept.
+ *
+ * @param newerPage The newer page
+ * @return flxKVPError_t kKVPErrorOK on success, kKVPErrorIO on a read error
+ */
+flxKVPError_t flxKVPStorePage::removeDuplicates(flxKVPStorePage &newerPage)
+{
+    flxKVPStoreEntry theEntry, newerEntry;
+
+    for (size_t i = 0; i < _directory.size();)
+    {
+        const flxKVPDirEntry dirEntry = _directory[i];
+
+        // check the directory of the newer page first - only read entries when the key hash matches
+        auto it = std::find_if(newerPage._directory.begin(), newerPage._directory.end(),
+                               [&dirEntry](const flxKVPDirEntry &newer) {
+                                   return newer.iNameSpace == dirEntry.iNameSpace && newer.keyHash == dirEntry.keyHash;
+                               });
+        if (it == newerPage._directory.end())
+        {
+            i++;
+            continue;
+        }
+
+        if (readEntry(dirEntry.index, theEntry) != kKVPErrorOK)
+            return kKVPErrorIO;
+
+        // if deleted, the directory record is removed - so don't advance
+        if (newerPage.findEntry(theEntry.iNameSpace, theEntry.entryKey, newerEntry) == kKVPErrorOK &&
+            deleteEntry(dirEntry.index) == kKVPErrorOK)
+            continue;
+
+        i++;
+    }
+
+    return kKVPErrorOK;
+}
+
 //---------------------------------------------
 /**
  * @brief Dumps the contents of the page to the Serial monitor.
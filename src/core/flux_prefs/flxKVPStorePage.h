@@ -29,7 +29,15 @@
 #include "flxKVPStoreDefs.h"
 #include "flxKVPStoreDevice.h"
 #include "flxKVPStoreEntry.h"
+
+#include <bitset>
+#include <vector>
+
 // page state enum
+//
+// Flash can only be programmed from 1 to 0, so each status after uninitialized only clears bits of the one before:
+// uninitialized -> compacting -> available -> full. The status is updated in place, the rest of the header is
+// written once, after the page is erased.
 
 enum flxKVPPageStatus : uint32_t
 {
@@ -37,12 +45,20 @@ enum flxKVPPageStatus : uint32_t
     // Uninitialized
     kPageUninitialized = 0xFFFFFFFF,
 
+    // Being filled by compaction - not valid until the copy is complete
+    kPageCompacting = 0xFFFFFFFE,
+
     // Available
-    kPageAvailable = 0x02,
+    kPageAvailable = 0xFFFFFFFC,
 
     // Full  -- no space available
 
-    kPageFull = 0x04,
+    kPageFull = 0xFFFFFFF8,
+
+    // Status values of version 1 and 2 pages
+    kPageAvailableV2 = 0x02,
+    kPageFullV2 = 0x04,
+    kPageCompactingV2 = 0x08,
 
     // page hasn't been loaded from flash
     kPageInvalid = 0
@@ -128,24 +144,87 @@ class flxKVPStorePage
 
     bool keyExists(uint8_t iNS, const char *szKey);
 
+    // Does the page hold this key with this value?
+    bool hasValue(uint8_t iNS, flxDataType_t dType, const char *szKey, const void *value, size_t valueSize);
+
     flxKVPPageStatus status()
     {
         return _pageStatus;
     }
 
-    // Init the page - and optionally erase it
+    // Init the page - and optionally erase it. The page is blank until it's activated
     flxKVPError_t initPage(bool bErase = false);
 
+    // Sequence number of the page - set when the page becomes the active (write) page. Higher is newer.
+    uint32_t sequence(void)
+    {
+        return _sequence;
+    }
+
+    // Number of times the page has been erased
+    uint32_t eraseCount(void)
+    {
+        return _eraseCount;
+    }
+
+    // The page this page was compacted from - kNoSector if none
+    uint32_t source(void)
+    {
+        return _source;
+    }
+
+    // Number of entries in use on the page (includes string data entries)
+    uint32_t liveEntries(void);
+
+    // Number of deleted entries - they are reclaimed by compaction
+    uint32_t erasedEntries(void);
+
+    bool isEmpty(void)
+    {
+        return _directory.empty();
+    }
+
+    // Make the page ready for writes - a blank page gets its header, with the given sequence number. A page
+    // in use keeps its sequence number.
+    flxKVPError_t activate(uint32_t sequence);
+
+    // Compact the page in place - the live entries are read into RAM, the page erased and the entries written
+    // back. Used when there is no empty page to compact into. Note: not power loss safe.
+    flxKVPError_t compactInPlace(uint32_t sequence);
+
+    // Iterate over the entries on the page - returns the first entry at or after index
+    flxKVPError_t nextEntry(uint32_t &index, flxKVPStoreEntry &theEntry);
+
+    // Compaction - erase the page and copy entries into it from another page. The page isn't valid
+    // until endCopy() is called, so an interrupted copy is discarded when the page is next loaded.
+    flxKVPError_t beginCopy(uint32_t sequence, uint32_t source);
+    flxKVPError_t copyEntry(flxKVPStorePage &fromPage, uint32_t index);
+    flxKVPError_t endCopy(void);
+
+    // Delete entries that are also on the given (newer) page
+    flxKVPError_t removeDuplicates(flxKVPStorePage &newerPage);
+
+    // Batch updates. Changes to the entry state table are kept in memory and written when the batch
+    // ends - new entries become valid at that point, before entries deleted in the batch are erased.
+    void beginBatch(void)
+    {
+        _inBatch = true;
+    }
+    flxKVPError_t endBatch(void);
+
     void dumpPage(void);
 
   private:
     // Methods for our entry state table
 
+    // Entry states - 2 bits per entry. An entry goes from empty (erased flash) to written to erased, only
+    // clearing bits. An erased entry isn't reused until the page is erased.
     enum class entryStateT : uint8_t
     {
-        entryEmpty = 0,
-        entryError = 0x3,
-        entryWritten = 0x1
+        entryEmpty = 0x3,
+        entryWritten = 0x2,
+        entryError = 0x1,
+        entryErased = 0
     };
 
     entryStateT entryState(uint32_t entry)
@@ -161,27 +240,69 @@ class flxKVPStorePage
     }
 
     //---------------------------------------------------------------
-    entryStateT setEntryState(uint32_t entry, entryStateT eState)
+    // Set the state of a range of entries - the table is written once
+    entryStateT setEntryState(uint32_t entry, entryStateT eState, uint32_t count = 1)
     {
-        if (entry >= kNEntriesPerPage)
+        if (count == 0 || entry + count > kNEntriesPerPage)
             return entryStateT::entryError;
 
-        size_t idx = entry / 16;
-        size_t offset = (entry % 16) * 2;
+        bool bChanged = false;
+
+        for (uint32_t i = entry; i < entry + count; i++)
+        {
+            size_t idx = i / 16;
+            size_t offset = (i % 16) * 2;
+
+            uint32_t newState = (_entryState[idx] & ~(0x3 << offset)) | (static_cast<uint32_t>(eState) << offset);
+
+            // no change - nothing to write
+            if (newState == _entryState[idx])
+                continue;
 
-        _entryState[idx] = (_entryState[idx] & ~(0x3 << offset)) | (static_cast<uint32_t>(eState) << offset);
+            // An entry erased in a batch is written as valid until the new entries of the batch are valid
+            if (_inBatch && eState == entryStateT::entryErased && entryState(i) == entryStateT::entryWritten)
+                _freedInBatch.set(i);
 
-        bool bStatus = false;
-        if (_pStorage)
-            bStatus = _pStorage->write(_pageSector, _pageBaseAddress + flxKVPStoreEntry::kEntrySize, _entryState,
-                                       sizeof(_entryState));
+            _entryState[idx] = newState;
+            bChanged = true;
+        }
+
+        if (!bChanged)
+            return eState;
+
+        // In a batch, the table is written when the batch ends
+        if (_inBatch)
+        {
+            _stateDirty = true;
+            return eState;
+        }
 
         // If we are unable to write the entry state, we return an error
-        return bStatus ? eState : entryStateT::entryError;
+        return writeEntryState() ? eState : entryStateT::entryError;
     }
 
+    bool writeEntryState(const uint32_t *pState = nullptr);
+
     uint32_t getNextFreeEntry(uint8_t span = 1);
 
+    //---------------------------------------------------------------
+    // In-RAM key directory. One record for each entry written to the page (string data entries are
+    // not included), ordered by entry index. Built when the page is loaded and updated as entries
+    // are written and deleted - so a lookup only reads the matching entry from flash.
+    struct flxKVPDirEntry
+    {
+        uint16_t keyHash;
+        uint8_t iNameSpace;
+        uint8_t index;
+    };
+
+    static uint16_t keyHash(const char *szKey);
+
+    flxKVPError_t loadDirectory(void);
+    void addToDirectory(uint32_t index, const flxKVPStoreEntry &theEntry);
+    void removeFromDirectory(uint32_t index);
+    std::vector<flxKVPDirEntry>::iterator directoryPosition(uint32_t index);
+
     //---------------------------------------------------------------
     // struct for our header -- 32 bytes in size
     /**
@@ -196,12 +317,17 @@ class flxKVPStorePage
         flxKVPStorePageHeader() : status{flxKVPPageStatus::kPageInvalid}
         {
             memset(fill, 0xff, sizeof(fill) / sizeof(fill[0]));
+            memset(reserved, 0xff, sizeof(reserved) / sizeof(reserved[0]));
         };
 
         flxKVPPageStatus status; /**< The status of the flash page. */
         uint32_t number;         /**< The number of the flash page. */
         uint8_t version;         /**< The version of the flash page. */
-        uint8_t fill[19];        /**< An array used for padding. */
+        uint8_t fill[3];         /**< An array used for padding. */
+        uint32_t sequence;       /**< Sequence number of the page - higher is newer. (version 2) */
+        uint32_t eraseCount;     /**< Number of times the page was erased. (version 2, v3 - written at erase) */
+        uint32_t source;         /**< The page this page was compacted from, or kNoSector. (version 2) */
+        uint8_t reserved[4];     /**< An array used for padding. */
         uint32_t crc32;          /**< The CRC32 checksum of the flash page. */
 
         /**
@@ -211,7 +337,10 @@ class flxKVPStorePage
         uint32_t calculateCRC32() const;
     };
 
-    flxKVPError_t updatePageStatus(flxKVPPageStatus newStatus, bool bForce = false);
+    flxKVPError_t updatePageStatus(flxKVPPageStatus newStatus);
+    flxKVPError_t writeHeader(flxKVPPageStatus status);
+    flxKVPError_t loadLegacyPage(const flxKVPStorePageHeader &theHeader);
+    bool isBlank(const flxKVPStorePageHeader &theHeader);
 
     flxKVPPageStatus _pageStatus;
 
@@ -223,4 +352,21 @@ class flxKVPStorePage
     uint32_t _entryState[8]; // 32 bits
 
     uint32_t _lastEmptyEntry;
+
+    uint32_t _sequence;
+    uint32_t _eraseCount;
+    uint32_t _source;
+
+    // Erased, and the header not written yet
+    bool _isBlank;
+
+    // A version 1 or 2 page - read and delete only, until it's compacted
+    bool _isLegacy;
+
+    // batch state
+    bool _inBatch;
+    bool _stateDirty;
+    std::bitset<kNEntriesPerPage> _freedInBatch;
+
+    std::vector<flxKVPDirEntry> _directory;
 };
\ No newline at end of file
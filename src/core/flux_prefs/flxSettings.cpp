@@ -21,6 +21,7 @@ flxSettingsSave &flxSettings = flxSettingsSave::get();
 void flxSettingsSave::setStorage(flxStorage *pStorage)
 {
     _primaryStorage = pStorage;
+    _primaryInSync = false;
 }
 
 void flxSettingsSave::setFallback(flxStorage *pStorage)
@@ -60,8 +61,18 @@ bool flxSettingsSave::saveObjectToStorage(flxObject *pObject, flxStorage *pStora
     if (!pStorage->begin())
         return false;
 
+    // If the primary (internal) storage is in sync with the system, only write out changes
+    pStorage->setSaveChangesOnly(pStorage == _primaryStorage && _primaryInSync &&
+                                 pStorage->kind() == flxStorage::flxStorageKindInternal);
+
     bool status = pObject->save(pStorage);
 
+    pStorage->setSaveChangesOnly(false);
+
+    // Saving to another storage clears the change flags - the primary storage can no longer rely on them
+    if (pStorage != _primaryStorage)
+        _primaryInSync = false;
+
     pStorage->end();
 
     return status;
@@ -91,13 +102,22 @@ bool flxSettingsSave::save(flxObject *pObject, bool primary_only)
     bool status = saveObjectToStorage(pObject, _primaryStorage);
 
     if (!status)
+    {
         flxLog_E(F("Unable to save %s to %s"), pObject->name(), _primaryStorage->name());
+        _primaryInSync = false;
+    }
+    else if (pObject == &flux)
+        _primaryInSync = true;
 
-    // Save to secondary ?
+    // Save to secondary ? The values were just saved to the primary storage, so it stays in sync
     if (!primary_only && fallbackSave() && _fallbackStorage != nullptr)
     {
+        bool bInSync = _primaryInSync;
+
         if (!saveObjectToStorage(pObject, _fallbackStorage))
             flxLog_W(F("Unable to save %s to the fallback system, %s"), pObject->name(), _fallbackStorage->name());
+
+        _primaryInSync = bInSync;
     }
 
     return status;
@@ -117,6 +137,10 @@ bool flxSettingsSave::restoreObjectFromStorage(flxObject *pObject, flxStorage *p
 
     bool status = pObject->restore(pStorage);
 
+    // Values restored from another storage aren't in the primary storage
+    if (pStorage != _primaryStorage)
+        _primaryInSync = false;
+
     pStorage->end();
 
     return status;
@@ -145,6 +169,10 @@ bool flxSettingsSave::restore(flxObject *pObject)
 
     bool status = restoreObjectFromStorage(pObject, _primaryStorage);
 
+    // A full restore from primary storage leaves the system in sync with it
+    if (pObject == &flux)
+        _primaryInSync = status;
+
     char *strSource = nullptr;
     if (!status)
     {
@@ -183,6 +211,8 @@ bool flxSettingsSave::restore(flxObject *pObject)
 
 void flxSettingsSave::reset(void)
 {
+    _primaryInSync = false;
+
     if (_primaryStorage)
         _primaryStorage->resetStorage();
 
@@ -123,7 +123,7 @@ class flxSettingsSave : public flxActionType<flxSettingsSave>
     flxParameterInVoid<flxSettingsSave, &flxSettingsSave::save_fallback> saveFallback;
 
   private:
-    flxSettingsSave() : _primaryStorage{nullptr}, _fallbackStorage{nullptr}
+    flxSettingsSave() : _primaryStorage{nullptr}, _fallbackStorage{nullptr}, _primaryInSync{false}
     {
 
         // Set name and description
@@ -147,5 +147,9 @@ class flxSettingsSave : public flxActionType<flxSettingsSave>
 
     flxStorage *_primaryStorage;
     flxStorage *_fallbackStorage;
+
+    // Does the primary storage hold the current state of the system (as of the last save/restore)? If so,
+    // only objects that changed since then are saved to it.
+    bool _primaryInSync;
 };
 extern flxSettingsSave &flxSettings;
\ No newline at end of file
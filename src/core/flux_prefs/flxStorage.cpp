@@ -28,7 +28,7 @@
 //    last block, we fill them with nulls (\0), so in decrypt the result is a c string
 //    with extra nulls.
 
-bool flxStorageBlock::saveSecureString(const char *tag, const char *data)
+bool flxStorageBlock::saveSecureString(const flxStorageTag &tag, const char *data)
 {
 
     if (!data || strlen(data) == 0)
@@ -66,7 +66,7 @@ bool flxStorageBlock::saveSecureString(const char *tag, const char *data)
 
     bool status = this->writeBytes(tag, (const uint8_t *)encoded_buffer, buffer_size);
     if (!status)
-        flxLogM_E(kMsgErrSavingProperty, tag);
+        flxLogM_E(kMsgErrSavingProperty, tag.name());
 
     return status;
 }
@@ -78,7 +78,7 @@ bool flxStorageBlock::saveSecureString(const char *tag, const char *data)
 //
 // If the provided buffer isn't long enough, the value is truncated.
 
-bool flxStorageBlock::restoreSecureString(const char *tag, char *data, size_t len)
+bool flxStorageBlock::restoreSecureString(const flxStorageTag &tag, char *data, size_t len)
 {
 
     if (!data || len == 0)
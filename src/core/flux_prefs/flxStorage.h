@@ -58,6 +58,47 @@ class flxStorageOld
     virtual void resetStorage() = 0;
 };
 
+//------------------------------------------------------------------------------
+// flxStorageTag
+//
+// The tag (name) a value or block is stored under. Internal storage keys values by a hash of the
+// tag, so the tag carries the hash - computed at compile time for a string literal, or cached by
+// the descriptor (flxDescriptor::nameHash()) for a property/object name. Storage that uses the
+// name - i.e. JSON - ignores the hash.
+
+class flxStorageTag
+{
+  public:
+    constexpr flxStorageTag(const char *name) : _name{name}, _hash{flx_utils::id_hash_string_constexpr(name)}
+    {
+    }
+    constexpr flxStorageTag(const char *name, uint32_t hash) : _name{name}, _hash{hash}
+    {
+    }
+    flxStorageTag(flxDescriptor &desc) : _name{desc.name()}, _hash{desc.nameHash()}
+    {
+    }
+
+    const char *name(void) const
+    {
+        return _name;
+    }
+    uint32_t hash(void) const
+    {
+        return _hash;
+    }
+
+    // The storage key - the hash as a string
+    bool key(char *szKey, size_t len) const
+    {
+        return flx_utils::id_hash_to_string(_hash, szKey, len);
+    }
+
+  private:
+    const char *_name;
+    uint32_t _hash;
+};
+
 class flxStorageBlock;
 //------------------------------------------------------------------------------
 // flxStorage
@@ -74,19 +115,23 @@ class flxStorage : public flxDescriptor
         flxStorageKindExternal
     } flxStorageKind_t;
 
+    flxStorage() : _saveChangesOnly{false}
+    {
+    }
+
     virtual flxStorageKind_t kind(void) = 0;
 
     // Methods used to bracket the save/restore transaction
     virtual bool begin(bool readonly = false) = 0;
     virtual void end(void) = 0;
     // public methods to manage a block
-    virtual flxStorageBlock *beginBlock(const char *tag) = 0;
+    virtual flxStorageBlock *beginBlock(const flxStorageTag &tag) = 0;
 
     // NOTE: TODO - for eeprom version of this, the number of bytes written
     // should be kept in the block, then when it's close, written to the block
     // header -- note, you will need to delete all existing blocks when writing
     // new ...
-    virtual flxStorageBlock *getBlock(const char *tag) = 0;
+    virtual flxStorageBlock *getBlock(const flxStorageTag &tag) = 0;
     virtual void endBlock(flxStorageBlock *) = 0;
 
     virtual void resetStorage() = 0;
@@ -98,6 +143,20 @@ class flxStorage : public flxDescriptor
     {
         return 0;
     }
+
+    // When set, objects that haven't changed since the last save aren't written. Only valid if
+    // the storage is known to hold the last saved state of the system.
+    void setSaveChangesOnly(bool bChangesOnly)
+    {
+        _saveChangesOnly = bChangesOnly;
+    }
+    bool saveChangesOnly(void)
+    {
+        return _saveChangesOnly;
+    }
+
+  private:
+    bool _saveChangesOnly;
 };
 
 //------------------------------------------------------------------------------
@@ -108,117 +167,117 @@ class flxStorageBlock
 {
 
   public:
-    virtual bool writeBool(const char *tag, bool data) = 0;
-    virtual bool writeInt8(const char *tag, int8_t data) = 0;
-    virtual bool writeInt16(const char *tag, int16_t data) = 0;
-    virtual bool writeInt32(const char *tag, int32_t data) = 0;
-    virtual bool writeUInt8(const char *tag, uint8_t data) = 0;
-    virtual bool writeUInt16(const char *tag, uint16_t data) = 0;
-    virtual bool writeUInt32(const char *tag, uint32_t data) = 0;
-    virtual bool writeFloat(const char *tag, float data) = 0;
-    virtual bool writeDouble(const char *tag, double data) = 0;
-    virtual bool writeString(const char *tag, const char *data) = 0;
-    virtual bool writeBytes(const char *tag, const uint8_t *data, size_t len) = 0;
+    virtual bool writeBool(const flxStorageTag &tag, bool data) = 0;
+    virtual bool writeInt8(const flxStorageTag &tag, int8_t data) = 0;
+    virtual bool writeInt16(const flxStorageTag &tag, int16_t data) = 0;
+    virtual bool writeInt32(const flxStorageTag &tag, int32_t data) = 0;
+    virtual bool writeUInt8(const flxStorageTag &tag, uint8_t data) = 0;
+    virtual bool writeUInt16(const flxStorageTag &tag, uint16_t data) = 0;
+    virtual bool writeUInt32(const flxStorageTag &tag, uint32_t data) = 0;
+    virtual bool writeFloat(const flxStorageTag &tag, float data) = 0;
+    virtual bool writeDouble(const flxStorageTag &tag, double data) = 0;
+    virtual bool writeString(const flxStorageTag &tag, const char *data) = 0;
+    virtual bool writeBytes(const flxStorageTag &tag, const uint8_t *data, size_t len) = 0;
 
     virtual flxStorage::flxStorageKind_t kind(void) = 0;
     virtual void setReadOnly(bool) = 0;
 
     // Overloaded versions
-    bool write(const char *tag, bool data)
+    bool write(const flxStorageTag &tag, bool data)
     {
         return writeBool(tag, data);
     }
-    bool write(const char *tag, int8_t data)
+    bool write(const flxStorageTag &tag, int8_t data)
     {
         return writeInt8(tag, data);
     }
-    bool write(const char *tag, int16_t data)
+    bool write(const flxStorageTag &tag, int16_t data)
     {
         return writeInt16(tag, data);
     }
-    bool write(const char *tag, int32_t data)
+    bool write(const flxStorageTag &tag, int32_t data)
     {
         return writeInt32(tag, data);
     }
-    bool write(const char *tag, uint8_t data)
+    bool write(const flxStorageTag &tag, uint8_t data)
     {
         return writeUInt8(tag, data);
     }
-    bool write(const char *tag, uint16_t data)
+    bool write(const flxStorageTag &tag, uint16_t data)
     {
         return writeUInt16(tag, data);
     }
-    bool write(const char *tag, uint32_t data)
+    bool write(const flxStorageTag &tag, uint32_t data)
     {
         return writeUInt32(tag, data);
     }
-    bool write(const char *tag, float data)
+    bool write(const flxStorageTag &tag, float data)
     {
         return writeFloat(tag, data);
     }
-    bool write(const char *tag, double data)
+    bool write(const flxStorageTag &tag, double data)
     {
         return writeDouble(tag, data);
     }
-    bool write(const char *tag, const char *data)
+    bool write(const flxStorageTag &tag, const char *data)
     {
         return writeString(tag, data);
     }
 
-    virtual bool valueExists(const char *tag) = 0;
-    virtual bool readBool(const char *tag, bool &value) = 0;
-    virtual bool readInt8(const char *tag, int8_t &value) = 0;
-    virtual bool readInt16(const char *tag, int16_t &value) = 0;
-    virtual bool readInt32(const char *tag, int32_t &value) = 0;
-    virtual bool readUInt8(const char *tag, uint8_t &value) = 0;
-    virtual bool readUInt16(const char *tag, uint16_t &value) = 0;
-    virtual bool readUInt32(const char *tag, uint32_t &value) = 0;
-    virtual bool readFloat(const char *tag, float &value) = 0;
-    virtual bool readDouble(const char *tag, double &value) = 0;
-    virtual size_t getStringLength(const char *tag) = 0;
-    virtual size_t readString(const char *tag, char *data, size_t len) = 0;
-    virtual size_t readBytes(const char *tag, uint8_t *data, size_t len) = 0;
-    virtual size_t getBytesLength(const char *tag) = 0;
+    virtual bool valueExists(const flxStorageTag &tag) = 0;
+    virtual bool readBool(const flxStorageTag &tag, bool &value) = 0;
+    virtual bool readInt8(const flxStorageTag &tag, int8_t &value) = 0;
+    virtual bool readInt16(const flxStorageTag &tag, int16_t &value) = 0;
+    virtual bool readInt32(const flxStorageTag &tag, int32_t &value) = 0;
+    virtual bool readUInt8(const flxStorageTag &tag, uint8_t &value) = 0;
+    virtual bool readUInt16(const flxStorageTag &tag, uint16_t &value) = 0;
+    virtual bool readUInt32(const flxStorageTag &tag, uint32_t &value) = 0;
+    virtual bool readFloat(const flxStorageTag &tag, float &value) = 0;
+    virtual bool readDouble(const flxStorageTag &tag, double &value) = 0;
+    virtual size_t getStringLength(const flxStorageTag &tag) = 0;
+    virtual size_t readString(const flxStorageTag &tag, char *data, size_t len) = 0;
+    virtual size_t readBytes(const flxStorageTag &tag, uint8_t *data, size_t len) = 0;
+    virtual size_t getBytesLength(const flxStorageTag &tag) = 0;
 
     // overload reads
 
-    bool read(const char *tag, bool &value)
+    bool read(const flxStorageTag &tag, bool &value)
     {
         return readBool(tag, value);
     };
-    bool read(const char *tag, int8_t &value)
+    bool read(const flxStorageTag &tag, int8_t &value)
     {
         return readInt8(tag, value);
     };
-    bool read(const char *tag, int16_t &value)
+    bool read(const flxStorageTag &tag, int16_t &value)
     {
         return readInt16(tag, value);
     };
-    bool read(const char *tag, int32_t &value)
+    bool read(const flxStorageTag &tag, int32_t &value)
     {
         return readInt32(tag, value);
     };
-    bool read(const char *tag, uint8_t &value)
+    bool read(const flxStorageTag &tag, uint8_t &value)
     {
         return readUInt8(tag, value);
     };
-    bool read(const char *tag, uint16_t &value)
+    bool read(const flxStorageTag &tag, uint16_t &value)
     {
         return readUInt16(tag, value);
     };
-    bool read(const char *tag, uint32_t &value)
+    bool read(const flxStorageTag &tag, uint32_t &value)
     {
         return readUInt32(tag, value);
     };
-    bool read(const char *tag, float &value)
+    bool read(const flxStorageTag &tag, float &value)
     {
         return readFloat(tag, value);
     };
-    bool read(const char *tag, double &value)
+    bool read(const flxStorageTag &tag, double &value)
     {
         return readDouble(tag, value);
     };
 
-    bool saveSecureString(const char *tag, const char *data);
-    bool restoreSecureString(const char *tag, char *data, size_t len);
+    bool saveSecureString(const flxStorageTag &tag, const char *data);
+    bool restoreSecureString(const flxStorageTag &tag, char *data, size_t len);
 };
@@ -42,14 +42,14 @@ static bool tag_is_valid(const char *tag)
 // ESP32 preference library
 
 // Write out a bool value
-bool flxStorageKVPBlock::writeBool(const char *tag, bool value)
+bool flxStorageKVPBlock::writeBool(const flxStorageTag &tag, bool value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putBool(szHash, value) > 0);
@@ -57,14 +57,14 @@ bool flxStorageKVPBlock::writeBool(const char *tag, bool value)
 //------------------------------------------------------------------------
 // write out an int8 value
 
-bool flxStorageKVPBlock::writeInt8(const char *tag, int8_t value)
+bool flxStorageKVPBlock::writeInt8(const flxStorageTag &tag, int8_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putChar(szHash, value) > 0);
@@ -73,14 +73,14 @@ bool flxStorageKVPBlock::writeInt8(const char *tag, int8_t value)
 //------------------------------------------------------------------------
 // write out an int16 value
 
-bool flxStorageKVPBlock::writeInt16(const char *tag, int16_t value)
+bool flxStorageKVPBlock::writeInt16(const flxStorageTag &tag, int16_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putShort(szHash, value) > 0);
@@ -89,14 +89,14 @@ bool flxStorageKVPBlock::writeInt16(const char *tag, int16_t value)
 //------------------------------------------------------------------------
 // write out a int value
 
-bool flxStorageKVPBlock::writeInt32(const char *tag, int32_t value)
+bool flxStorageKVPBlock::writeInt32(const flxStorageTag &tag, int32_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putInt(szHash, value) > 0);
@@ -104,14 +104,14 @@ bool flxStorageKVPBlock::writeInt32(const char *tag, int32_t value)
 //------------------------------------------------------------------------
 // Unsigned int8  - aka uchar
 
-bool flxStorageKVPBlock::writeUInt8(const char *tag, uint8_t value)
+bool flxStorageKVPBlock::writeUInt8(const flxStorageTag &tag, uint8_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putUChar(szHash, value) > 0);
@@ -120,28 +120,28 @@ bool flxStorageKVPBlock::writeUInt8(const char *tag, uint8_t value)
 //------------------------------------------------------------------------
 // Unsigned int16  - aka ushort
 
-bool flxStorageKVPBlock::writeUInt16(const char *tag, uint16_t value)
+bool flxStorageKVPBlock::writeUInt16(const flxStorageTag &tag, uint16_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putUShort(szHash, value) > 0);
 }
 
 //------------------------------------------------------------------------
-bool flxStorageKVPBlock::writeUInt32(const char *tag, uint32_t value)
+bool flxStorageKVPBlock::writeUInt32(const flxStorageTag &tag, uint32_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putUInt(szHash, value) > 0);
@@ -149,14 +149,14 @@ bool flxStorageKVPBlock::writeUInt32(const char *tag, uint32_t value)
 //------------------------------------------------------------------------
 // write out a float
 
-bool flxStorageKVPBlock::writeFloat(const char *tag, float value)
+bool flxStorageKVPBlock::writeFloat(const flxStorageTag &tag, float value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putFloat(szHash, value) > 0);
@@ -164,23 +164,23 @@ bool flxStorageKVPBlock::writeFloat(const char *tag, float value)
 //------------------------------------------------------------------------
 // double
 
-bool flxStorageKVPBlock::writeDouble(const char *tag, double value)
+bool flxStorageKVPBlock::writeDouble(const flxStorageTag &tag, double value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putDouble(szHash, value) > 0);
 }
 //------------------------------------------------------------------------
 // Write out a c string
-bool flxStorageKVPBlock::writeString(const char *tag, const char *value)
+bool flxStorageKVPBlock::writeString(const flxStorageTag &tag, const char *value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     // the value length is 0, just return true. Otherwise the esp pref system
@@ -191,7 +191,7 @@ bool flxStorageKVPBlock::writeString(const char *tag, const char *value)
 
     char szHash[kHashTagSize] = {0};
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putString(szHash, value) > 0);
@@ -200,9 +200,9 @@ bool flxStorageKVPBlock::writeString(const char *tag, const char *value)
 //------------------------------------------------------------------------
 // Write out an array of bytes
 
-bool flxStorageKVPBlock::writeBytes(const char *tag, const uint8_t *value, size_t len)
+bool flxStorageKVPBlock::writeBytes(const flxStorageTag &tag, const uint8_t *value, size_t len)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     // the value length is 0, just return true. Otherwise the esp pref system
@@ -213,7 +213,7 @@ bool flxStorageKVPBlock::writeBytes(const char *tag, const uint8_t *value, size_
 
     char szHash[kHashTagSize] = {0};
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putBytes(szHash, (void *)value, len) > 0);
@@ -222,14 +222,14 @@ bool flxStorageKVPBlock::writeBytes(const char *tag, const uint8_t *value, size_
 // Read value section
 //------------------------------------------------------------------------
 
-bool flxStorageKVPBlock::readBool(const char *tag, bool &value)
+bool flxStorageKVPBlock::readBool(const flxStorageTag &tag, bool &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -240,14 +240,14 @@ bool flxStorageKVPBlock::readBool(const char *tag, bool &value)
     return true;
 }
 //------------------------------------------------------------------------
-bool flxStorageKVPBlock::readInt8(const char *tag, int8_t &value)
+bool flxStorageKVPBlock::readInt8(const flxStorageTag &tag, int8_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -259,14 +259,14 @@ bool flxStorageKVPBlock::readInt8(const char *tag, int8_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageKVPBlock::readInt16(const char *tag, int16_t &value)
+bool flxStorageKVPBlock::readInt16(const flxStorageTag &tag, int16_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -278,14 +278,14 @@ bool flxStorageKVPBlock::readInt16(const char *tag, int16_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageKVPBlock::readInt32(const char *tag, int32_t &value)
+bool flxStorageKVPBlock::readInt32(const flxStorageTag &tag, int32_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -297,14 +297,14 @@ bool flxStorageKVPBlock::readInt32(const char *tag, int32_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageKVPBlock::readUInt8(const char *tag, uint8_t &value)
+bool flxStorageKVPBlock::readUInt8(const flxStorageTag &tag, uint8_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -316,14 +316,14 @@ bool flxStorageKVPBlock::readUInt8(const char *tag, uint8_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageKVPBlock::readUInt16(const char *tag, uint16_t &value)
+bool flxStorageKVPBlock::readUInt16(const flxStorageTag &tag, uint16_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -335,14 +335,14 @@ bool flxStorageKVPBlock::readUInt16(const char *tag, uint16_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageKVPBlock::readUInt32(const char *tag, uint32_t &value)
+bool flxStorageKVPBlock::readUInt32(const flxStorageTag &tag, uint32_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -354,14 +354,14 @@ bool flxStorageKVPBlock::readUInt32(const char *tag, uint32_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageKVPBlock::readFloat(const char *tag, float &value)
+bool flxStorageKVPBlock::readFloat(const flxStorageTag &tag, float &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -373,14 +373,14 @@ bool flxStorageKVPBlock::readFloat(const char *tag, float &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageKVPBlock::readDouble(const char *tag, double &value)
+bool flxStorageKVPBlock::readDouble(const flxStorageTag &tag, double &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -392,14 +392,14 @@ bool flxStorageKVPBlock::readDouble(const char *tag, double &value)
 }
 
 //------------------------------------------------------------------------
-size_t flxStorageKVPBlock::readString(const char *tag, char *data, size_t len)
+size_t flxStorageKVPBlock::readString(const flxStorageTag &tag, char *data, size_t len)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return 0;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return 0;
 
     if (!_prefs->isKey(szHash))
@@ -408,14 +408,14 @@ size_t flxStorageKVPBlock::readString(const char *tag, char *data, size_t len)
     return _prefs->getString(szHash, data, len);
 }
 //------------------------------------------------------------------------------
-size_t flxStorageKVPBlock::getStringLength(const char *tag)
+size_t flxStorageKVPBlock::getStringLength(const flxStorageTag &tag)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return 0;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return 0;
 
     if (!_prefs->isKey(szHash))
@@ -426,14 +426,14 @@ size_t flxStorageKVPBlock::getStringLength(const char *tag)
     return tmp.length();
 }
 //------------------------------------------------------------------------
-size_t flxStorageKVPBlock::readBytes(const char *tag, uint8_t *data, size_t len)
+size_t flxStorageKVPBlock::readBytes(const flxStorageTag &tag, uint8_t *data, size_t len)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return 0;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return 0;
 
     if (!_prefs->isKey(szHash))
@@ -448,14 +448,14 @@ size_t flxStorageKVPBlock::readBytes(const char *tag, uint8_t *data, size_t len)
     return _prefs->getBytes(szHash, data, len);
 }
 //------------------------------------------------------------------------------
-size_t flxStorageKVPBlock::getBytesLength(const char *tag)
+size_t flxStorageKVPBlock::getBytesLength(const flxStorageTag &tag)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return 0;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return 0;
 
     if (!_prefs->isKey(szHash))
@@ -464,14 +464,14 @@ size_t flxStorageKVPBlock::getBytesLength(const char *tag)
     return _prefs->getBytesLength(szHash);
 }
 //------------------------------------------------------------------------------
-bool flxStorageKVPBlock::valueExists(const char *tag)
+bool flxStorageKVPBlock::valueExists(const flxStorageTag &tag)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kHashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return _prefs->isKey(szHash);
@@ -497,14 +497,14 @@ flxStorageKVPPref::flxStorageKVPPref() : _readOnly{false}
 }
 
 // public methods to manage a block
-flxStorageKVPBlock *flxStorageKVPPref::beginBlock(const char *tag)
+flxStorageKVPBlock *flxStorageKVPPref::beginBlock(const flxStorageTag &tag)
 {
-    if (!tag_is_valid(tag))
+    if (!tag_is_valid(tag.name()))
         return nullptr;
 
     char szHash[kHashTagSize] = {0};
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return nullptr;
 
     if (!_prefs.begin(szHash, false))
@@ -517,7 +517,7 @@ flxStorageKVPBlock *flxStorageKVPPref::beginBlock(const char *tag)
     return &_theBlock;
 }
 
-flxStorageKVPBlock *flxStorageKVPPref::getBlock(const char *tag)
+flxStorageKVPBlock *flxStorageKVPPref::getBlock(const flxStorageTag &tag)
 {
 
     return beginBlock(tag);
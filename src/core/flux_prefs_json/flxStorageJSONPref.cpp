@@ -23,11 +23,11 @@
 //  JSON preference library
 
 // Write out a bool value
-bool flxStorageJSONBlock::writeBool(const char *tag, bool value)
+bool flxStorageJSONBlock::writeBool(const flxStorageTag &tag, bool value)
 {
     if (!_jSection.isNull() && !_readOnly)
     {
-        (_jSection)[tag] = value;
+        (_jSection)[tag.name()] = value;
         return true;
     }
     return false;
@@ -35,11 +35,11 @@ bool flxStorageJSONBlock::writeBool(const char *tag, bool value)
 //------------------------------------------------------------------------
 // write out an int8 value
 
-bool flxStorageJSONBlock::writeInt8(const char *tag, int8_t value)
+bool flxStorageJSONBlock::writeInt8(const flxStorageTag &tag, int8_t value)
 {
     if (!_jSection.isNull() && !_readOnly)
     {
-        (_jSection)[tag] = value;
+        (_jSection)[tag.name()] = value;
         return true;
     }
     return false;
@@ -48,11 +48,11 @@ bool flxStorageJSONBlock::writeInt8(const char *tag, int8_t value)
 //------------------------------------------------------------------------
 // write out an int16 value
 
-bool flxStorageJSONBlock::writeInt16(const char *tag, int16_t value)
+bool flxStorageJSONBlock::writeInt16(const flxStorageTag &tag, int16_t value)
 {
     if (!_jSection.isNull() && !_readOnly)
     {
-        (_jSection)[tag] = value;
+        (_jSection)[tag.name()] = value;
         return true;
     }
     return false;
@@ -61,11 +61,11 @@ bool flxStorageJSONBlock::writeInt16(const char *tag, int16_t value)
 //------------------------------------------------------------------------
 // write out a int value
 
-bool flxStorageJSONBlock::writeInt32(const char *tag, int32_t value)
+bool flxStorageJSONBlock::writeInt32(const flxStorageTag &tag, int32_t value)
 {
     if (!_jSection.isNull() && !_readOnly)
     {
-        (_jSection)[tag] = value;
+        (_jSection)[tag.name()] = value;
         return true;
     }
     return false;
@@ -73,11 +73,11 @@ bool flxStorageJSONBlock::writeInt32(const char *tag, int32_t value)
 //------------------------------------------------------------------------
 // Unsigned int8  - aka uchar
 
-bool flxStorageJSONBlock::writeUInt8(const char *tag, uint8_t value)
+bool flxStorageJSONBlock::writeUInt8(const flxStorageTag &tag, uint8_t value)
 {
     if (!_jSection.isNull() && !_readOnly)
     {
-        (_jSection)[tag] = value;
+        (_jSection)[tag.name()] = value;
         return true;
     }
     return false;
@@ -86,22 +86,22 @@ bool flxStorageJSONBlock::writeUInt8(const char *tag, uint8_t value)
 //------------------------------------------------------------------------
 // Unsigned int16  - aka ushort
 
-bool flxStorageJSONBlock::writeUInt16(const char *tag, uint16_t value)
+bool flxStorageJSONBlock::writeUInt16(const flxStorageTag &tag, uint16_t value)
 {
     if (!_jSection.isNull() && !_readOnly)
     {
-        (_jSection)[tag] = value;
+        (_jSection)[tag.name()] = value;
         return true;
     }
     return false;
 }
 
 //------------------------------------------------------------------------
-bool flxStorageJSONBlock::writeUInt32(const char *tag, uint32_t value)
+bool flxStorageJSONBlock::writeUInt32(const flxStorageTag &tag, uint32_t value)
 {
     if (!_jSection.isNull() && !_readOnly)
     {
-        (_jSection)[tag] = value;
+        (_jSection)[tag.name()] = value;
         return true;
     }
     return false;
@@ -109,11 +109,11 @@ bool flxStorageJSONBlock::writeUInt32(const char *tag, uint32_t value)
 //------------------------------------------------------------------------
 // write out a float
 
-bool flxStorageJSONBlock::writeFloat(const char *tag, float value)
+bool flxStorageJSONBlock::writeFloat(const flxStorageTag &tag, float value)
 {
     if (!_jSection.isNull() && !_readOnly)
     {
-        (_jSection)[tag] = value;
+        (_jSection)[tag.name()] = value;
         return true;
     }
     return false;
@@ -121,25 +121,25 @@ bool flxStorageJSONBlock::writeFloat(const char *tag, float value)
 //------------------------------------------------------------------------
 // double
 
-bool flxStorageJSONBlock::writeDouble(const char *tag, double value)
+bool flxStorageJSONBlock::writeDouble(const flxStorageTag &tag, double value)
 {
     if (!_jSection.isNull() && !_readOnly)
     {
-        (_jSection)[tag] = value;
+        (_jSection)[tag.name()] = value;
         return true;
     }
     return false;
 }
 //------------------------------------------------------------------------
 // Write out a c string
-bool flxStorageJSONBlock::writeString(const char *tag, const char *value)
+bool flxStorageJSONBlock::writeString(const flxStorageTag &tag, const char *value)
 {
 
     if (!_jSection.isNull() && !_readOnly)
     {
         // note - using std::string() to copy the input string. The Json library
         // assumes the pass in string is const/static - it is not
-        (_jSection)[tag] = std::string(value);
+        (_jSection)[tag.name()] = std::string(value);
         return true;
     }
     return false;
@@ -147,14 +147,14 @@ bool flxStorageJSONBlock::writeString(const char *tag, const char *value)
 
 //------------------------------------------------------------------------
 // Write out a byte array
-bool flxStorageJSONBlock::writeBytes(const char *tag, const uint8_t *value, size_t len)
+bool flxStorageJSONBlock::writeBytes(const flxStorageTag &tag, const uint8_t *value, size_t len)
 {
 
     if (!_jSection.isNull() && !_readOnly)
     {
         JsonArray jArr;
 
-        jArr = _jSection.createNestedArray(tag);
+        jArr = _jSection.createNestedArray(tag.name());
 
         for (int i = 0; i < len; i++)
             jArr.add(value[i]);
@@ -168,33 +168,33 @@ bool flxStorageJSONBlock::writeBytes(const char *tag, const uint8_t *value, size
 // Read value section
 //------------------------------------------------------------------------
 
-bool flxStorageJSONBlock::readBool(const char *tag, bool &value)
+bool flxStorageJSONBlock::readBool(const flxStorageTag &tag, bool &value)
 {
-    if (!_jSection.isNull() && _jSection.containsKey(tag))
+    if (!_jSection.isNull() && _jSection.containsKey(tag.name()))
     {
-        value = (_jSection)[tag];
+        value = (_jSection)[tag.name()];
         return true;
     }
 
     return false;
 }
 //------------------------------------------------------------------------
-bool flxStorageJSONBlock::readInt8(const char *tag, int8_t &value)
+bool flxStorageJSONBlock::readInt8(const flxStorageTag &tag, int8_t &value)
 {
-    if (!_jSection.isNull() && _jSection.containsKey(tag))
+    if (!_jSection.isNull() && _jSection.containsKey(tag.name()))
     {
-        value = (_jSection)[tag];
+        value = (_jSection)[tag.name()];
         return true;
     }
     return false;
 }
 
 //------------------------------------------------------------------------
-bool flxStorageJSONBlock::readInt16(const char *tag, int16_t &value)
+bool flxStorageJSONBlock::readInt16(const flxStorageTag &tag, int16_t &value)
 {
-    if (!_jSection.isNull() && _jSection.containsKey(tag))
+    if (!_jSection.isNull() && _jSection.containsKey(tag.name()))
     {
-        value = (_jSection)[tag];
+        value = (_jSection)[tag.name()];
         return true;
     }
 
@@ -202,11 +202,11 @@ bool flxStorageJSONBlock::readInt16(const char *tag, int16_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageJSONBlock::readInt32(const char *tag, int32_t &value)
+bool flxStorageJSONBlock::readInt32(const flxStorageTag &tag, int32_t &value)
 {
-    if (!_jSection.isNull() && _jSection.containsKey(tag))
+    if (!_jSection.isNull() && _jSection.containsKey(tag.name()))
     {
-        value = (_jSection)[tag];
+        value = (_jSection)[tag.name()];
         return true;
     }
 
@@ -214,11 +214,11 @@ bool flxStorageJSONBlock::readInt32(const char *tag, int32_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageJSONBlock::readUInt8(const char *tag, uint8_t &value)
+bool flxStorageJSONBlock::readUInt8(const flxStorageTag &tag, uint8_t &value)
 {
-    if (!_jSection.isNull() && _jSection.containsKey(tag))
+    if (!_jSection.isNull() && _jSection.containsKey(tag.name()))
     {
-        value = (_jSection)[tag];
+        value = (_jSection)[tag.name()];
         return true;
     }
 
@@ -226,11 +226,11 @@ bool flxStorageJSONBlock::readUInt8(const char *tag, uint8_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageJSONBlock::readUInt16(const char *tag, uint16_t &value)
+bool flxStorageJSONBlock::readUInt16(const flxStorageTag &tag, uint16_t &value)
 {
-    if (!_jSection.isNull() && _jSection.containsKey(tag))
+    if (!_jSection.isNull() && _jSection.containsKey(tag.name()))
     {
-        value = (_jSection)[tag];
+        value = (_jSection)[tag.name()];
         return true;
     }
 
@@ -238,11 +238,11 @@ bool flxStorageJSONBlock::readUInt16(const char *tag, uint16_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageJSONBlock::readUInt32(const char *tag, uint32_t &value)
+bool flxStorageJSONBlock::readUInt32(const flxStorageTag &tag, uint32_t &value)
 {
-    if (!_jSection.isNull() && _jSection.containsKey(tag))
+    if (!_jSection.isNull() && _jSection.containsKey(tag.name()))
     {
-        value = (_jSection)[tag];
+        value = (_jSection)[tag.name()];
         return true;
     }
 
@@ -250,11 +250,11 @@ bool flxStorageJSONBlock::readUInt32(const char *tag, uint32_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageJSONBlock::readFloat(const char *tag, float &value)
+bool flxStorageJSONBlock::readFloat(const flxStorageTag &tag, float &value)
 {
-    if (!_jSection.isNull() && _jSection.containsKey(tag))
+    if (!_jSection.isNull() && _jSection.containsKey(tag.name()))
     {
-        value = (_jSection)[tag];
+        value = (_jSection)[tag.name()];
         return true;
     }
 
@@ -262,11 +262,11 @@ bool flxStorageJSONBlock::readFloat(const char *tag, float &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageJSONBlock::readDouble(const char *tag, double &value)
+bool flxStorageJSONBlock::readDouble(const flxStorageTag &tag, double &value)
 {
-    if (!_jSection.isNull() && _jSection.containsKey(tag))
+    if (!_jSection.isNull() && _jSection.containsKey(tag.name()))
     {
-        value = (_jSection)[tag];
+        value = (_jSection)[tag.name()];
         return true;
     }
 
@@ -274,35 +274,35 @@ bool flxStorageJSONBlock::readDouble(const char *tag, double &value)
 }
 
 //------------------------------------------------------------------------
-size_t flxStorageJSONBlock::readString(const char *tag, char *data, size_t len)
+size_t flxStorageJSONBlock::readString(const flxStorageTag &tag, char *data, size_t len)
 {
 
-    if (_jSection.isNull() || !_jSection.containsKey(tag))
+    if (_jSection.isNull() || !_jSection.containsKey(tag.name()))
         return 0;
 
-    std::string value = (_jSection)[tag];
+    std::string value = (_jSection)[tag.name()];
 
     return strlcpy(data, value.c_str(), len);
 }
 //------------------------------------------------------------------------------
-size_t flxStorageJSONBlock::getStringLength(const char *tag)
+size_t flxStorageJSONBlock::getStringLength(const flxStorageTag &tag)
 {
 
-    if (_jSection.isNull() || !_jSection.containsKey(tag))
+    if (_jSection.isNull() || !_jSection.containsKey(tag.name()))
         return 0;
 
-    std::string value = (_jSection)[tag];
+    std::string value = (_jSection)[tag.name()];
 
     return value.size();
 }
 //------------------------------------------------------------------------
-size_t flxStorageJSONBlock::readBytes(const char *tag, uint8_t *data, size_t len)
+size_t flxStorageJSONBlock::readBytes(const flxStorageTag &tag, uint8_t *data, size_t len)
 {
 
-    if (_jSection.isNull() || !_jSection.containsKey(tag) || len < 1)
+    if (_jSection.isNull() || !_jSection.containsKey(tag.name()) || len < 1)
         return 0;
 
-    JsonArray jArr = (_jSection)[tag];
+    JsonArray jArr = (_jSection)[tag.name()];
 
     int i = 0;
     for (JsonVariant v : jArr)
@@ -317,21 +317,21 @@ size_t flxStorageJSONBlock::readBytes(const char *tag, uint8_t *data, size_t len
     return i;
 }
 //------------------------------------------------------------------------------
-size_t flxStorageJSONBlock::getBytesLength(const char *tag)
+size_t flxStorageJSONBlock::getBytesLength(const flxStorageTag &tag)
 {
 
-    if (_jSection.isNull() || !_jSection.containsKey(tag))
+    if (_jSection.isNull() || !_jSection.containsKey(tag.name()))
         return 0;
 
-    JsonArray jArr = (_jSection)[tag];
+    JsonArray jArr = (_jSection)[tag.name()];
 
     return jArr.size();
 }
 //------------------------------------------------------------------------------
-bool flxStorageJSONBlock::valueExists(const char *tag)
+bool flxStorageJSONBlock::valueExists(const flxStorageTag &tag)
 {
     if (!_jSection.isNull())
-        return _jSection.containsKey(tag);
+        return _jSection.containsKey(tag.name());
     else
         return false;
 }
@@ -373,19 +373,19 @@ void flxStorageJSONPref::end(void)
 }
 
 // public methods to manage a block
-flxStorageJSONBlock *flxStorageJSONPref::beginBlock(const char *tag)
+flxStorageJSONBlock *flxStorageJSONPref::beginBlock(const flxStorageTag &tag)
 {
 
-    if (!tag)
+    if (!tag.name())
         return nullptr;
 
     JsonObject jObj;
 
     // Does the object already exists?
-    jObj = (*_pDocument)[tag];
+    jObj = (*_pDocument)[tag.name()];
     if (jObj.isNull())
     {
-        jObj = _pDocument->createNestedObject(tag);
+        jObj = _pDocument->createNestedObject(tag.name());
 
         if (jObj.isNull())
         {
@@ -401,7 +401,7 @@ flxStorageJSONBlock *flxStorageJSONPref::beginBlock(const char *tag)
     return &_theBlock;
 }
 
-flxStorageJSONBlock *flxStorageJSONPref::getBlock(const char *tag)
+flxStorageJSONBlock *flxStorageJSONPref::getBlock(const flxStorageTag &tag)
 {
 
     // TODO - find object in JSON doc, set in block and return that
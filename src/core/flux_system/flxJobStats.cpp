@@ -0,0 +1,101 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+#include "flxJobStats.h"
+
+#include <algorithm>
+
+//-----------------------------------------------------------------------------------
+// Build our list of jobs - ordered by job address, so the entries of each output
+// array line up across the parameters of an observation.
+//
+void flxJobStats::updateJobs(void)
+{
+    _jobs.clear();
+
+    for (uint32_t i = 0; i < flxJobQueue.size(); i++)
+        _jobs.push_back(flxJobQueue.at(i));
+
+    std::sort(_jobs.begin(), _jobs.end());
+}
+
+//-----------------------------------------------------------------------------------
+// Fill an output array with a value from each job
+//
+// Note - the output data points to our buffer (no copy) - it's valid until the next read.
+//
+bool flxJobStats::readStat(flxDataArrayUInt32 *data, uint32_t (*getValue)(flxJob *))
+{
+    updateJobs();
+
+    if (_jobs.size() == 0)
+        return false;
+
+    _values.resize(_jobs.size());
+
+    for (int i = 0; i < _jobs.size(); i++)
+        _values[i] = getValue(_jobs[i]);
+
+    data->set(_values.data(), _values.size(), true);
+
+    return true;
+}
+//-----------------------------------------------------------------------------------
+bool flxJobStats::read_names(flxDataArrayString *data)
+{
+    updateJobs();
+
+    if (_jobs.size() == 0)
+        return false;
+
+    _names.resize(_jobs.size());
+
+    for (int i = 0; i < _jobs.size(); i++)
+        _names[i] = (char *)(_jobs[i]->name() ? _jobs[i]->name() : "");
+
+    data->set(_names.data(), _names.size(), true);
+
+    return true;
+}
+//-----------------------------------------------------------------------------------
+bool flxJobStats::read_calls(flxDataArrayUInt32 *data)
+{
+    return readStat(data, [](flxJob *theJob) { return theJob->stats().calls; });
+}
+//-----------------------------------------------------------------------------------
+bool flxJobStats::read_avg_time(flxDataArrayUInt32 *data)
+{
+    return readStat(data, [](flxJob *theJob) { return theJob->usAverage(); });
+}
+//-----------------------------------------------------------------------------------
+bool flxJobStats::read_max_time(flxDataArrayUInt32 *data)
+{
+    return readStat(data, [](flxJob *theJob) { return theJob->stats().usMax; });
+}
+//-----------------------------------------------------------------------------------
+bool flxJobStats::read_avg_late(flxDataArrayUInt32 *data)
+{
+    return readStat(data, [](flxJob *theJob) { return theJob->msLateAverage(); });
+}
+//-----------------------------------------------------------------------------------
+bool flxJobStats::read_max_late(flxDataArrayUInt32 *data)
+{
+    return readStat(data, [](flxJob *theJob) { return theJob->stats().msLateMax; });
+}
+//-----------------------------------------------------------------------------------
+bool flxJobStats::read_skipped(flxDataArrayUInt32 *data)
+{
+    return readStat(data, [](flxJob *theJob) { return theJob->stats().skipped; });
+}
+//-----------------------------------------------------------------------------------
+void flxJobStats::reset_stats(void)
+{
+    flxJobQueue.resetStats();
+}
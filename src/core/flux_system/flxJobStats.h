@@ -0,0 +1,81 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+// Action that exposes the execution statistics of the job queue as output parameters.
+//
+// Add this action to the logger to log the per job stats - each parameter is an array,
+// with one entry per job in the job queue.
+
+#pragma once
+
+#include "flxCore.h"
+#include "flxCoreJobs.h"
+#include "flxFlux.h"
+
+#include <vector>
+
+class flxJobStats : public flxActionType<flxJobStats>
+{
+
+  public:
+    flxJobStats()
+    {
+        // Set name and description
+        setName("Job Statistics", "Execution statistics of the system job queue");
+
+        flxRegister(jobNames, "Job Name", "The name of each job");
+        flxRegister(jobCalls, "Calls", "Number of times each job was called");
+        flxRegister(jobAvgTime, "Average Time (us)", "Average execution time of each job");
+        flxRegister(jobMaxTime, "Max Time (us)", "Max execution time of each job");
+        flxRegister(jobAvgLate, "Average Lateness (ms)", "Average dispatch delay of each job");
+        flxRegister(jobMaxLate, "Max Lateness (ms)", "Max dispatch delay of each job");
+        flxRegister(jobSkipped, "Skipped Periods", "Number of periods skipped by each job");
+
+        flxRegister(resetStats, "Reset Statistics", "Reset the job statistics");
+        resetStats.prompt = false;
+
+        flux_add(this);
+    }
+
+  private:
+    bool read_names(flxDataArrayString *);
+    bool read_calls(flxDataArrayUInt32 *);
+    bool read_avg_time(flxDataArrayUInt32 *);
+    bool read_max_time(flxDataArrayUInt32 *);
+    bool read_avg_late(flxDataArrayUInt32 *);
+    bool read_max_late(flxDataArrayUInt32 *);
+    bool read_skipped(flxDataArrayUInt32 *);
+
+    void reset_stats(void);
+
+    // helpers
+    void updateJobs(void);
+    bool readStat(flxDataArrayUInt32 *, uint32_t (*)(flxJob *));
+
+    // The jobs, in a stable order - the job queue order changes as jobs are dispatched
+    std::vector<flxJob *> _jobs;
+
+    // buffers for the output arrays
+    std::vector<char *> _names;
+    std::vector<uint32_t> _values;
+
+  public:
+    // Our output parameters
+    flxParameterOutArrayString<flxJobStats, &flxJobStats::read_names> jobNames;
+    flxParameterOutArrayUInt32<flxJobStats, &flxJobStats::read_calls> jobCalls;
+    flxParameterOutArrayUInt32<flxJobStats, &flxJobStats::read_avg_time> jobAvgTime;
+    flxParameterOutArrayUInt32<flxJobStats, &flxJobStats::read_max_time> jobMaxTime;
+    flxParameterOutArrayUInt32<flxJobStats, &flxJobStats::read_avg_late> jobAvgLate;
+    flxParameterOutArrayUInt32<flxJobStats, &flxJobStats::read_max_late> jobMaxLate;
+    flxParameterOutArrayUInt32<flxJobStats, &flxJobStats::read_skipped> jobSkipped;
+
+    // Our input parameters/functions
+    flxParameterInVoid<flxJobStats, &flxJobStats::reset_stats> resetStats;
+};
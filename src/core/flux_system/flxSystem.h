@@ -17,9 +17,7 @@
 #include "flxPlatform.h"
 #include "flxSettingsSerial.h"
 
-// Define the firmware load event
-flxDefineEventID(kOnSystemRestart);
-flxDefineEventID(kOnSystemReset);
+// Note: the restart and reset events (kOnSystemRestart, kOnSystemReset) are defined in flxCoreEventID.h
 
 class flxSystem : public flxActionType<flxSystem>
 {
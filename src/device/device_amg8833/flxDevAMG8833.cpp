@@ -124,14 +124,15 @@ float flxDevAMG8833::read_device_temperature_C()
 
 bool flxDevAMG8833::read_pixel_temperatures(flxDataArrayFloat *temps)
 {
-    static float theTemps[64] = {-99.0};
+    // fill the array buffer in place - it's reused from one read to the next
+    float *theTemps = temps->buffer(8, 8);
+    if (!theTemps)
+        return false;
 
     int i = 0;
     for (int y = 0; y < 8; y++)
         for (int x = 0; x < 64; x += 8)
             theTemps[i++] = GridEYE::getPixelTemperature(x + y);
 
-    temps->set(theTemps, 8, 8, true); // don't copy
-
     return true;
 }
@@ -231,7 +231,7 @@ void flxDevAS7265X::set_ir_current(uint8_t value)
 /// @brief Called right before data parameters are read - take measurements called
 ///
 
-bool flxDevAS7265X::execute(void)
+bool flxDevAS7265X::onAcquire(void)
 {
     if (readWithLED())
         AS7265X::takeMeasurementsWithBulb();
@@ -53,7 +53,8 @@ class flxDevAS7265X : public flxDeviceI2CType<flxDevAS7265X>, public AS7265X
 
     bool onInitialize(TwoWire &);
 
-    bool execute(void);
+  protected:
+    bool onAcquire(void);
 
   private:
     // property methods
@@ -47,6 +47,7 @@ flxRegisterDevice(flxDevGNSS);
 
 flxDevGNSS::flxDevGNSS()
 {
+    memset(&_sample, 0, sizeof(_sample));
 
     // Setup unique identifiers for this device and basic device object systems
     setName(getDeviceName());
@@ -196,95 +197,149 @@ bool flxDevGNSS::onInitialize(TwoWire &wirePort)
     return result;
 }
 
+//----------------------------------------------------------------------------------------------------------
+// onAcquire()
+//
+// Read the PVT sample. The update job processes the periodic (auto) PVT messages from the receiver - one
+// check for new data, then the values are copied from the last navigation solution. This replaces a
+// library getter call - and a possible bus transaction - per output parameter.
+//
+bool flxDevGNSS::onAcquire(void)
+{
+    SFE_UBLOX_GNSS::getPVT();
+
+    if (!SFE_UBLOX_GNSS::packetUBXNAVPVT)
+        return false;
+
+    UBX_NAV_PVT_data_t &pvt = SFE_UBLOX_GNSS::packetUBXNAVPVT->data;
+
+    _sample.year = pvt.year;
+    _sample.month = pvt.month;
+    _sample.day = pvt.day;
+    _sample.hour = pvt.hour;
+    _sample.min = pvt.min;
+    _sample.sec = pvt.sec;
+    _sample.latitude = ((double)pvt.lat) / 10000000;
+    _sample.longitude = ((double)pvt.lon) / 10000000;
+    _sample.altitude = ((double)pvt.height) / 1000;
+    _sample.altitudeMSL = ((double)pvt.hMSL) / 1000;
+    _sample.siv = pvt.numSV;
+    _sample.fix = pvt.fixType;
+    _sample.carrierSoln = pvt.flags.bits.carrSoln;
+    _sample.groundSpeed = ((float)pvt.gSpeed) / 1000;
+    _sample.heading = ((float)pvt.headMot) / 100000;
+    _sample.pdop = ((float)pvt.pDOP) / 100;
+    _sample.horizAcc = ((float)pvt.hAcc) / 1000;
+    _sample.vertAcc = ((float)pvt.vAcc) / 1000;
+    _sample.tow = pvt.iTOW;
+
+    return true;
+}
+
 // GETTER methods for output params
 uint32_t flxDevGNSS::read_year()
 {
-    return SFE_UBLOX_GNSS::getYear();
+    sampleReady();
+    return _sample.year;
 }
 uint32_t flxDevGNSS::read_month()
 {
-    return SFE_UBLOX_GNSS::getMonth();
+    sampleReady();
+    return _sample.month;
 }
 uint32_t flxDevGNSS::read_day()
 {
-    return SFE_UBLOX_GNSS::getDay();
+    sampleReady();
+    return _sample.day;
 }
 uint32_t flxDevGNSS::read_hour()
 {
-    return SFE_UBLOX_GNSS::getHour();
+    sampleReady();
+    return _sample.hour;
 }
 uint32_t flxDevGNSS::read_min()
 {
-    return SFE_UBLOX_GNSS::getMinute();
+    sampleReady();
+    return _sample.min;
 }
 uint32_t flxDevGNSS::read_sec()
 {
-    return SFE_UBLOX_GNSS::getSecond();
+    sampleReady();
+    return _sample.sec;
 }
 double flxDevGNSS::read_latitude()
 {
-    return (((double)SFE_UBLOX_GNSS::getLatitude()) / 10000000);
+    sampleReady();
+    return _sample.latitude;
 }
 double flxDevGNSS::read_longitude()
 {
-    return (((double)SFE_UBLOX_GNSS::getLongitude()) / 10000000);
+    sampleReady();
+    return _sample.longitude;
 }
 double flxDevGNSS::read_altitude()
 {
-    return (((double)SFE_UBLOX_GNSS::getAltitude()) / 1000);
+    sampleReady();
+    return _sample.altitude;
 }
 double flxDevGNSS::read_altitude_msl()
 {
-    return (((double)SFE_UBLOX_GNSS::getAltitudeMSL()) / 1000);
+    sampleReady();
+    return _sample.altitudeMSL;
 }
 uint32_t flxDevGNSS::read_siv()
 {
-    return SFE_UBLOX_GNSS::getSIV();
+    sampleReady();
+    return _sample.siv;
 }
 uint32_t flxDevGNSS::read_fix()
 {
-    return SFE_UBLOX_GNSS::getFixType();
+    sampleReady();
+    return _sample.fix;
 }
 uint32_t flxDevGNSS::read_carrier_soln()
 {
-    return SFE_UBLOX_GNSS::getCarrierSolutionType();
+    sampleReady();
+    return _sample.carrierSoln;
 }
 float flxDevGNSS::read_ground_speed()
 {
-    return (((float)SFE_UBLOX_GNSS::getGroundSpeed()) / 1000);
+    sampleReady();
+    return _sample.groundSpeed;
 }
 float flxDevGNSS::read_heading()
 {
-    return (((float)SFE_UBLOX_GNSS::getHeading()) / 100000);
+    sampleReady();
+    return _sample.heading;
 }
 float flxDevGNSS::read_horiz_acc()
 {
-    return (((float)SFE_UBLOX_GNSS::getHorizontalAccEst()) / 1000);
+    sampleReady();
+    return _sample.horizAcc;
 }
 float flxDevGNSS::read_vert_acc()
 {
-    return (((float)SFE_UBLOX_GNSS::getVerticalAccEst()) / 1000);
+    sampleReady();
+    return _sample.vertAcc;
 }
 float flxDevGNSS::read_pdop()
 {
-    return (((float)SFE_UBLOX_GNSS::getPDOP()) / 100);
+    sampleReady();
+    return _sample.pdop;
 }
 uint32_t flxDevGNSS::read_tow()
 {
-    return SFE_UBLOX_GNSS::getTimeOfWeek();
+    sampleReady();
+    return _sample.tow;
 }
 
 std::string flxDevGNSS::read_iso8601()
 {
-    uint y = SFE_UBLOX_GNSS::getYear();
-    uint M = SFE_UBLOX_GNSS::getMonth();
-    uint d = SFE_UBLOX_GNSS::getDay();
-    uint h = SFE_UBLOX_GNSS::getHour();
-    uint m = SFE_UBLOX_GNSS::getMinute();
-    uint s = SFE_UBLOX_GNSS::getSecond();
+    sampleReady();
 
     char szBuffer[32] = {'\0'};
-    snprintf(szBuffer, sizeof(szBuffer), "%04d-%02d-%02dT%02d:%02d:%02dZ", y, M, d, h, m, s);
+    snprintf(szBuffer, sizeof(szBuffer), "%04u-%02u-%02uT%02u:%02u:%02uZ", (uint)_sample.year, (uint)_sample.month,
+             (uint)_sample.day, (uint)_sample.hour, (uint)_sample.min, (uint)_sample.sec);
 
     std::string theString = szBuffer;
 
@@ -293,12 +348,10 @@ std::string flxDevGNSS::read_iso8601()
 
 std::string flxDevGNSS::read_yyyy_mm_dd()
 {
-    uint y = SFE_UBLOX_GNSS::getYear();
-    uint M = SFE_UBLOX_GNSS::getMonth();
-    uint d = SFE_UBLOX_GNSS::getDay();
+    sampleReady();
 
     char szBuffer[24] = {'\0'};
-    snprintf(szBuffer, sizeof(szBuffer), "%04d/%02d/%02d", y, M, d);
+    snprintf(szBuffer, sizeof(szBuffer), "%04u/%02u/%02u", (uint)_sample.year, (uint)_sample.month, (uint)_sample.day);
 
     std::string theString = szBuffer;
 
@@ -307,12 +360,10 @@ std::string flxDevGNSS::read_yyyy_mm_dd()
 
 std::string flxDevGNSS::read_yyyy_dd_mm()
 {
-    uint y = SFE_UBLOX_GNSS::getYear();
-    uint M = SFE_UBLOX_GNSS::getMonth();
-    uint d = SFE_UBLOX_GNSS::getDay();
+    sampleReady();
 
     char szBuffer[24] = {'\0'};
-    snprintf(szBuffer, sizeof(szBuffer), "%04d/%02d/%02d", y, d, M);
+    snprintf(szBuffer, sizeof(szBuffer), "%04u/%02u/%02u", (uint)_sample.year, (uint)_sample.day, (uint)_sample.month);
 
     std::string theString = szBuffer;
 
@@ -321,12 +372,10 @@ std::string flxDevGNSS::read_yyyy_dd_mm()
 
 std::string flxDevGNSS::read_dd_mm_yyyy()
 {
-    uint y = SFE_UBLOX_GNSS::getYear();
-    uint M = SFE_UBLOX_GNSS::getMonth();
-    uint d = SFE_UBLOX_GNSS::getDay();
+    sampleReady();
 
     char szBuffer[24] = {'\0'};
-    snprintf(szBuffer, sizeof(szBuffer), "%02d/%02d/%04d", d, M, y);
+    snprintf(szBuffer, sizeof(szBuffer), "%02u/%02u/%04u", (uint)_sample.day, (uint)_sample.month, (uint)_sample.year);
 
     std::string theString = szBuffer;
 
@@ -335,12 +384,10 @@ std::string flxDevGNSS::read_dd_mm_yyyy()
 
 std::string flxDevGNSS::read_hh_mm_ss()
 {
-    uint h = SFE_UBLOX_GNSS::getHour();
-    uint m = SFE_UBLOX_GNSS::getMinute();
-    uint s = SFE_UBLOX_GNSS::getSecond();
+    sampleReady();
 
     char szBuffer[24] = {'\0'};
-    snprintf(szBuffer, sizeof(szBuffer), "%02d:%02d:%02d", h, m, s);
+    snprintf(szBuffer, sizeof(szBuffer), "%02u:%02u:%02u", (uint)_sample.hour, (uint)_sample.min, (uint)_sample.sec);
 
     std::string theString = szBuffer;
 
@@ -349,7 +396,8 @@ std::string flxDevGNSS::read_hh_mm_ss()
 
 std::string flxDevGNSS::read_fix_string()
 {
-    uint fix = SFE_UBLOX_GNSS::getFixType();
+    sampleReady();
+    uint fix = _sample.fix;
 
     const char *types[] = {"none", "dead_reckoning", "2D", "3D", "GNSS_+_dead_reckoning", "time_only", "unknown"};
 
@@ -363,7 +411,8 @@ std::string flxDevGNSS::read_fix_string()
 
 std::string flxDevGNSS::read_carrier_soln_string()
 {
-    uint carrSoln = SFE_UBLOX_GNSS::getCarrierSolutionType();
+    sampleReady();
+    uint carrSoln = _sample.carrierSoln;
 
     const char *types[] = {"none", "floating", "fixed", "unknown"};
 
@@ -61,6 +61,9 @@ class flxDevGNSS : public flxDeviceI2CType<flxDevGNSS>, public flxIClock, public
     // Method called to initialize the class
     bool onInitialize(TwoWire &);
 
+  protected:
+    bool onAcquire(void);
+
   private:
     // methods used to get values for our output parameters
     uint32_t read_year();
@@ -100,6 +103,30 @@ class flxDevGNSS : public flxDeviceI2CType<flxDevGNSS>, public flxIClock, public
     void jobHandlerCB(void);
     flxJob _theJob;
 
+    // The PVT sample - the output parameters of an observation are from the same navigation solution
+    struct
+    {
+        uint32_t year;
+        uint32_t month;
+        uint32_t day;
+        uint32_t hour;
+        uint32_t min;
+        uint32_t sec;
+        double latitude;
+        double longitude;
+        double altitude;
+        double altitudeMSL;
+        uint32_t siv;
+        uint32_t fix;
+        uint32_t carrierSoln;
+        float groundSpeed;
+        float heading;
+        float pdop;
+        float horizAcc;
+        float vertAcc;
+        uint32_t tow;
+    } _sample;
+
   public:
     // Define our read-write properties
     flxPropertyRWUInt32<flxDevGNSS, &flxDevGNSS::get_measurement_rate, &flxDevGNSS::set_measurement_rate>
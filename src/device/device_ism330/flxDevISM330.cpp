@@ -113,83 +113,134 @@ bool flxDevISM330Base::onInitialize(void)
     return result;
 }
 
-// GETTER methods for output params
-float flxDevISM330Base::read_accel_x()
+//----------------------------------------------------------------------------------------------------------
+// Read the accel and gyro sample - the axis values of an observation come from one burst read.
+//
+// The gyro (OUTX_L_G) and accel (OUTX_L_A) output registers are contiguous - 12 bytes, each axis a little
+// endian int16. Only the sensors with enabled output parameters are read. If the read fails, the sample is
+// zeroed - an observation doesn't repeat the values of the last one.
+
+#define kISM330AxisBytes 6
+
+bool flxDevISM330Base::onAcquire(void)
 {
-    if (!_accelX)
+    bool bGyro = gyroX.enabled() || gyroY.enabled() || gyroZ.enabled();
+    bool bAccel = accelX.enabled() || accelY.enabled() || accelZ.enabled();
+
+    if (!bGyro && !bAccel)
+        return true;
+
+    uint8_t buffer[kISM330AxisBytes * 2];
+    uint8_t *pAccel = bGyro ? buffer + kISM330AxisBytes : buffer;
+
+    if (readRegisterRegion(bGyro ? ISM330DHCX_OUTX_L_G : ISM330DHCX_OUTX_L_A, buffer,
+                           (bGyro && bAccel) ? sizeof(buffer) : kISM330AxisBytes) != 0)
     {
-        if (getAccel(&_accelData))
-        {
-            _accelY = true;
-            _accelZ = true;
-        }
+        memset(&_accelData, 0, sizeof(_accelData));
+        memset(&_gyroData, 0, sizeof(_gyroData));
+        return false;
     }
-    _accelX = false;
-    return _accelData.xData;
+
+    if (bGyro)
+        convert_gyro(buffer);
+    if (bAccel)
+        convert_accel(pAccel);
+
+    return true;
 }
-float flxDevISM330Base::read_accel_y()
+
+//----------------------------------------------------------------------------------------------------------
+// Raw axis values to milli-g and milli-dps, for the full scale setting. The same conversions the library
+// getAccel() and getGyro() use.
+
+static inline int16_t axisValue(const uint8_t *data, int axis)
 {
-    if (!_accelY)
+    return (int16_t)(data[axis * 2] | (data[axis * 2 + 1] << 8));
+}
+
+void flxDevISM330Base::convert_accel(const uint8_t *data)
+{
+    float_t (*toMilliG)(int16_t);
+
+    switch (_accel_full_scale)
     {
-        if (getAccel(&_accelData))
-        {
-            _accelX = true;
-            _accelZ = true;
-        }
+    case ISM_2g:
+        toMilliG = ism330dhcx_from_fs2g_to_mg;
+        break;
+    case ISM_16g:
+        toMilliG = ism330dhcx_from_fs16g_to_mg;
+        break;
+    case ISM_8g:
+        toMilliG = ism330dhcx_from_fs8g_to_mg;
+        break;
+    default:
+        toMilliG = ism330dhcx_from_fs4g_to_mg;
+        break;
     }
-    _accelY = false;
-    return _accelData.yData;
+    _accelData.xData = toMilliG(axisValue(data, 0));
+    _accelData.yData = toMilliG(axisValue(data, 1));
+    _accelData.zData = toMilliG(axisValue(data, 2));
 }
-float flxDevISM330Base::read_accel_z()
+
+void flxDevISM330Base::convert_gyro(const uint8_t *data)
 {
-    if (!_accelZ)
+    float_t (*toMilliDPS)(int16_t);
+
+    switch (_gyro_full_scale)
     {
-        if (getAccel(&_accelData))
-        {
-            _accelX = true;
-            _accelY = true;
-        }
+    case ISM_125dps:
+        toMilliDPS = ism330dhcx_from_fs125dps_to_mdps;
+        break;
+    case ISM_250dps:
+        toMilliDPS = ism330dhcx_from_fs250dps_to_mdps;
+        break;
+    case ISM_1000dps:
+        toMilliDPS = ism330dhcx_from_fs1000dps_to_mdps;
+        break;
+    case ISM_2000dps:
+        toMilliDPS = ism330dhcx_from_fs2000dps_to_mdps;
+        break;
+    case ISM_4000dps:
+        toMilliDPS = ism330dhcx_from_fs4000dps_to_mdps;
+        break;
+    default:
+        toMilliDPS = ism330dhcx_from_fs500dps_to_mdps;
+        break;
     }
-    _accelZ = false;
+    _gyroData.xData = toMilliDPS(axisValue(data, 0));
+    _gyroData.yData = toMilliDPS(axisValue(data, 1));
+    _gyroData.zData = toMilliDPS(axisValue(data, 2));
+}
+
+// GETTER methods for output params
+float flxDevISM330Base::read_accel_x()
+{
+    sampleReady();
+    return _accelData.xData;
+}
+float flxDevISM330Base::read_accel_y()
+{
+    sampleReady();
+    return _accelData.yData;
+}
+float flxDevISM330Base::read_accel_z()
+{
+    sampleReady();
     return _accelData.zData;
 }
 float flxDevISM330Base::read_gyro_x()
 {
-    if (!_gyroX)
-    {
-        if (getGyro(&_gyroData))
-        {
-            _gyroY = true;
-            _gyroZ = true;
-        }
-    }
-    _gyroX = false;
+    sampleReady();
     return _gyroData.xData;
 }
 float flxDevISM330Base::read_gyro_y()
 {
-    if (!_gyroY)
-    {
-        if (getGyro(&_gyroData))
-        {
-            _gyroX = true;
-            _gyroZ = true;
-        }
-    }
-    _gyroY = false;
+    sampleReady();
     return _gyroData.yData;
 }
 float flxDevISM330Base::read_gyro_z()
 {
-    if (!_gyroZ)
-    {
-        if (getGyro(&_gyroData))
-        {
-            _gyroX = true;
-            _gyroY = true;
-        }
-    }
-    _gyroZ = false;
+    sampleReady();
     return _gyroData.zData;
 }
 float flxDevISM330Base::read_temperature()
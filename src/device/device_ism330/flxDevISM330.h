@@ -67,16 +67,10 @@ class flxDevISM330Base : public flxDevice, public QwDevISM330DHCX
     uint8_t get_gyro_lp1_bandwidth();
     void set_gyro_lp1_bandwidth(uint8_t);
 
-    // Flags to prevent getAccel being called multiple times
-    bool _accelX = false;
-    bool _accelY = false;
-    bool _accelZ = false;
-
-    // Flags to prevent getGyro being called multiple times
-    bool _gyroX = false;
-    bool _gyroY = false;
-    bool _gyroZ = false;
+    void convert_accel(const uint8_t *data);
+    void convert_gyro(const uint8_t *data);
 
+    // The accel and gyro sample - read once per observation in onAcquire()
     sfe_ism_data_t _accelData;
     sfe_ism_data_t _gyroData;
 
@@ -176,6 +170,7 @@ class flxDevISM330Base : public flxDevice, public QwDevISM330DHCX
 
   protected:
     bool onInitialize(void);
+    bool onAcquire(void);
 };
 
 //----------------------------------------------------------------------------------------------------------
@@ -104,8 +104,6 @@ bool flxDevVL53L5::onInitialize(TwoWire &wirePort)
 // GETTER methods for output params
 bool flxDevVL53L5::read_distance(flxDataArrayInt16 *distances)
 {
-    static int16_t theDistances[64] = {-999};
-
     VL53L5CX_ResultsData measurementData; // Result data class structure, 1356 byes of RAM
 
     bool result = SparkFun_VL53L5CX::isDataReady();
@@ -114,12 +112,15 @@ bool flxDevVL53L5::read_distance(flxDataArrayInt16 *distances)
     {
         result &= SparkFun_VL53L5CX::getRangingData(&measurementData);
 
+        // fill the array buffer in place - it's reused from one read to the next
+        int16_t *theDistances = result ? distances->buffer(8, 8) : nullptr;
+        if (!theDistances)
+            return false;
+
         int i = 0;
         for (int y = 0; y < 64; y += 8)
             for (int x = 7; x >= 0; x--)
                 theDistances[i++] = measurementData.distance_mm[x + y];
-
-        distances->set(theDistances, 8, 8, true); // don't copy
     }
 
     return result;
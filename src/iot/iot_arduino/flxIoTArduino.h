@@ -382,7 +382,8 @@ class flxIoTArduino : public flxActionType<flxIoTArduino>, public flxIWriterJSON
 
         flux.add(this);
 
-        _theJob.setup("ArduinoIOT", kArduinoIoTUpdateDelta, this, &flxIoTArduino::jobUpdateCB);
+        _theJob.setup("ArduinoIOT", kArduinoIoTUpdateDelta, this, &flxIoTArduino::jobUpdateCB, false,
+                      flxJobPriorityBackground);
     }
 
     //----------------------------------------------------------------------
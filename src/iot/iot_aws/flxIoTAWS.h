@@ -12,7 +12,9 @@
 
 #include "flxMQTTESP32.h"
 
-#define kAWSUpdateShadowTemplate "{\"state\":{\"reported\":%s}}"
+// The update shadow document is {"state":{"reported":<value>}}
+#define kAWSUpdateShadowPrefix "{\"state\":{\"reported\":"
+#define kAWSUpdateShadowSuffix "}}"
 #define kAWSUpdateShadowTopic "$aws/things/%s/shadow/update"
 
 // simple class to support AWS IoT
@@ -23,6 +25,10 @@ class flxIoTAWS : public flxMQTTESP32SecureCore<flxIoTAWS>, public flxWriter
     flxIoTAWS()
     {
         setName("AWS IoT", "Connection to AWS IoT");
+
+        // The device shadow is a JSON document
+        hideProperty(payloadFormat);
+
         flux.add(this);
     }
 
@@ -41,10 +47,13 @@ class flxIoTAWS : public flxMQTTESP32SecureCore<flxIoTAWS>, public flxWriter
         if (!value || type != flxLineTypeData)
             return;
 
-        // Wrap the value with the structure required to update the device shadow
-        char szBuffer[strlen(value) + sizeof(kAWSUpdateShadowTemplate)];
-        snprintf(szBuffer, sizeof(szBuffer), kAWSUpdateShadowTemplate, value);
-        flxMQTTESP32SecureCore::write(szBuffer, false, type);
+        // Wrap the value with the structure required to update the device shadow. The buffer is
+        // kept, so its memory is reused for each observation.
+        _shadowBuffer.assign(kAWSUpdateShadowPrefix);
+        _shadowBuffer.append(value);
+        _shadowBuffer.append(kAWSUpdateShadowSuffix);
+
+        flxMQTTESP32SecureCore::write(_shadowBuffer.c_str(), false, type);
     }
 
     bool initialize(void)
@@ -59,4 +68,7 @@ class flxIoTAWS : public flxMQTTESP32SecureCore<flxIoTAWS>, public flxWriter
 
         return true;
     }
-};
\ No newline at end of file
+
+  private:
+    std::string _shadowBuffer;
+};
@@ -67,8 +67,12 @@ class flxIoTAzure : public flxMQTTESP32SecureCore<flxIoTAzure>, public flxWriter
         flxRegister(deviceID, "Device ID", "The device id for the Azure IoT device");
         flxRegister(deviceKey, "Device Key", "The device key for the Azure IoT device");
 
+        // Telemetry is sent as JSON
+        hideProperty(payloadFormat);
+
         flux.add(this);
-        _theJob.setup("AzureIOT", kAzureIoTDriverJobUpdate, this, &flxIoTAzure::jobHandlerCB);
+        _theJob.setup("AzureIOT", kAzureIoTDriverJobUpdate, this, &flxIoTAzure::jobHandlerCB, false,
+                      flxJobPriorityBackground);
     }
 
     // for the Writer interface
@@ -83,8 +87,15 @@ class flxIoTAzure : public flxMQTTESP32SecureCore<flxIoTAzure>, public flxWriter
     //---------------------------------------------------------------------
     virtual void write(const char *value, bool newline, flxLineType_t type)
     {
-        // value? Connected? Data line?
-        if (!value || !_connected || type != flxLineTypeData)
+        // value? Enabled? Data line?
+        //
+        // Note: The message goes to the outbox even when not connected - it's held (or spilled) there,
+        // and published once the connection is up.
+        if (!value || !enabled() || type != flxLineTypeData)
+            return;
+
+        // The telemetry topic is queued with the message - it's known before the first connection
+        if (topic().length() == 0 && !setTelemetryTopic())
             return;
 
         flxMQTTESP32SecureCore::write(value, false, type);
@@ -176,6 +187,25 @@ class flxIoTAzure : public flxMQTTESP32SecureCore<flxIoTAzure>, public flxWriter
         password = token;
 
         // If we are here, we can get our mqtt update topic
+        if (!setTelemetryTopic())
+            return false;
+
+        _connected = flxMQTTESP32SecureCore<flxIoTAzure>::connect();
+
+        if (_connected)
+            flxAddJobToQueue(_theJob);
+        return _connected;
+    }
+
+    //---------------------------------------------------------------------
+    // Set the topic property to the telemetry topic of the device - no network access
+    bool setTelemetryTopic(void)
+    {
+        if (!_initialized && !initialize())
+            return false;
+
+        if (!initializeIoTHubClient())
+            return false;
 
         char telemetry_topic[kBufferSize];
 
@@ -188,11 +218,7 @@ class flxIoTAzure : public flxMQTTESP32SecureCore<flxIoTAzure>, public flxWriter
         // Set the topic property
         topic = telemetry_topic;
 
-        _connected = flxMQTTESP32SecureCore<flxIoTAzure>::connect();
-
-        if (_connected)
-            flxAddJobToQueue(_theJob);
-        return _connected;
+        return true;
     }
 
     //---------------------------------------------------------------------
@@ -15,12 +15,22 @@
 #include "flxCoreInterface.h"
 #include "flxFS.h"
 #include "flxFlux.h"
+#include "flxFmtMsgPack.h"
 #include "flxNetwork.h"
+#include "flxOutbox.h"
 
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
 #include <WiFi.h>
 
+// Batching - number of observations (1 == no batching) and max time (ms) a batch is held (0 == no limit)
+#define kHTTPBatchSizeDefault 1
+#define kHTTPBatchSizeMax 32
+#define kHTTPBatchIntervalMax 600000
+
+// Window used for the requests/minute value
+#define kHTTPRequestWindowMS 60000
+
 // A General HTTP/HTTPS output writer for the framework
 //
 // Create a template for the HTTP operation. This is then
@@ -28,13 +38,17 @@
 
 // Object -- the name of the class
 
-template <class Object> class flxIoTHTTPBase : public flxActionType<Object>
+template <class Object> class flxIoTHTTPBase : public flxActionType<Object>, public flxIOutboxSender
 {
   private:
     bool createWiFiClient(void)
     {
         if (_wifiClient)
+        {
+            // drop any kept-alive connection before the client goes away
+            _wifiClient->stop();
             delete _wifiClient;
+        }
 
         _wifiClient = _isSecure ? new WiFiClientSecure : new WiFiClient;
 
@@ -185,6 +199,145 @@ template <class Object> class flxIoTHTTPBase : public flxActionType<Object>
 
         _caFilename = theFile;
     }
+
+    //----------------------------------------------------------------------------
+    void set_outboxSize(uint16_t size)
+    {
+        _outbox.setDepth(size);
+        _outboxSize = size;
+    }
+    //----------------------------------------------------------------------------
+    uint16_t get_outboxSize(void)
+    {
+        return _outboxSize;
+    }
+
+    //----------------------------------------------------------------------------
+    void set_batchSize(uint16_t size)
+    {
+        _batchSize = size;
+
+        // send anything that's now a full batch
+        if (_nBatch >= _batchSize)
+            sendBatch();
+    }
+    //----------------------------------------------------------------------------
+    uint16_t get_batchSize(void)
+    {
+        return _batchSize;
+    }
+
+    //----------------------------------------------------------------------------
+    void set_batchInterval(uint32_t msInterval)
+    {
+        _msBatchInterval = msInterval;
+
+        if (_msBatchInterval == 0)
+        {
+            if (_jobBatch.queued())
+                flxRemoveJobFromQueue(_jobBatch);
+            return;
+        }
+
+        if (_jobBatch.queued())
+        {
+            _jobBatch.setPeriod(_msBatchInterval);
+            flxUpdateJobInQueue(_jobBatch);
+        }
+        else
+        {
+            _jobBatch.setup("http batch", _msBatchInterval, this, &flxIoTHTTPBase::sendBatch, false,
+                            flxJobPriorityBackground);
+            flxAddJobToQueue(_jobBatch);
+        }
+    }
+    //----------------------------------------------------------------------------
+    uint32_t get_batchInterval(void)
+    {
+        return _msBatchInterval;
+    }
+
+    //----------------------------------------------------------------------------
+    void set_payloadFormat(uint8_t format)
+    {
+        // don't mix formats in a batch, and JSON has no dictionary
+        if (format != _payloadFormat)
+        {
+            sendBatch();
+            _outbox.setContext(nullptr, 0);
+        }
+
+        _payloadFormat = format;
+    }
+    //----------------------------------------------------------------------------
+    uint8_t get_payloadFormat(void)
+    {
+        return _payloadFormat;
+    }
+
+    //----------------------------------------------------------------------------
+    // Queue the pending batch as a single array payload - JSON or MessagePack
+    void sendBatch(void)
+    {
+        if (_nBatch == 0)
+            return;
+
+        if (_payloadFormat == kPayloadFormatMsgPack)
+        {
+            // MessagePack array header (array 16), followed by the messages
+            const char header[] = {(char)0xDC, (char)((_nBatch >> 8) & 0xFF), (char)(_nBatch & 0xFF)};
+            _batch.insert(0, header, sizeof(header));
+        }
+        else
+            _batch += "]";
+
+        _outbox.enqueue((const uint8_t *)_batch.c_str(), _batch.length());
+
+        // note: clear() keeps the string memory for the next batch
+        _batch.clear();
+        _nBatch = 0;
+    }
+
+    //----------------------------------------------------------------------------
+    // Request stats - requests in the last full minute window
+    void updateRequestWindow(void)
+    {
+        uint32_t msNow = millis();
+        if (msNow - _msWindowStart < kHTTPRequestWindowMS)
+            return;
+
+        // if more than one window has passed, nothing was sent in the last one
+        _requestsPerMinute = msNow - _msWindowStart < 2 * kHTTPRequestWindowMS ? _nWindowRequests : 0;
+        _nWindowRequests = 0;
+        _msWindowStart = msNow;
+    }
+
+    //----------------------------------------------------------------------------
+    uint32_t get_requestsPerMinute(void)
+    {
+        updateRequestWindow();
+        return _requestsPerMinute;
+    }
+    uint32_t get_bytesSent(void)
+    {
+        return _bytesSent;
+    }
+
+    // Outbox output parameters
+    //----------------------------------------------------------------------------
+    uint32_t get_outboxDepth(void)
+    {
+        return _outbox.depth();
+    }
+    uint32_t get_outboxDropped(void)
+    {
+        return _outbox.dropped();
+    }
+    uint32_t get_outboxLatency(void)
+    {
+        return _outbox.latency();
+    }
+
     // Event callback
     //----------------------------------------------------------------------------
     void onConnectionChange(bool bConnected)
@@ -192,27 +345,107 @@ template <class Object> class flxIoTHTTPBase : public flxActionType<Object>
 
         _canConnect = bConnected;
 
+        // a new session - the server gets the MessagePack dictionary again
+        if (bConnected)
+            _outbox.resendContext();
+
         // Are we enabled ...
         if (!_isEnabled)
             return;
     }
 
+    //----------------------------------------------------------------------------
+    // Add a message to the current batch, or queue it if not batching
+    void batchMessage(const uint8_t *data, size_t length)
+    {
+        // No batching - the value is sent as is
+        if (_batchSize <= 1 && _msBatchInterval == 0)
+        {
+            _outbox.enqueue(data, length);
+            return;
+        }
+
+        // JSON batches are a JSON array - MessagePack batches get an array header when sent
+        if (_payloadFormat == kPayloadFormatJSON)
+            _batch += _nBatch == 0 ? "[" : ",";
+
+        _batch.append((const char *)data, length);
+        _nBatch++;
+
+        // A time limit is handled by the batch job
+        if (_nBatch >= _batchSize)
+            sendBatch();
+    }
+
+    //----------------------------------------------------------------------------
+    // Post a payload to the server
+    bool post(const char *message, size_t length)
+    {
+        // Post the data. The connection is kept alive between requests (set in the constructor),
+        // so the TCP/TLS connection setup is only done when the server closes it.
+
+        if (!_http.begin(*_wifiClient, _url.c_str()))
+        {
+            flxLogM_E(kMsgErrConnectionFailure, this->name(), _url.c_str());
+            return false;
+        }
+
+        _http.addHeader("Content-Type",
+                        _payloadFormat == kPayloadFormatMsgPack ? kMsgPackContentType : "application/json");
+
+        int rc = _http.POST((uint8_t *)message, length);
+
+        if (rc != 200)
+            flxLogM_W(kMsgErrConnectionFailure, this->name(), _http.errorToString(rc).c_str());
+
+        _http.end();
+
+        updateRequestWindow();
+        _nWindowRequests++;
+
+        if (rc == 200)
+            _bytesSent += length;
+
+        return rc == 200;
+    }
+
   public:
     flxIoTHTTPBase()
         : _theNetwork{nullptr}, _isEnabled{false}, _canConnect{false}, _isSecure{false}, _pCACert{nullptr},
-          _fileSystem{nullptr}, _wifiClient{nullptr}
+          _fileSystem{nullptr}, _wifiClient{nullptr}, _outbox{this}, _outboxSize{kOutboxDefaultDepth},
+          _batchSize{kHTTPBatchSizeDefault}, _msBatchInterval{0}, _nBatch{0}, _msWindowStart{0}, _nWindowRequests{0},
+          _requestsPerMinute{0}, _bytesSent{0}, _payloadFormat{kPayloadFormatJSON}
     {
         flxRegister(enabled, "Enabled", "Enable or Disable the HTTP Client");
 
+        _http.setReuse(true);
+
         flxRegister(URL, "URL", "URL to call with log information");
 
         flxRegister(caCertificate, "CA Certificate", "Certificate Authority certificate. Set to secure connection");
 
         flxRegister(caCertFilename, "CA Cert Filename", "File to load the certificate from");
+
+        flxRegister(outboxSize, "Outbox Size", "Number of messages held in memory while waiting to be sent");
+
+        flxRegister(payloadFormat, "Payload Format", "Format of the posted data - JSON or MessagePack");
+
+        flxRegister(batchSize, "Batch Size", "Number of observations sent in each request. If > 1, sent as a JSON array");
+        flxRegister(batchInterval, "Batch Interval", "Max time (ms) an observation is held for a batch. 0 = no limit");
+
+        flxRegister(requestsPerMinute, "Requests Per Minute", "Number of HTTP requests made in the last minute");
+        flxRegister(bytesSent, "Bytes Sent", "Total number of payload bytes sent");
+
+        flxRegister(outboxDepth, "Outbox Depth", "Number of messages waiting to be sent");
+        flxRegister(outboxDropped, "Outbox Dropped", "Number of messages dropped");
+        flxRegister(outboxLatency, "Outbox Latency", "Average time from logging to sending a message (ms)");
     };
 
     ~flxIoTHTTPBase()
     {
+        if (_jobBatch.queued())
+            flxRemoveJobFromQueue(_jobBatch);
+
         if (_pCACert != nullptr)
             delete _pCACert;
 
@@ -233,44 +466,76 @@ template <class Object> class flxIoTHTTPBase : public flxActionType<Object>
 
     //----------------------------------------------------------------------------
     // flxWriter interface method
+    //
+    // The message is queued in the outbox, which posts it from a background job. This
+    // keeps network delays out of the logging path.
     virtual void write(const char *value, bool newline, flxLineType_t type)
     {
-        // if we are not connected, ignore, bad url skip, we want json, so no headers
-        if (!_isEnabled || !_canConnect || !value || _url.length() < 10 || type != flxLineTypeData)
+        // if we are not enabled, ignore, bad url skip, we want json, so no headers
+        if (!_isEnabled || !value || _url.length() < 10 || type != flxLineTypeData ||
+            _payloadFormat != kPayloadFormatJSON)
             return;
 
-        if (!_wifiClient)
-        {
-            if (!createWiFiClient())
-            {
-                flxLogM_E(kMsgErrInitialization, this->name(), "Network Connection");
-                return;
-            }
-        }
+        batchMessage((const uint8_t *)value, strlen(value));
+    }
 
-        // Connect to server, post data, disconnect
+    //----------------------------------------------------------------------------
+    // flxWriter binary interface methods - used for MessagePack output (flxFormatMsgPack)
+    bool acceptsBinary(void)
+    {
+        return _payloadFormat == kPayloadFormatMsgPack;
+    }
 
-        HTTPClient http;
+    //----------------------------------------------------------------------------
+    void writeBytes(const uint8_t *data, size_t length, flxLineType_t type)
+    {
+        if (!_isEnabled || !data || _url.length() < 10 || _payloadFormat != kPayloadFormatMsgPack)
+            return;
 
-        if (!http.begin(*_wifiClient, _url.c_str()))
+        // The dictionary is the outbox context - posted ahead of the data that follows it, and again at the
+        // start of each session. Ids are stable in a run, so the latest dictionary covers what's queued in
+        // memory. Spilled data keeps the dictionary it was logged with, so a replay after a restart is decoded
+        // with the right names.
+        if (type == flxLineTypeHeader)
         {
-            flxLogM_E(kMsgErrConnectionFailure, this->name(), _url.c_str());
+            _outbox.setContext(data, length);
             return;
         }
+        if (type != flxLineTypeData)
+            return;
 
-        http.addHeader("Content-Type", "application/json");
+        batchMessage(data, length);
+    }
 
-        int rc = http.POST((uint8_t *)value, strlen(value));
+    //----------------------------------------------------------------------------
+    // flxIOutboxSender interface methods
+    bool outboxReady(void)
+    {
+        return _isEnabled && _canConnect;
+    }
 
-        if (rc != 200)
-            flxLogM_W(kMsgErrConnectionFailure, this->name(), http.errorToString(rc).c_str());
+    //----------------------------------------------------------------------------
+    bool outboxSend(const char *message, size_t length, const char *route)
+    {
+        if (!_wifiClient)
+        {
+            if (!createWiFiClient())
+            {
+                flxLogM_E(kMsgErrInitialization, this->name(), "Network Connection");
+                return false;
+            }
+        }
 
-        http.end();
+        return post(message, length);
     }
     //---------------------------------------------------------
+    // The file system is used to load certificates, and to spill queued messages when
+    // the server can't be reached
     void setFileSystem(flxIFileSystem *fs)
     {
         _fileSystem = fs;
+
+        _outbox.setFileSystem(fs, this->name());
     }
 
     // Properties
@@ -286,6 +551,29 @@ template <class Object> class flxIoTHTTPBase : public flxActionType<Object>
     flxPropertyRWString<flxIoTHTTPBase, &flxIoTHTTPBase::get_caCertFilename, &flxIoTHTTPBase::set_caCertFilename>
         caCertFilename;
 
+    // Outbox size property
+    flxPropertyRWUInt16<flxIoTHTTPBase, &flxIoTHTTPBase::get_outboxSize, &flxIoTHTTPBase::set_outboxSize> outboxSize = {
+        kOutboxDefaultDepth, 1, 128};
+
+    // Payload format - JSON text, or MessagePack from a flxFormatMsgPack formatter
+    flxPropertyRWUInt8<flxIoTHTTPBase, &flxIoTHTTPBase::get_payloadFormat, &flxIoTHTTPBase::set_payloadFormat>
+        payloadFormat = {kPayloadFormatJSON, {{"JSON", kPayloadFormatJSON}, {"MessagePack", kPayloadFormatMsgPack}}};
+
+    // Batching properties
+    flxPropertyRWUInt16<flxIoTHTTPBase, &flxIoTHTTPBase::get_batchSize, &flxIoTHTTPBase::set_batchSize> batchSize = {
+        kHTTPBatchSizeDefault, 1, kHTTPBatchSizeMax};
+    flxPropertyRWUInt32<flxIoTHTTPBase, &flxIoTHTTPBase::get_batchInterval, &flxIoTHTTPBase::set_batchInterval>
+        batchInterval = {0, 0, kHTTPBatchIntervalMax};
+
+    // Request stats
+    flxParameterOutUInt32<flxIoTHTTPBase, &flxIoTHTTPBase::get_requestsPerMinute> requestsPerMinute;
+    flxParameterOutUInt32<flxIoTHTTPBase, &flxIoTHTTPBase::get_bytesSent> bytesSent;
+
+    // Outbox state
+    flxParameterOutUInt32<flxIoTHTTPBase, &flxIoTHTTPBase::get_outboxDepth> outboxDepth;
+    flxParameterOutUInt32<flxIoTHTTPBase, &flxIoTHTTPBase::get_outboxDropped> outboxDropped;
+    flxParameterOutUInt32<flxIoTHTTPBase, &flxIoTHTTPBase::get_outboxLatency> outboxLatency;
+
   protected:
     flxNetwork *_theNetwork;
 
@@ -308,6 +596,28 @@ template <class Object> class flxIoTHTTPBase : public flxActionType<Object>
     flxIFileSystem *_fileSystem;
 
     WiFiClient *_wifiClient;
+
+    // Messages waiting to be sent
+    flxOutbox _outbox;
+    uint16_t _outboxSize;
+
+    // Kept between requests for connection reuse (keep-alive)
+    HTTPClient _http;
+
+    // batch being built
+    uint16_t _batchSize;
+    uint32_t _msBatchInterval;
+    std::string _batch;
+    uint16_t _nBatch;
+    flxJob _jobBatch;
+
+    // request stats
+    uint32_t _msWindowStart;
+    uint32_t _nWindowRequests;
+    uint32_t _requestsPerMinute;
+    uint32_t _bytesSent;
+
+    uint8_t _payloadFormat;
 };
 
 class flxIoTHTTP : public flxIoTHTTPBase<flxIoTHTTP>, public flxWriter
@@ -334,5 +644,13 @@ class flxIoTHTTP : public flxIoTHTTPBase<flxIoTHTTP>, public flxWriter
 
         flxIoTHTTPBase<flxIoTHTTP>::write(value, false, type);
     }
+    bool acceptsBinary(void)
+    {
+        return flxIoTHTTPBase<flxIoTHTTP>::acceptsBinary();
+    }
+    void writeBytes(const uint8_t *data, size_t length, flxLineType_t type)
+    {
+        flxIoTHTTPBase<flxIoTHTTP>::writeBytes(data, length, type);
+    }
 };
 #endif
\ No newline at end of file
@@ -16,7 +16,9 @@
 #include "flxFmtJSON.h"
 #include "flxUtils.h"
 
+#include <map>
 #include <string.h>
+#include <string>
 #include <time.h>
 
 #define kOutputBufferSize 1600
@@ -26,10 +28,13 @@
 class flxIoTMachineChat : public flxIoTHTTPBase<flxIoTMachineChat>, public flxIWriterJSON
 {
   public:
-    flxIoTMachineChat() : _isInitalized{false}, _szLocalIP{""}
+    flxIoTMachineChat() : _isInitalized{false}, _szLocalIP{""}, _jsonOutput(kOutputBufferSize)
     {
         setName("Machinechat", "Connection to Machinechat IoT Server");
 
+        // Machinechat takes JSON
+        hideProperty(payloadFormat);
+
         flux.add(this);
     }
 
@@ -42,6 +47,23 @@ class flxIoTMachineChat : public flxIoTHTTPBase<flxIoTMachineChat>, public flxIW
         snprintf(_szLocalIP, sizeof(_szLocalIP), "%u.%u.%u.%u", myIP[0], myIP[1], myIP[2], myIP[3]);
     }
 
+    //---------------------------------------------------------------------
+    // Return the MachineChat (variable) name for the given device/parameter name. Names don't
+    // change between observations, so the sanitized names are cached.
+    const char *variableName(const char *name)
+    {
+        auto it = _variableNames.find(name);
+        if (it != _variableNames.end())
+            return it->second.c_str();
+
+        char szName[64];
+        if (strlen(name) >= sizeof(szName) || !flx_utils::createVariableName(name, szName))
+            return nullptr;
+
+        return _variableNames.emplace(name, szName).first->second.c_str();
+    }
+
+    //---------------------------------------------------------------------
     void write(JsonDocument &jsonDoc)
     {
 
@@ -68,15 +90,10 @@ class flxIoTMachineChat : public flxIoTHTTPBase<flxIoTMachineChat>, public flxIW
         time(&t_now);
         flx_utils::timestampISO8601(t_now, szTime, sizeof(szTime), true);
 
-        DynamicJsonDocument jsonOutput(kOutputBufferSize);
-
-        JsonObject jsonContext;
         JsonObject jRoot = jsonDoc.as<JsonObject>();
 
-        std::string strOutput;
-
-        char szName[64];
-        char szData[64];
+        const char *szName;
+        const char *szData;
 
         // loop over top level objects in the output document - these are devices
         for (JsonPair kvObj : jRoot)
@@ -85,38 +102,49 @@ class flxIoTMachineChat : public flxIoTHTTPBase<flxIoTMachineChat>, public flxIW
                 continue;
 
             // get a proper context name/ID --
-            if (!flx_utils::createVariableName(kvObj.key().c_str(), szName))
+            szName = variableName(kvObj.key().c_str());
+            if (!szName)
             {
                 flxLogM_E(kMsgErrAllocErrorN, name(), kvObj.key().c_str());
                 continue;
             }
 
-            jsonOutput.clear();
-            jsonOutput["context"]["target_id"] = szName;
-            jsonOutput["context"]["target_ip"] = _szLocalIP;
-            jsonOutput["context"]["timestamp"] = szTime;
+            // note: the names are stored as pointers (not copied) in the document - the cache owns them
+            _jsonOutput.clear();
+            _jsonOutput["context"]["target_id"] = szName;
+            _jsonOutput["context"]["target_ip"] = (const char *)_szLocalIP;
+            _jsonOutput["context"]["timestamp"] = szTime;
 
             // loop over data
             for (JsonPair kvParam : kvObj.value().as<JsonObject>())
             {
                 // cleanup the name
-                if (!flx_utils::createVariableName(kvParam.key().c_str(), szData))
+                szData = variableName(kvParam.key().c_str());
+                if (!szData)
                 {
                     flxLogM_E(kMsgErrAllocErrorN, name(), kvParam.key().c_str());
                     continue;
                 }
-                jsonOutput["data"][szData] = kvParam.value();
+                _jsonOutput["data"][szData] = kvParam.value();
             }
 
-            strOutput.clear();
-            serializeJson(jsonOutput, strOutput);
+            // note: clear() keeps the string memory between calls
+            _strOutput.clear();
+            serializeJson(_jsonOutput, _strOutput);
 
             // post to machine chat.
-            flxIoTHTTPBase<flxIoTMachineChat>::write(strOutput.c_str(), false, flxLineTypeData);
+            flxIoTHTTPBase<flxIoTMachineChat>::write(_strOutput.c_str(), false, flxLineTypeData);
         }
     }
 
   private:
     bool _isInitalized;
     char _szLocalIP[16];
+
+    // Reused for each observation - the document memory pool and output string are allocated once
+    DynamicJsonDocument _jsonOutput;
+    std::string _strOutput;
+
+    // device/parameter name -> MachineChat variable name
+    std::map<std::string, std::string> _variableNames;
 };
@@ -90,6 +90,9 @@ class flxIoTThingSpeak : public flxMQTTESP32SecureCore<flxIoTThingSpeak>, public
         // user.
         hideProperty(topic);
 
+        // ThingSpeak updates are field lists, not JSON or MessagePack
+        hideProperty(payloadFormat);
+
         flux.add(this);
     }
 
@@ -0,0 +1,729 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+#include "flxOutbox.h"
+#include "flxCoreLog.h"
+#include "flxUtils.h"
+
+#include <Arduino.h>
+
+// Spill file format: a sequence of records - messages can be binary:
+//
+//      route length (uint16), message length (uint32) - little endian
+//      route
+//      message
+//
+// A context record has a route length of kOutboxSpillContext, and no route. It applies to the message
+// records that follow it.
+//
+#define kOutboxSpillHeaderSize 6
+#define kOutboxSpillContext 0xFFFF
+#define kOutboxSpillSuffix ".obx"
+
+// Replay position file: the offset of the next unsent record in the spill file (uint32) and a CRC32 of
+// it. Written after each drain pass that sends spilled messages, so a restart resumes from there.
+#define kOutboxPositionSize 8
+#define kOutboxPositionSuffix ".obp"
+
+// Size limits of a spilled message - a record outside these is taken as a damaged file, so larger
+// messages aren't spilled
+#define kOutboxSpillMaxRoute 1024
+#define kOutboxSpillMaxMessage 65536
+
+//----------------------------------------------------------------------------------
+static void put_le(uint8_t *buffer, uint32_t value, uint8_t size)
+{
+    for (int i = 0; i < size; i++, value >>= 8)
+        buffer[i] = value & 0xFF;
+}
+
+//----------------------------------------------------------------------------------
+static uint32_t get_le(const uint8_t *buffer, uint8_t size)
+{
+    uint32_t value = 0;
+    for (int i = size - 1; i >= 0; i--)
+        value = (value << 8) | buffer[i];
+
+    return value;
+}
+
+//----------------------------------------------------------------------------------
+flxOutbox::flxOutbox(flxIOutboxSender *sender)
+    : _sender{sender}, _head{0}, _count{0}, _bContextSent{false}, _bSpillContextSent{false},
+      _bContextSpilled{false}, _fileSystem{nullptr}, _spillOffset{0}, _nSpilled{0},
+      _haveSpillRecord{false}, _spillRecordSize{0}, _readPos{0}, _readLength{0}, _msRetry{0}, _msFailed{0},
+      _attempts{0}, _bBackoff{false}, _nDropped{0}, _msLatencyTotal{0}, _nLatency{0}
+{
+    _queue.resize(kOutboxDefaultDepth);
+}
+
+//----------------------------------------------------------------------------------
+flxOutbox::~flxOutbox()
+{
+    if (_jobDrain.queued())
+        flxRemoveJobFromQueue(_jobDrain);
+
+    closeSpillRead();
+}
+
+//----------------------------------------------------------------------------------
+void flxOutbox::setDepth(uint16_t depth)
+{
+    if (depth == 0 || depth == _queue.size())
+        return;
+
+    // Keep the newest messages that fit - in order
+    std::vector<flxOutboxEntry_t> newQueue(depth);
+
+    while (_count > depth)
+    {
+        if (!spillOldest())
+        {
+            _head = (_head + 1) % _queue.size();
+            _count--;
+            _nDropped++;
+        }
+    }
+    for (uint16_t i = 0; i < _count; i++)
+        newQueue[i] = std::move(_queue[(_head + i) % _queue.size()]);
+
+    _queue = std::move(newQueue);
+    _head = 0;
+}
+
+//----------------------------------------------------------------------------------
+void flxOutbox::setFileSystem(flxIFileSystem *fs, const char *name)
+{
+    closeSpillRead();
+
+    _fileSystem = fs;
+    _nSpilled = 0;
+    _spillOffset = 0;
+    _spillContext.clear();
+    _bSpillContextSent = false;
+
+    if (!_fileSystem || !name)
+        return;
+
+    // spill file name - based on the owner name
+    char szName[64];
+    char szBuffer[64];
+    strlcpy(szBuffer, name, sizeof(szBuffer));
+    if (!flx_utils::createVariableName(szBuffer, szName))
+        strlcpy(szName, "outbox", sizeof(szName));
+
+    _spillName = "/";
+    _spillName += szName;
+    _positionName = _spillName + kOutboxPositionSuffix;
+    _spillName += kOutboxSpillSuffix;
+
+    // Messages left from a previous run? They'll be sent first - from the saved replay position
+    if (_fileSystem->exists(_spillName.c_str()))
+    {
+        _spillOffset = loadPosition();
+        _nSpilled = countSpilled();
+        if (_nSpilled > 0)
+            startDrain();
+        else
+            removeSpill();
+    }
+    else if (_fileSystem->exists(_positionName.c_str()))
+        _fileSystem->remove(_positionName.c_str());
+}
+
+//----------------------------------------------------------------------------------
+// Context - the destination holds one context at a time. The flags track if it's the queued message
+// context, the spilled message context, or both (the same).
+
+void flxOutbox::setContext(const uint8_t *data, size_t length)
+{
+    if (!data)
+        length = 0;
+
+    if (length == _context.length() && memcmp(_context.data(), data, length) == 0)
+        return;
+
+    _context.assign((const char *)data, length);
+    _bContextSent = _bSpillContextSent && _context == _spillContext;
+    _bContextSpilled = false;
+}
+
+//----------------------------------------------------------------------------------
+void flxOutbox::resendContext(void)
+{
+    _bContextSent = false;
+    _bSpillContextSent = false;
+}
+
+//----------------------------------------------------------------------------------
+// Send a context, if the destination doesn't have it. Returns false if the send failed.
+
+bool flxOutbox::sendContext(const std::string &context, bool &bSent, const char *route)
+{
+    if (bSent || context.length() == 0)
+        return true;
+
+    if (!_sender->outboxSend(context.c_str(), context.length(), route))
+        return false;
+
+    _bContextSent = _bSpillContextSent = _context == _spillContext;
+    bSent = true;
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------
+void flxOutbox::startDrain(void)
+{
+    if (_jobDrain.queued())
+        return;
+
+    _jobDrain.setup("iot outbox", kOutboxDrainPeriod, this, &flxOutbox::drain, false, flxJobPriorityBackground);
+    flxAddJobToQueue(_jobDrain);
+}
+
+//----------------------------------------------------------------------------------
+// Add a message to the queue - constant time, no network access
+
+void flxOutbox::enqueue(const char *message, const char *route)
+{
+    if (!message)
+        return;
+
+    enqueue((const uint8_t *)message, strlen(message), route);
+}
+
+//----------------------------------------------------------------------------------
+void flxOutbox::enqueue(const uint8_t *data, size_t length, const char *route)
+{
+    if (!data)
+        return;
+
+    // Queue full? Make room - spill (or drop) the oldest message
+    if (_count == _queue.size())
+    {
+        if (!spillOldest())
+        {
+            _head = (_head + 1) % _queue.size();
+            _count--;
+            _nDropped++;
+        }
+    }
+
+    flxOutboxEntry_t &entry = _queue[(_head + _count) % _queue.size()];
+
+    // note: assign() reuses the entry string memory
+    entry.message.assign((const char *)data, length);
+    entry.route.assign(route ? route : "");
+    entry.msQueued = millis();
+    _count++;
+
+    startDrain();
+}
+
+//----------------------------------------------------------------------------------
+// Send queued messages - spilled messages are the oldest, so they go first
+
+void flxOutbox::drain(void)
+{
+    if (!_sender || depth() == 0)
+        return;
+
+    // backing off after a failure?
+    if (_bBackoff && millis() - _msFailed < _msRetry)
+        return;
+
+    if (!_sender->outboxReady())
+        return;
+
+    bool bReplayed = false;
+
+    for (int i = 0; i < kOutboxBatchSize && depth() > 0; i++)
+    {
+        if (_nSpilled > 0)
+        {
+            if (!nextSpilled())
+            {
+                // spill file is gone, truncated or damaged - nothing more to replay
+                flxLog_W(F("Outbox: spill file damaged - %u messages lost"), (unsigned)_nSpilled);
+                _nDropped += _nSpilled;
+                removeSpill();
+                continue;
+            }
+
+            bool bSent = sendContext(_spillContext, _bSpillContextSent, _spillRoute.c_str()) &&
+                         _sender->outboxSend(_spillMessage.c_str(), _spillMessage.length(), _spillRoute.c_str());
+
+            if (bSent)
+                sendSucceeded();
+            else if (!sendFailed())
+                break;
+
+            // sent, or dropped after too many attempts - move to the next record
+            _spillOffset += _spillRecordSize;
+            _haveSpillRecord = false;
+            _nSpilled--;
+            bReplayed = true;
+
+            if (_nSpilled == 0)
+                removeSpill();
+        }
+        else
+        {
+            flxOutboxEntry_t &entry = _queue[_head];
+
+            bool bSent = sendContext(_context, _bContextSent, entry.route.c_str()) &&
+                         _sender->outboxSend(entry.message.c_str(), entry.message.length(), entry.route.c_str());
+
+            if (bSent)
+            {
+                sendSucceeded();
+                _msLatencyTotal += millis() - entry.msQueued;
+                _nLatency++;
+            }
+            else if (!sendFailed())
+                break;
+
+            _head = (_head + 1) % _queue.size();
+            _count--;
+        }
+
+        if (!_sender->outboxReady())
+            break;
+    }
+
+    // Record how far the replay got - once per pass, not per message
+    if (bReplayed && _nSpilled > 0)
+        savePosition();
+}
+
+//----------------------------------------------------------------------------------
+// A send failed - back off before the next try. Returns true if the message should be
+// dropped (too many attempts).
+
+bool flxOutbox::sendFailed(void)
+{
+    if (++_attempts >= kOutboxMaxAttempts)
+    {
+        sendSucceeded(); // the next message starts fresh
+        _nDropped++;
+        return true;
+    }
+
+    _msRetry = _msRetry == 0 ? kOutboxRetryMin : std::min((uint32_t)kOutboxRetryMax, _msRetry * 2);
+    _msFailed = millis();
+    _bBackoff = true;
+
+    return false;
+}
+
+//----------------------------------------------------------------------------------
+// A message was sent (or given up on) - clear the retry state, so the next message gets its
+// full number of attempts and the backoff starts from the minimum.
+
+void flxOutbox::sendSucceeded(void)
+{
+    _attempts = 0;
+    _msRetry = 0;
+    _msFailed = 0;
+    _bBackoff = false;
+}
+
+//----------------------------------------------------------------------------------
+// Spill file management
+//----------------------------------------------------------------------------------
+
+//----------------------------------------------------------------------------------
+// Move the oldest queued message to the end of the spill file. Spilled messages are always
+// older than the messages in memory, so order is kept.
+
+bool flxOutbox::spillOldest(void)
+{
+    if (!_fileSystem || _spillName.length() == 0 || _count == 0)
+        return false;
+
+    flxOutboxEntry_t &entry = _queue[_head];
+
+    // Too large to spill? The replay would take it as a damaged file - drop it
+    if (entry.route.length() > kOutboxSpillMaxRoute || entry.message.length() > kOutboxSpillMaxMessage)
+    {
+        flxLog_W(F("Outbox: message too large to spill (%u bytes) - dropped"), (unsigned)entry.message.length());
+        _head = (_head + 1) % _queue.size();
+        _count--;
+        _nDropped++;
+        return true;
+    }
+
+    if (!appendSpill(entry))
+        return false;
+
+    _head = (_head + 1) % _queue.size();
+    _count--;
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------
+bool flxOutbox::appendSpill(const flxOutboxEntry_t &entry)
+{
+    // The replay read position is kept - the file is reopened at that point when needed
+    closeSpillRead();
+
+    flxFSFile theFile = _fileSystem->open(_spillName.c_str(), flxIFileSystem::kFileAppend, true);
+    if (!theFile)
+        return false;
+
+    // end of the last complete record - for the repair of a failed write
+    uint32_t validEnd = theFile.size();
+
+    // The context this message was queued with - if it's not in the file yet
+    bool status = true;
+    bool bWriteContext = !_bContextSpilled && _context.length() > 0 && _context.length() <= kOutboxSpillMaxMessage;
+    if (bWriteContext)
+        status = writeSpillRecord(theFile, kOutboxSpillContext, nullptr, _context);
+
+    status = status && writeSpillRecord(theFile, entry.route.length(), entry.route.c_str(), entry.message);
+    theFile.close();
+
+    if (status)
+    {
+        _nSpilled++;
+        if (bWriteContext)
+            _bContextSpilled = true;
+    }
+    else
+        repairSpill(validEnd);
+
+    return status;
+}
+
+//----------------------------------------------------------------------------------
+// Write a record to the spill file - a route length of kOutboxSpillContext is a context record
+
+bool flxOutbox::writeSpillRecord(flxFSFile &theFile, uint16_t routeLength, const char *route,
+                                 const std::string &message)
+{
+    uint8_t header[kOutboxSpillHeaderSize];
+    put_le(header, routeLength, 2);
+    put_le(header + 2, message.length(), 4);
+
+    if (routeLength == kOutboxSpillContext)
+        routeLength = 0;
+
+    return theFile.write(header, sizeof(header)) == sizeof(header) &&
+           theFile.write((const uint8_t *)route, routeLength) == routeLength &&
+           theFile.write((const uint8_t *)message.c_str(), message.length()) == message.length();
+}
+
+//----------------------------------------------------------------------------------
+// A write to the spill file failed part way - remove the partial record, so later records aren't
+// written after it. The file interface can't truncate, so the unsent records (up to validEnd) are
+// copied to a new file, which replaces the spill file. If that fails, the spilled messages are lost.
+
+bool flxOutbox::repairSpill(uint32_t validEnd)
+{
+    closeSpillRead();
+
+    std::string tmpName = _spillName + ".tmp";
+
+    flxFSFile fileIn = _fileSystem->open(_spillName.c_str(), flxIFileSystem::kFileRead);
+    flxFSFile fileOut = _fileSystem->open(tmpName.c_str(), flxIFileSystem::kFileWrite, true);
+
+    bool status = fileIn && fileOut;
+    uint32_t position = 0;
+
+    // The context of the next record to replay was read from the part of the file that isn't copied
+    if (status && _spillOffset > 0 && _spillContext.length() > 0)
+        status = writeSpillRecord(fileOut, kOutboxSpillContext, nullptr, _spillContext);
+
+    while (status && position < validEnd)
+    {
+        size_t nRead = fileIn.read(_readBuffer, std::min((uint32_t)sizeof(_readBuffer), validEnd - position));
+        if (nRead == 0)
+        {
+            status = false;
+            break;
+        }
+
+        // skip the records already sent
+        if (position + nRead > _spillOffset)
+        {
+            uint32_t skip = position < _spillOffset ? _spillOffset - position : 0;
+            status = fileOut.write(_readBuffer + skip, nRead - skip) == nRead - skip;
+        }
+        position += nRead;
+    }
+
+    if (fileIn)
+        fileIn.close();
+    if (fileOut)
+        fileOut.close();
+
+    // this read buffer content is stale now
+    _readPos = 0;
+    _readLength = 0;
+
+    // The saved position is for the old file - remove it first. If the rename doesn't happen, the replay
+    // starts from the beginning, which resends messages rather than skipping them.
+    if (status)
+        status = (!_fileSystem->exists(_positionName.c_str()) || _fileSystem->remove(_positionName.c_str())) &&
+                 _fileSystem->remove(_spillName.c_str()) && _fileSystem->rename(tmpName.c_str(), _spillName.c_str());
+
+    if (status)
+    {
+        _spillOffset = 0;
+        _bContextSpilled = false;
+        return true;
+    }
+
+    _fileSystem->remove(tmpName.c_str());
+
+    flxLog_W(F("Outbox: unable to repair the spill file - %u messages lost"), (unsigned)_nSpilled);
+    _nDropped += _nSpilled;
+    removeSpill();
+
+    return false;
+}
+
+//----------------------------------------------------------------------------------
+// Read bytes from the spill file, through the read buffer. If a string is provided, the
+// bytes are appended to it, otherwise they're skipped.
+
+bool flxOutbox::readSpill(std::string *dest, size_t length)
+{
+    while (length > 0)
+    {
+        if (_readPos == _readLength)
+        {
+            _readLength = _spillRead.read(_readBuffer, sizeof(_readBuffer));
+            _readPos = 0;
+
+            if (_readLength == 0)
+                return false;
+        }
+
+        size_t n = std::min(length, (size_t)(_readLength - _readPos));
+        if (dest)
+            dest->append((const char *)_readBuffer + _readPos, n);
+
+        _readPos += n;
+        length -= n;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------
+// Read the header of the next spilled record - returns the route and message length
+
+bool flxOutbox::readSpillHeader(size_t &routeLength, size_t &messageLength)
+{
+    _spillHeader.clear();
+    if (!readSpill(&_spillHeader, kOutboxSpillHeaderSize))
+        return false;
+
+    const uint8_t *pHeader = (const uint8_t *)_spillHeader.c_str();
+    routeLength = get_le(pHeader, 2);
+    messageLength = get_le(pHeader + 2, 4);
+
+    return (routeLength <= kOutboxSpillMaxRoute || routeLength == kOutboxSpillContext) &&
+           messageLength <= kOutboxSpillMaxMessage;
+}
+
+//----------------------------------------------------------------------------------
+// Read a context record - it's the context of the spilled records that follow it
+
+bool flxOutbox::readSpillContext(size_t length)
+{
+    // note: read into the message string, so an unchanged context doesn't have to be sent again
+    _spillMessage.clear();
+    if (!readSpill(&_spillMessage, length))
+        return false;
+
+    if (_spillMessage != _spillContext)
+    {
+        _spillContext.swap(_spillMessage);
+        _bSpillContextSent = _bContextSent && _spillContext == _context;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------
+// Get the next spilled record. The record is kept until it's consumed.
+
+bool flxOutbox::nextSpilled(void)
+{
+    if (_haveSpillRecord)
+        return true;
+
+    if (!_spillRead)
+    {
+        if (!_fileSystem)
+            return false;
+
+        _spillRead = _fileSystem->open(_spillName.c_str(), flxIFileSystem::kFileRead);
+        if (!_spillRead)
+            return false;
+
+        _readPos = 0;
+        _readLength = 0;
+
+        // skip what has already been sent
+        if (!readSpill(nullptr, _spillOffset))
+            return false;
+    }
+
+    size_t routeLength, messageLength;
+    if (!readSpillHeader(routeLength, messageLength))
+        return false;
+
+    // context records are used as they're read - the replay position moves past them
+    while (routeLength == kOutboxSpillContext)
+    {
+        if (!readSpillContext(messageLength))
+            return false;
+
+        _spillOffset += kOutboxSpillHeaderSize + messageLength;
+
+        if (!readSpillHeader(routeLength, messageLength))
+            return false;
+    }
+
+    // note: clear() keeps the string memory
+    _spillRoute.clear();
+    _spillMessage.clear();
+
+    // a partial last record (power loss) is ignored
+    if (!readSpill(&_spillRoute, routeLength) || !readSpill(&_spillMessage, messageLength))
+        return false;
+
+    _spillRecordSize = kOutboxSpillHeaderSize + routeLength + messageLength;
+    _haveSpillRecord = true;
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------
+void flxOutbox::closeSpillRead(void)
+{
+    if (_spillRead)
+        _spillRead.close();
+
+    _spillRead = flxFSFile();
+    _readPos = 0;
+    _readLength = 0;
+    _haveSpillRecord = false;
+}
+
+//----------------------------------------------------------------------------------
+void flxOutbox::removeSpill(void)
+{
+    closeSpillRead();
+
+    if (_fileSystem && _spillName.length() > 0)
+    {
+        _fileSystem->remove(_spillName.c_str());
+        if (_fileSystem->exists(_positionName.c_str()))
+            _fileSystem->remove(_positionName.c_str());
+    }
+
+    _spillOffset = 0;
+    _nSpilled = 0;
+    _bContextSpilled = false;
+}
+
+//----------------------------------------------------------------------------------
+// Count the complete message records from the replay position (_spillOffset), and get the context in
+// effect there. If the position isn't the start of a record, it's not valid for this file - the replay
+// starts from the beginning.
+
+uint32_t flxOutbox::countSpilled(void)
+{
+    closeSpillRead();
+
+    _spillRead = _fileSystem->open(_spillName.c_str(), flxIFileSystem::kFileRead);
+    if (!_spillRead)
+        return 0;
+
+    uint32_t nRecords = 0;
+    uint32_t nUnsent = 0;
+    uint32_t position = 0;
+    bool bAtOffset = _spillOffset == 0;
+    size_t routeLength, messageLength;
+
+    while (readSpillHeader(routeLength, messageLength))
+    {
+        if (position == _spillOffset)
+            bAtOffset = true;
+
+        if (routeLength == kOutboxSpillContext)
+        {
+            // a context ahead of the replay position applies to the records after it
+            if (bAtOffset ? !readSpill(nullptr, messageLength) : !readSpillContext(messageLength))
+                break;
+            position += kOutboxSpillHeaderSize + messageLength;
+            continue;
+        }
+        if (!readSpill(nullptr, routeLength + messageLength))
+            break;
+
+        if (bAtOffset)
+            nUnsent++;
+
+        position += kOutboxSpillHeaderSize + routeLength + messageLength;
+        nRecords++;
+    }
+
+    closeSpillRead();
+
+    // the position can be the end of the file - everything was sent
+    if (bAtOffset || position == _spillOffset)
+        return nUnsent;
+
+    flxLog_W(F("Outbox: spill file replay position not valid - resending from the start"));
+    _spillOffset = 0;
+    _spillContext.clear();
+
+    return nRecords;
+}
+
+//----------------------------------------------------------------------------------
+// Replay position - saved in a small file next to the spill file. The CRC catches a torn write, in which
+// case the replay starts from the beginning of the spill file.
+
+void flxOutbox::savePosition(void)
+{
+    uint8_t buffer[kOutboxPositionSize];
+    put_le(buffer, _spillOffset, 4);
+    put_le(buffer + 4, flx_utils::calc_crc32(0, buffer, 4), 4);
+
+    flxFSFile theFile = _fileSystem->open(_positionName.c_str(), flxIFileSystem::kFileWrite, true);
+    if (!theFile)
+        return;
+
+    theFile.write(buffer, sizeof(buffer));
+    theFile.close();
+}
+
+//----------------------------------------------------------------------------------
+uint32_t flxOutbox::loadPosition(void)
+{
+    flxFSFile theFile = _fileSystem->open(_positionName.c_str(), flxIFileSystem::kFileRead);
+    if (!theFile)
+        return 0;
+
+    uint8_t buffer[kOutboxPositionSize];
+    size_t nRead = theFile.read(buffer, sizeof(buffer));
+    theFile.close();
+
+    if (nRead != sizeof(buffer) || get_le(buffer + 4, 4) != flx_utils::calc_crc32(0, buffer, 4))
+        return 0;
+
+    return get_le(buffer, 4);
+}
@@ -0,0 +1,191 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Store and forward outbox for network (IoT) writers.
+//
+// Messages are queued in constant time from the writer, and a background job sends them to the
+// destination - with retry, backoff and batching. This keeps network I/O out of the logging path.
+//
+// If the destination isn't reachable and the queue is full, queued messages are spilled to a file
+// (if a file system is set) and replayed, in order, once the destination is reachable again.
+//
+// A message can have a context - a message the destination needs before it, such as the dictionary of a
+// MessagePack payload. The context is sent before the first message queued after it, and again at the start
+// of each session. Spilled messages keep the context they were queued with - it's written to the spill file
+// ahead of them, and sent before they're replayed, even after a restart.
+//
+// The replay position is saved after each drain pass, so a restart doesn't resend what was already sent.
+// Delivery is at least once - after a power loss, up to kOutboxBatchSize messages sent since the position
+// was last saved are sent again.
+//
+
+#pragma once
+
+#include "flxCoreJobs.h"
+#include "flxFS.h"
+
+#include <string>
+#include <vector>
+
+// Default number of messages held in memory
+#define kOutboxDefaultDepth 16
+
+// Period of the drain job (ms) and messages sent each time it runs
+#define kOutboxDrainPeriod 250
+#define kOutboxBatchSize 4
+
+// Retry backoff (ms) after a failed send - doubles on each failure
+#define kOutboxRetryMin 1000
+#define kOutboxRetryMax 60000
+
+// A message that fails to send this many times is dropped
+#define kOutboxMaxAttempts 5
+
+// read buffer size used when replaying spilled messages
+#define kOutboxReadChunk 256
+
+//----------------------------------------------------------------------------------
+// Interface implemented by the object that sends the messages
+class flxIOutboxSender
+{
+  public:
+    // Can messages be sent now - i.e. is the network connected?
+    virtual bool outboxReady(void) = 0;
+
+    // Send a message. The message can be binary - it's also null terminated for text messages.
+    // The route is destination specific (e.g. MQTT topic) and can be empty. Returns true on success.
+    virtual bool outboxSend(const char *message, size_t length, const char *route) = 0;
+};
+
+//----------------------------------------------------------------------------------
+class flxOutbox
+{
+  public:
+    flxOutbox(flxIOutboxSender *sender);
+    ~flxOutbox();
+
+    // Queue a message for sending. If the queue is full, the oldest message is spilled to
+    // the file system, or dropped if spilling isn't possible.
+    void enqueue(const char *message, const char *route = nullptr);
+    void enqueue(const uint8_t *data, size_t length, const char *route = nullptr);
+
+    // Set the context for the messages queued from now on. An empty context clears it.
+    void setContext(const uint8_t *data, size_t length);
+
+    // The destination has lost the context (a new session) - send it again before the next message
+    void resendContext(void);
+
+    // File system used to spill messages. The name (of the owner) is used for the spill filename.
+    void setFileSystem(flxIFileSystem *fs, const char *name);
+
+    // Number of messages held in memory
+    void setDepth(uint16_t depth);
+
+    // Messages waiting to be sent - in memory and spilled
+    uint32_t depth(void)
+    {
+        return _count + _nSpilled;
+    }
+
+    // Messages dropped - queue full with nowhere to spill, too large to spill, lost from a damaged
+    // spill file, or failed kOutboxMaxAttempts sends
+    uint32_t dropped(void)
+    {
+        return _nDropped;
+    }
+
+    // Average time (ms) from queuing to sending for messages sent from memory
+    uint32_t latency(void)
+    {
+        return _nLatency > 0 ? (uint32_t)(_msLatencyTotal / _nLatency) : 0;
+    }
+
+    // Messages waiting in the spill file
+    uint32_t spilled(void)
+    {
+        return _nSpilled;
+    }
+
+    // Drain job callback - sends queued messages
+    void drain(void);
+
+  private:
+    typedef struct
+    {
+        std::string message;
+        std::string route;
+        uint32_t msQueued;
+    } flxOutboxEntry_t;
+
+    bool sendContext(const std::string &context, bool &bSent, const char *route);
+
+    bool spillOldest(void);
+    bool appendSpill(const flxOutboxEntry_t &entry);
+    bool writeSpillRecord(flxFSFile &theFile, uint16_t routeLength, const char *route, const std::string &message);
+    bool repairSpill(uint32_t validEnd);
+    bool nextSpilled(void);
+    bool readSpill(std::string *dest, size_t length);
+    bool readSpillHeader(size_t &routeLength, size_t &messageLength);
+    bool readSpillContext(size_t length);
+    void closeSpillRead(void);
+    void removeSpill(void);
+    uint32_t countSpilled(void);
+    void savePosition(void);
+    uint32_t loadPosition(void);
+
+    bool sendFailed(void);
+    void sendSucceeded(void);
+    void startDrain(void);
+
+    flxIOutboxSender *_sender;
+
+    // ring buffer of queued messages
+    std::vector<flxOutboxEntry_t> _queue;
+    uint16_t _head;
+    uint16_t _count;
+
+    // context - for queued messages, and for the spilled messages being replayed. Sent flags are set if
+    // the destination has that context.
+    std::string _context;
+    std::string _spillContext;
+    bool _bContextSent;
+    bool _bSpillContextSent;
+    bool _bContextSpilled;
+
+    // spill file state
+    flxIFileSystem *_fileSystem;
+    std::string _spillName;
+    std::string _positionName;
+    flxFSFile _spillRead;
+    uint32_t _spillOffset;
+    uint32_t _nSpilled;
+    std::string _spillHeader;
+    std::string _spillRoute;
+    std::string _spillMessage;
+    bool _haveSpillRecord;
+    uint32_t _spillRecordSize;
+    uint8_t _readBuffer[kOutboxReadChunk];
+    uint16_t _readPos;
+    uint16_t _readLength;
+
+    // retry/backoff - for the message at the front of the outbox
+    uint32_t _msRetry;
+    uint32_t _msFailed;
+    uint8_t _attempts;
+    bool _bBackoff;
+
+    // stats
+    uint32_t _nDropped;
+    uint64_t _msLatencyTotal;
+    uint32_t _nLatency;
+
+    flxJob _jobDrain;
+};
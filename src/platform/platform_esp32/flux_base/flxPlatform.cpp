@@ -10,6 +10,7 @@
 
 #include "flxPlatform.h"
 #include <Arduino.h>
+#include <esp_timer.h>
 // esp version of our platform class
 
 //---------------------------------------------------------------------------------
@@ -46,3 +47,9 @@ uint32_t flxPlatform::heap_free(void)
 {
     return ESP.getFreeHeap();
 }
+
+// monotonic time - the esp timer is 64 bit, in us
+uint64_t flxPlatform::micros64(void)
+{
+    return (uint64_t)esp_timer_get_time();
+}
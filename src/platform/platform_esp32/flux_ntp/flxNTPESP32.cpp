@@ -15,6 +15,7 @@
 #include "esp_netif.h"
 #include "lwip/apps/sntp.h"
 #include "time.h"
+#include <sys/time.h>
 
 //----------------------------------------------------------------
 // Enabled Property setter/getters
@@ -150,6 +151,13 @@ uint32_t flxNTPESP32::get_epoch(void)
     return now;
 }
 
+flxTimestamp_t flxNTPESP32::get_epoch_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (flxTimestamp_t)tv.tv_sec * kTimestampUSPerSecond + tv.tv_usec;
+}
+
 bool flxNTPESP32::valid_epoch(void)
 {
     return _isEnabled && sntp_enabled();
@@ -68,6 +68,12 @@ class flxNTPESP32 : public flxActionType<flxNTPESP32>, public flxIClock
     // Note - the NTP updates run in the background for the ESP32
 
     uint32_t get_epoch(void);
+    flxTimestamp_t get_epoch_us(void);
+    uint32_t epoch_resolution_us(void)
+    {
+        // SNTP sets the system time - good to about a millisecond
+        return 1000;
+    }
     void set_epoch(const uint32_t &)
     {
     }
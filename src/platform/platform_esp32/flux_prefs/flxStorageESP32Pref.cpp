@@ -43,14 +43,14 @@ static bool tag_is_valid(const char *tag)
 // ESP32 preference library
 
 // Write out a bool value
-bool flxStorageESP32Block::writeBool(const char *tag, bool value)
+bool flxStorageESP32Block::writeBool(const flxStorageTag &tag, bool value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putBool(szHash, value) > 0);
@@ -58,14 +58,14 @@ bool flxStorageESP32Block::writeBool(const char *tag, bool value)
 //------------------------------------------------------------------------
 // write out an int8 value
 
-bool flxStorageESP32Block::writeInt8(const char *tag, int8_t value)
+bool flxStorageESP32Block::writeInt8(const flxStorageTag &tag, int8_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putChar(szHash, value) > 0);
@@ -74,14 +74,14 @@ bool flxStorageESP32Block::writeInt8(const char *tag, int8_t value)
 //------------------------------------------------------------------------
 // write out an int16 value
 
-bool flxStorageESP32Block::writeInt16(const char *tag, int16_t value)
+bool flxStorageESP32Block::writeInt16(const flxStorageTag &tag, int16_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putShort(szHash, value) > 0);
@@ -90,14 +90,14 @@ bool flxStorageESP32Block::writeInt16(const char *tag, int16_t value)
 //------------------------------------------------------------------------
 // write out a int value
 
-bool flxStorageESP32Block::writeInt32(const char *tag, int32_t value)
+bool flxStorageESP32Block::writeInt32(const flxStorageTag &tag, int32_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putInt(szHash, value) > 0);
@@ -105,14 +105,14 @@ bool flxStorageESP32Block::writeInt32(const char *tag, int32_t value)
 //------------------------------------------------------------------------
 // Unsigned int8  - aka uchar
 
-bool flxStorageESP32Block::writeUInt8(const char *tag, uint8_t value)
+bool flxStorageESP32Block::writeUInt8(const flxStorageTag &tag, uint8_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putUChar(szHash, value) > 0);
@@ -121,28 +121,28 @@ bool flxStorageESP32Block::writeUInt8(const char *tag, uint8_t value)
 //------------------------------------------------------------------------
 // Unsigned int16  - aka ushort
 
-bool flxStorageESP32Block::writeUInt16(const char *tag, uint16_t value)
+bool flxStorageESP32Block::writeUInt16(const flxStorageTag &tag, uint16_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putUShort(szHash, value) > 0);
 }
 
 //------------------------------------------------------------------------
-bool flxStorageESP32Block::writeUInt32(const char *tag, uint32_t value)
+bool flxStorageESP32Block::writeUInt32(const flxStorageTag &tag, uint32_t value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putUInt(szHash, value) > 0);
@@ -150,14 +150,14 @@ bool flxStorageESP32Block::writeUInt32(const char *tag, uint32_t value)
 //------------------------------------------------------------------------
 // write out a float
 
-bool flxStorageESP32Block::writeFloat(const char *tag, float value)
+bool flxStorageESP32Block::writeFloat(const flxStorageTag &tag, float value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putFloat(szHash, value) > 0);
@@ -165,23 +165,23 @@ bool flxStorageESP32Block::writeFloat(const char *tag, float value)
 //------------------------------------------------------------------------
 // double
 
-bool flxStorageESP32Block::writeDouble(const char *tag, double value)
+bool flxStorageESP32Block::writeDouble(const flxStorageTag &tag, double value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putDouble(szHash, value) > 0);
 }
 //------------------------------------------------------------------------
 // Write out a c string
-bool flxStorageESP32Block::writeString(const char *tag, const char *value)
+bool flxStorageESP32Block::writeString(const flxStorageTag &tag, const char *value)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     // the value length is 0, just return true. Otherwise the esp pref system
@@ -192,7 +192,7 @@ bool flxStorageESP32Block::writeString(const char *tag, const char *value)
 
     char szHash[kESP32HashTagSize] = {0};
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putString(szHash, value) > 0);
@@ -201,9 +201,9 @@ bool flxStorageESP32Block::writeString(const char *tag, const char *value)
 //------------------------------------------------------------------------
 // Write out an array of bytes
 
-bool flxStorageESP32Block::writeBytes(const char *tag, const uint8_t *value, size_t len)
+bool flxStorageESP32Block::writeBytes(const flxStorageTag &tag, const uint8_t *value, size_t len)
 {
-    if (!tag_is_valid(tag) || !_prefs || _readOnly)
+    if (!tag_is_valid(tag.name()) || !_prefs || _readOnly)
         return false;
 
     // the value length is 0, just return true. Otherwise the esp pref system
@@ -214,7 +214,7 @@ bool flxStorageESP32Block::writeBytes(const char *tag, const uint8_t *value, siz
 
     char szHash[kESP32HashTagSize] = {0};
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return (_prefs->putBytes(szHash, (void *)value, len) > 0);
@@ -223,14 +223,14 @@ bool flxStorageESP32Block::writeBytes(const char *tag, const uint8_t *value, siz
 // Read value section
 //------------------------------------------------------------------------
 
-bool flxStorageESP32Block::readBool(const char *tag, bool &value)
+bool flxStorageESP32Block::readBool(const flxStorageTag &tag, bool &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -241,14 +241,14 @@ bool flxStorageESP32Block::readBool(const char *tag, bool &value)
     return true;
 }
 //------------------------------------------------------------------------
-bool flxStorageESP32Block::readInt8(const char *tag, int8_t &value)
+bool flxStorageESP32Block::readInt8(const flxStorageTag &tag, int8_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -260,14 +260,14 @@ bool flxStorageESP32Block::readInt8(const char *tag, int8_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageESP32Block::readInt16(const char *tag, int16_t &value)
+bool flxStorageESP32Block::readInt16(const flxStorageTag &tag, int16_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -279,14 +279,14 @@ bool flxStorageESP32Block::readInt16(const char *tag, int16_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageESP32Block::readInt32(const char *tag, int32_t &value)
+bool flxStorageESP32Block::readInt32(const flxStorageTag &tag, int32_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -298,14 +298,14 @@ bool flxStorageESP32Block::readInt32(const char *tag, int32_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageESP32Block::readUInt8(const char *tag, uint8_t &value)
+bool flxStorageESP32Block::readUInt8(const flxStorageTag &tag, uint8_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -317,14 +317,14 @@ bool flxStorageESP32Block::readUInt8(const char *tag, uint8_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageESP32Block::readUInt16(const char *tag, uint16_t &value)
+bool flxStorageESP32Block::readUInt16(const flxStorageTag &tag, uint16_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -336,14 +336,14 @@ bool flxStorageESP32Block::readUInt16(const char *tag, uint16_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageESP32Block::readUInt32(const char *tag, uint32_t &value)
+bool flxStorageESP32Block::readUInt32(const flxStorageTag &tag, uint32_t &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -355,14 +355,14 @@ bool flxStorageESP32Block::readUInt32(const char *tag, uint32_t &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageESP32Block::readFloat(const char *tag, float &value)
+bool flxStorageESP32Block::readFloat(const flxStorageTag &tag, float &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -374,14 +374,14 @@ bool flxStorageESP32Block::readFloat(const char *tag, float &value)
 }
 
 //------------------------------------------------------------------------
-bool flxStorageESP32Block::readDouble(const char *tag, double &value)
+bool flxStorageESP32Block::readDouble(const flxStorageTag &tag, double &value)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     if (!_prefs->isKey(szHash))
@@ -393,14 +393,14 @@ bool flxStorageESP32Block::readDouble(const char *tag, double &value)
 }
 
 //------------------------------------------------------------------------
-size_t flxStorageESP32Block::readString(const char *tag, char *data, size_t len)
+size_t flxStorageESP32Block::readString(const flxStorageTag &tag, char *data, size_t len)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return 0;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return 0;
 
     if (!_prefs->isKey(szHash))
@@ -409,14 +409,14 @@ size_t flxStorageESP32Block::readString(const char *tag, char *data, size_t len)
     return _prefs->getString(szHash, data, len);
 }
 //------------------------------------------------------------------------------
-size_t flxStorageESP32Block::getStringLength(const char *tag)
+size_t flxStorageESP32Block::getStringLength(const flxStorageTag &tag)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return 0;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return 0;
 
     if (!_prefs->isKey(szHash))
@@ -427,14 +427,14 @@ size_t flxStorageESP32Block::getStringLength(const char *tag)
     return tmp.length();
 }
 //------------------------------------------------------------------------
-size_t flxStorageESP32Block::readBytes(const char *tag, uint8_t *data, size_t len)
+size_t flxStorageESP32Block::readBytes(const flxStorageTag &tag, uint8_t *data, size_t len)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return 0;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return 0;
 
     if (!_prefs->isKey(szHash))
@@ -445,14 +445,14 @@ size_t flxStorageESP32Block::readBytes(const char *tag, uint8_t *data, size_t le
     return _prefs->getBytes(szHash, data, (nBytes < len ? nBytes : len));
 }
 //------------------------------------------------------------------------------
-size_t flxStorageESP32Block::getBytesLength(const char *tag)
+size_t flxStorageESP32Block::getBytesLength(const flxStorageTag &tag)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return 0;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return 0;
 
     if (!_prefs->isKey(szHash))
@@ -461,14 +461,14 @@ size_t flxStorageESP32Block::getBytesLength(const char *tag)
     return _prefs->getBytesLength(szHash);
 }
 //------------------------------------------------------------------------------
-bool flxStorageESP32Block::valueExists(const char *tag)
+bool flxStorageESP32Block::valueExists(const flxStorageTag &tag)
 {
-    if (!tag_is_valid(tag) || !_prefs)
+    if (!tag_is_valid(tag.name()) || !_prefs)
         return false;
 
     char szHash[kESP32HashTagSize];
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return false;
 
     return _prefs->isKey(szHash);
@@ -536,14 +536,14 @@ flxStorageESP32Pref::flxStorageESP32Pref() : _readOnly{false}
 }
 
 // public methods to manage a block
-flxStorageESP32Block *flxStorageESP32Pref::beginBlock(const char *tag)
+flxStorageESP32Block *flxStorageESP32Pref::beginBlock(const flxStorageTag &tag)
 {
-    if (!tag_is_valid(tag))
+    if (!tag_is_valid(tag.name()))
         return nullptr;
 
     char szHash[kESP32HashTagSize] = {0};
 
-    if (!flx_utils::id_hash_string_to_string(tag, szHash, sizeof(szHash)))
+    if (!tag.key(szHash, sizeof(szHash)))
         return nullptr;
 
     if (!_prefs.begin(szHash, false))
@@ -556,7 +556,7 @@ flxStorageESP32Block *flxStorageESP32Pref::beginBlock(const char *tag)
     return &_theBlock;
 }
 
-flxStorageESP32Block *flxStorageESP32Pref::getBlock(const char *tag)
+flxStorageESP32Block *flxStorageESP32Pref::getBlock(const flxStorageTag &tag)
 {
 
     return beginBlock(tag);
@@ -35,34 +35,34 @@ class flxStorageESP32Block : public flxStorageBlock
   public:
     flxStorageESP32Block() : _prefs{nullptr}, _readOnly{false} {};
 
-    bool writeBool(const char *tag, bool data);
-    bool writeInt8(const char *tag, int8_t data);
-    bool writeInt16(const char *tag, int16_t data);
-    bool writeInt32(const char *tag, int32_t data);
-    bool writeUInt8(const char *tag, uint8_t data);
-    bool writeUInt16(const char *tag, uint16_t data);
-    bool writeUInt32(const char *tag, uint32_t data);
-    bool writeFloat(const char *tag, float data);
-    bool writeDouble(const char *tag, double data);
-    bool writeString(const char *tag, const char *data);
-    bool writeBytes(const char *tag, const uint8_t *data, size_t len);
-
-    bool readBool(const char *tag, bool &value);
-    bool readInt8(const char *tag, int8_t &value);
-    bool readInt16(const char *tag, int16_t &value);
-    bool readInt32(const char *tag, int32_t &value);
-    bool readUInt8(const char *tag, uint8_t &value);
-    bool readUInt16(const char *tag, uint16_t &value);
-    bool readUInt32(const char *tag, uint32_t &value);
-    bool readFloat(const char *tag, float &value);
-    bool readDouble(const char *tag, double &value);
-    size_t readString(const char *tag, char *data, size_t len);
-    size_t readBytes(const char *tag, uint8_t *data, size_t len);
-
-    size_t getStringLength(const char *tag);
-    size_t getBytesLength(const char *tag);
-
-    bool valueExists(const char *tag);
+    bool writeBool(const flxStorageTag &tag, bool data);
+    bool writeInt8(const flxStorageTag &tag, int8_t data);
+    bool writeInt16(const flxStorageTag &tag, int16_t data);
+    bool writeInt32(const flxStorageTag &tag, int32_t data);
+    bool writeUInt8(const flxStorageTag &tag, uint8_t data);
+    bool writeUInt16(const flxStorageTag &tag, uint16_t data);
+    bool writeUInt32(const flxStorageTag &tag, uint32_t data);
+    bool writeFloat(const flxStorageTag &tag, float data);
+    bool writeDouble(const flxStorageTag &tag, double data);
+    bool writeString(const flxStorageTag &tag, const char *data);
+    bool writeBytes(const flxStorageTag &tag, const uint8_t *data, size_t len);
+
+    bool readBool(const flxStorageTag &tag, bool &value);
+    bool readInt8(const flxStorageTag &tag, int8_t &value);
+    bool readInt16(const flxStorageTag &tag, int16_t &value);
+    bool readInt32(const flxStorageTag &tag, int32_t &value);
+    bool readUInt8(const flxStorageTag &tag, uint8_t &value);
+    bool readUInt16(const flxStorageTag &tag, uint16_t &value);
+    bool readUInt32(const flxStorageTag &tag, uint32_t &value);
+    bool readFloat(const flxStorageTag &tag, float &value);
+    bool readDouble(const flxStorageTag &tag, double &value);
+    size_t readString(const flxStorageTag &tag, char *data, size_t len);
+    size_t readBytes(const flxStorageTag &tag, uint8_t *data, size_t len);
+
+    size_t getStringLength(const flxStorageTag &tag);
+    size_t getBytesLength(const flxStorageTag &tag);
+
+    bool valueExists(const flxStorageTag &tag);
 
     flxStorage::flxStorageKind_t kind(void)
     {
@@ -114,9 +114,9 @@ class flxStorageESP32Pref : public flxStorage
     }
 
     // public methods to manage a block
-    flxStorageESP32Block *beginBlock(const char *tag);
+    flxStorageESP32Block *beginBlock(const flxStorageTag &tag);
 
-    flxStorageESP32Block *getBlock(const char *tag);
+    flxStorageESP32Block *getBlock(const flxStorageTag &tag);
     void endBlock(flxStorageBlock *);
 
     void resetStorage();
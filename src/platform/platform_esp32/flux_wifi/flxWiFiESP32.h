@@ -56,7 +56,8 @@ class flxWiFiESP32 : public flxActionType<flxWiFiESP32>, public flxNetwork, publ
 
         flux.add(this);
 
-        _theJob.setup("WiFi", kWiFiUpdateHandlerTimeMS, this, &flxWiFiESP32::jobHandlerCB);
+        _theJob.setup("WiFi", kWiFiUpdateHandlerTimeMS, this, &flxWiFiESP32::jobHandlerCB, false,
+                      flxJobPriorityBackground);
     };
 
     // Properties
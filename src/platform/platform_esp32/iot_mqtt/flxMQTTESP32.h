@@ -15,14 +15,44 @@
 #include "flxCoreInterface.h"
 #include "flxFS.h"
 #include "flxFlux.h"
+#include "flxFmtMsgPack.h"
 #include "flxNetwork.h"
+#include "flxOutbox.h"
 
 #include <ArduinoMqttClient.h>
 #include <WiFiClientSecure.h>
 #include <WiFi.h>
 
+// Period (ms) of the connection job - runs the connection state machine and services the client
+#define kMQTTConnectionJobPeriod 500
+
+// Reconnect backoff (ms) - doubles after each failed attempt, plus up to 50% random jitter
+#define kMQTTBackoffMin 1000
+#define kMQTTBackoffMax 120000
+
+// Time (ms) to wait for the broker on each connection attempt
+#define kMQTTConnectTimeout 5000
+
+// Time (ms) allowed for the TCP connect that checks the broker is reachable, before a connection attempt
+#define kMQTTProbeTimeout 1000
+
+// Time (seconds) allowed for the TLS handshake of the secure client - the WiFiClientSecure default is 120 s
+#define kMQTTHandshakeTimeout 5
+
+#define kMQTTKeepAliveDefault 60
+
+// Connection states
+typedef enum
+{
+    kMQTTConnIdle,      // not enabled, or no network
+    kMQTTConnWaiting,   // waiting to (re)connect
+    kMQTTConnReachable, // the broker accepted a TCP connection - connect on the next run
+    kMQTTConnConnected, // connected to the broker
+} flxMQTTConnState_t;
+
 // A General MQTT client for the framework - for use on the ESP32
-template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActionType<Object>
+template <class Object, typename CLIENT>
+class flxMQTTESP32Base : public flxActionType<Object>, public flxIOutboxSender
 {
   private:
     // Enabled Property setter/getters
@@ -34,11 +64,14 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
 
         _isEnabled = bEnabled;
 
-        // TODO check network connection availability ...
+        // The connection is made from the connection job
         if (_isEnabled)
-            (void)connect();
+            resetBackoff();
         else
+        {
             disconnect();
+            _connState = kMQTTConnIdle;
+        }
     }
 
     //----------------------------------------------------------------
@@ -63,6 +96,33 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
         return _txBufferSize;
     }
 
+    //----------------------------------------------------------------------------
+    void set_outboxSize(uint16_t size)
+    {
+        _outbox.setDepth(size);
+        _outboxSize = size;
+    }
+    //----------------------------------------------------------------------------
+    uint16_t get_outboxSize(void)
+    {
+        return _outboxSize;
+    }
+
+    // Outbox output parameters
+    //----------------------------------------------------------------------------
+    uint32_t get_outboxDepth(void)
+    {
+        return _outbox.depth();
+    }
+    uint32_t get_outboxDropped(void)
+    {
+        return _outbox.dropped();
+    }
+    uint32_t get_outboxLatency(void)
+    {
+        return _outbox.latency();
+    }
+
     // Event callback
     //----------------------------------------------------------------------------
     void onConnectionChange(bool bConnected)
@@ -75,23 +135,152 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
         if (bConnected == connected())
             return;
 
+        // On a new network connection, connect to the broker on the next run of the
+        // connection job
         if (bConnected)
-        {
-            flxLog_I_(F("%s: connecting to MQTT endpoint %s:%u ..."), this->name(), server().c_str(), port());
-            if (connect())
-                flxLog_N(F("connected"));
-            // the connect method will print out sufficient error messages
-        }
+            resetBackoff();
         else
         {
             flxLog_I(F("Disconnecting from MQTT endpoint %s"), clientName().c_str());
             disconnect();
+            _connState = kMQTTConnIdle;
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    bool publish(const char *message, size_t length, const char *route)
+    {
+        // the mqtt object has a limited transmit buffer size (256) that doesn't adapt,
+        // but you can set the size (which performs a malloc and free)
+        //
+        // Openlog payloads can be large, so if in dynamic mode we keep track of the
+        // allocated size and increase when needed if in dynamic buffer size mode ..
+
+        if (_txBufferSize == 0 && _dynamicBufferSize < length)
+        {
+            _dynamicBufferSize = length;
+            _mqttClient.setTxPayloadSize(_dynamicBufferSize);
         }
+
+        // send the message
+        if (!_mqttClient.beginMessage(route, false, qos()))
+            return false;
+
+        _mqttClient.write((const uint8_t *)message, length);
+
+        return _mqttClient.endMessage() != 0;
+    }
+
+    //----------------------------------------------------------------------------
+    void resetBackoff(void)
+    {
+        _msBackoff = 0;
+        _msNextConnect = millis();
+    }
+
+    //----------------------------------------------------------------------------
+    // A TCP connect to the broker, bounded by kMQTTProbeTimeout. A plain TCP client is used for the
+    // secure client too - this only checks the broker is reachable.
+    bool probeBroker(void)
+    {
+        WiFiClient probeClient;
+
+        bool bReachable = probeClient.connect(server().c_str(), port(), kMQTTProbeTimeout) != 0;
+        probeClient.stop();
+
+        return bReachable;
+    }
+
+    //----------------------------------------------------------------------------
+    void connectFailed(void)
+    {
+        _connState = kMQTTConnWaiting;
+        _msBackoff = _msBackoff == 0 ? kMQTTBackoffMin : std::min((uint32_t)kMQTTBackoffMax, _msBackoff * 2);
+
+        // jitter keeps a group of devices from retrying in lock step
+        _msNextConnect = millis() + _msBackoff + random(_msBackoff / 2 + 1);
+    }
+
+    //----------------------------------------------------------------------------
+    // Connection job callback - the connection state machine.
+    //
+    // Connection attempts are only made from here, with an exponential backoff (plus jitter) between
+    // failed attempts. So the logging path (write()) never blocks on a connection to the broker.
+    //
+    // An attempt is two steps, each in its own run of the job:
+    //      probe   - a TCP connect to the broker, bounded by kMQTTProbeTimeout (plus the DNS lookup)
+    //      connect - the session connect, ArduinoMqttClient::connect()
+    //
+    // Each step blocks the main loop - jobs run from it - so this is bounded blocking, not non-blocking.
+    // A broker that is down or unreachable fails the probe, and delays other jobs by up to
+    // kMQTTProbeTimeout. The session connect is only made once the probe succeeds. It connects again,
+    // does the TLS handshake (secure client - kMQTTHandshakeTimeout) and waits for the broker to accept
+    // the session (kMQTTConnectTimeout) - so a broker that accepts the connection but doesn't respond
+    // still blocks for up to about 10 seconds. The backoff limits either case to one attempt every two
+    // minutes.
+    void connectionLoop(void)
+    {
+        if (!_isEnabled || !_theNetwork || !_theNetwork->isConnected())
+        {
+            _connState = kMQTTConnIdle;
+            return;
+        }
+
+        if (connected())
+        {
+            // services keep alive pings and incoming packets
+            _mqttClient.poll();
+            return;
+        }
+
+        // lost the broker?
+        if (_connState == kMQTTConnConnected)
+        {
+            flxLog_W(F("%s: disconnected from MQTT endpoint %s"), this->name(), server().c_str());
+            disconnect();
+            resetBackoff();
+        }
+        if (_connState != kMQTTConnReachable)
+            _connState = kMQTTConnWaiting;
+
+        // in backoff?
+        if ((int32_t)(millis() - _msNextConnect) < 0)
+            return;
+
+        // Probe first - connect on the next run. Without a server, connect() reports the error
+        if (_connState == kMQTTConnWaiting && server().length() > 0)
+        {
+            if (probeBroker())
+                _connState = kMQTTConnReachable;
+            else
+            {
+                flxLog_W(F("%s: MQTT endpoint %s:%u not reachable"), this->name(), server().c_str(), port());
+                connectFailed();
+            }
+            return;
+        }
+
+        flxLog_I_(F("%s: connecting to MQTT endpoint %s:%u ..."), this->name(), server().c_str(), port());
+        if (connect())
+        {
+            flxLog_N(F("connected"));
+            _connState = kMQTTConnConnected;
+            _msBackoff = 0;
+
+            // new session - the broker/subscribers need the MessagePack dictionary again
+            _outbox.resendContext();
+            return;
+        }
+        // the connect method will print out sufficient error messages
+
+        connectFailed();
     }
 
   public:
     flxMQTTESP32Base()
-        : _isEnabled{false}, _theNetwork{nullptr}, _mqttClient(_wifiClient), _txBufferSize{0}, _dynamicBufferSize{0}
+        : _isEnabled{false}, _theNetwork{nullptr}, _mqttClient(_wifiClient), _txBufferSize{0}, _dynamicBufferSize{0},
+          _outbox{this}, _outboxSize{kOutboxDefaultDepth}, _connState{kMQTTConnIdle}, _msBackoff{0},
+          _msNextConnect{0}
     {
         flxRegister(enabled, "Enabled", "Enable or Disable the MQTT Client");
 
@@ -104,10 +293,24 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
         flxRegister(password, "Password", "Password to connect to an MQTT broker, if required");
 
         flxRegister(bufferSize, "Buffer Size", "MQTT payload buffer size. If 0, the buffer size is dynamic");
+
+        flxRegister(payloadFormat, "Payload Format", "Format of the published data - JSON or MessagePack");
+        flxRegister(qos, "QoS", "The MQTT quality of service level used to publish messages");
+        flxRegister(keepAlive, "Keep Alive", "MQTT keep alive interval in seconds");
+        flxRegister(cleanSession, "Clean Session",
+                    "Start a new session on connect. If false, the broker resumes the previous session");
+        flxRegister(outboxSize, "Outbox Size", "Number of messages held in memory while waiting to be sent");
+
+        flxRegister(outboxDepth, "Outbox Depth", "Number of messages waiting to be sent");
+        flxRegister(outboxDropped, "Outbox Dropped", "Number of messages dropped");
+        flxRegister(outboxLatency, "Outbox Latency", "Average time from logging to sending a message (ms)");
     };
 
     ~flxMQTTESP32Base()
     {
+        if (_jobConnection.queued())
+            flxRemoveJobFromQueue(_jobConnection);
+
         disconnect();
     }
 
@@ -116,6 +319,20 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
         _theNetwork = theNetwork;
 
         flxRegisterEventCB(flxEvent::kOnConnectionChange, this, &flxMQTTESP32Base::onConnectionChange);
+
+        if (!_jobConnection.queued())
+        {
+            _jobConnection.setup("mqtt connection", kMQTTConnectionJobPeriod, this,
+                                 &flxMQTTESP32Base::connectionLoop, false, flxJobPriorityBackground);
+            flxAddJobToQueue(_jobConnection);
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    // If a file system is provided, messages are spilled to a file when the broker can't be reached
+    void setFileSystem(flxIFileSystem *fs)
+    {
+        _outbox.setFileSystem(fs, this->name());
     }
 
     bool connected()
@@ -133,6 +350,9 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
             _wifiClient.stop();
     }
     //----------------------------------------------------------------------------
+    // Make one attempt to connect to the broker. Called from the connection job, which
+    // handles retries, once the broker is reachable. Blocks until connected, or the attempt
+    // fails - see connectionLoop().
     virtual bool connect(void)
     {
 
@@ -163,23 +383,21 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
         // mqtt time
 
         _mqttClient.setId(clientName().c_str());
-        _mqttClient.setKeepAliveInterval(60 * 1000);
-        _mqttClient.setConnectionTimeout(20 * 1000);
+        _mqttClient.setKeepAliveInterval(keepAlive() * 1000);
+        _mqttClient.setConnectionTimeout(kMQTTConnectTimeout);
+
+        // Resuming a session needs a stable client name
+        _mqttClient.setCleanSession(cleanSession());
 
         // Username/password provided?
         if (username().length() > 0 && password().length() > 0)
             _mqttClient.setUsernamePassword(username().c_str(), password().c_str());
 
         // Connect
-        for (int i = 0; !_mqttClient.connect(server().c_str(), port()); i++)
+        if (!_mqttClient.connect(server().c_str(), port()))
         {
-            if (i > 3)
-            {
-                flxLogM_E(kMsgErrConnectionFailureD, this->name(), _mqttClient.connectError());
-                return false;
-            }
-            flxLog_N_(".");
-            delay(400);
+            flxLogM_E(kMsgErrConnectionFailureD, this->name(), _mqttClient.connectError());
+            return false;
         }
 
         // we're connected
@@ -188,48 +406,81 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
 
     //----------------------------------------------------------------------------
     // flxWriter interface method
+    //
+    // The message is queued in the outbox, which sends it from a background job. This
+    // keeps network delays out of the logging path.
     virtual void write(const char *value, bool newline, flxLineType_t type)
     {
 
         // Should we continue?
         // enabled? Have a value to send? We only deal with JSON - just the data
-        if (!_isEnabled || !value || type != flxLineTypeData)
+        if (!_isEnabled || !value || type != flxLineTypeData || payloadFormat() != kPayloadFormatJSON)
             return;
 
-        // If we lost the connection to the broker, try to reconnect...
-        if (!_mqttClient.connected() || !_wifiClient.connected())
+        // do we have a topic?
+        if (topic().length() == 0)
         {
-            flxLog_W_(F("%s disconnected - reconnecting..."), this->name());
-            if (!connect())
-                return;
-
-            flxLog_N(F("reconnected"));
+            flxLog_E(kMsgErrValueNotProvided, this->name(), "MQTT Topic");
+            return;
         }
 
-        // do we have a topic?
+        // The topic is queued with the message - some clients change it for each message
+        _outbox.enqueue(value, topic().c_str());
+    }
+
+    //----------------------------------------------------------------------------
+    // flxWriter binary interface methods - used for MessagePack output (flxFormatMsgPack)
+    bool acceptsBinary(void)
+    {
+        return payloadFormat() == kPayloadFormatMsgPack;
+    }
+
+    //----------------------------------------------------------------------------
+    void writeBytes(const uint8_t *data, size_t length, flxLineType_t type)
+    {
+        if (!_isEnabled || !data || payloadFormat() != kPayloadFormatMsgPack)
+            return;
+
         if (topic().length() == 0)
         {
             flxLog_E(kMsgErrValueNotProvided, this->name(), "MQTT Topic");
             return;
         }
 
-        // the mqtt object has a limited transmit buffer size (256) that doesn't adapt,
-        // but you can set the size (which performs a malloc and free)
-        //
-        // Openlog payloads can be large, so if in dynamic mode we keep track of the
-        // allocated size and increase when needed if in dynamic buffer size mode ..
-
-        if (_txBufferSize == 0 && _dynamicBufferSize < strlen(value))
+        // The dictionary is the outbox context - published ahead of the data that follows it, and again at
+        // the start of each session. Ids are stable in a run, so the latest dictionary covers what's queued in
+        // memory. Spilled data keeps the dictionary it was logged with, so a replay after a restart is decoded
+        // with the right names.
+        if (type == flxLineTypeHeader)
         {
-            _dynamicBufferSize = strlen(value);
-            _mqttClient.setTxPayloadSize(_dynamicBufferSize);
+            _outbox.setContext(data, length);
+            return;
         }
+        if (type != flxLineTypeData)
+            return;
 
-        // send the message
-        _mqttClient.beginMessage(topic().c_str());
-        _mqttClient.print(value);
-        _mqttClient.endMessage();
+        _outbox.enqueue(data, length, topic().c_str());
+    }
+
+    //----------------------------------------------------------------------------
+    // flxIOutboxSender interface methods
+    //
+    // Messages are only sent when connected - reconnecting is left to the connection job.
+    bool outboxReady(void)
+    {
+        return connected();
+    }
+
+    //----------------------------------------------------------------------------
+    bool outboxSend(const char *message, size_t length, const char *route)
+    {
+        if (!connected())
+            return false;
+
+        return publish(message, length, route);
     }
+
+
     // Properties
 
     // Enabled/Disabled
@@ -244,10 +495,29 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
     flxPropertyRWUInt16<flxMQTTESP32Base, &flxMQTTESP32Base::get_bufferSize, &flxMQTTESP32Base::set_bufferSize>
         bufferSize = {0};
 
+    // Payload format - JSON text, or MessagePack from a flxFormatMsgPack formatter
+    flxPropertyUInt8<flxMQTTESP32Base> payloadFormat = {
+        kPayloadFormatJSON, {{"JSON", kPayloadFormatJSON}, {"MessagePack", kPayloadFormatMsgPack}}};
+
+    // Quality of service. The message is sent again by the outbox if the publish fails
+    flxPropertyUInt8<flxMQTTESP32Base> qos = {0, {{"At most once (0)", 0}, {"At least once (1)", 1}}};
+
+    flxPropertyUInt16<flxMQTTESP32Base> keepAlive = {kMQTTKeepAliveDefault, 10, 1200};
+    flxPropertyBool<flxMQTTESP32Base> cleanSession = {true};
+
     // username and password properties - some brokers requires this
     flxPropertyString<flxMQTTESP32Base> username;
     flxPropertySecureString<flxMQTTESP32Base> password;
 
+    // Outbox size property
+    flxPropertyRWUInt16<flxMQTTESP32Base, &flxMQTTESP32Base::get_outboxSize, &flxMQTTESP32Base::set_outboxSize>
+        outboxSize = {kOutboxDefaultDepth, 1, 128};
+
+    // Outbox state
+    flxParameterOutUInt32<flxMQTTESP32Base, &flxMQTTESP32Base::get_outboxDepth> outboxDepth;
+    flxParameterOutUInt32<flxMQTTESP32Base, &flxMQTTESP32Base::get_outboxDropped> outboxDropped;
+    flxParameterOutUInt32<flxMQTTESP32Base, &flxMQTTESP32Base::get_outboxLatency> outboxLatency;
+
   protected:
     CLIENT _wifiClient;
 
@@ -260,6 +530,16 @@ template <class Object, typename CLIENT> class flxMQTTESP32Base : public flxActi
 
     uint16_t _txBufferSize;
     uint16_t _dynamicBufferSize;
+
+    // Messages waiting to be sent
+    flxOutbox _outbox;
+    uint16_t _outboxSize;
+
+    // connection state machine
+    flxMQTTConnState_t _connState;
+    uint32_t _msBackoff;
+    uint32_t _msNextConnect;
+    flxJob _jobConnection;
 };
 
 class flxMQTTESP32 : public flxMQTTESP32Base<flxMQTTESP32, WiFiClient>, public flxWriter
@@ -284,6 +564,14 @@ class flxMQTTESP32 : public flxMQTTESP32Base<flxMQTTESP32, WiFiClient>, public f
     {
         flxMQTTESP32Base::write(value, newline, type);
     }
+    bool acceptsBinary(void)
+    {
+        return flxMQTTESP32Base::acceptsBinary();
+    }
+    void writeBytes(const uint8_t *data, size_t length, flxLineType_t type)
+    {
+        flxMQTTESP32Base::writeBytes(data, length, type);
+    }
 };
 
 template <class Object> class flxMQTTESP32SecureCore : public flxMQTTESP32Base<Object, WiFiClientSecure>
@@ -520,6 +808,10 @@ template <class Object> class flxMQTTESP32SecureCore : public flxMQTTESP32Base<O
         if (_pClientKey != nullptr)
             flxMQTTESP32Base<Object, WiFiClientSecure>::_wifiClient.setPrivateKey(_pClientKey);
 
+        // A broker that accepts the TCP connection but stalls the handshake would otherwise block the
+        // main loop for two minutes
+        flxMQTTESP32Base<Object, WiFiClientSecure>::_wifiClient.setHandshakeTimeout(kMQTTHandshakeTimeout);
+
         return flxMQTTESP32Base<Object, WiFiClientSecure>::connect();
     }
 
@@ -527,6 +819,8 @@ template <class Object> class flxMQTTESP32SecureCore : public flxMQTTESP32Base<O
     void setFileSystem(flxIFileSystem *fs)
     {
         _fileSystem = fs;
+
+        flxMQTTESP32Base<Object, WiFiClientSecure>::setFileSystem(fs);
     }
 
     // Security certs/keys
@@ -591,5 +885,13 @@ class flxMQTTESP32Secure : public flxMQTTESP32SecureCore<flxMQTTESP32Secure>, pu
     {
         flxMQTTESP32Base::write(value, newline, type);
     }
+    bool acceptsBinary(void)
+    {
+        return flxMQTTESP32Base::acceptsBinary();
+    }
+    void writeBytes(const uint8_t *data, size_t length, flxLineType_t type)
+    {
+        flxMQTTESP32Base::writeBytes(data, length, type);
+    }
 };
 #endif
\ No newline at end of file
@@ -12,6 +12,7 @@
 
 #include <hardware/watchdog.h>
 #include <malloc.h>
+#include <pico/time.h>
 #include <pico/unique_id.h>
 
 // rpi version of our platform class
@@ -53,3 +54,9 @@ uint32_t flxPlatform::heap_free(void)
 
     return heap_size() - m.uordblks;
 }
+
+// monotonic time - the pico timer is 64 bit, in us
+uint64_t flxPlatform::micros64(void)
+{
+    return time_us_64();
+}
@@ -66,8 +66,8 @@ flxKVPStoreDeviceRP2::flxKVPStoreDeviceRP2(uint8_t *partitionStart, uint32_t seg
 
 flxKVPStoreDeviceRP2::~flxKVPStoreDeviceRP2()
 {
-    if (!_pData)
-        delete _pData;
+    if (_pData)
+        delete[] _pData;
 }
 
 void flxKVPStoreDeviceRP2::initialize(uint8_t *partitionStart, uint32_t segmentSize, uint32_t nSegments)
@@ -16,6 +16,10 @@
 //
 // The system is designed to mimic the ESP32 Preferences library, heavily borrowed/copied the design
 // pattern of that system.
+//
+// Note: The device holds one sector in RAM, and writes it to flash (an erase and a program of the whole
+// sector) when another sector is accessed or on flush. This isn't power loss safe - if power is lost
+// during the write, the sector is lost. The partition is a single sector, so there is no spare to write to.
 //----------------------------------------------------------
 #pragma once
 
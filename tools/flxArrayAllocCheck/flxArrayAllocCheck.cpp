@@ -0,0 +1,630 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxArrayAllocCheck - host check of the heap use of array output parameters. Counts the allocations
+// made reading array parameters the way the logger does (flxParameterOutArray::getArray()), for each way
+// a device reader method can provide its data, and checks the steady state makes none. Then logs
+// observations with the logger itself (flxLogger::logObservation()), and checks the same.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -fpermissive -w -Ihost -I../flxCSVBench/host -I../flxOutboxSim/host
+//          -I../../src/core/flux_base -I../../src/core/flux_prefs -I../../src/core/flux_logging
+//          -I../../src/core/flux_clock -I../../src/core/flux_file -I../flxBinaryRoundTrip/host
+//          -o flxArrayAllocCheck flxArrayAllocCheck.cpp ../../src/core/flux_logging/flxLogger.cpp
+//          ../../src/core/flux_logging/flxTimestamp.cpp ../../src/core/flux_clock/flxClock.cpp
+//          ../../src/core/flux_clock/flxTimebase.cpp ../../src/core/flux_base/flxCore.cpp
+//          ../../src/core/flux_base/flxCoreJobs.cpp ../../src/core/flux_base/flxUtils.cpp
+//          ../../src/core/flux_base/flxCoreMsg.cpp
+//
+// The host directory has a flxFlux.h stand-in without the devices. The other host stand-ins are shared
+// with flxCSVBench (mbedtls), flxOutboxSim and flxBinaryRoundTrip (last, so the framework headers are
+// found first). flxCoreMsg.cpp has the message table the log object refers to.
+//
+// Usage:
+//      flxArrayAllocCheck [-n reads]
+//
+// Readers checked:
+//      buffer  - fills the array buffer in place with buffer() (flxDevAMG8833, flxDevVL53L5)
+//      static  - a static array passed to set() with no copy (flxDevTMF882X)
+//      copy    - a local array passed to set(), which copies it. The length changes from read to read.
+//      string  - a string array passed to set() - each string is copied, so this allocates per read
+//
+// Logger checked - the CSV formatter, with a writer that drops the output. An operation with scalar
+// and array parameters, some with names too long for a short string, plus the ISO8601 timestamp and the
+// sample number. Once the row buffers and the value tag have grown, an observation makes no allocations.
+//
+// Exit status is 0 if all checks pass.
+//
+
+#include "flxCoreParam.h"
+#include "flxFmtCSV.h"
+#include "flxLogger.h"
+#include "flxPlatform.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//-------------------------------------------------------------------------------------
+// Allocation counting - every form of new and delete
+
+static uint32_t nAllocs = 0;
+static uint32_t nFrees = 0;
+
+static void *countedAlloc(size_t size)
+{
+    nAllocs++;
+    return malloc(size ? size : 1);
+}
+static void countedFree(void *ptr)
+{
+    if (ptr)
+        nFrees++;
+    free(ptr);
+}
+
+void *operator new(size_t size)
+{
+    void *ptr = countedAlloc(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void *operator new[](size_t size)
+{
+    void *ptr = countedAlloc(size);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size);
+}
+void operator delete(void *ptr) noexcept
+{
+    countedFree(ptr);
+}
+void operator delete[](void *ptr) noexcept
+{
+    countedFree(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+    countedFree(ptr);
+}
+void operator delete[](void *ptr, size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+//-------------------------------------------------------------------------------------
+// Host stand-in for the framework log - the parameters log an error if they have no object
+
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const int idFmt, ...)
+{
+    printf("    log message %d\n", idFmt);
+    return 0;
+}
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const char *fmt, ...)
+{
+    printf("    log message %s\n", fmt);
+    return 0;
+}
+flxLogging &flxLog = flxLogging::get();
+
+//-------------------------------------------------------------------------------------
+// Host stand-ins for the framework the logger uses - it adds itself to the framework, listens for time
+// zone changes and posts an activity event for each observation. Timestamps are from flxClock, which
+// has its monotonic time from the platform.
+
+static flxFlux theFlux;
+flxFlux &flux = theFlux;
+
+void flux_add(flxAction *theAction)
+{
+}
+
+_flxEventHub &flxEventHub = _flxEventHub::get();
+
+flxSignalBase *_flxEventHub::findSignal(uint32_t id)
+{
+    return nullptr;
+}
+void _flxEventHub::addSignal(uint32_t id, flxSignalBase *theSignal)
+{
+}
+void flxSendEvent(flxEvent::flxEventID_t id)
+{
+}
+bool flxPostEvent(flxEvent::flxEventID_t id)
+{
+    return true;
+}
+
+// Simulated clock - advanced for each observation
+static uint32_t simMillis = 0;
+
+unsigned long millis(void)
+{
+    return simMillis;
+}
+unsigned long micros(void)
+{
+    return simMillis * 1000;
+}
+void delay(unsigned long ms)
+{
+    simMillis += ms;
+}
+uint64_t flxPlatform::micros64(void)
+{
+    return (uint64_t)simMillis * 1000;
+}
+
+// Settings aren't saved - the secure string properties refer to these
+bool flxStorageBlock::saveSecureString(const flxStorageTag &tag, const char *data)
+{
+    return false;
+}
+bool flxStorageBlock::restoreSecureString(const flxStorageTag &tag, char *data, size_t len)
+{
+    return false;
+}
+
+//-------------------------------------------------------------------------------------
+static int nFailures = 0;
+
+#define CHECK(cond, ...)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            nFailures++;                                                                                               \
+            printf("    FAIL: ");                                                                                      \
+            printf(__VA_ARGS__);                                                                                       \
+            printf("\n");                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+//-------------------------------------------------------------------------------------
+// A device with array output parameters - one per way a reader can provide its data
+
+#define kTestMaxResults 36
+
+class testDevice : public _flxParameterContainer
+{
+  private:
+    // reader methods - declared before the parameters that use them
+
+    // Like flxDevAMG8833
+    bool read_buffer(flxDataArrayFloat *values)
+    {
+        float *pData = values->buffer(8, 8);
+        if (!pData)
+            return false;
+
+        for (size_t i = 0; i < 64; i++)
+            pData[i] = value(i);
+
+        return true;
+    }
+
+    // Like flxDevTMF882X
+    bool read_static(flxDataArrayInt16 *values)
+    {
+        static int16_t theValues[64];
+
+        for (size_t i = 0; i < 64; i++)
+            theValues[i] = value(i);
+
+        values->set(theValues, 4, 16, true); // don't copy
+        return true;
+    }
+
+    bool read_copy(flxDataArrayUInt32 *values)
+    {
+        uint32_t theValues[kTestMaxResults];
+
+        uint16_t length = copyLength();
+        for (size_t i = 0; i < length; i++)
+            theValues[i] = value(i);
+
+        values->set(theValues, length);
+        return true;
+    }
+
+    bool read_string(flxDataArrayString *values)
+    {
+        char szValues[3][16];
+        char *pValues[3];
+
+        for (size_t i = 0; i < 3; i++)
+        {
+            snprintf(szValues[i], sizeof(szValues[i]), "%u", value(i));
+            pValues[i] = szValues[i];
+        }
+        values->set(pValues, 3);
+        return true;
+    }
+
+
+  public:
+    testDevice() : _nRead{0}
+    {
+        flxRegister(bufferValues, "Buffer");
+        flxRegister(staticValues, "Static");
+        flxRegister(copyValues, "Copy");
+        flxRegister(stringValues, "String");
+    }
+
+    flxParameterOutArrayFloat<testDevice, &testDevice::read_buffer> bufferValues;
+    flxParameterOutArrayInt16<testDevice, &testDevice::read_static> staticValues;
+    flxParameterOutArrayUInt32<testDevice, &testDevice::read_copy> copyValues;
+    flxParameterOutArrayString<testDevice, &testDevice::read_string> stringValues;
+
+    // The value of an element - changes with each read
+    uint32_t value(size_t i)
+    {
+        return _nRead * 100 + i;
+    }
+
+    // The number of elements of the copy reader - changes with each read
+    uint16_t copyLength(void)
+    {
+        return 1 + _nRead % kTestMaxResults;
+    }
+
+    void next(void)
+    {
+        _nRead++;
+    }
+
+    // called by the parameters - a device marks its settings as changed
+    void setIsDirty(void)
+    {
+    }
+
+  private:
+    uint32_t _nRead;
+};
+
+//-------------------------------------------------------------------------------------
+// Check the values read are the ones the device set
+
+static bool checkValues(testDevice &device, flxDataArrayFloat *values)
+{
+    if (!values || values->n_dimensions() != 2 || values->size() != 64)
+        return false;
+    for (size_t i = 0; i < 64; i++)
+        if (values->get()[i] != (float)device.value(i))
+            return false;
+    return true;
+}
+
+static bool checkValues(testDevice &device, flxDataArrayInt16 *values)
+{
+    if (!values || values->n_dimensions() != 2 || values->size() != 64)
+        return false;
+    for (size_t i = 0; i < 64; i++)
+        if (values->get()[i] != (int16_t)device.value(i))
+            return false;
+    return true;
+}
+
+static bool checkValues(testDevice &device, flxDataArrayUInt32 *values)
+{
+    if (!values || values->size() != device.copyLength())
+        return false;
+    for (size_t i = 0; i < values->size(); i++)
+        if (values->get()[i] != device.value(i))
+            return false;
+    return true;
+}
+
+static bool checkValues(testDevice &device, flxDataArrayString *values)
+{
+    if (!values || values->size() != 3)
+        return false;
+    char szValue[16];
+    for (size_t i = 0; i < 3; i++)
+    {
+        snprintf(szValue, sizeof(szValue), "%u", device.value(i));
+        if (!values->get()[i] || strcmp(values->get()[i], szValue) != 0)
+            return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Read a parameter n times, as the logger does (getArray()) and with the allocating get(), and report the
+// allocations per read in the steady state. The buffer grows to the largest array read, so the counts start
+// after a warm up - a cycle of the copy reader lengths.
+
+template <typename P>
+static void checkParameter(testDevice &device, P &param, const char *szName, uint32_t nReads, bool bAllocates)
+{
+    bool bValid = true;
+    for (uint32_t i = 0; i < kTestMaxResults; i++)
+    {
+        device.next();
+        bValid = bValid && checkValues(device, param.getArray());
+    }
+
+    uint32_t startAllocs = nAllocs;
+    for (uint32_t i = 0; i < nReads; i++)
+    {
+        device.next();
+        bValid = bValid && checkValues(device, param.getArray());
+    }
+    uint32_t arrayAllocs = nAllocs - startAllocs;
+
+    startAllocs = nAllocs;
+    for (uint32_t i = 0; i < nReads; i++)
+    {
+        device.next();
+        auto values = param.get();
+        bValid = bValid && checkValues(device, values);
+        delete values;
+    }
+    uint32_t getAllocs = nAllocs - startAllocs;
+
+    printf("  %-8s getArray(): %6.2f allocations per read    get(): %6.2f allocations per read\n", szName,
+           (double)arrayAllocs / nReads, (double)getAllocs / nReads);
+
+    CHECK(bValid, "%s - values read don't match the values set", szName);
+    if (bAllocates)
+        CHECK(arrayAllocs > 0, "%s - expected allocations", szName);
+    else
+        CHECK(arrayAllocs == 0, "%s - %u allocations in %u reads", szName, arrayAllocs, nReads);
+}
+
+//-------------------------------------------------------------------------------------
+// buffer() - new allocations are zeroed, and a smaller array reuses the buffer
+
+static void checkBuffer(void)
+{
+    printf("buffer\n");
+
+    flxDataArrayInt32 values;
+
+    int32_t *pData = values.buffer(4);
+    CHECK(pData && values.size() == 4, "buffer(4) failed");
+    for (int i = 0; pData && i < 4; i++)
+    {
+        CHECK(pData[i] == 0, "new buffer element %d not zero", i);
+        pData[i] = -1;
+    }
+
+    // grow - a new, zeroed allocation
+    uint32_t startAllocs = nAllocs;
+    pData = values.buffer(2, 5);
+    CHECK(nAllocs - startAllocs == 1, "growing the buffer made %u allocations", nAllocs - startAllocs);
+    for (int i = 0; pData && i < 10; i++)
+        CHECK(pData[i] == 0, "grown buffer element %d not zero", i);
+
+    // shrink - reused
+    startAllocs = nAllocs;
+    pData = values.buffer(2, 2, 2);
+    CHECK(pData && values.size() == 8 && values.n_dimensions() == 3, "buffer(2, 2, 2) failed");
+    CHECK(nAllocs == startAllocs, "a smaller buffer made %u allocations", nAllocs - startAllocs);
+
+    // no elements - no buffer
+    CHECK(values.buffer(0) == nullptr && values.size() == 0, "buffer(0) returned a buffer");
+}
+
+// String arrays own their strings - there's no buffer() to fill in place. Checked at compile time.
+template <typename A, typename = void> struct hasBuffer : std::false_type
+{
+};
+template <typename A> struct hasBuffer<A, decltype((void)std::declval<A &>().buffer(1))> : std::true_type
+{
+};
+static_assert(hasBuffer<flxDataArrayInt32>::value, "buffer() should be available for numeric arrays");
+static_assert(!hasBuffer<flxDataArrayString>::value, "buffer() should not be available for string arrays");
+
+//-------------------------------------------------------------------------------------
+// The logger - an operation logged with the CSV formatter, the output dropped
+
+class logDevice : public flxActionType<logDevice>
+{
+  private:
+    float read_temperature()
+    {
+        return 20.0 + _nRead % 10;
+    }
+    double read_pressure()
+    {
+        return 101325.0 + _nRead;
+    }
+    int32_t read_count()
+    {
+        return _nRead;
+    }
+    uint16_t read_status()
+    {
+        return _nRead & 0xFF;
+    }
+    bool read_valid()
+    {
+        return _nRead & 1;
+    }
+
+    // Like flxDevAMG8833
+    bool read_temperatures(flxDataArrayFloat *values)
+    {
+        float *pData = values->buffer(8, 8);
+        if (!pData)
+            return false;
+
+        for (size_t i = 0; i < 64; i++)
+            pData[i] = _nRead + i;
+
+        return true;
+    }
+
+    bool read_distances(flxDataArrayUInt32 *values)
+    {
+        uint32_t theValues[kTestMaxResults];
+
+        uint16_t length = 1 + _nRead % kTestMaxResults;
+        for (size_t i = 0; i < length; i++)
+            theValues[i] = _nRead + i;
+
+        values->set(theValues, length);
+        return true;
+    }
+
+  public:
+    logDevice() : _nRead{0}
+    {
+        setName("Log Device", "Values to log");
+
+        flxRegister(temperature, "Temperature (C)");
+        flxRegister(pressure, "Barometric Pressure (Pa)");
+        flxRegister(count, "Count");
+        flxRegister(status, "Device Status Register");
+        flxRegister(valid, "Valid");
+        flxRegister(temperatures, "Temperature Array (C)");
+        flxRegister(distances, "Distances (mm)");
+    }
+
+    bool execute(void)
+    {
+        _nRead++;
+        return true;
+    }
+
+    flxParameterOutFloat<logDevice, &logDevice::read_temperature> temperature;
+    flxParameterOutDouble<logDevice, &logDevice::read_pressure> pressure;
+    flxParameterOutInt32<logDevice, &logDevice::read_count> count;
+    flxParameterOutUInt16<logDevice, &logDevice::read_status> status;
+    flxParameterOutBool<logDevice, &logDevice::read_valid> valid;
+    flxParameterOutArrayFloat<logDevice, &logDevice::read_temperatures> temperatures;
+    flxParameterOutArrayUInt32<logDevice, &logDevice::read_distances> distances;
+
+  private:
+    uint32_t _nRead;
+};
+
+class nullWriter : public flxWriter
+{
+  public:
+    nullWriter() : nLines{0}
+    {
+    }
+    void write(int32_t value)
+    {
+    }
+    void write(float value)
+    {
+    }
+    void write(const char *value, bool newline, flxLineType_t type)
+    {
+        if (newline)
+            nLines++;
+    }
+
+    uint32_t nLines;
+};
+
+static void checkLogger(uint32_t nObservations)
+{
+    flxFormatCSV theFormat;
+    nullWriter theWriter;
+    logDevice device;
+    flxLogger theLogger;
+
+    theFormat.add(theWriter);
+    theLogger.add(theFormat);
+    theLogger.add(device);
+    theLogger.timestampMode = flxLogger::TimeStampISO8601TZ;
+    theLogger.numberMode = true;
+
+    // warm up - the row buffers and the value tag grow, and the copy reader lengths cycle
+    for (uint32_t i = 0; i < kTestMaxResults; i++)
+    {
+        theLogger.logObservation();
+        simMillis += 250;
+    }
+
+    uint32_t startLines = theWriter.nLines;
+    uint32_t startAllocs = nAllocs;
+    for (uint32_t i = 0; i < nObservations; i++)
+    {
+        theLogger.logObservation();
+        simMillis += 250;
+    }
+    uint32_t logAllocs = nAllocs - startAllocs;
+
+    printf("logger - %u observations\n", nObservations);
+    printf("  %-8s logObservation(): %6.2f allocations per observation\n", "csv", (double)logAllocs / nObservations);
+
+    CHECK(theWriter.nLines - startLines == nObservations, "logger - %u lines written for %u observations",
+          theWriter.nLines - startLines, nObservations);
+    CHECK(logAllocs == 0, "logger - %u allocations in %u observations", logAllocs, nObservations);
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-n reads]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t nReads = 10000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            nReads = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nReads == 0)
+        nReads = 1;
+
+    checkBuffer();
+
+    uint32_t startAllocs = nAllocs;
+    uint32_t startFrees = nFrees;
+    {
+        testDevice device;
+
+        printf("parameters - %u reads each\n", nReads);
+        checkParameter(device, device.bufferValues, "buffer", nReads, false);
+        checkParameter(device, device.staticValues, "static", nReads, false);
+        checkParameter(device, device.copyValues, "copy", nReads, false);
+        checkParameter(device, device.stringValues, "string", nReads, true);
+    }
+    CHECK(nAllocs - startAllocs == nFrees - startFrees, "leak - %u allocations, %u frees", nAllocs - startAllocs,
+          nFrees - startFrees);
+
+    checkLogger(nReads);
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}
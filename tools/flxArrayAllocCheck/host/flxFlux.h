@@ -0,0 +1,36 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for src/core/flux_base/flxFlux.h - the logger adds itself to the framework, and reads
+// the board ID and name. The devices and buses aren't needed.
+//
+
+#pragma once
+
+#include "flxCore.h"
+#include "flxCoreJobs.h"
+
+class flxFlux
+{
+  public:
+    const char *deviceId(void)
+    {
+        return "0123456789AB";
+    }
+    std::string localName(void)
+    {
+        return "flxArrayAllocCheck";
+    }
+};
+
+extern flxFlux &flux;
+
+void flux_add(flxAction *theAction);
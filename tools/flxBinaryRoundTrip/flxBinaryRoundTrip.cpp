@@ -0,0 +1,973 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxBinaryRoundTrip - host round trip test for the binary log format. Observations are encoded
+// with flxFormatBinary and decoded with the flxBinaryToCSV reader, and every field name, type,
+// dimension and value is compared to what was logged.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -fpermissive -w -Ihost -I../../src/core/flux_base -I../../src/core/flux_logging
+//          -I../flxBinaryToCSV -o flxBinaryRoundTrip flxBinaryRoundTrip.cpp host/flxHost.cpp
+//          ../flxBinaryToCSV/flxBinaryReader.cpp
+//
+// The host directory has stand-ins for the Arduino headers, and a flxCore.h with just the data types,
+// so the formatter builds without the rest of the framework. -fpermissive is for flxCoreEventID.h,
+// which casts a pointer to uint32_t - fine on the device, an error on a 64 bit host.
+//
+// Usage:
+//      flxBinaryRoundTrip [-n observations] [-s seed] [-f file]
+//
+//      -n observations number of random observations (default 2000)
+//      -s seed         random seed (default 1)
+//      -f file         write the random test output to a file - sample input for flxBinaryToCSV
+//
+// Tests:
+//      types   - every scalar type (limits, float/double specials, strings with CSV special characters,
+//                empty, null and over length strings), and arrays of every type - 1 to 3 dimensions,
+//                empty arrays and null strings in string arrays. Field names with and without a section.
+//      random  - observations with random layouts and values - the layout is kept for runs of
+//                observations, so cached and re-sent schemas (output_header) are both covered.
+//      damage  - a record in the random output is corrupted. The reader must skip just that record.
+//      rotate  - the output is split into files the way flxFileRotate does it - a new file is started
+//                after a block is written, and the format is asked for the schema (the kOnNewFile
+//                handler). Files start after a schema block, the sync block that follows it, and a record
+//                block. Each file must decode on its own - no record before the first schema in the file.
+//
+// Exit status is 0 if all checks pass.
+//
+
+#include "flxFmtBinary.h"
+
+#include "flxBinaryReader.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Collects the binary output of the formatter
+class memoryWriter : public flxWriter
+{
+  public:
+    void write(int32_t)
+    {
+    }
+    void write(float)
+    {
+    }
+    void write(const char *, bool, flxLineType_t)
+    {
+    }
+    bool acceptsBinary(void)
+    {
+        return true;
+    }
+    void writeBytes(const uint8_t *data, size_t length, flxLineType_t type)
+    {
+        bytes.insert(bytes.end(), data, data + length);
+    }
+
+    std::vector<uint8_t> bytes;
+};
+
+//-------------------------------------------------------------------------------------
+// What was logged - the expected result of decoding
+struct expectField
+{
+    uint8_t type;
+    std::vector<uint16_t> dims;
+    std::string name;
+    binaryFieldValues values;
+};
+
+struct expectObservation
+{
+    std::string title;
+    std::vector<expectField> fields;
+};
+
+//-------------------------------------------------------------------------------------
+// The expected decoded value of a logged value - integers at their size, float/double as their bits
+template <typename T> static binaryValue expectValue(T value)
+{
+    binaryValue expect;
+    expect.bits = (uint64_t)(typename std::make_unsigned<T>::type)value;
+    return expect;
+}
+template <> binaryValue expectValue(bool value)
+{
+    return binaryValue{value ? 1u : 0u, ""};
+}
+template <> binaryValue expectValue(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return binaryValue{bits, ""};
+}
+template <> binaryValue expectValue(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return binaryValue{bits, ""};
+}
+template <> binaryValue expectValue(char *value)
+{
+    std::string str = value ? value : "";
+    if (str.length() > kBinaryMaxString)
+        str.resize(kBinaryMaxString);
+    return binaryValue{0, str};
+}
+
+//-------------------------------------------------------------------------------------
+// Logs values through the formatter, and records what was logged
+class roundTrip
+{
+  public:
+    roundTrip()
+    {
+        format.add(writer);
+    }
+
+    void begin(const char *szTitle)
+    {
+        format.beginObservation(szTitle);
+        _current = expectObservation{szTitle ? szTitle : "", {}};
+    }
+
+    void section(const char *szName)
+    {
+        format.beginSection(szName);
+        _section = szName ? szName : "";
+    }
+
+    void endSection(void)
+    {
+        format.endSection();
+        _section.clear();
+    }
+
+    void write(void)
+    {
+        format.endObservation();
+        format.writeObservation();
+
+        // an observation with no values isn't written
+        if (_current.fields.size() > 0)
+            expected.push_back(_current);
+        _section.clear();
+    }
+
+    template <typename T> void scalar(const std::string &tag, T value)
+    {
+        format.logValue(tag, value);
+        add(tag, flxGetTypeOf<T>(), {}, {expectValue(value)});
+    }
+
+    void string(const std::string &tag, const char *value)
+    {
+        format.logValue(tag, value);
+        add(tag, flxTypeString, {}, {expectValue((char *)value)});
+    }
+
+    // dims - 1 to 3 dimensions, or none for an array that isn't set
+    template <typename T, typename A>
+    void array(const std::string &tag, A &theArray, T *data, const std::vector<uint16_t> &dims)
+    {
+        if (dims.size() == 1)
+            theArray.set(data, dims[0]);
+        else if (dims.size() == 2)
+            theArray.set(data, dims[0], dims[1]);
+        else if (dims.size() == 3)
+            theArray.set(data, dims[0], dims[1], dims[2]);
+
+        format.logValue(tag, &theArray);
+
+        // an array with no data is written as an empty, one dimension array
+        if (dims.size() == 0)
+        {
+            add(tag, theArray.type(), {0}, {});
+            return;
+        }
+
+        size_t count = 1;
+        for (uint16_t dim : dims)
+            count *= dim;
+
+        binaryFieldValues values;
+        for (size_t i = 0; i < count; i++)
+            values.push_back(expectValue(data[i]));
+
+        add(tag, theArray.type(), dims, values);
+    }
+
+    flxFormatBinary format;
+    memoryWriter writer;
+    std::vector<expectObservation> expected;
+
+  private:
+    void add(const std::string &tag, uint8_t type, const std::vector<uint16_t> &dims, const binaryFieldValues &values)
+    {
+        std::string name = _section.empty() ? tag : _section + "." + tag;
+        _current.fields.push_back(expectField{type, dims, name, values});
+    }
+
+    expectObservation _current;
+    std::string _section;
+};
+
+//-------------------------------------------------------------------------------------
+// Decode the output and compare it to what was logged. skipRecord is a record that was damaged - it
+// must be missing from the output, and nothing else.
+
+static int nFailures = 0;
+
+#define CHECK(cond, ...)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            if (nFailures++ < 20)                                                                                      \
+            {                                                                                                          \
+                printf("    FAIL: ");                                                                                  \
+                printf(__VA_ARGS__);                                                                                   \
+                printf("\n");                                                                                          \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (0)
+
+static binaryStats verify(const std::vector<uint8_t> &data, const std::vector<expectObservation> &expected,
+                          int64_t skipRecord = -1)
+{
+    binaryStats stats = {};
+    std::vector<binaryField> fields;
+    std::vector<binaryFieldValues> values;
+    std::string title;
+    std::string line;
+    bool haveSchema = false;
+
+    size_t iExpect = 0;
+    size_t pos = 0;
+    binaryBlock block;
+
+    while (next_block(data.data(), data.size(), pos, block, stats))
+    {
+        if (block.type == kBinaryBlockSchema)
+        {
+            stats.schemas++;
+            haveSchema = parse_schema(block.payload, block.length, fields, title);
+            CHECK(haveSchema, "schema %u doesn't parse", stats.schemas);
+            continue;
+        }
+        if (block.type == kBinaryBlockSync)
+        {
+            stats.syncs++;
+            continue;
+        }
+        if (block.type != kBinaryBlockRecord)
+        {
+            CHECK(false, "unknown block type 0x%02X", block.type);
+            continue;
+        }
+        if (!haveSchema)
+        {
+            stats.recordsWithoutSchema++;
+            continue;
+        }
+
+        if ((int64_t)iExpect == skipRecord)
+            iExpect++;
+
+        if (iExpect >= expected.size())
+        {
+            CHECK(false, "more records than observations logged");
+            break;
+        }
+        const expectObservation &expect = expected[iExpect];
+
+        uint32_t sequence;
+        bool bDecoded = decode_record(block.payload, block.length, fields, sequence, values);
+        CHECK(bDecoded, "record %zu doesn't decode", iExpect);
+        CHECK(sequence == iExpect, "record %zu has sequence number %u", iExpect, sequence);
+        CHECK(title == expect.title, "record %zu title '%s', expected '%s'", iExpect, title.c_str(),
+              expect.title.c_str());
+
+        // the CSV output has to work too
+        CHECK(format_record(block.payload, block.length, fields, 3, sequence, line), "record %zu doesn't format",
+              iExpect);
+
+        CHECK(fields.size() == expect.fields.size(), "record %zu has %zu fields, expected %zu", iExpect, fields.size(),
+              expect.fields.size());
+
+        for (size_t i = 0; bDecoded && i < fields.size() && i < expect.fields.size(); i++)
+        {
+            const expectField &ef = expect.fields[i];
+            const char *szName = ef.name.c_str();
+
+            CHECK(fields[i].name == ef.name, "record %zu field %zu named '%s', expected '%s'", iExpect, i,
+                  fields[i].name.c_str(), szName);
+            CHECK(fields[i].type == ef.type, "%s: type 0x%02X, expected 0x%02X", szName, fields[i].type, ef.type);
+            CHECK(fields[i].dims == ef.dims, "%s: dimensions differ", szName);
+            CHECK(values[i].size() == ef.values.size(), "%s: %zu values, expected %zu", szName, values[i].size(),
+                  ef.values.size());
+
+            for (size_t n = 0; n < values[i].size() && n < ef.values.size(); n++)
+            {
+                CHECK(values[i][n].bits == ef.values[n].bits, "%s[%zu]: 0x%llX, expected 0x%llX", szName, n,
+                      (unsigned long long)values[i][n].bits, (unsigned long long)ef.values[n].bits);
+                CHECK(values[i][n].str == ef.values[n].str, "%s[%zu]: string '%.40s', expected '%.40s'", szName, n,
+                      values[i][n].str.c_str(), ef.values[n].str.c_str());
+            }
+        }
+        stats.records++;
+        iExpect++;
+    }
+
+    if ((int64_t)iExpect == skipRecord)
+        iExpect++;
+    CHECK(iExpect == expected.size(), "%zu records decoded, %zu logged", iExpect, expected.size());
+
+    return stats;
+}
+
+//-------------------------------------------------------------------------------------
+// types - every type, at its limits
+
+static void testTypes(void)
+{
+    printf("types\n");
+
+    roundTrip rt;
+
+    // scalars - no section, then in a section
+    rt.begin("scalars");
+    rt.scalar("bool", true);
+    rt.scalar("int8", (int8_t)-1);
+
+    rt.section("limits");
+    rt.scalar("boolF", false);
+    rt.scalar("int8min", std::numeric_limits<int8_t>::min());
+    rt.scalar("int8max", std::numeric_limits<int8_t>::max());
+    rt.scalar("uint8max", std::numeric_limits<uint8_t>::max());
+    rt.scalar("int16min", std::numeric_limits<int16_t>::min());
+    rt.scalar("int16max", std::numeric_limits<int16_t>::max());
+    rt.scalar("uint16max", std::numeric_limits<uint16_t>::max());
+    rt.scalar("int32min", std::numeric_limits<int32_t>::min());
+    rt.scalar("int32max", std::numeric_limits<int32_t>::max());
+    rt.scalar("uint32max", std::numeric_limits<uint32_t>::max());
+    rt.scalar("uint32zero", (uint32_t)0);
+    rt.endSection();
+
+    rt.section("float");
+    const float floats[] = {0.0f,
+                            -0.0f,
+                            1.5f,
+                            -3.14159f,
+                            FLT_MIN,
+                            FLT_MAX,
+                            std::numeric_limits<float>::denorm_min(),
+                            std::numeric_limits<float>::infinity(),
+                            -std::numeric_limits<float>::infinity(),
+                            std::numeric_limits<float>::quiet_NaN()};
+    for (size_t i = 0; i < sizeof(floats) / sizeof(floats[0]); i++)
+        rt.scalar("f" + std::to_string(i), floats[i]);
+
+    const double doubles[] = {0.0,
+                              -0.0,
+                              1.0 / 3.0,
+                              -2.718281828459045,
+                              DBL_MIN,
+                              DBL_MAX,
+                              std::numeric_limits<double>::denorm_min(),
+                              std::numeric_limits<double>::infinity(),
+                              -std::numeric_limits<double>::infinity(),
+                              std::numeric_limits<double>::quiet_NaN()};
+    for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++)
+        rt.scalar("d" + std::to_string(i), doubles[i]);
+    rt.endSection();
+
+    rt.section("string");
+    std::string longString(kBinaryMaxString + 100, 'x');
+    rt.string("empty", "");
+    rt.string("null", nullptr);
+    rt.string("plain", "hello");
+    rt.string("csv", "a,b \"quoted\"\r\nnext line");
+    rt.string("utf8", "\xC2\xB0""C - 25\xE2\x84\x83");
+    rt.string("long", longString.c_str());
+    rt.endSection();
+    rt.write();
+
+
+    // arrays - every type, 1 to 3 dimensions
+    rt.begin("arrays");
+    rt.section("array");
+
+    bool boolData[] = {true, false, false, true, true, false};
+    flxDataArrayBool aBool;
+    rt.array("bool", aBool, boolData, {2, 3});
+
+    int8_t int8Data[] = {-128, -1, 0, 1, 127};
+    flxDataArrayInt8 aInt8;
+    rt.array("int8", aInt8, int8Data, {5});
+
+    int16_t int16Data[] = {-32768, -2, 0, 2, 32767, 1234};
+    flxDataArrayInt16 aInt16;
+    rt.array("int16", aInt16, int16Data, {1, 2, 3});
+
+    int32_t int32Data[] = {std::numeric_limits<int32_t>::min(), -70000, 0, 70000, std::numeric_limits<int32_t>::max()};
+    flxDataArrayInt32 aInt32;
+    rt.array("int32", aInt32, int32Data, {5});
+
+    uint8_t uint8Data[] = {0, 1, 128, 255};
+    flxDataArrayUInt8 aUInt8;
+    rt.array("uint8", aUInt8, uint8Data, {2, 2});
+
+    uint16_t uint16Data[] = {0, 1, 32768, 65535};
+    flxDataArrayUInt16 aUInt16;
+    rt.array("uint16", aUInt16, uint16Data, {4});
+
+    uint32_t uint32Data[] = {0, 1, 0x80000000, 0xFFFFFFFF};
+    flxDataArrayUInt32 aUInt32;
+    rt.array("uint32", aUInt32, uint32Data, {4, 1});
+
+    float floatData[10];
+    memcpy(floatData, floats, sizeof(floatData));
+    flxDataArrayFloat aFloat;
+    rt.array("float", aFloat, floatData, {2, 5});
+
+    double doubleData[10];
+    memcpy(doubleData, doubles, sizeof(doubleData));
+    flxDataArrayDouble aDouble;
+    rt.array("double", aDouble, doubleData, {10});
+
+    char *stringData[] = {(char *)"one", (char *)"", nullptr, (char *)"with, \"quotes\""};
+    flxDataArrayString aString;
+    rt.array("string", aString, stringData, {2, 2});
+
+    // arrays that aren't set
+    flxDataArrayFloat aEmptyFloat;
+    rt.array<float>("emptyFloat", aEmptyFloat, nullptr, {});
+    flxDataArrayString aEmptyString;
+    rt.array<char *>("emptyString", aEmptyString, nullptr, {});
+    rt.endSection();
+
+    rt.scalar("after", (uint16_t)4321);
+    rt.write();
+
+    // An observation with no values isn't written - nor counted
+    rt.begin("nothing");
+    rt.write();
+
+    // same layout as the first - the schema is written again, as it changed
+    rt.begin("scalars");
+    rt.scalar("bool", false);
+    rt.scalar("int8", (int8_t)100);
+    rt.write();
+
+    binaryStats stats = verify(rt.writer.bytes, rt.expected);
+
+    CHECK(stats.records == rt.expected.size(), "%u records, expected %zu", stats.records, rt.expected.size());
+    CHECK(stats.schemas == 3, "%u schemas, expected 3", stats.schemas);
+    CHECK(stats.badBlocks == 0, "%u damaged blocks", stats.badBlocks);
+
+    printf("  %u records, %u schemas, %zu bytes\n", stats.records, stats.schemas, rt.writer.bytes.size());
+}
+
+//-------------------------------------------------------------------------------------
+// random - random layouts and values
+
+// A field of a random layout
+struct layoutField
+{
+    std::string section;
+    std::string tag;
+    uint8_t type;
+    std::vector<uint16_t> dims; // none for a scalar
+};
+
+static const uint8_t kLayoutTypes[] = {flxTypeBool,   flxTypeInt8,   flxTypeUInt8,  flxTypeInt16,
+                                       flxTypeUInt16, flxTypeInt32,  flxTypeUInt32, flxTypeFloat,
+                                       flxTypeDouble, flxTypeString};
+
+static std::vector<layoutField> randomLayout(std::mt19937 &rng)
+{
+    std::vector<layoutField> layout;
+
+    int nSections = 1 + rng() % 4;
+    for (int s = 0; s < nSections; s++)
+    {
+        // the first section has no name - values logged outside of a section
+        std::string section = s == 0 ? "" : "dev" + std::to_string(rng() % 100);
+        int nFields = 1 + rng() % 8;
+        for (int f = 0; f < nFields; f++)
+        {
+            layoutField field;
+            field.section = section;
+            field.tag = "v" + std::to_string(f);
+            field.type = kLayoutTypes[rng() % sizeof(kLayoutTypes)];
+            if (rng() % 4 == 0)
+            {
+                // an array - or one that isn't set
+                int nDims = rng() % 4;
+                for (int d = 0; d < nDims; d++)
+                    field.dims.push_back(1 + rng() % 5);
+                if (nDims == 0)
+                    field.dims.push_back(0);
+            }
+            layout.push_back(field);
+        }
+    }
+    return layout;
+}
+
+// Random values of each type - biased to the limits
+template <typename T> static T randomValue(std::mt19937 &rng)
+{
+    switch (rng() % 4)
+    {
+    case 0:
+        return std::numeric_limits<T>::min();
+    case 1:
+        return std::numeric_limits<T>::max();
+    default: {
+        uint64_t bits = ((uint64_t)rng() << 32) | rng();
+        T value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    }
+}
+template <> bool randomValue(std::mt19937 &rng)
+{
+    return rng() % 2;
+}
+
+// Random bit patterns for floats cover NaN, infinity and denormals
+template <> float randomValue(std::mt19937 &rng)
+{
+    uint32_t bits = rng();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static std::string randomString(std::mt19937 &rng)
+{
+    static const char kChars[] = "abcXYZ019 ,\"\r\n\t.-_\xC2\xB0";
+    std::string value;
+    int length = rng() % 8 == 0 ? rng() % 1000 : rng() % 20;
+    for (int i = 0; i < length; i++)
+        value += kChars[rng() % (sizeof(kChars) - 1)];
+    return value;
+}
+
+// Array objects - reused from one observation to the next, as a device would
+struct arrayStore
+{
+    flxDataArrayBool aBool;
+    flxDataArrayInt8 aInt8;
+    flxDataArrayUInt8 aUInt8;
+    flxDataArrayInt16 aInt16;
+    flxDataArrayUInt16 aUInt16;
+    flxDataArrayInt32 aInt32;
+    flxDataArrayUInt32 aUInt32;
+    flxDataArrayFloat aFloat;
+    flxDataArrayDouble aDouble;
+    flxDataArrayString aString;
+};
+
+template <typename T, typename A>
+static void logRandomArray(roundTrip &rt, std::mt19937 &rng, const layoutField &field, A &theArray)
+{
+    // A dimension of 0 - an array that isn't set
+    if (field.dims[0] == 0)
+    {
+        A emptyArray;
+        rt.array<T>(field.tag, emptyArray, nullptr, {});
+        return;
+    }
+    size_t count = 1;
+    for (uint16_t dim : field.dims)
+        count *= dim;
+
+    std::unique_ptr<T[]> data(new T[count]);
+    for (size_t i = 0; i < count; i++)
+        data[i] = randomValue<T>(rng);
+
+    rt.array(field.tag, theArray, data.get(), field.dims);
+}
+
+static void logRandomStringArray(roundTrip &rt, std::mt19937 &rng, const layoutField &field, flxDataArrayString &theArray)
+{
+    if (field.dims[0] == 0)
+    {
+        flxDataArrayString emptyArray;
+        rt.array<char *>(field.tag, emptyArray, nullptr, {});
+        return;
+    }
+    size_t count = 1;
+    for (uint16_t dim : field.dims)
+        count *= dim;
+
+    std::vector<std::string> strings(count);
+    std::vector<char *> data(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        strings[i] = randomString(rng);
+        data[i] = rng() % 8 == 0 ? nullptr : (char *)strings[i].c_str();
+    }
+    rt.array(field.tag, theArray, data.data(), field.dims);
+}
+
+static void logRandom(roundTrip &rt, std::mt19937 &rng, const layoutField &field, arrayStore &arrays)
+{
+    if (field.dims.size() > 0)
+    {
+        switch (field.type)
+        {
+        case flxTypeBool:
+            logRandomArray<bool>(rt, rng, field, arrays.aBool);
+            break;
+        case flxTypeInt8:
+            logRandomArray<int8_t>(rt, rng, field, arrays.aInt8);
+            break;
+        case flxTypeUInt8:
+            logRandomArray<uint8_t>(rt, rng, field, arrays.aUInt8);
+            break;
+        case flxTypeInt16:
+            logRandomArray<int16_t>(rt, rng, field, arrays.aInt16);
+            break;
+        case flxTypeUInt16:
+            logRandomArray<uint16_t>(rt, rng, field, arrays.aUInt16);
+            break;
+        case flxTypeInt32:
+            logRandomArray<int32_t>(rt, rng, field, arrays.aInt32);
+            break;
+        case flxTypeUInt32:
+            logRandomArray<uint32_t>(rt, rng, field, arrays.aUInt32);
+            break;
+        case flxTypeFloat:
+            logRandomArray<float>(rt, rng, field, arrays.aFloat);
+            break;
+        case flxTypeDouble:
+            logRandomArray<double>(rt, rng, field, arrays.aDouble);
+            break;
+        case flxTypeString:
+            logRandomStringArray(rt, rng, field, arrays.aString);
+            break;
+        }
+        return;
+    }
+
+    switch (field.type)
+    {
+    case flxTypeBool:
+        rt.scalar(field.tag, randomValue<bool>(rng));
+        break;
+    case flxTypeInt8:
+        rt.scalar(field.tag, randomValue<int8_t>(rng));
+        break;
+    case flxTypeUInt8:
+        rt.scalar(field.tag, randomValue<uint8_t>(rng));
+        break;
+    case flxTypeInt16:
+        rt.scalar(field.tag, randomValue<int16_t>(rng));
+        break;
+    case flxTypeUInt16:
+        rt.scalar(field.tag, randomValue<uint16_t>(rng));
+        break;
+    case flxTypeInt32:
+        rt.scalar(field.tag, randomValue<int32_t>(rng));
+        break;
+    case flxTypeUInt32:
+        rt.scalar(field.tag, randomValue<uint32_t>(rng));
+        break;
+    case flxTypeFloat:
+        rt.scalar(field.tag, randomValue<float>(rng));
+        break;
+    case flxTypeDouble:
+        rt.scalar(field.tag, randomValue<double>(rng));
+        break;
+    case flxTypeString: {
+        std::string value = randomString(rng);
+        rt.string(field.tag, rng() % 16 == 0 ? nullptr : value.c_str());
+        break;
+    }
+    }
+}
+
+static void testRandom(uint32_t nObservations, uint32_t seed, const char *szFile)
+{
+    printf("random - %u observations, seed %u\n", nObservations, seed);
+
+    std::mt19937 rng(seed);
+    roundTrip rt;
+    arrayStore arrays;
+
+    std::vector<layoutField> layout;
+    const char *szTitle = nullptr;
+    uint32_t nLayouts = 0;
+    uint32_t nHeaders = 0;
+
+    for (uint32_t i = 0; i < nObservations; i++)
+    {
+        // keep a layout for a run of observations - the schema is only written when it changes
+        if (layout.empty() || rng() % 20 == 0)
+        {
+            layout = randomLayout(rng);
+            szTitle = rng() % 2 ? "observation" : nullptr;
+            nLayouts++;
+        }
+
+        // a new file - the schema is written again
+        if (rng() % 50 == 0)
+        {
+            rt.format.output_header();
+            nHeaders++;
+        }
+
+        rt.begin(szTitle);
+
+        const std::string *pSection = nullptr;
+        for (const layoutField &field : layout)
+        {
+            if (!pSection || *pSection != field.section)
+            {
+                if (pSection && !pSection->empty())
+                    rt.endSection();
+                if (!field.section.empty())
+                    rt.section(field.section.c_str());
+                pSection = &field.section;
+            }
+            logRandom(rt, rng, field, arrays);
+        }
+        if (pSection && !pSection->empty())
+            rt.endSection();
+
+        rt.write();
+    }
+
+    binaryStats stats = verify(rt.writer.bytes, rt.expected);
+
+    CHECK(stats.badBlocks == 0, "%u damaged blocks", stats.badBlocks);
+    CHECK(stats.records == rt.expected.size(), "%u records, expected %zu", stats.records, rt.expected.size());
+    CHECK(stats.syncs >= stats.records / kBinarySyncInterval, "%u sync blocks for %u records", stats.syncs,
+          stats.records);
+
+    printf("  %u records, %u schemas (%u layouts, %u headers requested), %u sync blocks, %zu bytes\n", stats.records,
+           stats.schemas, nLayouts, nHeaders, stats.syncs, rt.writer.bytes.size());
+
+    if (szFile)
+    {
+        FILE *fOut = fopen(szFile, "wb");
+        CHECK(fOut, "unable to open %s", szFile);
+        if (fOut)
+        {
+            fwrite(rt.writer.bytes.data(), 1, rt.writer.bytes.size(), fOut);
+            fclose(fOut);
+        }
+    }
+
+    // damage - corrupt a byte in the middle of a record. The reader skips to the next block.
+    printf("damage\n");
+
+    size_t pos = 0;
+    binaryBlock block;
+    binaryStats scanStats = {};
+    int64_t iRecord = -1;
+    int64_t target = rt.expected.size() / 2;
+    while (next_block(rt.writer.bytes.data(), rt.writer.bytes.size(), pos, block, scanStats))
+    {
+        if (block.type == kBinaryBlockRecord && ++iRecord == target)
+        {
+            std::vector<uint8_t> damaged = rt.writer.bytes;
+            damaged[(block.payload - rt.writer.bytes.data()) + block.length / 2] ^= 0x5A;
+
+            binaryStats damagedStats = verify(damaged, rt.expected, target);
+
+            CHECK(damagedStats.records == rt.expected.size() - 1, "%u records after damage, expected %zu",
+                  damagedStats.records, rt.expected.size() - 1);
+            CHECK(damagedStats.badBlocks > 0, "damaged block not detected");
+
+            printf("  record %lld damaged: %u records read, %u damaged blocks\n", (long long)target,
+                   damagedStats.records, damagedStats.badBlocks);
+            break;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// rotate - files started mid-observation. The writer starts a new file after a block, and requests the
+// schema from the format like the kOnNewFile handler does - during the format's own write.
+
+class rotatingWriter : public flxWriter
+{
+  public:
+    rotatingWriter(flxFormatBinary &theFormat) : files{1}, _format{theFormat}, _rotateAfter{0}
+    {
+    }
+
+    void write(int32_t)
+    {
+    }
+    void write(float)
+    {
+    }
+    void write(const char *, bool, flxLineType_t)
+    {
+    }
+    bool acceptsBinary(void)
+    {
+        return true;
+    }
+    void writeBytes(const uint8_t *data, size_t length, flxLineType_t type)
+    {
+        files.back().insert(files.back().end(), data, data + length);
+
+        // the block type follows the magic
+        if (_rotateAfter != 0 && length > 2 && data[2] == _rotateAfter)
+        {
+            _rotateAfter = 0;
+            files.emplace_back();
+            _format.output_header();
+        }
+    }
+
+    // start a new file after the next block of this type
+    void rotateAfter(uint8_t type)
+    {
+        _rotateAfter = type;
+    }
+
+    std::vector<std::vector<uint8_t>> files;
+
+  private:
+    flxFormatBinary &_format;
+    uint8_t _rotateAfter;
+};
+
+static void testRotate(uint32_t seed)
+{
+    printf("rotate\n");
+
+    static const uint8_t kRotateTypes[] = {kBinaryBlockSchema, kBinaryBlockSync, kBinaryBlockRecord};
+
+    std::mt19937 rng(seed);
+    flxFormatBinary format;
+    rotatingWriter writer(format);
+    format.add(writer);
+
+    // one layout - the schema is only written again when a new file asks for it
+    const std::string tags[] = {"count", "temperature"};
+    uint32_t nObservations = 0;
+    uint32_t nRotations[3] = {0};
+
+    for (int i = 0; i < 600; i++)
+    {
+        // a schema is requested first for a new file after the schema or its sync block - the case where
+        // the new file event arrives while the schema is written
+        if (rng() % 10 == 0)
+        {
+            int iType = rng() % 3;
+            if (kRotateTypes[iType] != kBinaryBlockRecord)
+                format.output_header();
+            writer.rotateAfter(kRotateTypes[iType]);
+            nRotations[iType]++;
+        }
+
+        format.beginObservation("rotate");
+        format.beginSection("bench");
+        format.logValue(tags[0], (uint32_t)i);
+        format.logValue(tags[1], (float)i / 4);
+        format.endSection();
+        format.endObservation();
+        format.writeObservation();
+        format.clearObservation();
+        nObservations++;
+    }
+
+    uint32_t nRecords = 0;
+    uint32_t nWithoutSchema = 0;
+    for (size_t iFile = 0; iFile < writer.files.size(); iFile++)
+    {
+        const std::vector<uint8_t> &data = writer.files[iFile];
+        binaryStats stats = {};
+        std::vector<binaryField> fields;
+        std::string title;
+        bool haveSchema = false;
+        size_t pos = 0;
+        binaryBlock block;
+
+        while (next_block(data.data(), data.size(), pos, block, stats))
+        {
+            if (block.type == kBinaryBlockSchema)
+                haveSchema = parse_schema(block.payload, block.length, fields, title);
+            else if (block.type == kBinaryBlockRecord)
+            {
+                nRecords++;
+                if (!haveSchema)
+                    nWithoutSchema++;
+            }
+        }
+        CHECK(stats.badBlocks == 0, "file %zu has %u damaged blocks", iFile, stats.badBlocks);
+    }
+
+    printf("  %zu files (after %u schema, %u sync, %u record blocks), %u records, %u without a schema\n",
+           writer.files.size(), nRotations[0], nRotations[1], nRotations[2], nRecords, nWithoutSchema);
+
+    CHECK(nRecords == nObservations, "%u records, expected %u", nRecords, nObservations);
+    CHECK(nWithoutSchema == 0, "%u records in a file before its schema", nWithoutSchema);
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-n observations] [-s seed] [-f file]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t nObservations = 2000;
+    uint32_t seed = 1;
+    const char *szFile = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            nObservations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+            szFile = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    testTypes();
+    testRandom(nObservations, seed, szFile);
+    testRotate(seed);
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for the Arduino core - just what the framework type headers use.
+//
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifndef F
+#define F(x) x
+#endif
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+
+// Not in every C library
+inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size > 0)
+    {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+inline size_t strlcat(char *dst, const char *src, size_t size)
+{
+    size_t len = strnlen(dst, size);
+    if (len == size)
+        return len + strlen(src);
+    return len + strlcpy(dst + len, src, size - len);
+}
+
+// Arduino output stream - the methods a sink implements
+class Print
+{
+  public:
+    virtual ~Print()
+    {
+    }
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+            n += write(*buffer++);
+        return n;
+    }
+};
+
+// Arduino random numbers
+inline void randomSeed(unsigned long seed)
+{
+    srandom(seed);
+}
+inline long random(long min, long max)
+{
+    return max > min ? min + random() % (max - min) : min;
+}
+
+// From the ESP32 (newlib) machine headers
+inline uint16_t __bswap16(uint16_t value)
+{
+    return __builtin_bswap16(value);
+}
+inline uint32_t __bswap32(uint32_t value)
+{
+    return __builtin_bswap32(value);
+}
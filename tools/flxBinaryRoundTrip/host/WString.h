@@ -0,0 +1,20 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for the Arduino WString.h - the flash string type named in flxCoreLog.h.
+//
+
+#pragma once
+
+namespace arduino
+{
+class __FlashStringHelper;
+}
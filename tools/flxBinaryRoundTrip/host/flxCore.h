@@ -0,0 +1,18 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for src/core/flux_base/flxCore.h - just the data types, which is all the output
+// formatters use.
+//
+
+#pragma once
+
+#include "flxCoreTypes.h"
@@ -0,0 +1,43 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host implementations of the platform and framework functions the output formatters use.
+//
+
+#include "Arduino.h"
+#include "flxUtils.h"
+
+#include <chrono>
+
+//---------------------------------------------------------------------------------------
+unsigned long millis(void)
+{
+    static auto start = std::chrono::steady_clock::now();
+
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                                 start)
+        .count();
+}
+
+//---------------------------------------------------------------------------------------
+// Same CRC32 as flx_utils::calc_crc32() (reflected, polynomial 0xEDB88320) - computed bitwise, not from a table.
+
+uint32_t flx_utils::calc_crc32(uint32_t crc, const uint8_t *buf, uint32_t size)
+{
+    crc = ~crc;
+    while (size--)
+    {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
@@ -0,0 +1,336 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxBinaryReader - decoder for log files written by flxFormatBinary.
+//
+
+#include "flxBinaryReader.h"
+
+#include <cstdio>
+#include <cstring>
+
+// Values from flxCoreTypes.h. Duplicated so the reader builds without the framework.
+typedef enum
+{
+    flxTypeNone = 0x00,
+    flxTypeBool = 0x0A,
+    flxTypeInt8 = 0x11,
+    flxTypeUInt8 = 0x01,
+    flxTypeInt16 = 0x12,
+    flxTypeUInt16 = 0x02,
+    flxTypeInt32 = 0x14,
+    flxTypeUInt32 = 0x04,
+    flxTypeFloat = 0x24,
+    flxTypeDouble = 0x28,
+    flxTypeString = 0x21
+} flxDataType_t;
+
+//-------------------------------------------------------------------------------------
+uint64_t payloadReader::read(uint8_t nBytes)
+{
+    if (_pos + nBytes > _size)
+    {
+        _error = true;
+        _pos = _size;
+        return 0;
+    }
+    uint64_t value = 0;
+    for (int i = 0; i < nBytes; i++)
+        value |= (uint64_t)_data[_pos++] << (8 * i);
+    return value;
+}
+
+//-------------------------------------------------------------------------------------
+std::string payloadReader::readString(void)
+{
+    size_t len = read(2);
+    if (_pos + len > _size)
+    {
+        _error = true;
+        _pos = _size;
+        return "";
+    }
+    std::string value((const char *)_data + _pos, len);
+    _pos += len;
+    return value;
+}
+
+//-------------------------------------------------------------------------------------
+uint32_t binary_crc32(const uint8_t *buf, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (size--)
+    {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+//-------------------------------------------------------------------------------------
+bool next_block(const uint8_t *data, size_t size, size_t &pos, binaryBlock &block, binaryStats &stats)
+{
+    while (pos + kBinaryBlockHeaderSize + kBinaryBlockCRCSize <= size)
+    {
+        const uint8_t *pBlock = data + pos;
+
+        // Find the start of a valid block - on damage, step forward a byte and look again
+        if (pBlock[0] != kBinaryMagic0 || pBlock[1] != kBinaryMagic1)
+        {
+            pos++;
+            continue;
+        }
+
+        uint32_t length = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | ((uint32_t)pBlock[7] << 24);
+        size_t blockSize = kBinaryBlockHeaderSize + (size_t)length + kBinaryBlockCRCSize;
+
+        if (length > kBinaryMaxBlockSize || pos + blockSize > size)
+        {
+            stats.badBlocks++;
+            pos++;
+            continue;
+        }
+
+        const uint8_t *pCRC = pBlock + kBinaryBlockHeaderSize + length;
+        uint32_t crc = pCRC[0] | (pCRC[1] << 8) | (pCRC[2] << 16) | ((uint32_t)pCRC[3] << 24);
+
+        if (crc != binary_crc32(pBlock, kBinaryBlockHeaderSize + length))
+        {
+            stats.badBlocks++;
+            pos++;
+            continue;
+        }
+
+        block.type = pBlock[2];
+        block.payload = pBlock + kBinaryBlockHeaderSize;
+        block.length = length;
+
+        pos += blockSize;
+        return true;
+    }
+    return false;
+}
+
+//-------------------------------------------------------------------------------------
+bool parse_schema(const uint8_t *data, size_t size, std::vector<binaryField> &fields, std::string &title)
+{
+    payloadReader reader(data, size);
+
+    uint8_t version = reader.read(1);
+    reader.read(1); // reserved
+    uint16_t nFields = reader.read(2);
+    title = reader.readString();
+
+    if (version != kBinaryVersion)
+    {
+        fprintf(stderr, "Unsupported schema version: %u\n", version);
+        return false;
+    }
+
+    fields.clear();
+    for (int i = 0; i < nFields && !reader.error(); i++)
+    {
+        binaryField field;
+        field.type = reader.read(1);
+        uint8_t nDims = reader.read(1);
+        for (int n = 0; n < nDims; n++)
+            field.dims.push_back(reader.read(2));
+        field.name = reader.readString();
+        fields.push_back(field);
+    }
+    return !reader.error();
+}
+
+//-------------------------------------------------------------------------------------
+// Values are written at their native size
+static void read_value(payloadReader &reader, uint8_t type, binaryValue &value)
+{
+    value.bits = 0;
+    value.str.clear();
+
+    switch (type)
+    {
+    case flxTypeBool:
+    case flxTypeInt8:
+    case flxTypeUInt8:
+        value.bits = reader.read(1);
+        break;
+    case flxTypeInt16:
+    case flxTypeUInt16:
+        value.bits = reader.read(2);
+        break;
+    case flxTypeInt32:
+    case flxTypeUInt32:
+    case flxTypeFloat:
+        value.bits = reader.read(4);
+        break;
+    case flxTypeDouble:
+        value.bits = reader.read(8);
+        break;
+    case flxTypeString:
+        value.str = reader.readString();
+        break;
+    default:
+        break;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+bool decode_record(const uint8_t *data, size_t size, const std::vector<binaryField> &fields, uint32_t &sequence,
+                   std::vector<binaryFieldValues> &values)
+{
+    payloadReader reader(data, size);
+
+    sequence = reader.read(4);
+
+    values.resize(fields.size());
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        // a scalar is one value, an array the product of its dimensions
+        size_t count = 1;
+        for (uint16_t dim : fields[i].dims)
+            count *= dim;
+
+        values[i].resize(count);
+        for (size_t n = 0; n < count; n++)
+            read_value(reader, fields[i].type, values[i][n]);
+    }
+    return !reader.error();
+}
+
+//-------------------------------------------------------------------------------------
+// CSV output helpers
+
+static void append_quoted(std::string &out, const std::string &value)
+{
+    if (value.find_first_of(",\"\n\r") == std::string::npos)
+    {
+        out += value;
+        return;
+    }
+    out += '"';
+    for (char c : value)
+    {
+        if (c == '"')
+            out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+static void format_value(std::string &out, const binaryValue &value, uint8_t type, int precision)
+{
+    char szBuffer[64];
+
+    switch (type)
+    {
+    case flxTypeBool:
+        out += value.bits ? "true" : "false";
+        return;
+    case flxTypeInt8:
+        snprintf(szBuffer, sizeof(szBuffer), "%d", (int8_t)value.bits);
+        break;
+    case flxTypeUInt8:
+        snprintf(szBuffer, sizeof(szBuffer), "%u", (uint8_t)value.bits);
+        break;
+    case flxTypeInt16:
+        snprintf(szBuffer, sizeof(szBuffer), "%d", (int16_t)value.bits);
+        break;
+    case flxTypeUInt16:
+        snprintf(szBuffer, sizeof(szBuffer), "%u", (uint16_t)value.bits);
+        break;
+    case flxTypeInt32:
+        snprintf(szBuffer, sizeof(szBuffer), "%d", (int32_t)value.bits);
+        break;
+    case flxTypeUInt32:
+        snprintf(szBuffer, sizeof(szBuffer), "%u", (uint32_t)value.bits);
+        break;
+    case flxTypeFloat: {
+        uint32_t bits = value.bits;
+        float fValue;
+        memcpy(&fValue, &bits, sizeof(fValue));
+        snprintf(szBuffer, sizeof(szBuffer), "%.*f", precision, fValue);
+        break;
+    }
+    case flxTypeDouble: {
+        double dValue;
+        memcpy(&dValue, &value.bits, sizeof(dValue));
+        snprintf(szBuffer, sizeof(szBuffer), "%.*f", precision, dValue);
+        break;
+    }
+    case flxTypeString:
+        out += value.str;
+        return;
+    default:
+        return;
+    }
+    out += szBuffer;
+}
+
+// Arrays are output as nested, bracketed lists - the same as flxFormatCSV
+static void format_array(std::string &out, const binaryFieldValues &values, size_t &iValue, const binaryField &field,
+                         size_t dim, int precision)
+{
+    out += '[';
+    for (int i = 0; i < field.dims[dim]; i++)
+    {
+        if (i > 0)
+            out += ',';
+
+        if (dim == field.dims.size() - 1)
+            format_value(out, values[iValue++], field.type, precision);
+        else
+            format_array(out, values, iValue, field, dim + 1, precision);
+    }
+    out += ']';
+}
+
+//-------------------------------------------------------------------------------------
+void format_header(const std::vector<binaryField> &fields, std::string &line)
+{
+    line.clear();
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        if (i > 0)
+            line += ',';
+        append_quoted(line, fields[i].name);
+    }
+}
+
+//-------------------------------------------------------------------------------------
+bool format_record(const uint8_t *data, size_t size, const std::vector<binaryField> &fields, int precision,
+                   uint32_t &sequence, std::string &line)
+{
+    std::vector<binaryFieldValues> values;
+
+    if (!decode_record(data, size, fields, sequence, values))
+        return false;
+
+    line.clear();
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        if (i > 0)
+            line += ',';
+
+        std::string value;
+        if (fields[i].dims.size() == 0)
+            format_value(value, values[i][0], fields[i].type, precision);
+        else
+        {
+            size_t iValue = 0;
+            format_array(value, values[i], iValue, fields[i], 0, precision);
+        }
+
+        append_quoted(line, value);
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxBinaryReader - decoder for log files written by flxFormatBinary. Used by flxBinaryToCSV and the
+// flxBinaryRoundTrip test.
+//
+// The file layout is described in src/core/flux_logging/flxFmtBinary.h. This code has no framework
+// dependencies.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Values from flxFmtBinary.h. Duplicated so the reader builds without the framework.
+#define kBinaryMagic0 0xF1
+#define kBinaryMagic1 0x58
+#define kBinaryVersion 1
+
+#define kBinaryBlockSchema 'S'
+#define kBinaryBlockRecord 'R'
+#define kBinaryBlockSync 'Y'
+
+#define kBinaryBlockHeaderSize 8
+#define kBinaryBlockCRCSize 4
+
+// Largest block the reader accepts - anything bigger is treated as damage
+#define kBinaryMaxBlockSize (16 * 1024 * 1024)
+
+//-------------------------------------------------------------------------------------
+struct binaryField
+{
+    uint8_t type;
+    std::vector<uint16_t> dims;
+    std::string name;
+};
+
+struct binaryStats
+{
+    uint32_t schemas;
+    uint32_t records;
+    uint32_t syncs;
+    uint32_t badBlocks;
+    uint32_t missingRecords;
+    uint32_t recordsWithoutSchema;
+};
+
+// A block found in the data - the payload points into the data
+struct binaryBlock
+{
+    uint8_t type;
+    const uint8_t *payload;
+    uint32_t length;
+};
+
+// A decoded value - integers as read (not sign extended), float/double as their IEEE 754 bits, and
+// strings in str.
+struct binaryValue
+{
+    uint64_t bits;
+    std::string str;
+};
+
+// The values of one field of a record - one for a scalar, the elements in row-major order for an array
+typedef std::vector<binaryValue> binaryFieldValues;
+
+//-------------------------------------------------------------------------------------
+// Little-endian reader over a block payload. Reads past the end set the error flag.
+class payloadReader
+{
+  public:
+    payloadReader(const uint8_t *data, size_t size) : _data{data}, _size{size}, _pos{0}, _error{false}
+    {
+    }
+
+    uint64_t read(uint8_t nBytes);
+
+    std::string readString(void);
+
+    bool error(void)
+    {
+        return _error;
+    }
+
+  private:
+    const uint8_t *_data;
+    size_t _size;
+    size_t _pos;
+    bool _error;
+};
+
+//-------------------------------------------------------------------------------------
+// Standard CRC32 (reflected, 0xEDB88320) - matches flx_utils::calc_crc32(0, ...)
+uint32_t binary_crc32(const uint8_t *buf, size_t size);
+
+// Find the next valid block, starting at pos. On return pos is past the block. Damaged data is skipped
+// - the reader scans forward a byte at a time - and counted in stats. Returns false at the end of the data.
+bool next_block(const uint8_t *data, size_t size, size_t &pos, binaryBlock &block, binaryStats &stats);
+
+// Decode a schema block payload
+bool parse_schema(const uint8_t *data, size_t size, std::vector<binaryField> &fields, std::string &title);
+
+// Decode a record block payload - the values of each field
+bool decode_record(const uint8_t *data, size_t size, const std::vector<binaryField> &fields, uint32_t &sequence,
+                   std::vector<binaryFieldValues> &values);
+
+// CSV output - the header line of a schema, and a record as a line
+void format_header(const std::vector<binaryField> &fields, std::string &line);
+
+bool format_record(const uint8_t *data, size_t size, const std::vector<binaryField> &fields, int precision,
+                   uint32_t &sequence, std::string &line);
@@ -0,0 +1,154 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxBinaryToCSV - host tool that converts a log file written by flxFormatBinary to CSV.
+//
+// The file layout is described in src/core/flux_logging/flxFmtBinary.h.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -o flxBinaryToCSV flxBinaryToCSV.cpp flxBinaryReader.cpp
+//
+// Usage:
+//      flxBinaryToCSV [-p precision] <input file> [output file]
+//
+// Output goes to stdout if no output file is given. Damaged blocks are skipped - the reader
+// scans forward to the next valid block - and a summary is written to stderr.
+//
+
+#include "flxBinaryReader.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-p precision] <input file> [output file]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    int precision = 3;
+    const char *szInput = nullptr;
+    const char *szOutput = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            precision = atoi(argv[++i]);
+        else if (!szInput)
+            szInput = argv[i];
+        else if (!szOutput)
+            szOutput = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!szInput)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *fIn = fopen(szInput, "rb");
+    if (!fIn)
+    {
+        fprintf(stderr, "Unable to open %s\n", szInput);
+        return 1;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fIn)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+    fclose(fIn);
+
+    FILE *fOut = szOutput ? fopen(szOutput, "w") : stdout;
+    if (!fOut)
+    {
+        fprintf(stderr, "Unable to open %s\n", szOutput);
+        return 1;
+    }
+
+    binaryStats stats = {};
+    std::vector<binaryField> fields;
+    std::string title;
+    std::string line;
+    bool haveSchema = false;
+    bool haveSequence = false;
+    uint32_t nextSequence = 0;
+
+    size_t pos = 0;
+    binaryBlock block;
+    while (next_block(data.data(), data.size(), pos, block, stats))
+    {
+        switch (block.type)
+        {
+        case kBinaryBlockSchema:
+            stats.schemas++;
+            haveSchema = parse_schema(block.payload, block.length, fields, title);
+            if (haveSchema)
+            {
+                format_header(fields, line);
+                fprintf(fOut, "%s\n", line.c_str());
+            }
+            break;
+
+        case kBinaryBlockRecord: {
+            if (!haveSchema)
+            {
+                stats.recordsWithoutSchema++;
+                break;
+            }
+            uint32_t sequence;
+            if (!format_record(block.payload, block.length, fields, precision, sequence, line))
+            {
+                stats.badBlocks++;
+                break;
+            }
+            // note: sequence restarts at 0 on a device restart
+            if (haveSequence && sequence > nextSequence)
+                stats.missingRecords += sequence - nextSequence;
+            haveSequence = true;
+            nextSequence = sequence + 1;
+
+            stats.records++;
+            fprintf(fOut, "%s\n", line.c_str());
+            break;
+        }
+
+        case kBinaryBlockSync:
+            stats.syncs++;
+            break;
+
+        default:
+            // unknown block type - valid CRC, so skip it
+            break;
+        }
+    }
+
+    if (fOut != stdout)
+        fclose(fOut);
+
+    fprintf(stderr, "%u records, %u schemas, %u sync blocks, %u damaged blocks, %u missing records", stats.records,
+            stats.schemas, stats.syncs, stats.badBlocks, stats.missingRecords);
+    if (stats.recordsWithoutSchema)
+        fprintf(stderr, ", %u records skipped - no schema", stats.recordsWithoutSchema);
+    fprintf(stderr, "\n");
+
+    return 0;
+}
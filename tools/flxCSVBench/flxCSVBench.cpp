@@ -0,0 +1,376 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxCSVBench - host benchmark of the CSV output formatter (flxFormatCSV). Formats observations the way
+// the logger does and reports the time and heap allocations per row, with checks of the output.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -fpermissive -w -Ihost -I../flxBinaryRoundTrip/host -I../../src/core/flux_base
+//          -I../../src/core/flux_logging -o flxCSVBench flxCSVBench.cpp ../../src/core/flux_base/flxUtils.cpp
+//          ../../src/core/flux_base/flxCoreMsg.cpp
+//
+// The host stand-ins for the Arduino headers are shared with flxBinaryRoundTrip. host/mbedtls has
+// stand-ins for the mbedtls headers flxUtils.cpp includes. To compare with another version of the
+// formatter, build with ../../src replaced by the path to that tree.
+//
+// Usage:
+//      flxCSVBench [-n observations] [-s seed]
+//
+// Layouts:
+//      scalar  - 5 sections of 6 values - float, double, int32, uint16, bool and string
+//      array   - the scalar layout, plus a section with an 8x8 float array
+//
+// Checks:
+//      dtostr  - flx_utils::dtostr() matches printf("%.*f") for random values and precisions, apart from
+//                the rounding of ties and the sign of zero
+//      rows    - the header is written once, and every row has one field per header column
+//      allocs  - no heap allocations once the row buffers have grown to size
+//
+// Exit status is 0 if all checks pass.
+//
+
+#include "flxFmtCSV.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Allocation counting
+
+static uint32_t nAllocs = 0;
+
+void *operator new(size_t size)
+{
+    nAllocs++;
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void *operator new[](size_t size)
+{
+    nAllocs++;
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+void operator delete[](void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+//-------------------------------------------------------------------------------------
+// Host stand-ins for the platform and the framework log
+
+unsigned long millis(void)
+{
+    return 0;
+}
+
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const char *fmt, ...)
+{
+    return 0;
+}
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const int idFmt, ...)
+{
+    return 0;
+}
+flxLogging &flxLog = flxLogging::get();
+
+//-------------------------------------------------------------------------------------
+static int nFailures = 0;
+
+#define CHECK(cond, ...)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            nFailures++;                                                                                               \
+            printf("    FAIL: ");                                                                                      \
+            printf(__VA_ARGS__);                                                                                       \
+            printf("\n");                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+//-------------------------------------------------------------------------------------
+// A writer that keeps the last row - like a file or serial writer, it takes the text as is
+
+class benchWriter : public flxWriter
+{
+  public:
+    benchWriter() : nHeaders{0}, nRows{0}, nBytes{0}
+    {
+        header.reserve(2048);
+        row.reserve(2048);
+    }
+
+    void write(int32_t value)
+    {
+    }
+    void write(float value)
+    {
+    }
+    void write(const char *value, bool newline, flxLineType_t type)
+    {
+        if (type == flxLineTypeHeader)
+        {
+            nHeaders++;
+            header.assign(value);
+        }
+        else if (type == flxLineTypeData)
+        {
+            nRows++;
+            nBytes += strlen(value) + 1;
+            row.assign(value);
+        }
+    }
+
+    uint32_t nHeaders;
+    uint32_t nRows;
+    uint64_t nBytes;
+    std::string header;
+    std::string row;
+};
+
+//-------------------------------------------------------------------------------------
+// The observation - section and tag names are made once, as the logger's parameters hold them
+
+#define kBenchSections 5
+
+static const char *kSectionNames[kBenchSections] = {"BME280", "SHTC3", "VEML7700", "MAX17048", "GNSS"};
+static const char *kStatus[] = {"ok", "warming", "idle"};
+
+class benchObservation
+{
+  public:
+    benchObservation(uint32_t seed) : _rng{seed}, _tags{"Temperature", "Humidity", "Count", "Level", "Valid", "Status"}
+    {
+        _array.buffer(8, 8);
+    }
+
+    void log(flxOutputFormat &theFormat, bool bArray)
+    {
+        std::uniform_real_distribution<float> fValue(-40.0, 125.0);
+        std::uniform_real_distribution<double> dValue(0, 100000.0);
+        std::uniform_int_distribution<int32_t> iValue(-100000, 100000);
+
+        theFormat.beginObservation();
+        for (int i = 0; i < kBenchSections; i++)
+        {
+            theFormat.beginSection(kSectionNames[i]);
+            theFormat.logValue(_tags[0], fValue(_rng), 2);
+            theFormat.logValue(_tags[1], dValue(_rng), 3);
+            theFormat.logValue(_tags[2], (int32_t)iValue(_rng));
+            theFormat.logValue(_tags[3], (uint16_t)(_rng() & 0xFFFF));
+            theFormat.logValue(_tags[4], (bool)(_rng() & 1));
+            theFormat.logValue(_tags[5], kStatus[_rng() % 3]);
+            theFormat.endSection();
+        }
+        if (bArray)
+        {
+            float *pData = _array.get();
+            for (int i = 0; i < 64; i++)
+                pData[i] = fValue(_rng);
+
+            theFormat.beginSection("AMG8833");
+            theFormat.logValue(_arrayTag, &_array, 2);
+            theFormat.endSection();
+        }
+        theFormat.endObservation();
+        theFormat.writeObservation();
+        theFormat.clearObservation();
+    }
+
+  private:
+    std::mt19937 _rng;
+    std::string _tags[6];
+    std::string _arrayTag = "Temperatures";
+    flxDataArrayFloat _array;
+};
+
+//-------------------------------------------------------------------------------------
+// Count the fields of a CSV line - commas in brackets (arrays) or quotes don't separate fields
+
+static uint32_t countFields(const std::string &line)
+{
+    uint32_t nFields = 1;
+    int depth = 0;
+    bool bQuoted = false;
+
+    for (char c : line)
+    {
+        if (c == '"')
+            bQuoted = !bQuoted;
+        else if (!bQuoted && c == '[')
+            depth++;
+        else if (!bQuoted && c == ']')
+            depth--;
+        else if (!bQuoted && depth == 0 && c == ',')
+            nFields++;
+    }
+    return nFields;
+}
+
+//-------------------------------------------------------------------------------------
+// dtostr() against printf. Two differences are expected - dtostr() rounds a tie (a value exactly half way
+// between two outputs) away from zero where printf rounds to even, and outputs -0 as 0.
+
+static bool isTie(double value, int precision)
+{
+    // printf outputs the exact decimal value of a double given enough digits
+    char szDigits[400];
+    snprintf(szDigits, sizeof(szDigits), "%.*f", precision + 60, value);
+
+    const char *pDigit = strchr(szDigits, '.') + 1 + precision;
+    if (*pDigit++ != '5')
+        return false;
+    while (*pDigit == '0')
+        pDigit++;
+    return *pDigit == '\0';
+}
+
+static void checkDtostr(uint32_t seed)
+{
+    printf("dtostr\n");
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> small(-1000.0, 1000.0);
+    std::uniform_real_distribution<double> large(-1e9, 1e9);
+    std::uniform_int_distribution<int> precision(0, 6);
+
+    static const double kEdges[] = {0.0, -0.0, 0.5, -0.5, 1.5, 2.5, 0.0005, -0.0004, 999.9995, 4294967295.0,
+                                    4e9, 4.1e9, -4.1e9, 1e15, -1e15, 123456789.123456};
+    uint32_t nChecked = 0;
+    uint32_t nMismatch = 0;
+    char szValue[64];
+    char szExpected[64];
+
+    auto check = [&](double value, int prec) {
+        flx_utils::dtostr(value, szValue, sizeof(szValue), prec);
+        snprintf(szExpected, sizeof(szExpected), "%.*f", prec, value);
+        nChecked++;
+        if (value == 0)
+            snprintf(szExpected, sizeof(szExpected), "%.*f", prec, 0.0);
+        if (strcmp(szValue, szExpected) != 0 && !isTie(value, prec))
+        {
+            if (nMismatch++ < 5)
+                printf("    %.17g precision %d: dtostr %s, printf %s\n", value, prec, szValue, szExpected);
+        }
+    };
+
+    for (double value : kEdges)
+        for (int prec = 0; prec <= 6; prec++)
+            check(value, prec);
+
+    for (int i = 0; i < 100000; i++)
+    {
+        check(small(rng), precision(rng));
+        check(large(rng), precision(rng));
+    }
+    printf("    %u values, %u differ from printf\n", nChecked, nMismatch);
+    CHECK(nMismatch == 0, "dtostr() output differs from printf");
+}
+
+//-------------------------------------------------------------------------------------
+static void benchLayout(const char *szName, bool bArray, uint32_t nObservations, uint32_t seed)
+{
+    flxFormatCSV theFormat;
+    benchWriter theWriter;
+    benchObservation theObservation(seed);
+
+    theFormat.add(theWriter);
+
+    // warm up - the buffers grow to the row size
+    for (int i = 0; i < 10; i++)
+        theObservation.log(theFormat, bArray);
+
+    uint32_t nColumns = countFields(theWriter.header);
+    bool bRowsValid = true;
+
+    uint32_t startAllocs = nAllocs;
+    uint64_t startBytes = theWriter.nBytes;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nObservations; i++)
+    {
+        theObservation.log(theFormat, bArray);
+        bRowsValid = bRowsValid && countFields(theWriter.row) == nColumns;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    uint32_t nRowAllocs = nAllocs - startAllocs;
+
+    printf("  %-8s %3u columns %5.0f bytes per row %8.2f us per row %6.2f allocations per row\n", szName, nColumns,
+           (double)(theWriter.nBytes - startBytes) / nObservations,
+           std::chrono::duration<double, std::micro>(t1 - t0).count() / nObservations,
+           (double)nRowAllocs / nObservations);
+
+    CHECK(theWriter.nHeaders == 1, "%s - header written %u times", szName, theWriter.nHeaders);
+    CHECK(bRowsValid, "%s - a row doesn't have %u fields", szName, nColumns);
+    CHECK(nRowAllocs == 0, "%s - %u allocations in %u rows", szName, nRowAllocs, nObservations);
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-n observations] [-s seed]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t nObservations = 100000;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            nObservations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nObservations == 0)
+        nObservations = 1;
+
+    checkDtostr(seed);
+
+    printf("rows - %u observations\n", nObservations);
+    benchLayout("scalar", false, nObservations, seed);
+    benchLayout("array", true, nObservations, seed);
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}
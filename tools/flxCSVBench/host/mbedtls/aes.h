@@ -0,0 +1,43 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for mbedtls/aes.h - lets flxUtils.cpp build on the host. The benchmarks don't
+// encrypt anything, so every call fails.
+//
+
+#pragma once
+
+#include <cstddef>
+
+#define MBEDTLS_AES_ENCRYPT 1
+#define MBEDTLS_AES_DECRYPT 0
+
+typedef struct
+{
+    int unused;
+} mbedtls_aes_context;
+
+inline int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits)
+{
+    return -1;
+}
+inline int mbedtls_aes_setkey_dec(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits)
+{
+    return -1;
+}
+inline int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx, int mode, size_t length, unsigned char iv[16],
+                                 const unsigned char *input, unsigned char *output)
+{
+    return -1;
+}
+inline void mbedtls_aes_free(mbedtls_aes_context *ctx)
+{
+}
@@ -0,0 +1,22 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for mbedtls/base64.h - lets flxUtils.cpp build on the host. Decoding always fails.
+//
+
+#pragma once
+
+#include <cstddef>
+
+inline int mbedtls_base64_decode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen)
+{
+    return -1;
+}
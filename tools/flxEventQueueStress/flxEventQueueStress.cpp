@@ -0,0 +1,305 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxEventQueueStress - host stress test for the deferred event queue (flxEventRing) used by the
+// event hub.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -pthread -I../../src/core/flux_base -o flxEventQueueStress flxEventQueueStress.cpp
+//
+// Usage:
+//      flxEventQueueStress [-p producers] [-n posts] [-s]
+//
+//      -p producers    number of producer threads (default 4)
+//      -n posts        posts per producer (default 200000)
+//      -s              the consumer sleeps between drains - like a busy main loop, the queue overflows
+//
+// Tests:
+//      burst   - fill the ring with no consumer. Exactly size() records are accepted, the rest counted
+//                as overflows, and the records drain in order.
+//      stress  - producer threads post (producer, sequence) records while one consumer drains. Checks
+//                every record is received at most once, in order per producer, and that the records
+//                received plus the overflows counted equals the records posted. Run twice - the
+//                producers retry a post when the ring is full (every record delivered), then drop it.
+//      lookup  - event signal lookup, std::map vs a sorted flat array
+//
+// Exit status is 0 if all checks pass.
+//
+
+#include "flxCoreEventQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <vector>
+
+// Same size as the event hub queue
+#define kStressRingSize 32
+
+typedef struct
+{
+    uint32_t producer;
+    uint32_t sequence;
+    uint8_t payload[8];
+} stressRecord_t;
+
+typedef flxEventRing<stressRecord_t, kStressRingSize> stressRing_t;
+
+static int nFailures = 0;
+
+static void check(bool bOkay, const char *what)
+{
+    printf("    %-60s %s\n", what, bOkay ? "ok" : "FAIL");
+    if (!bOkay)
+        nFailures++;
+}
+
+//----------------------------------------------------------
+static void testBurst(void)
+{
+    printf("burst\n");
+
+    stressRing_t ring;
+    stressRecord_t rec = {0, 0, {0}};
+
+    uint32_t nAccepted = 0;
+    for (uint32_t i = 0; i < ring.size() + 10; i++)
+    {
+        rec.sequence = i;
+        if (ring.push(rec))
+            nAccepted++;
+    }
+    check(nAccepted == ring.size(), "accepts size() records");
+    check(ring.overflows() == 10, "counts the overflows");
+    check(ring.highWater() == ring.size(), "high water is size()");
+
+    bool bOrder = true;
+    uint32_t nRead = 0;
+    while (ring.pop(rec))
+        bOrder = bOrder && rec.sequence == nRead++;
+
+    check(nRead == ring.size() && bOrder, "drains in order");
+    check(ring.empty(), "empty after drain");
+
+    // wrap the ring many times, one record at a time
+    bool bWrap = true;
+    for (uint32_t i = 0; i < 100000 && bWrap; i++)
+    {
+        rec.sequence = i;
+        bWrap = ring.push(rec) && ring.pop(rec) && rec.sequence == i;
+    }
+    check(bWrap, "push/pop across 100000 wraps");
+}
+
+//----------------------------------------------------------
+static void testStress(uint32_t nProducers, uint32_t nPosts, bool bSlowConsumer, bool bRetry)
+{
+    printf("stress - %u producers x %u posts%s, %s when full\n", nProducers, nPosts,
+           bSlowConsumer ? ", slow consumer" : "", bRetry ? "retry" : "drop");
+
+    stressRing_t ring;
+    std::atomic<uint32_t> nDone{0};
+    std::atomic<bool> bStart{false};
+    std::vector<uint32_t> dropped(nProducers, 0);
+
+    // consumer state
+    std::vector<int64_t> lastSeq(nProducers, -1);
+    std::vector<uint32_t> received(nProducers, 0);
+    uint32_t nOutOfOrder = 0;
+    uint32_t nBadPayload = 0;
+
+    auto tStart = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < nProducers; p++)
+    {
+        producers.emplace_back([&, p]() {
+            while (!bStart.load())
+                std::this_thread::yield();
+            stressRecord_t rec;
+            rec.producer = p;
+            for (uint32_t i = 0; i < nPosts; i++)
+            {
+                rec.sequence = i;
+                memset(rec.payload, (uint8_t)(i ^ p), sizeof(rec.payload));
+                while (!ring.push(rec))
+                {
+                    if (!bRetry)
+                    {
+                        dropped[p]++;
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+            nDone.fetch_add(1);
+        });
+    }
+
+    bStart.store(true);
+
+    // drain until the producers are done, and the ring is empty
+    stressRecord_t rec;
+    for (;;)
+    {
+        bool bFinished = nDone.load() == nProducers;
+        bool bAny = false;
+
+        while (ring.pop(rec))
+        {
+            bAny = true;
+            if (rec.producer >= nProducers)
+            {
+                nBadPayload++;
+                continue;
+            }
+            if ((int64_t)rec.sequence <= lastSeq[rec.producer])
+                nOutOfOrder++;
+            lastSeq[rec.producer] = rec.sequence;
+            received[rec.producer]++;
+
+            for (size_t i = 0; i < sizeof(rec.payload); i++)
+            {
+                if (rec.payload[i] != (uint8_t)(rec.sequence ^ rec.producer))
+                {
+                    nBadPayload++;
+                    break;
+                }
+            }
+        }
+        if (bFinished && !bAny)
+            break;
+
+        if (bSlowConsumer)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        else if (!bAny)
+            std::this_thread::yield();
+    }
+
+    for (auto &t : producers)
+        t.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+    uint64_t nPosted = (uint64_t)nProducers * nPosts;
+    uint64_t nReceived = 0;
+    uint64_t nDropped = 0;
+    bool bBalanced = true;
+    for (uint32_t p = 0; p < nProducers; p++)
+    {
+        nReceived += received[p];
+        nDropped += dropped[p];
+        bBalanced = bBalanced && received[p] + dropped[p] == nPosts;
+    }
+
+    printf("    posted %llu, received %llu, dropped %llu, high water %u, %.2f M posts/s\n",
+           (unsigned long long)nPosted, (unsigned long long)nReceived, (unsigned long long)nDropped, ring.highWater(),
+           nPosted / seconds / 1e6);
+
+    check(nOutOfOrder == 0, "in order per producer, no duplicates");
+    check(nBadPayload == 0, "payloads intact");
+    check(bBalanced, "received + dropped == posted, per producer");
+    if (bRetry)
+        check(nReceived == nPosted, "every record delivered");
+    else
+        check(ring.overflows() == nDropped, "overflow counter matches the drops");
+}
+
+//----------------------------------------------------------
+// Event hub signal lookup - the IDs are addresses of the event ID objects
+static void testLookup(void)
+{
+    printf("lookup\n");
+
+    const uint32_t nEvents = 16;
+    const uint32_t nLookups = 10000000;
+
+    typedef struct
+    {
+        uint32_t id;
+        void *signal;
+    } entry_t;
+
+    std::map<uint32_t, void *> theMap;
+    std::vector<entry_t> theArray;
+
+    uint32_t ids[nEvents];
+    for (uint32_t i = 0; i < nEvents; i++)
+    {
+        ids[i] = 0x3FFB0000 + i * 4 * 37 % 512;
+        theMap[ids[i]] = &ids[i];
+
+        auto it = std::lower_bound(theArray.begin(), theArray.end(), ids[i],
+                                   [](const entry_t &e, uint32_t v) { return e.id < v; });
+        theArray.insert(it, {ids[i], &ids[i]});
+    }
+
+    uintptr_t sum = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nLookups; i++)
+    {
+        auto it = theMap.find(ids[i % nEvents]);
+        sum += (uintptr_t)it->second;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nLookups; i++)
+    {
+        auto it = std::lower_bound(theArray.begin(), theArray.end(), ids[i % nEvents],
+                                   [](const entry_t &e, uint32_t v) { return e.id < v; });
+        sum -= (uintptr_t)it->signal;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    printf("    %u events: std::map %.1f ns, sorted array %.1f ns per lookup\n", nEvents,
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / nLookups,
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / nLookups);
+
+    check(sum == 0, "same results");
+}
+
+//----------------------------------------------------------
+int main(int argc, char **argv)
+{
+    uint32_t nProducers = 4;
+    uint32_t nPosts = 200000;
+    bool bSlowConsumer = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc)
+            nProducers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            nPosts = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s"))
+            bSlowConsumer = true;
+        else
+        {
+            fprintf(stderr, "usage: %s [-p producers] [-n posts] [-s]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (nProducers == 0)
+        nProducers = 1;
+
+    testBurst();
+    testStress(nProducers, nPosts, bSlowConsumer, true);
+    testStress(nProducers, nPosts, bSlowConsumer, false);
+    testLookup();
+
+    printf("%s - %d failures\n", nFailures ? "FAILED" : "PASSED", nFailures);
+
+    return nFailures ? 1 : 0;
+}
@@ -0,0 +1,350 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxJSONStreamBench - host test and benchmark of the sink the JSON output formatter serializes into
+// (flxJSONWriterSink). Replays JSON observations into the sink the way a serializer writes them, and
+// checks and times what the writers receive.
+//
+// ArduinoJson isn't used - the serializer is replaced by a replay of the document text, written mostly a
+// character at a time with numbers in one write. So the times are the sink's own cost, not serialization.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -fpermissive -w -I../flxBinaryRoundTrip/host -I../../src/core/flux_base
+//          -I../../src/core/flux_logging -o flxJSONStreamBench flxJSONStreamBench.cpp
+//
+// The host stand-ins for the Arduino headers are shared with flxBinaryRoundTrip.
+//
+// Usage:
+//      flxJSONStreamBench [-n observations] [-s seed]
+//
+// Documents:
+//      scalar  - 5 sections of 6 values
+//      array   - the scalar document, plus a section with an 8x8 float array
+//      large   - 8 sections, each with an 8x8 float array
+//
+// Each document is output to a streamed writer (partial lines), a buffered writer (complete line), and
+// both. Checks:
+//      output  - each writer receives the document exactly, and the sink returns its size
+//      chunks  - streamed pieces are at most kJSONStreamChunkSize, and only the last ends the line
+//      allocs  - no heap allocations once the line buffer has grown to the document size
+//
+// Exit status is 0 if all checks pass.
+//
+
+#include "flxJSONWriterSink.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Allocation counting
+
+static uint32_t nAllocs = 0;
+
+void *operator new(size_t size)
+{
+    nAllocs++;
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+//-------------------------------------------------------------------------------------
+static int nFailures = 0;
+
+#define CHECK(cond, ...)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            nFailures++;                                                                                               \
+            printf("    FAIL: ");                                                                                      \
+            printf(__VA_ARGS__);                                                                                       \
+            printf("\n");                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+//-------------------------------------------------------------------------------------
+// A writer that collects the output of each observation, and checks the pieces it's sent
+
+class benchWriter : public flxWriter
+{
+  public:
+    benchWriter() : nLines{0}, bValid{true}
+    {
+        text.reserve(32768);
+    }
+
+    void write(int32_t value)
+    {
+    }
+    void write(float value)
+    {
+    }
+    void write(const char *value, bool newline, flxLineType_t type)
+    {
+        if (_bEnded)
+        {
+            text.clear();
+            _bEnded = false;
+        }
+        if (strlen(value) > kJSONStreamChunkSize && !bBuffered)
+            bValid = false;
+        text += value;
+        if (newline)
+        {
+            nLines++;
+            _bEnded = true;
+        }
+    }
+
+    bool bBuffered = false;
+    uint32_t nLines;
+    bool bValid;
+    std::string text;
+
+  private:
+    bool _bEnded = false;
+};
+
+//-------------------------------------------------------------------------------------
+// A document, and the writes a serializer makes to output it
+
+typedef struct
+{
+    size_t offset;
+    size_t length;
+} docWrite_t;
+
+class benchDocument
+{
+  public:
+    // nSections sections of nValues values, then nArrays sections with an 8x8 float array
+    void build(uint32_t nSections, uint32_t nValues, uint32_t nArrays, std::mt19937 &rng)
+    {
+        static const char *kTags[] = {"Temperature", "Humidity", "Pressure", "Count", "Valid", "Status"};
+        std::uniform_real_distribution<float> fValue(-40.0, 125.0);
+        char szValue[32];
+
+        text.clear();
+        writes.clear();
+
+        addChar('{');
+        for (uint32_t i = 0; i < nSections + nArrays; i++)
+        {
+            if (i > 0)
+                addChar(',');
+            snprintf(szValue, sizeof(szValue), "Device%u", i);
+            addString(szValue);
+            addChar(':');
+            addChar('{');
+            if (i < nSections)
+            {
+                for (uint32_t n = 0; n < nValues; n++)
+                {
+                    if (n > 0)
+                        addChar(',');
+                    addString(kTags[n % 6]);
+                    addChar(':');
+                    snprintf(szValue, sizeof(szValue), "%.2f", fValue(rng));
+                    addBlock(szValue);
+                }
+            }
+            else
+            {
+                addString("Temperatures");
+                addChar(':');
+                addChar('[');
+                for (int row = 0; row < 8; row++)
+                {
+                    if (row > 0)
+                        addChar(',');
+                    addChar('[');
+                    for (int col = 0; col < 8; col++)
+                    {
+                        if (col > 0)
+                            addChar(',');
+                        snprintf(szValue, sizeof(szValue), "%.2f", fValue(rng));
+                        addBlock(szValue);
+                    }
+                    addChar(']');
+                }
+                addChar(']');
+            }
+            addChar('}');
+        }
+        addChar('}');
+    }
+
+    void output(Print &sink)
+    {
+        const uint8_t *pText = (const uint8_t *)text.data();
+        for (auto &aWrite : writes)
+        {
+            if (aWrite.length == 1)
+                sink.write(pText[aWrite.offset]);
+            else
+                sink.write(pText + aWrite.offset, aWrite.length);
+        }
+    }
+
+    std::string text;
+    std::vector<docWrite_t> writes;
+
+  private:
+    void addChar(char c)
+    {
+        writes.push_back({text.length(), 1});
+        text += c;
+    }
+    void addString(const char *value)
+    {
+        addChar('"');
+        while (*value)
+            addChar(*value++);
+        addChar('"');
+    }
+    void addBlock(const char *value)
+    {
+        writes.push_back({text.length(), strlen(value)});
+        text += value;
+    }
+};
+
+//-------------------------------------------------------------------------------------
+static void runDocument(const char *szName, benchDocument &theDoc, uint32_t nObservations)
+{
+    printf("  %-8s %6zu bytes, %5zu writes\n", szName, theDoc.text.length(), theDoc.writes.size());
+
+    static const char *kModes[] = {"stream", "buffer", "both"};
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        benchWriter streamWriter;
+        benchWriter bufferWriter;
+        bufferWriter.bBuffered = true;
+
+        std::vector<flxWriter *> streamWriters;
+        std::vector<flxWriter *> bufferWriters;
+        if (mode != 1)
+            streamWriters.push_back(&streamWriter);
+        if (mode != 0)
+            bufferWriters.push_back(&bufferWriter);
+
+        flxJSONWriterSink theSink;
+        bool bSizeValid = true;
+
+        // the formatter reserves its buffer size - smaller than the large document, so the line grows once
+        auto observation = [&]() {
+            if (bufferWriters.size() > 0)
+                theSink.reserve(1200);
+            theSink.begin(streamWriters, bufferWriters);
+            theDoc.output(theSink);
+            bSizeValid = bSizeValid && theSink.end() == theDoc.text.length();
+        };
+
+        observation();
+
+        uint32_t startAllocs = nAllocs;
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < nObservations; i++)
+            observation();
+        auto t1 = std::chrono::steady_clock::now();
+        uint32_t nDocAllocs = nAllocs - startAllocs;
+
+        double usDoc = std::chrono::duration<double, std::micro>(t1 - t0).count() / nObservations;
+        printf("    %-8s %8.2f us per observation %6.2f ns per byte %6.2f allocations per observation\n",
+               kModes[mode], usDoc, usDoc * 1000 / theDoc.text.length(), (double)nDocAllocs / nObservations);
+
+        CHECK(bSizeValid, "%s %s - the sink returned the wrong size", szName, kModes[mode]);
+        if (mode != 1)
+        {
+            CHECK(streamWriter.text == theDoc.text, "%s %s - streamed output differs", szName, kModes[mode]);
+            CHECK(streamWriter.bValid, "%s %s - a streamed piece is larger than the chunk size", szName,
+                  kModes[mode]);
+            CHECK(streamWriter.nLines == nObservations + 1, "%s %s - %u lines streamed for %u observations", szName,
+                  kModes[mode], streamWriter.nLines, nObservations + 1);
+        }
+        if (mode != 0)
+        {
+            CHECK(bufferWriter.text == theDoc.text, "%s %s - buffered output differs", szName, kModes[mode]);
+            CHECK(bufferWriter.nLines == nObservations + 1, "%s %s - %u lines buffered for %u observations", szName,
+                  kModes[mode], bufferWriter.nLines, nObservations + 1);
+        }
+        CHECK(nDocAllocs == 0, "%s %s - %u allocations in %u observations", szName, kModes[mode], nDocAllocs,
+              nObservations);
+    }
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-n observations] [-s seed]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t nObservations = 100000;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            nObservations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nObservations == 0)
+        nObservations = 1;
+
+    std::mt19937 rng(seed);
+    benchDocument scalarDoc;
+    benchDocument arrayDoc;
+    benchDocument largeDoc;
+
+    scalarDoc.build(5, 6, 0, rng);
+    arrayDoc.build(5, 6, 1, rng);
+    largeDoc.build(0, 0, 8, rng);
+
+    printf("sink - %zu bytes, chunk size %u - %u observations\n", sizeof(flxJSONWriterSink), kJSONStreamChunkSize,
+           nObservations);
+
+    runDocument("scalar", scalarDoc, nObservations);
+    runDocument("array", arrayDoc, nObservations);
+    runDocument("large", largeDoc, nObservations);
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}
@@ -0,0 +1,375 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxJobQueueBench - host benchmark of the job queue (flxCoreJobs). Runs the same set of jobs through
+// the job queue and through a copy of the previous queue - a std::multimap keyed by deadline, with a
+// linear search to find a job - on a simulated millisecond clock.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -fpermissive -w -I../flxBinaryRoundTrip/host -I../../src/core/flux_base
+//          -o flxJobQueueBench flxJobQueueBench.cpp ../../src/core/flux_base/flxCoreJobs.cpp
+//          ../../src/core/flux_base/flxCoreMsg.cpp
+//
+// The host stand-ins for the Arduino headers are shared with flxBinaryRoundTrip. flxCoreMsg.cpp has the
+// message table the log object refers to.
+//
+// Usage:
+//      flxJobQueueBench [-t seconds] [-u updates] [-s seed]
+//
+//      -t seconds      simulated run time for each job count (default 600)
+//      -u updates      job updates (period change) timed for each job count (default 100000)
+//      -s seed         random seed for the job periods (default 1)
+//
+// For 8, 32 and 128 jobs, with periods from 10 ms to 1 s, reports:
+//      dispatch    - time per loop pass and per job dispatched, and heap allocations per dispatch
+//      update      - time to update a job in the queue (flxUpdateJobInQueue())
+//
+// Both queues must dispatch each job the same number of times. Exit status is 0 if they do, and the
+// job queue makes no allocations while dispatching.
+//
+
+#include "flxCoreJobs.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Simulated clock - the benchmark sets the time. Handlers take no time.
+
+static uint32_t simMillis = 0;
+
+unsigned long millis(void)
+{
+    return simMillis;
+}
+unsigned long micros(void)
+{
+    return simMillis * 1000;
+}
+void delay(unsigned long ms)
+{
+    simMillis += ms;
+}
+
+//-------------------------------------------------------------------------------------
+// Host stand-in for the framework log - used by the queue dump()
+
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const char *fmt, ...)
+{
+    return 0;
+}
+flxLogging &flxLog = flxLogging::get();
+
+//-------------------------------------------------------------------------------------
+// Allocation counting
+
+static uint32_t nAllocs = 0;
+
+void *operator new(size_t size)
+{
+    nAllocs++;
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+//-------------------------------------------------------------------------------------
+// The previous job queue - a multimap keyed by deadline. Dispatch erases and re-inserts a map node,
+// and finding a job (add, remove, update) is a linear search.
+
+class legacyJobQueue
+{
+  public:
+    void addJob(flxJob &theJob)
+    {
+        if (_jobQueue.size() == 0 || findJob(theJob) == _jobQueue.end())
+        {
+            if (theJob.period() > 0)
+                _jobQueue.insert(std::pair<uint32_t, flxJob *>(millis() + theJob.period(), &theJob));
+        }
+    }
+
+    void removeJob(flxJob &theJob)
+    {
+        auto itJob = findJob(theJob);
+        if (itJob != _jobQueue.end())
+            _jobQueue.erase(itJob);
+    }
+
+    void updateJob(flxJob &theJob)
+    {
+        removeJob(theJob);
+        addJob(theJob);
+    }
+
+    void loop(void)
+    {
+        flxJob *theJob;
+        uint32_t tNext;
+        uint32_t ticks = millis();
+
+        for (auto it = _jobQueue.begin(); it != _jobQueue.end(); /*nothing*/)
+        {
+            if (it->first > ticks)
+                break;
+
+            theJob = it->second;
+            theJob->callHandler();
+
+            tNext = it->first + theJob->period();
+            if (tNext <= ticks)
+                tNext = it->first + (((ticks - it->first) / theJob->period()) + 1) * theJob->period();
+
+            it = _jobQueue.erase(it);
+
+            if (!theJob->oneShot())
+                _jobQueue.insert(std::pair<uint32_t, flxJob *>(tNext, theJob));
+        }
+    }
+
+  private:
+    std::multimap<uint32_t, flxJob *>::iterator findJob(flxJob &theJob)
+    {
+        auto itJob = _jobQueue.begin();
+        while (itJob != _jobQueue.end() && itJob->second != &theJob)
+            itJob++;
+        return itJob;
+    }
+
+    std::multimap<uint32_t, flxJob *> _jobQueue;
+};
+
+//-------------------------------------------------------------------------------------
+// The job queue, with the same interface
+
+class currentJobQueue
+{
+  public:
+    currentJobQueue(std::vector<std::unique_ptr<class benchJob>> &jobs);
+    ~currentJobQueue();
+
+    void addJob(flxJob &theJob)
+    {
+        flxJobQueue.addJob(theJob);
+    }
+    void updateJob(flxJob &theJob)
+    {
+        flxJobQueue.updateJob(theJob);
+    }
+    void loop(void)
+    {
+        flxJobQueue.loop();
+    }
+
+  private:
+    std::vector<std::unique_ptr<class benchJob>> &_jobs;
+};
+
+//-------------------------------------------------------------------------------------
+class benchJob
+{
+  public:
+    benchJob(uint32_t period) : calls{0}
+    {
+        job.setup("bench", period, this, &benchJob::handler);
+    }
+    void handler(void)
+    {
+        calls++;
+    }
+
+    flxJob job;
+    uint32_t calls;
+};
+
+currentJobQueue::currentJobQueue(std::vector<std::unique_ptr<benchJob>> &jobs) : _jobs{jobs}
+{
+    flxJobQueue.stop();
+}
+currentJobQueue::~currentJobQueue()
+{
+    for (auto &aJob : _jobs)
+        flxJobQueue.removeJob(aJob->job);
+}
+
+//-------------------------------------------------------------------------------------
+static int nFailures = 0;
+
+typedef struct
+{
+    double nsPass;
+    double nsDispatch;
+    double allocsDispatch;
+    double nsUpdate;
+    uint64_t dispatches;
+} benchResult_t;
+
+static void makeJobs(std::vector<std::unique_ptr<benchJob>> &jobs, uint32_t nJobs, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> period(10, 1000);
+
+    jobs.clear();
+    for (uint32_t i = 0; i < nJobs; i++)
+        jobs.emplace_back(new benchJob(period(rng)));
+}
+
+template <typename Q>
+static benchResult_t runQueue(Q &queue, std::vector<std::unique_ptr<benchJob>> &jobs, uint32_t msRun,
+                              uint32_t nUpdates, uint32_t seed, bool bStart)
+{
+    benchResult_t result = {};
+
+    simMillis = 0;
+    for (auto &aJob : jobs)
+        queue.addJob(aJob->job);
+    if (bStart)
+        flxJobQueue.start();
+
+    // dispatch - one loop pass per simulated millisecond
+    uint32_t startAllocs = nAllocs;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t ms = 1; ms <= msRun; ms++)
+    {
+        simMillis = ms;
+        queue.loop();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    for (auto &aJob : jobs)
+        result.dispatches += aJob->calls;
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    result.nsPass = ns / msRun;
+    result.nsDispatch = result.dispatches ? ns / result.dispatches : 0;
+    result.allocsDispatch = result.dispatches ? (double)(nAllocs - startAllocs) / result.dispatches : 0;
+
+    // update - change the period of a random job and update it in the queue
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> pick(0, jobs.size() - 1);
+    std::uniform_int_distribution<uint32_t> period(10, 1000);
+
+    t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nUpdates; i++)
+    {
+        flxJob &theJob = jobs[pick(rng)]->job;
+        theJob.setPeriod(period(rng));
+        queue.updateJob(theJob);
+    }
+    t1 = std::chrono::steady_clock::now();
+    result.nsUpdate = nUpdates ? std::chrono::duration<double, std::nano>(t1 - t0).count() / nUpdates : 0;
+
+    return result;
+}
+
+static void benchJobs(uint32_t nJobs, uint32_t msRun, uint32_t nUpdates, uint32_t seed)
+{
+    std::vector<std::unique_ptr<benchJob>> legacyJobs;
+    std::vector<std::unique_ptr<benchJob>> currentJobs;
+
+    makeJobs(legacyJobs, nJobs, seed);
+    makeJobs(currentJobs, nJobs, seed);
+
+    benchResult_t legacyResult;
+    {
+        legacyJobQueue queue;
+        legacyResult = runQueue(queue, legacyJobs, msRun, nUpdates, seed, false);
+    }
+
+    benchResult_t currentResult;
+    {
+        currentJobQueue queue(currentJobs);
+        currentResult = runQueue(queue, currentJobs, msRun, nUpdates, seed, true);
+    }
+
+    printf("  %3u jobs, %llu dispatches\n", nJobs, (unsigned long long)currentResult.dispatches);
+    printf("    %-10s %8.1f ns per pass %8.1f ns per dispatch %6.2f allocations per dispatch %8.1f ns per update\n",
+           "multimap", legacyResult.nsPass, legacyResult.nsDispatch, legacyResult.allocsDispatch,
+           legacyResult.nsUpdate);
+    printf("    %-10s %8.1f ns per pass %8.1f ns per dispatch %6.2f allocations per dispatch %8.1f ns per update\n",
+           "heap", currentResult.nsPass, currentResult.nsDispatch, currentResult.allocsDispatch,
+           currentResult.nsUpdate);
+
+    // the dispatch counts are taken before the updates, so they match
+    uint32_t nMismatch = 0;
+    for (uint32_t i = 0; i < nJobs; i++)
+        if (legacyJobs[i]->calls != currentJobs[i]->calls)
+            nMismatch++;
+
+    if (nMismatch)
+    {
+        nFailures++;
+        printf("    FAIL: %u jobs dispatched a different number of times\n", nMismatch);
+    }
+    if (currentResult.allocsDispatch > 0)
+    {
+        nFailures++;
+        printf("    FAIL: the job queue allocated memory while dispatching\n");
+    }
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-t seconds] [-u updates] [-s seed]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t secsRun = 600;
+    uint32_t nUpdates = 100000;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            secsRun = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+            nUpdates = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (secsRun == 0)
+        secsRun = 1;
+
+    printf("job queue - %u simulated seconds, %u updates\n", secsRun, nUpdates);
+
+    for (uint32_t nJobs : {8, 32, 128})
+        benchJobs(nJobs, secsRun * 1000, nUpdates, seed);
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}
@@ -0,0 +1,389 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//----------------------------------------------------------
+// Host (Linux/macOS) flash device for the KVP store - see flxKVPStoreDeviceSim.h
+//----------------------------------------------------------
+
+#include "flxKVPStoreDeviceSim.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint32_t kNoSector = 0xFFFFFFFF;
+
+flxKVPStoreDeviceSim::flxKVPStoreDeviceSim()
+    : _pFlash{nullptr}, _mapSize{0}, _fd{-1}, _sectorSize{kSimSectorSize}, _nSectors{0}, _mode{kSimModeNOR},
+      _norRule{kSimNORProgram}, _bufferSector{kNoSector}, _bufferDirty{false}, _usRead{0}, _usProgram{0}, _usErase{0},
+      _bDelay{false}, _nOps{0}, _cutAt{0}, _bTorn{false}, _dead{false}
+{
+    resetStats();
+}
+
+flxKVPStoreDeviceSim::~flxKVPStoreDeviceSim()
+{
+    if (_pFlash)
+        munmap(_pFlash, _mapSize);
+
+    if (_fd >= 0)
+        ::close(_fd);
+}
+
+//----------------------------------------------------------
+bool flxKVPStoreDeviceSim::open(const char *filename, uint32_t nSectors, uint32_t sectorSize)
+{
+    if (_pFlash || nSectors == 0 || sectorSize == 0)
+        return false;
+
+    _mapSize = (size_t)nSectors * sectorSize;
+    size_t existing = 0;
+
+    if (filename && *filename)
+    {
+        _fd = ::open(filename, O_RDWR | O_CREAT, 0644);
+        if (_fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(_fd, &st) != 0 || (st.st_size < (off_t)_mapSize && ftruncate(_fd, _mapSize) != 0))
+            return false;
+
+        existing = st.st_size < (off_t)_mapSize ? st.st_size : _mapSize;
+
+        _pFlash = (uint8_t *)mmap(nullptr, _mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    }
+    else
+        _pFlash = (uint8_t *)mmap(nullptr, _mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (_pFlash == MAP_FAILED)
+    {
+        _pFlash = nullptr;
+        return false;
+    }
+
+    // New flash is erased
+    memset(_pFlash + existing, 0xFF, _mapSize - existing);
+
+    _sectorSize = sectorSize;
+    _nSectors = nSectors;
+    _buffer.resize(sectorSize);
+    _eraseCounts.assign(nSectors, 0);
+
+    return true;
+}
+
+//----------------------------------------------------------
+void flxKVPStoreDeviceSim::setMode(flxSimMode_t mode)
+{
+    commitBuffer();
+    _bufferSector = kNoSector;
+    _mode = mode;
+}
+
+//----------------------------------------------------------
+void flxKVPStoreDeviceSim::setLatency(uint32_t usRead, uint32_t usProgram, uint32_t usErase, bool bDelay)
+{
+    _usRead = usRead;
+    _usProgram = usProgram;
+    _usErase = usErase;
+    _bDelay = bDelay;
+}
+
+//----------------------------------------------------------
+// Power cuts
+//----------------------------------------------------------
+void flxKVPStoreDeviceSim::cutPowerAfter(uint32_t nOps, bool bTorn)
+{
+    _cutAt = nOps > 0 ? _nOps + nOps : 0;
+    _bTorn = bTorn;
+}
+
+//----------------------------------------------------------
+// Power back on - the contents of the sector buffer were lost with the power
+
+void flxKVPStoreDeviceSim::restorePower(void)
+{
+    _dead = false;
+    _cutAt = 0;
+    _bufferSector = kNoSector;
+    _bufferDirty = false;
+}
+
+//----------------------------------------------------------
+// Called for each program/erase operation. Returns false if the operation doesn't happen - the
+// device has no power, or the power is cut during this operation (it's torn if set).
+
+bool flxKVPStoreDeviceSim::powerStep(void)
+{
+    if (_dead)
+        return false;
+
+    _nOps++;
+
+    if (_cutAt != 0 && _nOps == _cutAt)
+    {
+        _dead = true;
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------
+void flxKVPStoreDeviceSim::resetStats(void)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+//----------------------------------------------------------
+void flxKVPStoreDeviceSim::latency(uint32_t usTime)
+{
+    _stats.usFlash += usTime;
+
+    if (_bDelay && usTime > 0)
+        usleep(usTime);
+}
+
+//----------------------------------------------------------
+bool flxKVPStoreDeviceSim::copyFrom(flxKVPStoreDeviceSim &source)
+{
+    if (!_pFlash || !source._pFlash || _mapSize != source._mapSize)
+        return false;
+
+    memcpy(_pFlash, source._pFlash, _mapSize);
+    _bufferSector = kNoSector;
+    _bufferDirty = false;
+
+    return true;
+}
+
+//----------------------------------------------------------
+bool flxKVPStoreDeviceSim::validRange(uint32_t iPage, uint32_t address, size_t len)
+{
+    return _pFlash && iPage < _nSectors && len > 0 && address >= iPage * _sectorSize &&
+           address + len <= (iPage + 1) * _sectorSize;
+}
+
+//----------------------------------------------------------
+// Flash operations
+//----------------------------------------------------------
+
+bool flxKVPStoreDeviceSim::flashProgram(uint32_t address, const uint8_t *src, size_t len, bool bTorn)
+{
+    uint8_t *pDest = _pFlash + address;
+
+    // Any bits that need to go from 0 to 1?
+    bool bViolation = false;
+    for (size_t i = 0; i < len && !bViolation; i++)
+        bViolation = (src[i] & ~pDest[i]) != 0;
+
+    if (bViolation)
+    {
+        _stats.violations++;
+        if (_norRule == kSimNORReject)
+            return false;
+    }
+
+    // a torn program only gets half way
+    if (bTorn)
+        len /= 2;
+
+    if (_norRule == kSimNORProgram)
+    {
+        for (size_t i = 0; i < len; i++)
+            pDest[i] &= src[i];
+    }
+    else
+        memcpy(pDest, src, len);
+
+    return true;
+}
+
+//----------------------------------------------------------
+void flxKVPStoreDeviceSim::flashErase(uint32_t iSector, bool bTorn)
+{
+    memset(_pFlash + iSector * _sectorSize, 0xFF, bTorn ? _sectorSize / 2 : _sectorSize);
+
+    if (!bTorn)
+        _eraseCounts[iSector]++;
+}
+
+//----------------------------------------------------------
+// Sector buffer mode
+//----------------------------------------------------------
+
+bool flxKVPStoreDeviceSim::setBufferSector(uint32_t iSector)
+{
+    if (iSector == _bufferSector)
+        return true;
+
+    if (!commitBuffer())
+        return false;
+
+    memcpy(_buffer.data(), _pFlash + iSector * _sectorSize, _sectorSize);
+    _bufferSector = iSector;
+
+    return true;
+}
+
+//----------------------------------------------------------
+// Write the buffer to flash - an erase and a program of the whole sector
+
+bool flxKVPStoreDeviceSim::commitBuffer(void)
+{
+    if (!_bufferDirty || _bufferSector == kNoSector)
+        return true;
+
+    _stats.flushes++;
+
+    bool bLive = powerStep();
+    if (bLive || (_dead && _bTorn && _nOps == _cutAt))
+    {
+        _stats.erases++;
+        latency(_usErase);
+        flashErase(_bufferSector, !bLive);
+    }
+    if (!bLive)
+        return false;
+
+    bLive = powerStep();
+    if (bLive || (_dead && _bTorn && _nOps == _cutAt))
+    {
+        _stats.programs++;
+        _stats.bytesProgrammed += _sectorSize;
+        latency(_usProgram * ((_sectorSize + kSimProgramPageSize - 1) / kSimProgramPageSize));
+
+        // The sector was just erased - the whole sector is programmed
+        memcpy(_pFlash + _bufferSector * _sectorSize, _buffer.data(), bLive ? _sectorSize : _sectorSize / 2);
+    }
+    if (!bLive)
+        return false;
+
+    _bufferDirty = false;
+
+    return true;
+}
+
+//----------------------------------------------------------
+// flxKVPStoreDevice interface
+//----------------------------------------------------------
+
+bool flxKVPStoreDeviceSim::write(uint32_t iPage, uint32_t address, const void *src, size_t len)
+{
+    if (!src || !validRange(iPage, address, len) || _dead)
+        return false;
+
+    if (_mode == kSimModeSectorBuffer)
+    {
+        if (!setBufferSector(iPage))
+            return false;
+
+        memcpy(_buffer.data() + (address - iPage * _sectorSize), src, len);
+        _bufferDirty = true;
+
+        return true;
+    }
+
+    bool bLive = powerStep();
+
+    // power cut during this program - is anything written?
+    if (!bLive && !(_bTorn && _nOps == _cutAt))
+        return false;
+
+    _stats.programs++;
+    _stats.bytesProgrammed += len;
+    latency(_usProgram * ((len + kSimProgramPageSize - 1) / kSimProgramPageSize));
+
+    bool bStatus = flashProgram(address, (const uint8_t *)src, len, !bLive);
+
+    return bLive && bStatus;
+}
+
+//----------------------------------------------------------
+bool flxKVPStoreDeviceSim::read(uint32_t iPage, uint32_t address, void *dest, size_t len)
+{
+    if (!dest || !validRange(iPage, address, len) || _dead)
+        return false;
+
+    _stats.reads++;
+    _stats.bytesRead += len;
+    latency(_usRead);
+
+    if (_mode == kSimModeSectorBuffer)
+    {
+        if (!setBufferSector(iPage))
+            return false;
+
+        memcpy(dest, _buffer.data() + (address - iPage * _sectorSize), len);
+    }
+    else
+        memcpy(dest, _pFlash + address, len);
+
+    return true;
+}
+
+//----------------------------------------------------------
+bool flxKVPStoreDeviceSim::erase(uint32_t iPage)
+{
+    if (!_pFlash || iPage >= _nSectors || _dead)
+        return false;
+
+    if (_mode == kSimModeSectorBuffer)
+    {
+        if (!setBufferSector(iPage))
+            return false;
+
+        memset(_buffer.data(), 0xFF, _sectorSize);
+        _bufferDirty = true;
+
+        return true;
+    }
+
+    bool bLive = powerStep();
+
+    if (!bLive && !(_bTorn && _nOps == _cutAt))
+        return false;
+
+    _stats.erases++;
+    latency(_usErase);
+    flashErase(iPage, !bLive);
+
+    return bLive;
+}
+
+//----------------------------------------------------------
+void flxKVPStoreDeviceSim::flush(void)
+{
+    commitBuffer();
+}
+
+//----------------------------------------------------------
+void flxKVPStoreDeviceSim::close(void)
+{
+    commitBuffer();
+    _bufferSector = kNoSector;
+
+    if (_fd >= 0)
+        msync(_pFlash, _mapSize, MS_SYNC);
+}
+
+//----------------------------------------------------------
+uint32_t flxKVPStoreDeviceSim::storageSize(void)
+{
+    return _nSectors * _sectorSize;
+}
+
+//----------------------------------------------------------
+uint32_t flxKVPStoreDeviceSim::segmentSize(void)
+{
+    return _sectorSize;
+}
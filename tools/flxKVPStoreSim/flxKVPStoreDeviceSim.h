@@ -0,0 +1,176 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//----------------------------------------------------------
+// Host (Linux/macOS) flash device for the KVP store.
+//
+// The flash is a memory mapped file (or anonymous memory), so an image persists between runs and
+// can be inspected. The device follows flash rules and records what the store does with it:
+//
+//  - Sector granular erase, to 0xFF.
+//  - NOR mode - a program can only change bits from 1 to 0. What happens to a program that needs a
+//    0 -> 1 change is set by the NOR rule - store what real NOR would (old & new, the default), fail, or
+//    just count it.
+//  - Sector buffer mode - behaves like flxKVPStoreDeviceRP2. One sector is held in RAM, and written
+//    (erase + program of the whole sector) when another sector is accessed or on flush().
+//  - Counts reads, programs, erases (per sector) and NOR rule violations.
+//  - Simulated latency - accumulated as simulated flash time, and optionally as a real delay.
+//  - Power cut - after a given number of program/erase operations. The cut operation can be torn
+//    (half done), and the device is dead until power is restored.
+//
+// Addresses passed to the device are absolute (sector * sector size + offset), as used by flxKVPStorePage.
+//----------------------------------------------------------
+
+#pragma once
+
+#include "flxKVPStoreDevice.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define kSimSectorSize 4096
+
+// Size of a flash program page - used for program latency
+#define kSimProgramPageSize 256
+
+class flxKVPStoreDeviceSim : public flxKVPStoreDevice
+{
+  public:
+    typedef enum
+    {
+        kSimModeNOR,
+        kSimModeSectorBuffer
+    } flxSimMode_t;
+
+    // What a NOR program that needs a 0 -> 1 bit change does
+    typedef enum
+    {
+        kSimNORCount,   // write the data, count the violation
+        kSimNORProgram, // store old & new - what NOR flash does
+        kSimNORReject   // fail the write, flash unchanged
+    } flxSimNORRule_t;
+
+    typedef struct
+    {
+        uint32_t reads;
+        uint64_t bytesRead;
+        uint32_t programs;
+        uint64_t bytesProgrammed;
+        uint32_t erases;
+        uint32_t violations;
+        uint32_t flushes;
+        uint64_t usFlash; // simulated time spent in flash operations
+    } flxSimStats_t;
+
+    flxKVPStoreDeviceSim();
+    ~flxKVPStoreDeviceSim();
+
+    // Map a flash image file - created, erased, if it doesn't exist. An empty filename maps anonymous memory.
+    bool open(const char *filename, uint32_t nSectors, uint32_t sectorSize = kSimSectorSize);
+
+    void setMode(flxSimMode_t mode);
+    flxSimMode_t mode(void)
+    {
+        return _mode;
+    }
+
+    void setNORRule(flxSimNORRule_t rule)
+    {
+        _norRule = rule;
+    }
+
+    // Latency - read per call, program per program page, erase per sector. If bDelay, the device also sleeps
+    void setLatency(uint32_t usRead, uint32_t usProgram, uint32_t usErase, bool bDelay = false);
+
+    // Cut power at the nth program/erase operation from now (1 = the next one). 0 disables.
+    void cutPowerAfter(uint32_t nOps, bool bTorn = false);
+    void restorePower(void);
+    bool powerLost(void)
+    {
+        return _dead;
+    }
+
+    // Number of program/erase operations so far - used to pick power cut points
+    uint32_t operations(void)
+    {
+        return _nOps;
+    }
+
+    const flxSimStats_t &stats(void)
+    {
+        return _stats;
+    }
+    void resetStats(void);
+
+    uint32_t eraseCount(uint32_t iSector)
+    {
+        return iSector < _eraseCounts.size() ? _eraseCounts[iSector] : 0;
+    }
+
+    // Direct access to the flash contents
+    uint8_t *data(void)
+    {
+        return _pFlash;
+    }
+
+    // Copy the contents of another device - i.e. boot a new store from a flash image
+    bool copyFrom(flxKVPStoreDeviceSim &source);
+
+    // flxKVPStoreDevice interface
+    bool write(uint32_t iPage, uint32_t address, const void *src, size_t len);
+    bool read(uint32_t iPage, uint32_t address, void *dest, size_t len);
+    bool erase(uint32_t iPage);
+    void flush(void);
+    void close(void);
+    uint32_t storageSize();
+    uint32_t segmentSize();
+
+  private:
+    bool validRange(uint32_t iPage, uint32_t address, size_t len);
+    bool powerStep(void);
+    void latency(uint32_t usTime);
+
+    bool flashProgram(uint32_t address, const uint8_t *src, size_t len, bool bTorn);
+    void flashErase(uint32_t iSector, bool bTorn);
+
+    bool setBufferSector(uint32_t iSector);
+    bool commitBuffer(void);
+
+    uint8_t *_pFlash;
+    size_t _mapSize;
+    int _fd;
+
+    uint32_t _sectorSize;
+    uint32_t _nSectors;
+
+    flxSimMode_t _mode;
+    flxSimNORRule_t _norRule;
+
+    // sector buffer mode
+    std::vector<uint8_t> _buffer;
+    uint32_t _bufferSector;
+    bool _bufferDirty;
+
+    // latency
+    uint32_t _usRead;
+    uint32_t _usProgram;
+    uint32_t _usErase;
+    bool _bDelay;
+
+    // power cut
+    uint32_t _nOps;
+    uint32_t _cutAt;
+    bool _bTorn;
+    bool _dead;
+
+    flxSimStats_t _stats;
+    std::vector<uint32_t> _eraseCounts;
+};
@@ -0,0 +1,830 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxKVPStoreSim - host benchmark and fuzz suite for the KVP store (flxKVPStore), run on a simulated
+// flash device (flxKVPStoreDeviceSim).
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -Ihost -I../../src/core/flux_prefs -o flxKVPStoreSim flxKVPStoreSim.cpp
+//          flxKVPStoreDeviceSim.cpp host/flxHost.cpp ../../src/core/flux_prefs/flxKVPStore.cpp
+//          ../../src/core/flux_prefs/flxKVPStorePage.cpp ../../src/core/flux_prefs/flxKVPStoreEntry.cpp
+//
+// The host directory has stand-ins for the few framework headers the KVP store uses, so the store
+// builds without the rest of the framework.
+//
+// Usage:
+//      flxKVPStoreSim bench    [options]   - standard workloads, with flash operation counts and timing
+//      flxKVPStoreSim fuzz     [options]   - random operations, checked against a model of the store
+//      flxKVPStoreSim powercut [options]   - cut power at every flash operation of a run, check each reboot
+//
+// Options:
+//      -m nor|buffer   device mode - NOR flash, or a RAM sector buffer like flxKVPStoreDeviceRP2 (default nor).
+//                      The buffer device isn't power loss safe, so powercut fails in buffer mode.
+//      -r program|reject|count
+//                      NOR rule - what a program that needs a 0 -> 1 bit change does: store what NOR flash
+//                      does (old & new), fail the write, or write the data (default program). Any NOR
+//                      rule violation fails a run.
+//      -p sectors      number of flash sectors (default 4)
+//      -k keys         number of keys, spread over 4 name spaces (default 96)
+//      -n ops          number of operations for fuzz/powercut
+//      -s seed         random seed for fuzz/powercut
+//      -f file         flash image file (default - anonymous memory)
+//      -d              real flash delays (bench)
+//      -v              log store messages
+//
+// Exit status is 0 if all checks pass, with no NOR rule violations.
+//
+
+#include "flxKVPStore.h"
+#include "flxKVPStoreDeviceSim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// Flash timing used for the simulated flash time - typical QSPI NOR (us)
+#define kSimReadTime 1
+#define kSimProgramTime 400
+#define kSimEraseTime 45000
+
+// Size of the key space - the default key count is kSimNameSpaces * kSimKeysPerNS
+#define kSimNameSpaces 4
+#define kSimKeysPerNS 24
+#define kSimMaxString 100
+
+typedef struct
+{
+    flxKVPStoreDeviceSim::flxSimMode_t mode;
+    flxKVPStoreDeviceSim::flxSimNORRule_t norRule;
+    uint32_t nSectors;
+    uint32_t nOps;
+    uint32_t seed;
+    uint32_t nKeysPerNS;
+    const char *filename;
+    bool bDelay;
+} simOptions_t;
+
+static simOptions_t options = {flxKVPStoreDeviceSim::kSimModeNOR, flxKVPStoreDeviceSim::kSimNORProgram, 4, 2000, 1,
+                               kSimKeysPerNS, "", false};
+
+//----------------------------------------------------------------------------------
+// Small deterministic random generator - runs must repeat for a given seed
+
+class simRandom
+{
+  public:
+    simRandom(uint32_t seed) : _state(seed ? seed : 1)
+    {
+    }
+    uint32_t next(void)
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return _state;
+    }
+    uint32_t range(uint32_t n)
+    {
+        return next() % n;
+    }
+
+  private:
+    uint32_t _state;
+};
+
+//----------------------------------------------------------------------------------
+// Model of the store contents. Values are a uint32 or a string.
+
+typedef struct
+{
+    bool isString;
+    uint32_t value;
+    std::string sValue;
+} simValue_t;
+
+typedef std::map<std::string, simValue_t> simModel_t; // key = "<ns>/<key>"
+
+typedef struct
+{
+    enum
+    {
+        kSet,
+        kDelete,
+        kCommit
+    } type;
+    uint8_t ns;
+    std::string key;
+    simValue_t value;
+} simOp_t;
+
+static std::string modelKey(uint8_t ns, const std::string &key)
+{
+    return std::to_string(ns) + "/" + key;
+}
+
+static std::string keyName(uint32_t i)
+{
+    char szKey[16];
+    snprintf(szKey, sizeof(szKey), "key%03u", i);
+    return szKey;
+}
+
+//----------------------------------------------------------------------------------
+// The store under test, with its name space handles
+
+class simStore
+{
+  public:
+    simStore(flxKVPStoreDeviceSim &device)
+    {
+        _store.setStorageDevice(device);
+        _bOK = _store.initialize() == kKVPErrorOK;
+
+        char szNS[16];
+        for (int i = 0; i < kSimNameSpaces && _bOK; i++)
+        {
+            snprintf(szNS, sizeof(szNS), "space%d", i);
+            _ns[i] = _store.getNameSpace(szNS);
+            _bOK = _ns[i] != 0;
+        }
+    }
+    bool ok(void)
+    {
+        return _bOK;
+    }
+
+    flxKVPError_t apply(const simOp_t &op)
+    {
+        switch (op.type)
+        {
+        case simOp_t::kSet:
+            if (op.value.isString)
+                return _store.setValue(_ns[op.ns], op.key.c_str(), op.value.sValue.c_str());
+            else
+            {
+                uint32_t value = op.value.value;
+                return _store.setValue(_ns[op.ns], op.key.c_str(), value);
+            }
+
+        case simOp_t::kDelete:
+            return _store.deleteValue(_ns[op.ns], op.key.c_str());
+
+        case simOp_t::kCommit:
+            return _store.commitTransaction();
+        }
+        return kKVPErrorGeneric;
+    }
+
+    // Check a value against the model - returns a description of any difference, or empty
+    std::string check(uint8_t ns, const std::string &key, const simValue_t *pValue)
+    {
+        char szBuffer[kSimMaxString + 1];
+        uint32_t value;
+        flxKVPError_t rc;
+
+        if (!pValue)
+            return _store.keyExists(_ns[ns], key.c_str()) ? "deleted key exists" : "";
+
+        if (pValue->isString)
+        {
+            rc = _store.getValue(_ns[ns], key.c_str(), szBuffer, sizeof(szBuffer));
+            if (rc != kKVPErrorOK)
+                return "string missing (" + std::to_string(rc) + ")";
+            if (pValue->sValue != szBuffer)
+                return "string value differs";
+        }
+        else
+        {
+            rc = _store.getValue(_ns[ns], key.c_str(), value);
+            if (rc != kKVPErrorOK)
+                return "value missing (" + std::to_string(rc) + ")";
+            if (value != pValue->value)
+                return "value differs";
+        }
+        return "";
+    }
+
+    // Is the key on the store, but its string data fails the CRC check - an interrupted in-place update?
+    bool corrupt(uint8_t ns, const std::string &key)
+    {
+        char szBuffer[kSimMaxString + 1];
+
+        return _store.getValue(_ns[ns], key.c_str(), szBuffer, sizeof(szBuffer)) == kKVPErrorCorrupt;
+    }
+
+    flxKVPStore &store(void)
+    {
+        return _store;
+    }
+
+  private:
+    flxKVPStore _store;
+    uint8_t _ns[kSimNameSpaces];
+    bool _bOK;
+};
+
+//----------------------------------------------------------------------------------
+static simValue_t randomValue(simRandom &rand)
+{
+    simValue_t value;
+    value.isString = rand.range(4) == 0;
+    value.value = rand.next();
+
+    if (value.isString)
+    {
+        uint32_t length = 1 + rand.range(kSimMaxString);
+        for (uint32_t i = 0; i < length; i++)
+            value.sValue += (char)('a' + rand.range(26));
+    }
+    return value;
+}
+
+//----------------------------------------------------------------------------------
+// A random sequence of operations. Sets and deletes, in groups closed with a commit.
+
+static std::vector<simOp_t> randomOps(simRandom &rand, uint32_t nOps)
+{
+    std::vector<simOp_t> ops;
+
+    while (ops.size() < nOps)
+    {
+        uint32_t nGroup = 1 + rand.range(16);
+        for (uint32_t i = 0; i < nGroup; i++)
+        {
+            simOp_t op;
+            op.ns = rand.range(kSimNameSpaces);
+            op.key = keyName(rand.range(options.nKeysPerNS));
+            op.type = rand.range(5) == 0 ? simOp_t::kDelete : simOp_t::kSet;
+            if (op.type == simOp_t::kSet)
+                op.value = randomValue(rand);
+            ops.push_back(op);
+        }
+        simOp_t commit;
+        commit.type = simOp_t::kCommit;
+        ops.push_back(commit);
+    }
+    return ops;
+}
+
+static void applyToModel(simModel_t &model, const simOp_t &op)
+{
+    if (op.type == simOp_t::kSet)
+        model[modelKey(op.ns, op.key)] = op.value;
+    else if (op.type == simOp_t::kDelete)
+        model.erase(modelKey(op.ns, op.key));
+}
+
+//----------------------------------------------------------------------------------
+// Check the full contents of a store against the model - returns the number of differences
+
+static uint32_t checkStore(simStore &store, const simModel_t &model, bool bVerbose)
+{
+    uint32_t nDiff = 0;
+
+    for (uint8_t ns = 0; ns < kSimNameSpaces; ns++)
+    {
+        for (uint32_t i = 0; i < options.nKeysPerNS; i++)
+        {
+            std::string key = keyName(i);
+            auto it = model.find(modelKey(ns, key));
+            std::string result = store.check(ns, key, it == model.end() ? nullptr : &it->second);
+            if (!result.empty())
+            {
+                if (bVerbose)
+                    printf("    space%u/%s: %s\n", ns, key.c_str(), result.c_str());
+                nDiff++;
+            }
+        }
+    }
+    return nDiff;
+}
+
+//----------------------------------------------------------------------------------
+static bool openDevice(flxKVPStoreDeviceSim &device, const char *filename = "")
+{
+    if (!device.open(filename, options.nSectors))
+    {
+        printf("Unable to open the flash device\n");
+        return false;
+    }
+    device.setMode(options.mode);
+    device.setNORRule(options.norRule);
+    return true;
+}
+
+//----------------------------------------------------------------------------------
+// Benchmark
+//----------------------------------------------------------------------------------
+
+// NOR rule violations over all workloads
+static uint32_t benchViolations = 0;
+
+static void benchReport(const char *name, flxKVPStoreDeviceSim &device, double usWall)
+{
+    const flxKVPStoreDeviceSim::flxSimStats_t &stats = device.stats();
+
+    benchViolations += stats.violations;
+
+    printf("  %-28s %9.0f %8u %8u %9llu %6u %6u %10.1f\n", name, usWall, stats.reads, stats.programs,
+           (unsigned long long)stats.bytesProgrammed, stats.erases, stats.violations, stats.usFlash / 1000.);
+    device.resetStats();
+}
+
+template <typename T> static double timeIt(T work)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    work();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static int runBench(void)
+{
+    flxKVPStoreDeviceSim device;
+    if (!openDevice(device, options.filename))
+        return 1;
+
+    device.setLatency(kSimReadTime, kSimProgramTime, kSimEraseTime, options.bDelay);
+
+    printf("KVP store benchmark - %s device, %u sectors, %u keys\n",
+           options.mode == flxKVPStoreDeviceSim::kSimModeNOR ? "NOR" : "sector buffer", options.nSectors,
+           kSimNameSpaces * options.nKeysPerNS);
+    printf("  %-28s %9s %8s %8s %9s %6s %6s %10s\n", "workload", "wall(us)", "reads", "programs", "bytes",
+           "erases", "NOR!", "flash(ms)");
+
+    simRandom rand(options.seed);
+    simModel_t model;
+    std::vector<simOp_t> keys;
+
+    // The working set - every key, most are numbers, some strings
+    for (uint8_t ns = 0; ns < kSimNameSpaces; ns++)
+    {
+        for (uint32_t i = 0; i < options.nKeysPerNS; i++)
+        {
+            simOp_t op;
+            op.type = simOp_t::kSet;
+            op.ns = ns;
+            op.key = keyName(i);
+            op.value = randomValue(rand);
+            keys.push_back(op);
+        }
+    }
+    uint32_t nFail = 0;
+    double usWall;
+
+    {
+        simStore store(device);
+        if (!store.ok())
+        {
+            printf("Unable to initialize the store\n");
+            return 1;
+        }
+        device.resetStats();
+
+        usWall = timeIt([&]() {
+            store.store().beginTransaction();
+            for (auto &op : keys)
+            {
+                if (store.apply(op) != kKVPErrorOK)
+                    nFail++;
+            }
+            store.store().commitTransaction();
+        });
+        benchReport("populate (transaction)", device, usWall);
+
+        for (auto &op : keys)
+            applyToModel(model, op);
+    }
+
+    // boot - load the store and read every key
+    {
+        uint32_t nDiff = 0;
+        usWall = timeIt([&]() {
+            simStore store(device);
+            nDiff = checkStore(store, model, true);
+        });
+        nFail += nDiff;
+        benchReport("boot + read all", device, usWall);
+    }
+
+    simStore store(device);
+    device.resetStats();
+
+    // save the same values again - nothing should be written
+    usWall = timeIt([&]() {
+        store.store().beginTransaction();
+        for (auto &op : keys)
+            store.apply(op);
+        store.store().commitTransaction();
+    });
+    benchReport("rewrite unchanged", device, usWall);
+
+    // change 10% of the values
+    usWall = timeIt([&]() {
+        store.store().beginTransaction();
+        for (size_t i = 0; i < keys.size(); i += 10)
+        {
+            keys[i].value = randomValue(rand);
+            if (store.apply(keys[i]) != kKVPErrorOK)
+                nFail++;
+            applyToModel(model, keys[i]);
+        }
+        store.store().commitTransaction();
+    });
+    benchReport("update 10% (transaction)", device, usWall);
+
+    // churn - single updates, then updates grouped in transactions
+    for (int tx = 0; tx < 2; tx++)
+    {
+        usWall = timeIt([&]() {
+            for (uint32_t i = 0; i < options.nOps; i++)
+            {
+                if (tx && i % 20 == 0)
+                    store.store().beginTransaction();
+
+                simOp_t &op = keys[rand.range(keys.size())];
+                op.value.value = rand.next();
+                if (store.apply(op) != kKVPErrorOK)
+                    nFail++;
+                applyToModel(model, op);
+
+                if (tx && i % 20 == 19)
+                    store.store().commitTransaction();
+            }
+            store.store().commitTransaction();
+            store.store().commit();
+        });
+        benchReport(tx ? "churn (transactions of 20)" : "churn (single updates)", device, usWall);
+    }
+
+    nFail += checkStore(store, model, true);
+
+    printf("  sector erase counts:");
+    for (uint32_t i = 0; i < options.nSectors; i++)
+        printf(" %u", device.eraseCount(i));
+    printf("\n");
+
+    if (benchViolations)
+        printf("  FAIL: %u NOR violations\n", benchViolations);
+    nFail += benchViolations;
+
+    printf("  %s\n", nFail ? "FAILED" : "all values verified");
+
+    device.close();
+
+    return nFail ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------------
+// Fuzz - random operations, reads, compactions and reboots, checked against the model
+//----------------------------------------------------------------------------------
+
+static int runFuzz(void)
+{
+    flxKVPStoreDeviceSim device;
+    if (!openDevice(device))
+        return 1;
+
+    printf("KVP store fuzz - %s device, %u sectors, seed %u, %u operations\n",
+           options.mode == flxKVPStoreDeviceSim::kSimModeNOR ? "NOR" : "sector buffer", options.nSectors,
+           options.seed, options.nOps);
+
+    simRandom rand(options.seed);
+    simModel_t model;
+    uint32_t nReboots = 0, nCompactions = 0, nChecks = 0;
+
+    simStore *pStore = new simStore(device);
+    bool bInTransaction = false;
+
+    for (uint32_t i = 0; i < options.nOps; i++)
+    {
+        uint32_t choice = rand.range(100);
+        simOp_t op;
+        op.ns = rand.range(kSimNameSpaces);
+        op.key = keyName(rand.range(options.nKeysPerNS));
+
+        if (choice < 50 || choice >= 98)
+        {
+            // reboot - a clean shutdown - at 98+
+            if (choice >= 98)
+            {
+                pStore->store().commitTransaction();
+                pStore->store().commit();
+                delete pStore;
+                pStore = new simStore(device);
+                bInTransaction = false;
+                nReboots++;
+                if (!pStore->ok() || checkStore(*pStore, model, true))
+                {
+                    printf("  FAIL: op %u - contents differ after reboot\n", i);
+                    return 1;
+                }
+                continue;
+            }
+            op.type = rand.range(4) == 0 ? simOp_t::kDelete : simOp_t::kSet;
+            if (op.type == simOp_t::kSet)
+                op.value = randomValue(rand);
+
+            flxKVPError_t rc = pStore->apply(op);
+            if (rc != kKVPErrorOK && !(op.type == simOp_t::kDelete && rc == kKVPErrorNoMatch))
+            {
+                printf("  FAIL: op %u - %s %s failed (%d)\n", i, op.type == simOp_t::kSet ? "set" : "delete",
+                       op.key.c_str(), rc);
+                return 1;
+            }
+            applyToModel(model, op);
+        }
+        else if (choice < 90)
+        {
+            auto it = model.find(modelKey(op.ns, op.key));
+            std::string result = pStore->check(op.ns, op.key, it == model.end() ? nullptr : &it->second);
+            nChecks++;
+            if (!result.empty())
+            {
+                printf("  FAIL: op %u - space%u/%s: %s\n", i, op.ns, op.key.c_str(), result.c_str());
+                return 1;
+            }
+        }
+        else if (choice < 96)
+        {
+            if (bInTransaction)
+                pStore->store().commitTransaction();
+            else
+                pStore->store().beginTransaction();
+            bInTransaction = !bInTransaction;
+        }
+        else if (pStore->store().compact(choice == 96))
+            nCompactions++;
+    }
+
+    pStore->store().commitTransaction();
+    uint32_t nDiff = checkStore(*pStore, model, true);
+    delete pStore;
+
+    printf("  %u reads checked, %u reboots, %u compactions, %u NOR violations\n", nChecks, nReboots, nCompactions,
+           device.stats().violations);
+    nDiff += device.stats().violations;
+    printf("  %s\n", nDiff ? "FAILED" : "all values verified");
+
+    return nDiff ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------------
+// Power cut - run a sequence of operations, cutting power at each flash program/erase in turn. After
+// each cut, boot a store from the flash image and check it. Values committed before the cut must be
+// intact. A value changed since the last commit can have its old or a new value - or be missing, which
+// is counted as a lost update.
+//----------------------------------------------------------------------------------
+
+// run the operations - returns the index of the last commit before power was lost
+static long runOps(flxKVPStoreDeviceSim &device, const std::vector<simOp_t> &ops, long &inflight)
+{
+    simStore store(device);
+    long lastCommit = -1;
+    inflight = -1;
+
+    if (device.powerLost())
+        return -2;
+
+    store.store().beginTransaction();
+
+    for (size_t i = 0; i < ops.size(); i++)
+    {
+        store.apply(ops[i]);
+        if (device.powerLost())
+        {
+            inflight = i;
+            return lastCommit;
+        }
+        if (ops[i].type == simOp_t::kCommit)
+        {
+            store.store().commit();
+            if (device.powerLost())
+            {
+                inflight = i;
+                return lastCommit;
+            }
+            lastCommit = i;
+            store.store().beginTransaction();
+        }
+    }
+    store.store().commitTransaction();
+    store.store().commit();
+
+    return lastCommit;
+}
+
+static int runPowerCut(void)
+{
+    simRandom rand(options.seed);
+    std::vector<simOp_t> ops = randomOps(rand, options.nOps);
+
+    // A run without power cuts - to get the number of flash operations
+    flxKVPStoreDeviceSim full;
+    if (!openDevice(full))
+        return 1;
+
+    long inflight;
+    runOps(full, ops, inflight);
+    uint32_t nFlashOps = full.operations();
+
+    printf("KVP store power cut - %s device, %u sectors, seed %u, %zu operations, %u flash operations\n",
+           options.mode == flxKVPStoreDeviceSim::kSimModeNOR ? "NOR" : "sector buffer", options.nSectors,
+           options.seed, ops.size(), nFlashOps);
+
+    uint32_t nCuts = 0, nFail = 0, nLost = 0, nLostCuts = 0, nCorrupt = 0;
+    uint32_t nViolations = full.stats().violations;
+
+    for (int torn = 0; torn < 2; torn++)
+    {
+        for (uint32_t cut = 1; cut <= nFlashOps; cut++)
+        {
+            flxKVPStoreDeviceSim device;
+            if (!openDevice(device))
+                return 1;
+
+            device.cutPowerAfter(cut, torn);
+            long lastCommit = runOps(device, ops, inflight);
+            if (lastCommit == -2 || !device.powerLost())
+                continue; // cut during setup, or not reached
+
+            nCuts++;
+
+            // The committed state, and the keys changed since
+            simModel_t model;
+            std::map<std::string, std::vector<const simOp_t *>> changed;
+            for (long i = 0; i <= inflight; i++)
+            {
+                if (i <= lastCommit)
+                    applyToModel(model, ops[i]);
+                else if (ops[i].type != simOp_t::kCommit)
+                    changed[modelKey(ops[i].ns, ops[i].key)].push_back(&ops[i]);
+            }
+
+            // boot from the flash image
+            flxKVPStoreDeviceSim boot;
+            if (!openDevice(boot) || !boot.copyFrom(device))
+                return 1;
+
+            simStore store(boot);
+            uint32_t nCutFail = store.ok() ? 0 : 1, nCutLost = 0, nCutCorrupt = 0;
+
+            for (uint8_t ns = 0; ns < kSimNameSpaces && store.ok(); ns++)
+            {
+                for (uint32_t i = 0; i < options.nKeysPerNS; i++)
+                {
+                    std::string key = keyName(i);
+                    std::string mKey = modelKey(ns, key);
+                    auto it = model.find(mKey);
+                    const simValue_t *pCommitted = it == model.end() ? nullptr : &it->second;
+
+                    if (store.check(ns, key, pCommitted).empty())
+                        continue;
+
+                    auto itChanged = changed.find(mKey);
+                    if (itChanged == changed.end())
+                    {
+                        nCutFail++;
+                        continue;
+                    }
+                    bool bMatch = false;
+                    for (auto pOp : itChanged->second)
+                        bMatch = bMatch || store.check(ns, key, pOp->type == simOp_t::kSet ? &pOp->value : nullptr).empty();
+
+                    if (bMatch)
+                        continue;
+
+                    // missing, or a string rewritten in place that didn't complete?
+                    if (store.check(ns, key, nullptr).empty())
+                        nCutLost++;
+                    else if (store.corrupt(ns, key))
+                        nCutCorrupt++;
+                    else
+                        nCutFail++;
+                }
+            }
+
+            // and the store still works
+            simOp_t op;
+            op.type = simOp_t::kSet;
+            op.ns = 0;
+            op.key = "after";
+            op.value.isString = false;
+            op.value.value = 42;
+            if (store.ok() && (store.apply(op) != kKVPErrorOK || !store.check(0, "after", &op.value).empty()))
+                nCutFail++;
+
+            // Programs that break the NOR rule, before the cut and in the boot after it
+            uint32_t nCutViolations = device.stats().violations + boot.stats().violations;
+            nViolations += nCutViolations;
+            nCutFail += nCutViolations;
+
+            if (nCutFail)
+            {
+                if (nFail < 10)
+                    printf("  FAIL: cut at flash operation %u (%s) during op %ld - %u bad values\n", cut,
+                           torn ? "torn" : "clean", inflight, nCutFail);
+                nFail++;
+            }
+            nLost += nCutLost;
+            nLostCuts += nCutLost ? 1 : 0;
+            nCorrupt += nCutCorrupt;
+        }
+    }
+    printf("  %u power cuts (clean and torn): %u failures, %u uncommitted updates lost in %u cuts, %u uncommitted "
+           "strings corrupt, %u NOR violations\n",
+           nCuts, nFail, nLost, nLostCuts, nCorrupt, nViolations);
+
+    return nFail || nViolations ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------------
+static void usage(void)
+{
+    printf("Usage: flxKVPStoreSim bench|fuzz|powercut [-m nor|buffer] [-r program|reject|count] [-p sectors] [-n ops] "
+           "[-k keys] [-s seed] [-f file] [-d] [-v]\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        usage();
+        return 2;
+    }
+    std::string command = argv[1];
+
+    if (command == "powercut")
+        options.nOps = 300;
+
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (arg == "-d")
+            options.bDelay = true;
+        else if (arg == "-v")
+            flxHostLogLevel = flxLogVerbose;
+        else if (value && arg == "-m")
+        {
+            options.mode = strcmp(value, "buffer") == 0 ? flxKVPStoreDeviceSim::kSimModeSectorBuffer
+                                                        : flxKVPStoreDeviceSim::kSimModeNOR;
+            i++;
+        }
+        else if (value && arg == "-r")
+        {
+            if (strcmp(value, "program") == 0)
+                options.norRule = flxKVPStoreDeviceSim::kSimNORProgram;
+            else if (strcmp(value, "reject") == 0)
+                options.norRule = flxKVPStoreDeviceSim::kSimNORReject;
+            else if (strcmp(value, "count") == 0)
+                options.norRule = flxKVPStoreDeviceSim::kSimNORCount;
+            else
+            {
+                usage();
+                return 2;
+            }
+            i++;
+        }
+        else if (value && arg == "-p")
+            options.nSectors = strtoul(argv[++i], nullptr, 10);
+        else if (value && arg == "-n")
+            options.nOps = strtoul(argv[++i], nullptr, 10);
+        else if (value && arg == "-k")
+        {
+            uint32_t nKeys = strtoul(argv[++i], nullptr, 10);
+            options.nKeysPerNS = nKeys > kSimNameSpaces ? (nKeys + kSimNameSpaces - 1) / kSimNameSpaces : 1;
+        }
+        else if (value && arg == "-s")
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        else if (value && arg == "-f")
+            options.filename = argv[++i];
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if (command == "bench")
+        return runBench();
+    else if (command == "fuzz")
+        return runFuzz();
+    else if (command == "powercut")
+        return runPowerCut();
+
+    usage();
+    return 2;
+}
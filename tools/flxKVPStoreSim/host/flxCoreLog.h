@@ -0,0 +1,50 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for src/core/flux_base/flxCoreLog.h - just the logging macros used by the KVP store.
+// Messages go to stderr. Set flxHostLogLevel to change what's output.
+//
+
+#pragma once
+
+#include <cstdio>
+
+typedef enum
+{
+    flxLogError = 0,
+    flxLogWarning,
+    flxLogInfo,
+    flxLogDebug,
+    flxLogVerbose
+} flxLogLevel_t;
+
+extern flxLogLevel_t flxHostLogLevel;
+
+#ifndef F
+#define F(x) x
+#endif
+
+#define flxHostLog_(level, tag, format, ...)                                                                           \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (level <= flxHostLogLevel)                                                                                  \
+        {                                                                                                              \
+            fputs("[" tag "] ", stderr);                                                                               \
+            fprintf(stderr, format, ##__VA_ARGS__);                                                                    \
+            fputs("\n", stderr);                                                                                       \
+        }                                                                                                              \
+    } while (0)
+
+#define flxLog_E(format, ...) flxHostLog_(flxLogError, "E", format, ##__VA_ARGS__)
+#define flxLog_W(format, ...) flxHostLog_(flxLogWarning, "W", format, ##__VA_ARGS__)
+#define flxLog_I(format, ...) flxHostLog_(flxLogInfo, "I", format, ##__VA_ARGS__)
+#define flxLog_D(format, ...) flxHostLog_(flxLogDebug, "D", format, ##__VA_ARGS__)
+#define flxLog_V(format, ...) flxHostLog_(flxLogVerbose, "V", format, ##__VA_ARGS__)
@@ -0,0 +1,65 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for src/core/flux_base/flxCoreTypes.h - the data type codes used by the KVP store.
+// Values from flxCoreTypes.h. Duplicated so the KVP store builds without the framework.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "flxCoreLog.h"
+#include "flxUtils.h"
+
+enum flxDataType_t : std::uint8_t
+{
+    flxTypeNone = 0x00,
+    flxTypeBool = 0x0A,
+    flxTypeInt8 = 0x11,
+    flxTypeUInt8 = 0x01,
+    flxTypeInt16 = 0x12,
+    flxTypeUInt16 = 0x02,
+    flxTypeInt32 = 0x14,
+    flxTypeUInt32 = 0x04,
+    flxTypeFloat = 0x24,
+    flxTypeDouble = 0x28,
+    flxTypeString = 0x21
+};
+
+template <typename T, typename std::enable_if<std::is_integral<T>::value, void *>::type = nullptr>
+constexpr flxDataType_t flxGetTypeOf()
+{
+    return std::is_same<T, bool>::value
+               ? flxTypeBool
+               : (static_cast<flxDataType_t>(((std::is_signed<T>::value) ? 0x10 : 0x00) | sizeof(T)));
+}
+
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, void *>::type = nullptr>
+constexpr flxDataType_t flxGetTypeOf()
+{
+    return static_cast<flxDataType_t>(0x20 | sizeof(T));
+}
+
+template <typename T, typename std::enable_if<std::is_same<char *, T>::value || std::is_same<const char *, T>::value ||
+                                                  std::is_same<std::string, T>::value,
+                                              void *>::type = nullptr>
+constexpr flxDataType_t flxGetTypeOf()
+{
+    return flxTypeString;
+}
+
+template <typename T> constexpr flxDataType_t flxGetTypeOf(const T &)
+{
+    return flxGetTypeOf<T>();
+}
@@ -0,0 +1,34 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host implementations of the framework functions used by the KVP store.
+//
+
+#include "flxCoreLog.h"
+#include "flxUtils.h"
+
+flxLogLevel_t flxHostLogLevel = flxLogWarning;
+
+//---------------------------------------------------------------------------------------
+// Same CRC32 as flx_utils::calc_crc32() (reflected, polynomial 0xEDB88320) - computed bitwise, not from a table.
+// The result must match, so flash images are interchangeable with a device.
+
+uint32_t flx_utils::calc_crc32(uint32_t crc, const uint8_t *buf, uint32_t size)
+{
+    crc = ~crc;
+    while (size--)
+    {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
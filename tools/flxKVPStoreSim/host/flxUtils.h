@@ -0,0 +1,24 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for src/core/flux_base/flxUtils.h - the utilities used by the KVP store.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace flx_utils
+{
+uint32_t calc_crc32(uint32_t crc, const uint8_t *buf, uint32_t size);
+} // namespace flx_utils
@@ -0,0 +1,281 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxMQTTConnectSim - host test of the MQTT client connection job (flxMQTTESP32), with an in-process fake
+// broker on a simulated clock. Observations are written at 1 Hz while the broker goes away and comes
+// back, and the time the connection job blocks the main loop is measured.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -fpermissive -w -DESP32 -Ihost -I../flxOutboxSim/host -I../flxCSVBench/host
+//          -I../../src/core/flux_base -I../../src/core/flux_file -I../../src/core/flux_prefs
+//          -I../../src/core/flux_logging -I../../src/net/flux_network -I../../src/platform/platform_esp32/iot_mqtt
+//          -I../flxBinaryRoundTrip/host -o flxMQTTConnectSim flxMQTTConnectSim.cpp
+//          ../../src/net/flux_network/flxOutbox.cpp ../../src/core/flux_base/flxCoreJobs.cpp
+//          ../../src/core/flux_base/flxCore.cpp ../../src/core/flux_base/flxUtils.cpp
+//          ../../src/core/flux_base/flxCoreMsg.cpp
+//
+// The host directory has the fake broker - stand-ins for the WiFi and ArduinoMqttClient headers - and a
+// flxFlux.h stand-in without the devices. The other host stand-ins are shared with flxOutboxSim,
+// flxCSVBench and flxBinaryRoundTrip (last, so the framework headers are found first).
+//
+// Usage:
+//      flxMQTTConnectSim [-s seed]
+//
+// Scenarios - the broker is away from 60 s to 360 s of a 600 s run:
+//      down    - the broker is unreachable - a TCP connect times out
+//      stalled - the broker accepts TCP connections, but doesn't answer
+//
+// Reports the connect attempts (TCP connects and sessions), the longest time the connection job blocked
+// the main loop, the latest an observation was written, and how long the client took to reconnect.
+//
+// Checks - write() never blocks. The connection job blocks for at most the probe timeout while the broker
+// is down, and the session connect timeout while it's stalled. The client reconnects within the longest
+// backoff, and each message is published once, in order, or counted as dropped by the outbox.
+//
+// Exit status is 0 if all checks pass.
+//
+
+#include "flxMQTTESP32.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+//-------------------------------------------------------------------------------------
+// Simulated clock - blocking calls in the fake broker advance it
+
+static uint32_t simMillis = 0;
+
+unsigned long millis(void)
+{
+    return simMillis;
+}
+unsigned long micros(void)
+{
+    return simMillis * 1000;
+}
+void delay(unsigned long ms)
+{
+    simMillis += ms;
+}
+void simAdvance(uint32_t ms)
+{
+    simMillis += ms;
+}
+
+//-------------------------------------------------------------------------------------
+// Host stand-ins for the framework log and framework object
+
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const char *fmt, ...)
+{
+    return 0;
+}
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const int idFmt, ...)
+{
+    return 0;
+}
+flxLogging &flxLog = flxLogging::get();
+
+static flxFlux theFlux;
+flxFlux &flux = theFlux;
+
+// The network is always connected - no events are sent, so the client's event callback isn't kept
+_flxEventHub &flxEventHub = _flxEventHub::get();
+
+flxSignalBase *_flxEventHub::findSignal(uint32_t id)
+{
+    return nullptr;
+}
+void _flxEventHub::addSignal(uint32_t id, flxSignalBase *theSignal)
+{
+}
+
+// Settings aren't saved - the secure string properties refer to these
+bool flxStorageBlock::saveSecureString(const flxStorageTag &tag, const char *data)
+{
+    return false;
+}
+bool flxStorageBlock::restoreSecureString(const flxStorageTag &tag, char *data, size_t len)
+{
+    return false;
+}
+
+fakeBroker theBroker;
+
+//-------------------------------------------------------------------------------------
+static int nFailures = 0;
+
+#define CHECK(cond, ...)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            nFailures++;                                                                                               \
+            printf("    FAIL: ");                                                                                      \
+            printf(__VA_ARGS__);                                                                                       \
+            printf("\n");                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+//-------------------------------------------------------------------------------------
+// The network - always connected
+
+class fakeNetwork : public flxNetwork
+{
+  public:
+    bool isConnected()
+    {
+        return true;
+    }
+    IPAddress localIP(void)
+    {
+        return IPAddress();
+    }
+};
+
+//-------------------------------------------------------------------------------------
+#define kSimRunTime 600000
+#define kSimOutageStart 60000
+#define kSimOutageEnd 360000
+#define kSimObservationPeriod 1000
+
+static void runScenario(const char *szName, fakeBrokerState_t outage, uint32_t seed)
+{
+    simMillis = 0;
+    theBroker = fakeBroker();
+    randomSeed(seed);
+
+    fakeNetwork theNetwork;
+    flxMQTTESP32 theClient;
+
+    theClient.server = "broker.local";
+    theClient.clientName = "flxMQTTConnectSim";
+    theClient.topic = "sim/data";
+    theClient.outboxSize = 128;
+    theClient.setNetwork(&theNetwork);
+    theClient.enabled = true;
+
+    uint32_t nLogged = 0;
+    uint32_t tNextObservation = kSimObservationPeriod;
+    uint32_t msLatest = 0;
+    uint32_t msWrite = 0;
+    uint32_t msBlockOutage = 0;
+    uint32_t msBlockTotal = 0;
+    uint32_t tReconnect = 0;
+    uint32_t nOutageConnects = 0;
+    uint32_t nOutageSessions = 0;
+    char szMessage[32];
+
+    while (simMillis < kSimRunTime)
+    {
+        bool bOutage = simMillis >= kSimOutageStart && simMillis < kSimOutageEnd;
+        theBroker.setState(bOutage ? outage : kFakeBrokerUp);
+
+        if (simMillis >= kSimOutageEnd && tReconnect == 0 && theClient.connected())
+            tReconnect = simMillis;
+
+        if (simMillis >= tNextObservation)
+        {
+            msLatest = std::max(msLatest, simMillis - tNextObservation);
+
+            snprintf(szMessage, sizeof(szMessage), "%u", nLogged++);
+            uint32_t t0 = simMillis;
+            theClient.write(szMessage, true, flxLineTypeData);
+            msWrite = std::max(msWrite, simMillis - t0);
+
+            tNextObservation += kSimObservationPeriod;
+        }
+
+        uint32_t nConnects = theBroker.nTCPConnects;
+        uint32_t nSessions = theBroker.nSessions;
+        uint32_t t0 = simMillis;
+
+        flxJobQueue.loop();
+
+        if (bOutage)
+        {
+            msBlockOutage = std::max(msBlockOutage, simMillis - t0);
+            msBlockTotal += simMillis - t0;
+            nOutageConnects += theBroker.nTCPConnects - nConnects;
+            nOutageSessions += theBroker.nSessions - nSessions;
+        }
+        simMillis++;
+    }
+
+    // Published once, in order - or dropped
+    uint32_t nOrder = 0;
+    int64_t last = -1;
+    for (auto &aMessage : theBroker.messages)
+    {
+        int64_t seq = strtol(aMessage.c_str(), nullptr, 10);
+        if (seq <= last)
+            nOrder++;
+        last = seq;
+    }
+    uint32_t nPublished = theBroker.messages.size();
+    uint32_t nDropped = theClient.outboxDropped();
+
+    printf("  %-8s %u observations, the broker away from %u s to %u s\n", szName, nLogged, kSimOutageStart / 1000,
+           kSimOutageEnd / 1000);
+    printf("    away       %3u TCP connects %3u sessions, longest block %5u ms, blocked %6u ms in total\n",
+           nOutageConnects, nOutageSessions, msBlockOutage, msBlockTotal);
+    printf("    logging    write() %u ms, an observation written up to %u ms late\n", msWrite, msLatest);
+    printf("    back       reconnected after %.1f s, %u published, %u dropped\n",
+           tReconnect ? (tReconnect - kSimOutageEnd) / 1000.0 : -1.0, nPublished, nDropped);
+
+    uint32_t msBound = (outage == kFakeBrokerDown ? kMQTTProbeTimeout : kMQTTConnectTimeout) + 2 * theBroker.msRoundTrip;
+
+    CHECK(msWrite == 0, "%s - write() blocked for %u ms", szName, msWrite);
+    CHECK(msBlockOutage <= msBound, "%s - the connection job blocked for %u ms, over %u ms", szName, msBlockOutage,
+          msBound);
+    CHECK(tReconnect > 0 && tReconnect - kSimOutageEnd <= kMQTTBackoffMax * 3 / 2 + 2 * kMQTTConnectionJobPeriod,
+          "%s - no reconnect within the longest backoff", szName);
+    CHECK(nOrder == 0, "%s - %u messages published out of order, or again", szName, nOrder);
+    CHECK(nPublished + nDropped == nLogged, "%s - %u published and %u dropped, of %u logged", szName, nPublished,
+          nDropped, nLogged);
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-s seed]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    printf("mqtt connection - %u s runs, an observation every %u ms, seed %u\n", kSimRunTime / 1000,
+           kSimObservationPeriod, seed);
+
+    flxJobQueue.start();
+
+    runScenario("down", kFakeBrokerDown, seed);
+    runScenario("stalled", kFakeBrokerStalled, seed);
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}
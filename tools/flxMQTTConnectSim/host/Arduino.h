@@ -0,0 +1,26 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for the Arduino core - the flxBinaryRoundTrip stand-in, plus what the MQTT client uses.
+//
+
+#pragma once
+
+#include "../../flxBinaryRoundTrip/host/Arduino.h"
+
+inline long random(long max)
+{
+    return random(0, max);
+}
+
+class IPAddress
+{
+};
@@ -0,0 +1,115 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for ArduinoMqttClient - sessions with the fake broker of flxMQTTConnectSim. connect()
+// makes the TCP connection, then waits for the broker to accept the session - the connection timeout if
+// the broker is stalled.
+//
+
+#pragma once
+
+#include "WiFi.h"
+
+#define MQTT_CONNECTION_REFUSED -2
+#define MQTT_CONNECTION_TIMEOUT -1
+#define MQTT_SUCCESS 0
+
+class MqttClient
+{
+  public:
+    MqttClient(WiFiClient &client)
+        : _client{&client}, _connected{false}, _connectError{MQTT_SUCCESS}, _msConnectionTimeout{30000}
+    {
+    }
+
+    void setId(const char *id)
+    {
+    }
+    void setKeepAliveInterval(unsigned long interval)
+    {
+    }
+    void setConnectionTimeout(unsigned long timeout)
+    {
+        _msConnectionTimeout = timeout;
+    }
+    void setCleanSession(bool cleanSession)
+    {
+    }
+    void setUsernamePassword(const char *username, const char *password)
+    {
+    }
+    void setTxPayloadSize(unsigned short size)
+    {
+    }
+
+    int connect(const char *host, uint16_t port = 1883)
+    {
+        _connected = false;
+        if (!_client->connect(host, port))
+        {
+            _connectError = MQTT_CONNECTION_REFUSED;
+            return 0;
+        }
+        if (theBroker.state() == kFakeBrokerStalled)
+        {
+            simAdvance(_msConnectionTimeout);
+            _client->stop();
+            _connectError = MQTT_CONNECTION_TIMEOUT;
+            return 0;
+        }
+        simAdvance(theBroker.msRoundTrip);
+        theBroker.nSessions++;
+        _connected = true;
+        _connectError = MQTT_SUCCESS;
+        return 1;
+    }
+    int connectError(void)
+    {
+        return _connectError;
+    }
+    int connected(void)
+    {
+        return _connected && _client->connected();
+    }
+    void poll(void)
+    {
+    }
+    void stop(void)
+    {
+        _connected = false;
+        _client->stop();
+    }
+
+    int beginMessage(const char *topic, bool retain = false, uint8_t qos = 0)
+    {
+        _message.clear();
+        return connected();
+    }
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+        _message.append((const char *)buffer, size);
+        return size;
+    }
+    int endMessage(void)
+    {
+        if (!connected())
+            return 0;
+        theBroker.messages.push_back(_message);
+        return 1;
+    }
+
+  private:
+    WiFiClient *_client;
+    bool _connected;
+    int _connectError;
+    unsigned long _msConnectionTimeout;
+    std::string _message;
+};
@@ -0,0 +1,24 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for the Arduino FS header - the file and file system types the framework file interface
+// returns on the ESP32.
+//
+
+#pragma once
+
+class File
+{
+};
+
+class FS
+{
+};
@@ -0,0 +1,18 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for the Arduino WString.h - the flash string type named in flxCoreLog.h. This build
+// defines ESP32, where the type isn't in the arduino namespace.
+//
+
+#pragma once
+
+class __FlashStringHelper;
@@ -0,0 +1,110 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for the ESP32 WiFi client - TCP connections to an in-process fake broker, on the
+// simulated clock of flxMQTTConnectSim. A connect takes the round trip time, or the connect timeout if
+// the broker is down.
+//
+
+#pragma once
+
+#include "Arduino.h"
+
+#include <string>
+#include <vector>
+
+// ESP32 WiFiClient connect timeout (ms), when none is given
+#define kFakeClientTimeout 3000
+
+typedef enum
+{
+    kFakeBrokerUp,      // accepts connections and sessions
+    kFakeBrokerDown,    // unreachable - a TCP connect times out
+    kFakeBrokerStalled, // accepts TCP connections, but doesn't answer
+} fakeBrokerState_t;
+
+// The fake broker - the MQTT client stand-in publishes to it
+class fakeBroker
+{
+  public:
+    fakeBroker() : msRoundTrip{20}, epoch{0}, nTCPConnects{0}, nSessions{0}, _state{kFakeBrokerUp}
+    {
+    }
+
+    // A change of state drops the open connections
+    void setState(fakeBrokerState_t state)
+    {
+        if (state != _state)
+            epoch++;
+        _state = state;
+    }
+    fakeBrokerState_t state(void)
+    {
+        return _state;
+    }
+
+    uint32_t msRoundTrip;
+    uint32_t epoch;
+    uint32_t nTCPConnects;
+    uint32_t nSessions;
+
+    // Published messages, in the order received
+    std::vector<std::string> messages;
+
+  private:
+    fakeBrokerState_t _state;
+};
+
+extern fakeBroker theBroker;
+
+// Advance the simulated clock - the time a blocking call takes
+void simAdvance(uint32_t ms);
+
+class WiFiClient
+{
+  public:
+    WiFiClient() : _connected{false}, _epoch{0}
+    {
+    }
+    virtual ~WiFiClient()
+    {
+    }
+
+    int connect(const char *host, uint16_t port)
+    {
+        return connect(host, port, kFakeClientTimeout);
+    }
+    int connect(const char *host, uint16_t port, int32_t timeout_ms)
+    {
+        theBroker.nTCPConnects++;
+        if (theBroker.state() == kFakeBrokerDown)
+        {
+            simAdvance(timeout_ms);
+            return 0;
+        }
+        simAdvance(theBroker.msRoundTrip);
+        _connected = true;
+        _epoch = theBroker.epoch;
+        return 1;
+    }
+    uint8_t connected(void)
+    {
+        return _connected && _epoch == theBroker.epoch;
+    }
+    void stop(void)
+    {
+        _connected = false;
+    }
+
+  private:
+    bool _connected;
+    uint32_t _epoch;
+};
@@ -0,0 +1,35 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for the ESP32 secure WiFi client - the settings the MQTT secure client makes. The
+// connection is the plain fake client - flxMQTTConnectSim runs the plain MQTT client.
+//
+
+#pragma once
+
+#include "WiFi.h"
+
+class WiFiClientSecure : public WiFiClient
+{
+  public:
+    void setCACert(const char *rootCA)
+    {
+    }
+    void setCertificate(const char *client_ca)
+    {
+    }
+    void setPrivateKey(const char *private_key)
+    {
+    }
+    void setHandshakeTimeout(unsigned long handshake_timeout)
+    {
+    }
+};
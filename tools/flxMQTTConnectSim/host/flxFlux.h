@@ -0,0 +1,32 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for src/core/flux_base/flxFlux.h - the MQTT client adds itself to the framework, and
+// nothing more. The devices and buses aren't needed.
+//
+
+#pragma once
+
+#include "flxCore.h"
+#include "flxCoreJobs.h"
+
+class flxFlux
+{
+  public:
+    void add(flxAction &theAction)
+    {
+    }
+    void add(flxAction *theAction)
+    {
+    }
+};
+
+extern flxFlux &flux;
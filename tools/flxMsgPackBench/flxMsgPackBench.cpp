@@ -0,0 +1,561 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxMsgPackBench - host benchmark of the MessagePack output formatter (flxFormatMsgPack) against the
+// JSON output formatter (flxFormatJSON - ArduinoJson serializeJson()). Logs the same observations to
+// both formatters, and compares the size and time of each output.
+//
+// ArduinoJson is header only - the library source is all that's needed (https://arduinojson.org, v7).
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -fpermissive -w -I<ArduinoJson>/src -I../flxBinaryRoundTrip/host
+//          -I../../src/core/flux_base -I../../src/core/flux_logging -o flxMsgPackBench flxMsgPackBench.cpp
+//          ../../src/core/flux_base/flxCoreMsg.cpp
+//
+// The host stand-ins for the Arduino headers are shared with flxBinaryRoundTrip. flxCoreMsg.cpp has the
+// message table the log object refers to.
+//
+// Usage:
+//      flxMsgPackBench [-n observations] [-s seed]
+//
+// Each observation has 5 sections of 6 values - float, double, int32, uint16, bool and a short string.
+// Reports for each format:
+//      bytes       - output size per observation. For MessagePack, the dictionary is sent once per
+//                    session, and is reported on its own
+//      time        - time per observation, from beginObservation() to the output of writeObservation()
+//      allocs      - heap allocations (operator new) per observation, once the buffers have settled.
+//                    ArduinoJson allocates its document memory with malloc(), so isn't counted
+//
+// The MessagePack output is decoded, the value ids mapped to names with the dictionary, and each value
+// checked against the JSON output of the same observation. Exit status is 0 if all values match, and
+// the MessagePack formatter makes no allocations once its buffers have settled.
+//
+
+#include "flxCoreLog.h"
+#include "flxFmtJSON.h"
+#include "flxFmtMsgPack.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Host stand-in for the framework log - used by the JSON formatter error path
+
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const char *fmt, ...)
+{
+    return 0;
+}
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const int idFmt, ...)
+{
+    return 0;
+}
+flxLogging &flxLog = flxLogging::get();
+
+//-------------------------------------------------------------------------------------
+// Allocation counting
+
+static uint32_t nAllocs = 0;
+
+void *operator new(size_t size)
+{
+    nAllocs++;
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+//-------------------------------------------------------------------------------------
+static int nFailures = 0;
+
+#define CHECK(cond, ...)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            nFailures++;                                                                                               \
+            printf("    FAIL: ");                                                                                      \
+            printf(__VA_ARGS__);                                                                                       \
+            printf("\n");                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+//-------------------------------------------------------------------------------------
+// A writer that keeps the last output of each type - text lines (JSON) or binary (MessagePack)
+
+class benchWriter : public flxWriter
+{
+  public:
+    benchWriter(bool bBinary) : nBytes{0}, _bBinary{bBinary}
+    {
+        text.reserve(2048);
+        message.reserve(1024);
+    }
+
+    void write(int32_t value)
+    {
+    }
+    void write(float value)
+    {
+    }
+    void write(const char *value, bool newline, flxLineType_t type)
+    {
+        if (type != flxLineTypeData)
+            return;
+        text = value;
+        nBytes += text.length();
+    }
+    bool acceptsBinary(void)
+    {
+        return _bBinary;
+    }
+    void writeBytes(const uint8_t *data, size_t length, flxLineType_t type)
+    {
+        if (type == flxLineTypeHeader)
+            dictionary.assign(data, data + length);
+        else
+        {
+            message.assign(data, data + length);
+            nBytes += length;
+        }
+    }
+
+    uint64_t nBytes;
+    std::string text;
+    std::vector<uint8_t> dictionary;
+    std::vector<uint8_t> message;
+
+  private:
+    bool _bBinary;
+};
+
+//-------------------------------------------------------------------------------------
+// The observation - 5 sections of 6 values, the values from the given generator
+
+#define kBenchSections 5
+#define kBenchValues 6
+
+class benchObservation
+{
+  public:
+    benchObservation()
+    {
+        static const char *kTags[] = {"Temperature", "Pressure", "Count", "Status", "Valid", "Mode"};
+        char szName[32];
+
+        for (int i = 0; i < kBenchSections; i++)
+        {
+            snprintf(szName, sizeof(szName), "Device%d", i);
+            sections.push_back(szName);
+        }
+        for (int i = 0; i < kBenchValues; i++)
+            tags.push_back(kTags[i]);
+    }
+
+    template <typename F> void log(F &theFormat, std::mt19937 &rng)
+    {
+        static const char *kModes[] = {"idle", "sampling", "error"};
+        std::uniform_real_distribution<float> fValue(-40.0, 125.0);
+        std::uniform_real_distribution<double> dValue(900.0, 1100.0);
+        std::uniform_int_distribution<int32_t> iValue(-100000, 100000);
+        std::uniform_int_distribution<uint32_t> uValue(0, 65535);
+
+        theFormat.beginObservation();
+        for (auto &aSection : sections)
+        {
+            theFormat.beginSection(aSection.c_str());
+            theFormat.logValue(tags[0], fValue(rng), 2);
+            theFormat.logValue(tags[1], dValue(rng), 3);
+            theFormat.logValue(tags[2], iValue(rng));
+            theFormat.logValue(tags[3], (uint16_t)uValue(rng));
+            theFormat.logValue(tags[4], (bool)(uValue(rng) & 1));
+            theFormat.logValue(tags[5], kModes[uValue(rng) % 3]);
+            theFormat.endSection();
+        }
+        theFormat.endObservation();
+        theFormat.writeObservation();
+        theFormat.clearObservation();
+    }
+
+    std::vector<std::string> sections;
+    std::vector<std::string> tags;
+};
+
+//-------------------------------------------------------------------------------------
+typedef struct
+{
+    double bytes;
+    double usObservation;
+    double allocs;
+} benchResult_t;
+
+template <typename F>
+static benchResult_t runFormat(F &theFormat, benchWriter &theWriter, uint32_t nObservations, uint32_t seed)
+{
+    benchObservation theObservation;
+    std::mt19937 rng(seed);
+    benchResult_t result;
+
+    // first observation - outputs the headers, and settles the buffers
+    theObservation.log(theFormat, rng);
+    theWriter.nBytes = 0;
+
+    uint32_t startAllocs = nAllocs;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nObservations; i++)
+        theObservation.log(theFormat, rng);
+    auto t1 = std::chrono::steady_clock::now();
+
+    result.bytes = (double)theWriter.nBytes / nObservations;
+    result.usObservation = std::chrono::duration<double, std::micro>(t1 - t0).count() / nObservations;
+    result.allocs = (double)(nAllocs - startAllocs) / nObservations;
+
+    return result;
+}
+
+//-------------------------------------------------------------------------------------
+// Check - decode the MessagePack output, and compare each value with the JSON output of the same
+// observation (parsed with deserializeJson()).
+//
+// The decoder is just the encodings the formatter outputs. ArduinoJson isn't used for this - the
+// formatter's map keys are integers, and ArduinoJson only takes string keys.
+
+typedef enum
+{
+    kPackNil,
+    kPackBool,
+    kPackInt,
+    kPackFloat,
+    kPackString,
+    kPackArray,
+    kPackMap,
+    kPackInvalid
+} packType_t;
+
+typedef struct
+{
+    packType_t type;
+    int64_t iValue; // bool, integer, and array/map count
+    double dValue;
+    std::string sValue;
+} packValue_t;
+
+class packReader
+{
+  public:
+    packReader(const std::vector<uint8_t> &data) : _data{data}, _pos{0}
+    {
+    }
+
+    bool next(packValue_t &value)
+    {
+        value.type = kPackInvalid;
+        if (_pos >= _data.size())
+            return false;
+
+        uint8_t code = _data[_pos++];
+
+        if (code < 0x80 || code >= 0xE0)
+            return setInt(value, (int8_t)code < 0 ? (int8_t)code : code);
+        if ((code & 0xF0) == 0x80)
+            return setCount(value, kPackMap, code & 0x0F);
+        if ((code & 0xF0) == 0x90)
+            return setCount(value, kPackArray, code & 0x0F);
+        if ((code & 0xE0) == 0xA0)
+            return readString(value, code & 0x1F);
+
+        uint64_t raw;
+        switch (code)
+        {
+        case 0xC0:
+            value.type = kPackNil;
+            return true;
+        case 0xC2:
+        case 0xC3:
+            value.type = kPackBool;
+            value.iValue = code == 0xC3;
+            return true;
+        case 0xCA:
+            if (!readBE(raw, 4))
+                return false;
+            {
+                uint32_t bits = raw;
+                float fValue;
+                memcpy(&fValue, &bits, sizeof(fValue));
+                value.type = kPackFloat;
+                value.dValue = fValue;
+            }
+            return true;
+        case 0xCB:
+            if (!readBE(raw, 8))
+                return false;
+            memcpy(&value.dValue, &raw, sizeof(value.dValue));
+            value.type = kPackFloat;
+            return true;
+        case 0xCC:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            return readBE(raw, 1 << (code - 0xCC)) && setInt(value, raw);
+        case 0xD0:
+            return readBE(raw, 1) && setInt(value, (int8_t)raw);
+        case 0xD1:
+            return readBE(raw, 2) && setInt(value, (int16_t)raw);
+        case 0xD2:
+            return readBE(raw, 4) && setInt(value, (int32_t)raw);
+        case 0xD9:
+        case 0xDA:
+            return readBE(raw, 1 << (code - 0xD9)) && readString(value, raw);
+        case 0xDC:
+        case 0xDE:
+            return readBE(raw, 2) && setCount(value, code == 0xDC ? kPackArray : kPackMap, raw);
+        case 0xDD:
+        case 0xDF:
+            return readBE(raw, 4) && setCount(value, code == 0xDD ? kPackArray : kPackMap, raw);
+        default:
+            return false;
+        }
+    }
+
+    bool atEnd(void)
+    {
+        return _pos == _data.size();
+    }
+
+  private:
+    bool readBE(uint64_t &value, size_t size)
+    {
+        if (_pos + size > _data.size())
+            return false;
+        value = 0;
+        for (size_t i = 0; i < size; i++)
+            value = (value << 8) | _data[_pos++];
+        return true;
+    }
+    bool readString(packValue_t &value, size_t length)
+    {
+        if (_pos + length > _data.size())
+            return false;
+        value.type = kPackString;
+        value.sValue.assign((const char *)_data.data() + _pos, length);
+        _pos += length;
+        return true;
+    }
+    bool setInt(packValue_t &value, int64_t iValue)
+    {
+        value.type = kPackInt;
+        value.iValue = iValue;
+        return true;
+    }
+    bool setCount(packValue_t &value, packType_t type, int64_t count)
+    {
+        value.type = type;
+        value.iValue = count;
+        return true;
+    }
+
+    const std::vector<uint8_t> &_data;
+    size_t _pos;
+};
+
+// Read the [type, ...] array header of a payload, and check its type and item count
+static bool readPayloadHeader(packReader &theReader, uint8_t type, int64_t nItems)
+{
+    packValue_t value;
+    return theReader.next(value) && value.type == kPackArray && value.iValue == nItems && theReader.next(value) &&
+           value.type == kPackInt && value.iValue == type;
+}
+
+static bool sameValue(const packValue_t &vPack, JsonVariantConst vJSON)
+{
+    if (vJSON.is<bool>())
+        return vPack.type == kPackBool && (vPack.iValue != 0) == vJSON.as<bool>();
+
+    if (vJSON.is<const char *>())
+        return vPack.type == kPackString && vPack.sValue == vJSON.as<const char *>();
+
+    if (vJSON.is<long long>())
+        return vPack.type == kPackInt && vPack.iValue == vJSON.as<long long>();
+
+    // MessagePack floats are float32, and the JSON output is rounded - so compare at float precision
+    if (vPack.type != kPackFloat || !vJSON.is<double>())
+        return false;
+    double expect = vJSON.as<double>();
+    return fabs(vPack.dValue - expect) <= fabs(expect) * 1e-6 + 1e-6;
+}
+
+static void checkOutput(uint32_t nObservations, uint32_t seed)
+{
+    flxFormatJSON<1600> jsonFormat;
+    flxFormatMsgPack msgFormat;
+    benchWriter jsonWriter(false);
+    benchWriter msgWriter(true);
+
+    jsonFormat.add(jsonWriter);
+    msgFormat.add(msgWriter);
+
+    benchObservation theObservation;
+    std::mt19937 jsonRNG(seed);
+    std::mt19937 msgRNG(seed);
+
+    std::map<int64_t, std::string> names;
+    JsonDocument jsonDoc;
+    packValue_t key;
+    packValue_t value;
+    uint32_t nValues = 0;
+    uint32_t nDiffer = 0;
+    uint32_t nMissing = 0;
+    bool bValid = true;
+
+    for (uint32_t i = 0; i < nObservations && bValid; i++)
+    {
+        theObservation.log(jsonFormat, jsonRNG);
+        theObservation.log(msgFormat, msgRNG);
+
+        // the dictionary - [0, {id: "{section}.{tag}", ...}]
+        if (names.size() == 0)
+        {
+            packReader theReader(msgWriter.dictionary);
+            bValid = readPayloadHeader(theReader, kMsgPackTypeDictionary, 2) && theReader.next(value) &&
+                     value.type == kPackMap;
+            for (int64_t n = value.iValue; bValid && n > 0; n--)
+            {
+                bValid = theReader.next(key) && key.type == kPackInt && theReader.next(value) &&
+                         value.type == kPackString;
+                names[key.iValue] = value.sValue;
+            }
+            bValid = bValid && theReader.atEnd();
+            CHECK(bValid, "the dictionary doesn't decode");
+            if (!bValid)
+                break;
+        }
+
+        // the observation - [1, sequence number, {id: value, ...}]
+        packReader theReader(msgWriter.message);
+        bValid = !deserializeJson(jsonDoc, jsonWriter.text) &&
+                 readPayloadHeader(theReader, kMsgPackTypeObservation, 3) && theReader.next(value) &&
+                 value.type == kPackInt && value.iValue == i && theReader.next(value) && value.type == kPackMap;
+
+        for (int64_t n = value.iValue; bValid && n > 0; n--)
+        {
+            bValid = theReader.next(key) && key.type == kPackInt && theReader.next(value);
+            if (!bValid)
+                break;
+            nValues++;
+
+            auto itName = names.find(key.iValue);
+            if (itName == names.end())
+            {
+                nMissing++;
+                continue;
+            }
+            size_t dot = itName->second.find('.');
+            std::string section = itName->second.substr(0, dot);
+            std::string tag = itName->second.substr(dot + 1);
+
+            if (!sameValue(value, jsonDoc[section][tag]))
+                nDiffer++;
+        }
+        bValid = bValid && theReader.atEnd();
+        CHECK(bValid, "observation %u doesn't decode", i);
+    }
+
+    printf("check - %u observations, %u values decoded\n", nObservations, nValues);
+    if (bValid)
+    {
+        CHECK(nValues == nObservations * kBenchSections * kBenchValues, "%u values decoded, %u expected", nValues,
+              nObservations * kBenchSections * kBenchValues);
+        CHECK(nMissing == 0, "%u values have ids that aren't in the dictionary", nMissing);
+        CHECK(nDiffer == 0, "%u values differ from the JSON output", nDiffer);
+    }
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-n observations] [-s seed]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t nObservations = 100000;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            nObservations = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nObservations == 0)
+        nObservations = 1;
+
+    printf("observation - %d sections of %d values, %u observations\n", kBenchSections, kBenchValues,
+           nObservations);
+
+    benchResult_t jsonResult;
+    {
+        flxFormatJSON<1600> jsonFormat;
+        benchWriter jsonWriter(false);
+        jsonFormat.add(jsonWriter);
+        jsonResult = runFormat(jsonFormat, jsonWriter, nObservations, seed);
+    }
+
+    benchResult_t msgResult;
+    size_t dictionarySize;
+    {
+        flxFormatMsgPack msgFormat;
+        benchWriter msgWriter(true);
+        msgFormat.add(msgWriter);
+        msgResult = runFormat(msgFormat, msgWriter, nObservations, seed);
+        dictionarySize = msgWriter.dictionary.size();
+    }
+
+    printf("  %-10s %8.1f bytes %8.2f us per observation %6.2f allocations per observation\n", "json",
+           jsonResult.bytes, jsonResult.usObservation, jsonResult.allocs);
+    printf("  %-10s %8.1f bytes %8.2f us per observation %6.2f allocations per observation\n", "msgpack",
+           msgResult.bytes, msgResult.usObservation, msgResult.allocs);
+    printf("  dictionary %6zu bytes, once per session - msgpack is %.1f%% of the json size\n", dictionarySize,
+           jsonResult.bytes > 0 ? 100.0 * msgResult.bytes / jsonResult.bytes : 0);
+
+    CHECK(msgResult.allocs == 0, "the MessagePack formatter allocated memory once its buffers settled");
+
+    checkOutput(nObservations < 1000 ? nObservations : 1000, seed);
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}
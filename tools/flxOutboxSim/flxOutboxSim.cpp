@@ -0,0 +1,691 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxOutboxSim - host test of the IoT outbox (flxOutbox), the store and forward queue the HTTP and MQTT
+// clients send through. Messages are logged on a simulated clock and sent over a fake network link that
+// drops part way through a stream, with the device restarting and the SD card failing writes, and every
+// message logged is accounted for.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -fpermissive -w -Ihost -I../flxCSVBench/host -I../flxBinaryRoundTrip/host
+//          -I../../src/core/flux_base -I../../src/core/flux_file -I../../src/net/flux_network -o flxOutboxSim
+//          flxOutboxSim.cpp ../../src/net/flux_network/flxOutbox.cpp ../../src/core/flux_base/flxCoreJobs.cpp
+//          ../../src/core/flux_base/flxUtils.cpp ../../src/core/flux_base/flxCoreMsg.cpp
+//
+// The host directory has stand-ins for the Arduino file headers. The other host stand-ins are shared with
+// flxBinaryRoundTrip and flxCSVBench.
+//
+// Usage:
+//      flxOutboxSim [-s seed]
+//
+// Scenarios - the outbox holds 16 messages in memory, the rest spill to a file system in memory:
+//      outage      - the link is down while 400 messages are logged, then comes up
+//      drops       - the link drops after a random number of sends, for a random time, while logging
+//      restart     - the device restarts (a new outbox on the same file system) during the replay
+//      power loss  - the power fails part way through a drain pass - nothing more reaches the card
+//      torn append - the card fails part way through a spill write
+//
+// Each run (start up) has its own dictionary - the outbox context - and a new version of it every 150
+// messages. A version has the names of the versions before it in that run, but not of other runs.
+//
+// Checks - each message logged is received once, in order, or it's accounted for: dropped by the outbox,
+// or lost from memory at a restart. After a power loss, messages sent since the replay position was saved
+// can be received again - up to kOutboxBatchSize. Each message is received after a dictionary that has its
+// names - from its run, the version it was logged with or later. When the outbox is empty, no spill files
+// are left.
+//
+// Exit status is 0 if all checks pass.
+//
+
+#include "flxOutbox.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Simulated clock
+
+static uint32_t simMillis = 0;
+
+unsigned long millis(void)
+{
+    return simMillis;
+}
+unsigned long micros(void)
+{
+    return simMillis * 1000;
+}
+void delay(unsigned long ms)
+{
+    simMillis += ms;
+}
+
+//-------------------------------------------------------------------------------------
+// Host stand-in for the framework log - the outbox warnings are counted
+
+static uint32_t nWarnings = 0;
+
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const char *fmt, ...)
+{
+    if (level == flxLogWarning)
+        nWarnings++;
+    return 0;
+}
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const int idFmt, ...)
+{
+    return 0;
+}
+flxLogging &flxLog = flxLogging::get();
+
+//-------------------------------------------------------------------------------------
+static int nFailures = 0;
+
+#define CHECK(cond, ...)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            nFailures++;                                                                                               \
+            printf("    FAIL: ");                                                                                      \
+            printf(__VA_ARGS__);                                                                                       \
+            printf("\n");                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+//-------------------------------------------------------------------------------------
+// A file system in memory. Faults:
+//      frozen      - nothing more is written (power loss) - opens for write fail, remove and rename fail
+//      tornWrite   - the Nth write to the spill file from now writes half the data
+
+typedef std::shared_ptr<std::vector<uint8_t>> memData_t;
+
+class memFS;
+
+class memFile : public flxIFile
+{
+  public:
+    memFile(memFS &fs, memData_t data) : _fs{fs}, _data{data}, _position{0}, _bOpen{true}
+    {
+    }
+
+    size_t write(const uint8_t *buf, size_t size);
+
+    void close(void)
+    {
+        _bOpen = false;
+    }
+    bool isValid(void)
+    {
+        return _bOpen;
+    }
+    void flush(void)
+    {
+    }
+    size_t size(void)
+    {
+        return _data->size();
+    }
+    size_t read(uint8_t *buf, size_t size)
+    {
+        size_t n = std::min(size, _data->size() - _position);
+        memcpy(buf, _data->data() + _position, n);
+        _position += n;
+        return n;
+    }
+    const char *name(void)
+    {
+        return "";
+    }
+    bool isDirectory(void)
+    {
+        return false;
+    }
+    std::string getNextFilename(void)
+    {
+        return "";
+    }
+    int available(void)
+    {
+        return _data->size() - _position;
+    }
+    Stream *stream(void)
+    {
+        return nullptr;
+    }
+    flxFSFile openNextFile(void)
+    {
+        return flxFSFile();
+    }
+    time_t getLastWrite(void)
+    {
+        return 0;
+    }
+    File filePointer(void)
+    {
+        return File();
+    }
+
+  private:
+    memFS &_fs;
+    memData_t _data;
+    size_t _position;
+    bool _bOpen;
+};
+
+class memFS : public flxIFileSystem
+{
+  public:
+    memFS() : frozen{false}, tornWrite{0}, nTorn{0}
+    {
+    }
+
+    flxFSFile open(const char *name, flxFileOpenMode_t mode, bool create = false)
+    {
+        flxFSFile theFile;
+        auto it = files.find(name);
+
+        if (mode == kFileRead)
+        {
+            if (it != files.end())
+                theFile.setIFile(std::make_shared<memFile>(*this, it->second));
+            return theFile;
+        }
+        if (frozen || (it == files.end() && !create))
+            return theFile;
+
+        // write truncates, append keeps the data
+        if (it == files.end() || mode == kFileWrite)
+            files[name] = std::make_shared<std::vector<uint8_t>>();
+
+        theFile.setIFile(std::make_shared<memFile>(*this, files[name]));
+        return theFile;
+    }
+    bool exists(const char *name)
+    {
+        return files.count(name) > 0;
+    }
+    bool remove(const char *name)
+    {
+        return !frozen && files.erase(name) > 0;
+    }
+    bool rename(const char *nameFrom, const char *nameTo)
+    {
+        auto it = files.find(nameFrom);
+        if (frozen || it == files.end())
+            return false;
+        files[nameTo] = it->second;
+        files.erase(nameFrom);
+        return true;
+    }
+    bool mkdir(const char *path)
+    {
+        return true;
+    }
+    bool rmdir(const char *path)
+    {
+        return true;
+    }
+    uint64_t size(void)
+    {
+        return 0;
+    }
+    const char *type(void)
+    {
+        return "memory";
+    }
+    bool enabled(void)
+    {
+        return true;
+    }
+
+    size_t fileSize(const char *name)
+    {
+        auto it = files.find(name);
+        return it == files.end() ? 0 : it->second->size();
+    }
+
+    std::map<std::string, memData_t> files;
+    bool frozen;
+    uint32_t tornWrite;
+    uint32_t nTorn;
+};
+
+size_t memFile::write(const uint8_t *buf, size_t size)
+{
+    if (_fs.frozen)
+        return 0;
+
+    // the spill file is the one with records - the position file is written in one piece
+    if (_fs.tornWrite > 0 && size > 1 && --_fs.tornWrite == 0)
+    {
+        size /= 2;
+        _fs.nTorn++;
+    }
+    _data->insert(_data->end(), buf, buf + size);
+    return size;
+}
+
+//-------------------------------------------------------------------------------------
+// The fake network link. It drops after a random number of sends - that send fails - and comes back
+// after a random time, as a new session. A power loss can be set to happen at a send.
+//
+// Messages are "seq:run:version:" and filler. A dictionary is "D:run:version". The destination keeps the
+// last dictionary received in the session.
+
+class fakeNetwork : public flxIOutboxSender
+{
+  public:
+    fakeNetwork(memFS &fs)
+        : up{true}, dropAfter{0}, powerFailAfter{0}, session{0}, nContexts{0}, nWrongContext{0}, _fs{fs}, _msUp{0},
+          _contextRun{0}, _contextVersion{0}
+    {
+    }
+
+    bool outboxReady(void)
+    {
+        if (!up && _msUp != 0 && (int32_t)(millis() - _msUp) >= 0)
+            connect();
+
+        return up && !_fs.frozen;
+    }
+
+    // link up - a new session, the destination has no dictionary
+    void connect(void)
+    {
+        up = true;
+        _msUp = 0;
+        _contextRun = 0;
+        session++;
+    }
+
+    bool outboxSend(const char *message, size_t length, const char *route)
+    {
+        if (!up || _fs.frozen)
+            return false;
+
+        if (dropAfter > 0 && --dropAfter == 0)
+        {
+            drop(dropTime);
+            return false;
+        }
+
+        if (message[0] == 'D')
+        {
+            sscanf(message, "D:%u:%u", &_contextRun, &_contextVersion);
+            nContexts++;
+            return true;
+        }
+
+        uint32_t seq, run, version;
+        sscanf(message, "%u:%u:%u:", &seq, &run, &version);
+        received.push_back(seq);
+
+        if (run != _contextRun || version > _contextVersion)
+            nWrongContext++;
+
+        // the route and the message length are stored with the message when spilled
+        char szRoute[16];
+        snprintf(szRoute, sizeof(szRoute), "t%u", seq % 4);
+        if (strcmp(route, szRoute) != 0 || length != messageLength(seq))
+            nCorrupt++;
+
+        if (powerFailAfter > 0 && --powerFailAfter == 0)
+            _fs.frozen = true;
+
+        return true;
+    }
+
+    // link down until the given time from now - 0 is until up() is called
+    void drop(uint32_t msDown)
+    {
+        up = false;
+        _msUp = msDown ? millis() + msDown : 0;
+    }
+
+    static size_t messageLength(uint32_t seq)
+    {
+        return 24 + (seq * 37) % 300;
+    }
+
+    bool up;
+    uint32_t dropAfter;
+    uint32_t dropTime = 0;
+    uint32_t powerFailAfter;
+    uint32_t session;
+    std::vector<uint32_t> received;
+    uint32_t nCorrupt = 0;
+    uint32_t nContexts;
+    uint32_t nWrongContext;
+
+  private:
+    memFS &_fs;
+    uint32_t _msUp;
+    uint32_t _contextRun;
+    uint32_t _contextVersion;
+};
+
+//-------------------------------------------------------------------------------------
+// A run of a scenario - the outbox, restarts, and the messages logged
+
+#define kSimDrainPeriod kOutboxDrainPeriod
+
+class simRun
+{
+  public:
+    simRun() : network{fs}, nLogged{0}, nLostRestart{0}, nDropped{0}, _run{0}, _version{0}, _session{0}
+    {
+        simMillis = 0;
+        start();
+    }
+
+    // start up - a new run, with a new dictionary
+    void start(void)
+    {
+        outbox.reset(new flxOutbox(&network));
+        outbox->setFileSystem(&fs, "sim");
+
+        _run++;
+        _version = 0;
+        setContext();
+    }
+
+    // restart the device - what's in memory is lost, and it's a new session
+    void restart(void)
+    {
+        nLostRestart += outbox->depth() - outbox->spilled();
+        nDropped += outbox->dropped();
+        outbox.reset();
+        fs.frozen = false;
+        if (network.up)
+            network.connect();
+        start();
+    }
+
+    void log(void)
+    {
+        if (nLogged > 0 && nLogged % 150 == 0)
+        {
+            _version++;
+            setContext();
+        }
+
+        size_t length = fakeNetwork::messageLength(nLogged);
+        std::string message(length, 'x');
+        int n = snprintf(&message[0], length, "%08u:%03u:%03u:", nLogged, _run, _version);
+        message[n] = 'x';
+
+        char szRoute[16];
+        snprintf(szRoute, sizeof(szRoute), "t%u", nLogged % 4);
+        outbox->enqueue((const uint8_t *)message.c_str(), message.length(), szRoute);
+        nLogged++;
+    }
+
+    // a drain job pass, after the job period. A new session gets the dictionary again - the connection
+    // change event does this in the clients.
+    void pass(void)
+    {
+        simMillis += kSimDrainPeriod;
+
+        network.outboxReady();
+        if (network.session != _session)
+        {
+            _session = network.session;
+            outbox->resendContext();
+        }
+        outbox->drain();
+    }
+
+    // run until the outbox is empty - or the limit
+    void drainAll(uint32_t maxPasses = 100000)
+    {
+        for (uint32_t i = 0; i < maxPasses && outbox->depth() > 0; i++)
+            pass();
+    }
+
+    // check every message logged was received once, in order, or is accounted for
+    void verify(const char *szName, uint32_t maxRepeats = 0)
+    {
+        nDropped += outbox->dropped();
+
+        std::vector<uint32_t> counts(nLogged, 0);
+        uint32_t nOutOfOrder = 0;
+        uint32_t nRepeats = 0;
+        int64_t last = -1;
+
+        for (uint32_t seq : network.received)
+        {
+            if (seq >= nLogged)
+                continue;
+            if (counts[seq]++ > 0)
+                nRepeats++;
+            else if ((int64_t)seq < last)
+                nOutOfOrder++;
+            last = std::max(last, (int64_t)seq);
+        }
+
+        uint32_t nMissing = 0;
+        for (uint32_t count : counts)
+            if (count == 0)
+                nMissing++;
+
+        printf("  %-12s %5u logged %5u received %4u repeated %4u dropped %4u lost at restart %4u dictionaries\n",
+               szName, nLogged, (uint32_t)network.received.size(), nRepeats, nDropped, nLostRestart,
+               network.nContexts);
+
+        CHECK(outbox->depth() == 0, "%s - %u messages not sent", szName, outbox->depth());
+        CHECK(network.nCorrupt == 0, "%s - %u messages received with the wrong route or length", szName,
+              network.nCorrupt);
+        CHECK(network.nWrongContext == 0, "%s - %u messages received without their dictionary", szName,
+              network.nWrongContext);
+        CHECK(nRepeats <= maxRepeats, "%s - %u messages received more than once", szName, nRepeats);
+        CHECK(nOutOfOrder == 0, "%s - %u messages received out of order", szName, nOutOfOrder);
+        CHECK(nMissing == nDropped + nLostRestart, "%s - %u messages missing, %u dropped and %u lost at restart",
+              szName, nMissing, nDropped, nLostRestart);
+        CHECK(fs.files.size() == 0, "%s - %zu spill files left with the outbox empty", szName, fs.files.size());
+    }
+
+    memFS fs;
+    fakeNetwork network;
+    std::unique_ptr<flxOutbox> outbox;
+    uint32_t nLogged;
+    uint32_t nLostRestart;
+    uint32_t nDropped;
+
+  private:
+    void setContext(void)
+    {
+        char szContext[32];
+        snprintf(szContext, sizeof(szContext), "D:%03u:%03u", _run, _version);
+        outbox->setContext((const uint8_t *)szContext, strlen(szContext));
+    }
+
+    uint32_t _run;
+    uint32_t _version;
+    uint32_t _session;
+};
+
+//-------------------------------------------------------------------------------------
+// outage - the link is down while messages are logged
+
+static void testOutage(void)
+{
+    simRun sim;
+
+    sim.network.drop(0);
+    for (int i = 0; i < 400; i++)
+    {
+        sim.log();
+        sim.pass();
+    }
+    CHECK(sim.outbox->spilled() == 400 - kOutboxDefaultDepth, "outage - %u spilled, expected %u",
+          sim.outbox->spilled(), 400 - kOutboxDefaultDepth);
+
+    sim.network.connect();
+    sim.drainAll();
+    sim.verify("outage");
+}
+
+//-------------------------------------------------------------------------------------
+// drops - the link drops mid-stream, while logging continues
+
+static void testDrops(uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    simRun sim;
+
+    for (int i = 0; i < 4000; i++)
+    {
+        if (sim.network.up && sim.network.dropAfter == 0)
+        {
+            sim.network.dropAfter = 1 + rng() % 40;
+            sim.network.dropTime = 500 + rng() % 20000;
+        }
+        sim.log();
+        if (rng() % 2)
+            sim.log();
+        sim.pass();
+    }
+    sim.network.dropAfter = 0;
+    sim.drainAll();
+    sim.verify("drops");
+}
+
+//-------------------------------------------------------------------------------------
+// restart - the device restarts during the replay of the spill file
+
+static void testRestart(uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    simRun sim;
+
+    sim.network.drop(0);
+    for (int i = 0; i < 600; i++)
+        sim.log();
+    sim.network.connect();
+
+    for (int nRestarts = 0; nRestarts < 8 && sim.outbox->depth() > 0; nRestarts++)
+    {
+        for (uint32_t n = 1 + rng() % 20; n > 0; n--)
+        {
+            sim.log();
+            sim.pass();
+        }
+        sim.restart();
+    }
+    sim.drainAll();
+    sim.verify("restart");
+}
+
+//-------------------------------------------------------------------------------------
+// power loss - nothing more reaches the card after a send part way through a drain pass. Messages sent
+// in that pass are received again after the restart.
+
+static void testPowerLoss(uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    simRun sim;
+    uint32_t nPowerLoss = 0;
+
+    sim.network.drop(0);
+    for (int i = 0; i < 600; i++)
+        sim.log();
+    sim.network.connect();
+
+    while (nPowerLoss < 8 && sim.outbox->depth() > 0)
+    {
+        for (uint32_t n = rng() % 10; n > 0; n--)
+            sim.pass();
+
+        sim.network.powerFailAfter = 1 + rng() % kOutboxBatchSize;
+        sim.pass();
+        sim.network.powerFailAfter = 0;
+        sim.restart();
+        nPowerLoss++;
+    }
+    sim.drainAll();
+    sim.verify("power loss", nPowerLoss * kOutboxBatchSize);
+}
+
+//-------------------------------------------------------------------------------------
+// torn append - a write to the spill file fails part way. The record is removed, that message is dropped.
+
+static void testTornAppend(uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    simRun sim;
+
+    sim.network.drop(0);
+    for (int i = 0; i < 600; i++)
+    {
+        if (sim.fs.tornWrite == 0 && rng() % 50 == 0)
+            sim.fs.tornWrite = 1 + rng() % 3;
+        sim.log();
+        if (i > 300 && i % 3 == 0)
+        {
+            // replay while spilling
+            sim.network.connect();
+            sim.pass();
+            sim.network.drop(0);
+        }
+    }
+    sim.fs.tornWrite = 0;
+    sim.network.connect();
+    sim.drainAll();
+    sim.verify("torn append");
+
+    CHECK(sim.fs.nTorn > 0, "torn append - no writes failed");
+    CHECK(sim.nDropped == sim.fs.nTorn, "torn append - %u messages dropped for %u failed writes", sim.nDropped,
+          sim.fs.nTorn);
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-s seed]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    printf("outbox - %u messages in memory, %u per drain pass, seed %u\n", kOutboxDefaultDepth, kOutboxBatchSize,
+           seed);
+
+    testOutage();
+    testDrops(seed);
+    testRestart(seed);
+    testPowerLoss(seed);
+    testTornAppend(seed);
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}
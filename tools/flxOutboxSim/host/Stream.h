@@ -0,0 +1,21 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// Host stand-in for the Arduino Stream header - the framework file interface only passes a pointer.
+//
+
+#pragma once
+
+#include <Arduino.h>
+
+class Stream : public Print
+{
+};
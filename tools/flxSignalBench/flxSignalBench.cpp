@@ -0,0 +1,233 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxSignalBench - host benchmark of signal emit (flxCoreSignal). Connects the same slots to a signal and
+// to a copy of the previous signal - a std::vector of std::function slots, each a lambda that calls a
+// member function - and times emit.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -I../../src/core/flux_base -o flxSignalBench flxSignalBench.cpp
+//
+// flxCoreSignal.h has no framework dependencies, so no host stand-ins are needed.
+//
+// Usage:
+//      flxSignalBench [-n emits]
+//
+//      -n emits        emits timed for each slot count (default 1000000)
+//
+// For an int32 signal with 1, 4 and 16 member function slots (not inlined), reports the time per emit
+// and per slot called, and the heap allocations to connect the slots and to emit.
+//
+// Checks - both signals call each slot once per emit, in connection order, and emit makes no
+// allocations. Connecting up to kSignalInlineSlots slots makes no allocations. Exit status is 0 if all
+// checks pass.
+//
+
+#include "flxCoreSignal.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Allocation counting
+
+static uint32_t nAllocs = 0;
+
+void *operator new(size_t size)
+{
+    nAllocs++;
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+//-------------------------------------------------------------------------------------
+static int nFailures = 0;
+
+#define CHECK(cond, ...)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            nFailures++;                                                                                               \
+            printf("    FAIL: ");                                                                                      \
+            printf(__VA_ARGS__);                                                                                       \
+            printf("\n");                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+//-------------------------------------------------------------------------------------
+// The previous signal - each slot is a std::function, holding a lambda that captures the object and the
+// member function.
+
+template <typename TB, typename... ArgT> class legacySignal
+{
+  public:
+    template <typename T> void call(T *inst, void (T::*func)(ArgT...))
+    {
+        connect([=](ArgT... args) { (inst->*func)(args...); });
+    }
+
+    void connect(std::function<void(ArgT &...Values)> const &slot) const
+    {
+        slots_.push_back(slot);
+    }
+
+    void emit(ArgT... args)
+    {
+        for (auto const &it : slots_)
+            it(args...);
+    }
+
+  private:
+    mutable std::vector<std::function<void(ArgT &...Values)>> slots_;
+};
+
+//-------------------------------------------------------------------------------------
+// A slot - counts its calls, and records the order it was called in for the last emit
+
+static uint32_t callOrder = 0;
+
+class benchSlot
+{
+  public:
+    benchSlot() : calls{0}, order{0}, sum{0}
+    {
+    }
+
+    __attribute__((noinline)) void handler(int32_t value)
+    {
+        calls++;
+        order = callOrder++;
+        sum += value;
+    }
+
+    uint32_t calls;
+    uint32_t order;
+    int64_t sum;
+};
+
+//-------------------------------------------------------------------------------------
+typedef struct
+{
+    double nsEmit;
+    uint32_t connectAllocs;
+    uint32_t emitAllocs;
+    bool bCalls;
+    bool bOrder;
+} benchResult_t;
+
+template <typename S> static benchResult_t runSignal(uint32_t nSlots, uint32_t nEmits)
+{
+    benchResult_t result = {};
+    std::vector<benchSlot> slots(nSlots);
+    S theSignal;
+
+    uint32_t startAllocs = nAllocs;
+    for (auto &aSlot : slots)
+        theSignal.call(&aSlot, &benchSlot::handler);
+    result.connectAllocs = nAllocs - startAllocs;
+
+    startAllocs = nAllocs;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nEmits; i++)
+    {
+        callOrder = 0;
+        theSignal.emit((int32_t)i);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    result.emitAllocs = nAllocs - startAllocs;
+
+    result.nsEmit = std::chrono::duration<double, std::nano>(t1 - t0).count() / nEmits;
+
+    result.bCalls = true;
+    result.bOrder = true;
+    for (uint32_t i = 0; i < nSlots; i++)
+    {
+        result.bCalls = result.bCalls && slots[i].calls == nEmits;
+        result.bOrder = result.bOrder && slots[i].order == i;
+    }
+    return result;
+}
+
+static void printResult(const char *szName, uint32_t nSlots, const benchResult_t &result)
+{
+    printf("    %-14s %7.1f ns per emit %6.2f ns per slot %4u allocations to connect %4u to emit\n", szName,
+           result.nsEmit, result.nsEmit / nSlots, result.connectAllocs, result.emitAllocs);
+}
+
+static void benchSlots(uint32_t nSlots, uint32_t nEmits)
+{
+    benchResult_t legacyResult = runSignal<legacySignal<int32_t, int32_t>>(nSlots, nEmits);
+    benchResult_t currentResult = runSignal<flxSignalInt32>(nSlots, nEmits);
+
+    printf("  %2u slots\n", nSlots);
+    printResult("std::function", nSlots, legacyResult);
+    printResult("flxDelegate", nSlots, currentResult);
+
+    CHECK(legacyResult.bCalls && currentResult.bCalls, "%u slots - a slot wasn't called once per emit", nSlots);
+    CHECK(legacyResult.bOrder && currentResult.bOrder, "%u slots - slots weren't called in connection order",
+          nSlots);
+    CHECK(currentResult.emitAllocs == 0, "%u slots - %u allocations in emit", nSlots, currentResult.emitAllocs);
+    CHECK(nSlots > kSignalInlineSlots || currentResult.connectAllocs == 0, "%u slots - %u allocations to connect",
+          nSlots, currentResult.connectAllocs);
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-n emits]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t nEmits = 1000000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            nEmits = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nEmits == 0)
+        nEmits = 1;
+
+    printf("signal emit - int32 signal, %u emits, %d inline slots, %zu byte signal\n", nEmits, kSignalInlineSlots,
+           sizeof(flxSignalInt32));
+
+    for (uint32_t nSlots : {1, 4, 16})
+        benchSlots(nSlots, nEmits);
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}
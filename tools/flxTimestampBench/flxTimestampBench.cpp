@@ -0,0 +1,359 @@
+/*
+ *---------------------------------------------------------------------------------
+ *
+ * Copyright (c) 2022-2024, SparkFun Electronics Inc.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ *---------------------------------------------------------------------------------
+ */
+
+//
+// flxTimestampBench - host test and benchmark of the log entry timestamp formatter (flxTimestampFormatter).
+// Formats timestamps for each timestamp mode with the formatter, and with a copy of the previous logger
+// code - localtime(), strftime() and snprintf() for every entry - and checks and times both.
+//
+// Build (from this directory):
+//      c++ -std=c++17 -O2 -fpermissive -w -I../flxCSVBench/host -I../flxBinaryRoundTrip/host
+//          -I../../src/core/flux_base -I../../src/core/flux_logging -o flxTimestampBench flxTimestampBench.cpp
+//          ../../src/core/flux_logging/flxTimestamp.cpp ../../src/core/flux_base/flxUtils.cpp
+//          ../../src/core/flux_base/flxCoreMsg.cpp
+//
+// The host stand-ins for the Arduino headers are shared with flxBinaryRoundTrip, the mbedtls stand-ins
+// flxUtils.cpp includes with flxCSVBench.
+//
+// Usage:
+//      flxTimestampBench [-n timestamps] [-s seed]
+//
+// The time zone is kClockTimeZoneSparkFun (MST7MDT). Entries are timed with the clock advancing 1 ms per
+// entry, and reported in timestamps per second for each mode.
+//
+// Checks:
+//      match   - the formatter output matches the previous code for the existing modes, with the clock
+//                crossing DST changes and a new year, and making random jumps. The fractional modes
+//                match the ISO8601 modes, with the milli/micro seconds added
+//      zone    - after a time zone change and reset(), the next timestamp has the new offset - the
+//                logger calls reset() on flxEvent::kOnTimeZoneChange
+//
+// Exit status is 0 if all checks pass.
+//
+
+#include "flxCoreLog.h"
+#include "flxTimestamp.h"
+#include "flxUtils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+// The default time zone of flxClock
+#define kBenchTimeZone "MST7MDT,M3.2.0,M11.1.0"
+
+//-------------------------------------------------------------------------------------
+// Host stand-ins for the framework log and the Arduino clock
+
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const char *fmt, ...)
+{
+    return 0;
+}
+int flxLogging::logPrintf(const flxLogLevel_t level, bool newline, const int idFmt, ...)
+{
+    return 0;
+}
+flxLogging &flxLog = flxLogging::get();
+
+static uint32_t simMillis = 0;
+
+unsigned long millis(void)
+{
+    return simMillis;
+}
+unsigned long micros(void)
+{
+    return simMillis * 1000;
+}
+void delay(unsigned long ms)
+{
+    simMillis += ms;
+}
+
+//-------------------------------------------------------------------------------------
+static int nFailures = 0;
+
+#define CHECK(cond, ...)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            nFailures++;                                                                                               \
+            printf("    FAIL: ");                                                                                      \
+            printf(__VA_ARGS__);                                                                                       \
+            printf("\n");                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+//-------------------------------------------------------------------------------------
+static const char *kModeNames[] = {"none",          "millis",     "epoch",         "date time USA",
+                                   "date time",     "ISO8601",    "ISO8601 TZ",    "ISO8601 ms",
+                                   "ISO8601 ms TZ", "ISO8601 us", "ISO8601 us TZ"};
+
+// The mode without a fractional part - the previous code has no fractional modes
+static flxTimestampMode_t wholeSecondMode(flxTimestampMode_t mode)
+{
+    switch (mode)
+    {
+    case flxTimestampISO8601Millis:
+    case flxTimestampISO8601Micros:
+        return flxTimestampISO8601;
+    case flxTimestampISO8601MillisTZ:
+    case flxTimestampISO8601MicrosTZ:
+        return flxTimestampISO8601TZ;
+    default:
+        return mode;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// The previous logger code - flxLogger::get_timestamp(), with the time passed in
+
+static std::string legacyTimestamp(flxTimestampMode_t mode, time_t t_now, uint32_t msUptime)
+{
+    char szBuffer[64];
+
+    memset(szBuffer, '\0', sizeof(szBuffer));
+
+    struct tm *tmLocal = localtime(&t_now);
+    switch (mode)
+    {
+    case flxTimestampMillis:
+        snprintf(szBuffer, sizeof(szBuffer), "%lu", (unsigned long)msUptime);
+        break;
+
+    case flxTimestampEpoch:
+        snprintf(szBuffer, sizeof(szBuffer), "%ld", (long)t_now);
+        break;
+
+    case flxTimestampDateTimeUSA:
+        strftime(szBuffer, sizeof(szBuffer), "%m-%d-%G %T", tmLocal);
+        break;
+
+    case flxTimestampDateTime:
+        strftime(szBuffer, sizeof(szBuffer), "%d-%m-%G %T", tmLocal);
+        break;
+
+    case flxTimestampISO8601:
+    case flxTimestampISO8601TZ:
+        flx_utils::timestampISO8601(t_now, szBuffer, sizeof(szBuffer), mode == flxTimestampISO8601TZ);
+        break;
+
+    case flxTimestampNone:
+    default:
+        break;
+    }
+
+    std::string sBuffer = szBuffer;
+    return sBuffer;
+}
+
+// What the formatter should output - the previous code, with the fractional part added for those modes
+static std::string expectedTimestamp(flxTimestampMode_t mode, const struct timeval &tv, uint32_t msUptime)
+{
+    std::string sExpected = legacyTimestamp(wholeSecondMode(mode), tv.tv_sec, msUptime);
+
+    char szFraction[8];
+    if (mode == flxTimestampISO8601Millis || mode == flxTimestampISO8601MillisTZ)
+        snprintf(szFraction, sizeof(szFraction), ".%03ld", (long)tv.tv_usec / 1000);
+    else if (mode == flxTimestampISO8601Micros || mode == flxTimestampISO8601MicrosTZ)
+        snprintf(szFraction, sizeof(szFraction), ".%06ld", (long)tv.tv_usec);
+    else
+        return sExpected;
+
+    // the fraction goes after the seconds, before any time zone suffix
+    sExpected.insert(19, szFraction);
+    return sExpected;
+}
+
+//-------------------------------------------------------------------------------------
+// Output checks - walk the clock over the given span, with random steps
+
+static void checkSpan(const char *szName, time_t tStart, uint32_t nSteps, uint32_t maxStep, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<uint32_t> step(1, maxStep);
+    std::uniform_int_distribution<uint32_t> usec(0, 999999);
+
+    uint32_t nMismatch = 0;
+    char szBuffer[kTimestampBufferSize];
+
+    for (int iMode = flxTimestampMillis; iMode < flxTimestampModeCount; iMode++)
+    {
+        flxTimestampMode_t mode = (flxTimestampMode_t)iMode;
+        flxTimestampFormatter theFormatter;
+
+        struct timeval tv = {tStart, 0};
+        uint32_t msUptime = 0;
+
+        for (uint32_t i = 0; i < nSteps; i++)
+        {
+            uint32_t delta = step(rng);
+            tv.tv_sec += delta;
+            tv.tv_usec = usec(rng);
+            msUptime += delta * 1000;
+
+            size_t len = theFormatter.format(mode, tv, msUptime, szBuffer, sizeof(szBuffer));
+            std::string sExpected = expectedTimestamp(mode, tv, msUptime);
+
+            if (len != sExpected.length() || sExpected != szBuffer)
+            {
+                if (nMismatch++ == 0)
+                    printf("    %s %s - \"%s\", expected \"%s\"\n", szName, kModeNames[mode], szBuffer,
+                           sExpected.c_str());
+            }
+        }
+    }
+    CHECK(nMismatch == 0, "%s - %u timestamps differ from the previous code", szName, nMismatch);
+}
+
+// A time zone change - the formatter has the old offset cached until reset() is called
+static void checkZoneChange(void)
+{
+    char szBuffer[kTimestampBufferSize];
+    flxTimestampFormatter theFormatter;
+
+    struct timeval tv = {1718452800, 0}; // 2024-06-15 12:00:00 UTC, MDT
+
+    theFormatter.format(flxTimestampISO8601TZ, tv, 0, szBuffer, sizeof(szBuffer));
+    std::string sBefore = szBuffer;
+
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+
+    tv.tv_sec++;
+    theFormatter.reset();
+    theFormatter.format(flxTimestampISO8601TZ, tv, 0, szBuffer, sizeof(szBuffer));
+    std::string sExpected = legacyTimestamp(flxTimestampISO8601TZ, tv.tv_sec, 0);
+
+    CHECK(sExpected == szBuffer, "zone - \"%s\" after the time zone change, expected \"%s\"", szBuffer,
+          sExpected.c_str());
+    CHECK(sBefore != szBuffer, "zone - the time zone change had no effect");
+
+    setenv("TZ", kBenchTimeZone, 1);
+    tzset();
+}
+
+//-------------------------------------------------------------------------------------
+// Throughput - the clock advances 1 ms per entry
+
+static double timeLegacy(flxTimestampMode_t mode, time_t tStart, uint32_t nTimestamps, size_t &total)
+{
+    struct timeval tv = {tStart, 0};
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nTimestamps; i++)
+    {
+        total += legacyTimestamp(mode, tv.tv_sec, i).length();
+        tv.tv_usec += 1000;
+        if (tv.tv_usec >= 1000000)
+        {
+            tv.tv_usec = 0;
+            tv.tv_sec++;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    return nTimestamps / std::chrono::duration<double>(t1 - t0).count();
+}
+
+static double timeFormatter(flxTimestampMode_t mode, time_t tStart, uint32_t nTimestamps, size_t &total)
+{
+    flxTimestampFormatter theFormatter;
+    char szBuffer[kTimestampBufferSize];
+    struct timeval tv = {tStart, 0};
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nTimestamps; i++)
+    {
+        total += theFormatter.format(mode, tv, i, szBuffer, sizeof(szBuffer));
+        tv.tv_usec += 1000;
+        if (tv.tv_usec >= 1000000)
+        {
+            tv.tv_usec = 0;
+            tv.tv_sec++;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    return nTimestamps / std::chrono::duration<double>(t1 - t0).count();
+}
+
+//-------------------------------------------------------------------------------------
+static void usage(const char *szName)
+{
+    fprintf(stderr, "Usage: %s [-n timestamps] [-s seed]\n", szName);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t nTimestamps = 1000000;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            nTimestamps = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], nullptr, 0);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nTimestamps == 0)
+        nTimestamps = 1;
+
+    setenv("TZ", kBenchTimeZone, 1);
+    tzset();
+
+    std::mt19937 rng(seed);
+
+    printf("timestamps - TZ %s, %u timestamps per mode, seed %u\n", kBenchTimeZone, nTimestamps, seed);
+
+    // DST starts 2024-03-10 09:00 UTC, ends 2024-11-03 08:00 UTC
+    checkSpan("dst start", 1710054000, 10000, 3, rng);
+    checkSpan("dst end", 1730613600, 10000, 3, rng);
+    checkSpan("new year", 1735689600 - 3600, 10000, 2, rng);
+    checkSpan("jumps", 1700000000, 10000, 100000, rng);
+    checkZoneChange();
+
+    printf("  %-14s %12s %12s\n", "mode", "previous/s", "formatter/s");
+
+    size_t total = 0;
+    time_t tStart = 1718452800;
+
+    for (int iMode = flxTimestampMillis; iMode < flxTimestampModeCount; iMode++)
+    {
+        flxTimestampMode_t mode = (flxTimestampMode_t)iMode;
+
+        double rateFormatter = timeFormatter(mode, tStart, nTimestamps, total);
+
+        if (mode == wholeSecondMode(mode))
+            printf("  %-14s %11.1fM %11.1fM\n", kModeNames[mode], timeLegacy(mode, tStart, nTimestamps, total) / 1e6,
+                   rateFormatter / 1e6);
+        else
+            printf("  %-14s %12s %11.1fM\n", kModeNames[mode], "-", rateFormatter / 1e6);
+    }
+
+    // keep the output lengths live
+    if (total == 0)
+        printf("no output\n");
+
+    if (nFailures)
+        printf("FAILED - %d checks\n", nFailures);
+    else
+        printf("all checks passed\n");
+
+    return nFailures ? 1 : 0;
+}